@@ -1,11 +1,23 @@
 //
 // Created by Derek Roberts on 2019-06-27.
 //
+// Builds a skeleton: by default a straight chain of -length joints, or
+// with -template a whole hierarchy from a skeleton template (see
+// trackerCore/skeleton.h), optionally placed on the joints of a tracked
+// take with -fromTrajectory. A chain placed that way has one joint per
+// tracked joint.
+//
+// Every joint, IK effector and IK handle is created through one
+// MDagModifier, so the whole skeleton undoes and redoes in one step and
+// nothing depends on node names already in the scene.
+//
 #include <vector>
 #include <string>
 
 #include <maya/MIOStream.h>
 #include <maya/MString.h>
+#include <maya/MStringArray.h>
+#include <maya/MGlobal.h>
 #include <maya/MFnPlugin.h>
 #include <maya/MPxCommand.h>
 #include <maya/MDagPath.h>
@@ -13,13 +25,18 @@
 #include <maya/MSelectionList.h>
 #include <maya/MVector.h>
 #include <maya/MFnIkJoint.h>
-#include <maya/MFnIkEffector.h>
+#include <maya/MFnIkHandle.h>
+#include <maya/MFnDependencyNode.h>
+#include <maya/MPlug.h>
 #include <maya/MAngle.h>
 #include <maya/MArgParser.h>
 #include <maya/MArgList.h>
 #include <maya/MEulerRotation.h>
 #include <maya/MSyntax.h>
 
+#include "skeleton.h"
+#include "trajectory.h"
+
 class jointCreateCommand: public MPxCommand
 {
     public:
@@ -34,14 +51,42 @@ class jointCreateCommand: public MPxCommand
         static void* creator();
 
     private:
+        MStatus loadSkeleton();
+        MStatus placeOnTrajectory();
+        MStatus createNodes();
+        MStatus createIkHandle(const SkeletonIkHandle& handle);
         const char *kLengthFlag = "-l";
         const char *kLengthLongFlag = "-length";
+        const char *kTemplateFlag = "-t";
+        const char *kTemplateLongFlag = "-template";
+        const char *kFromTrajectoryFlag = "-ft";
+        const char *kFromTrajectoryLongFlag = "-fromTrajectory";
+        const char *kFrameFlag = "-f";
+        const char *kFrameLongFlag = "-frame";
+        const char *kPrefixFlag = "-p";
+        const char *kPrefixLongFlag = "-prefix";
         unsigned int m_length = 3;
-        unsigned int m_defaultLength = 3;
         double m_jointOrientation = 20;
         double m_jointDistance = 0.2;
+
+        //-template is a template file, or "humanoid" for the built in one.
+        MString m_templatePath;
+        //-fromTrajectory moves the template's tracked joints to where the
+        //trajectory has them on -frame, by default its first frame. Without
+        //a template it builds a chain through every tracked joint.
+        MString m_trajectoryPath;
+        bool m_hasFrame = false;
+        double m_frame = 0;
+        //Put in front of every node name, to build several rigs side by side.
+        MString m_prefix;
+
+        SkeletonTemplate m_skeleton;
+        std::vector<Vec3> m_worldPositions;
         MDagModifier m_dagModifier;
         std::vector<MObject> m_jointObjects;
+        std::vector<MObject> m_effectorObjects;
+        std::vector<MObject> m_ikHandleObjects;
+        MObject m_solver;
 };
  jointCreateCommand::jointCreateCommand() {}
  jointCreateCommand::~jointCreateCommand() {}
@@ -58,7 +103,8 @@ bool jointCreateCommand::isUndoable() const
 
 MStatus jointCreateCommand::undoIt()
 {
-    return MS::kSuccess;
+    //Connections made by the function sets in redoIt() go with the nodes.
+    return m_dagModifier.undoIt();
 }
 
 MStatus jointCreateCommand::parseArgs(const MArgList& args)
@@ -66,15 +112,30 @@ MStatus jointCreateCommand::parseArgs(const MArgList& args)
      //Get args from Maya command window
     MStatus status;
     MArgParser argData(cmdSyntax(), args, &status);
-    unsigned int flagValue;
+    if(!status)
+        return status;
 
-    if(args.asString(0) == "-l")
+    if(argData.isFlagSet(kLengthFlag))
     {
-        //Take user argument and store it as m_length
-        flagValue = args.asInt(1);
-        if(flagValue > m_defaultLength)
-            m_length = flagValue;
+        unsigned int flagValue;
+        argData.getFlagArgument(kLengthFlag, 0, flagValue);
+        if(flagValue < 2)
+        {
+            MGlobal::displayError("createJoint: -length needs at least 2 joints");
+            return MS::kFailure;
+        }
+        m_length = flagValue;
     }
+
+    if(argData.isFlagSet(kTemplateFlag))
+        argData.getFlagArgument(kTemplateFlag, 0, m_templatePath);
+    if(argData.isFlagSet(kFromTrajectoryFlag))
+        argData.getFlagArgument(kFromTrajectoryFlag, 0, m_trajectoryPath);
+    m_hasFrame = argData.isFlagSet(kFrameFlag);
+    if(m_hasFrame)
+        argData.getFlagArgument(kFrameFlag, 0, m_frame);
+    if(argData.isFlagSet(kPrefixFlag))
+        argData.getFlagArgument(kPrefixFlag, 0, m_prefix);
     return status;
 }
 
@@ -85,46 +146,215 @@ MStatus jointCreateCommand::doIt(const MArgList &args)
         return status;
     }
 
-    for(unsigned int i = 0; i < m_length; i++)
+    status = loadSkeleton();
+    if(!status)
+        return status;
+
+    status = createNodes();
+    if(!status)
+        return status;
+
+    status = redoIt();
+    if(!status)
+        return status;
+
+    MStringArray names;
+    for(const MObject& joint : m_jointObjects)
+        names.append(MFnDependencyNode(joint).name());
+    setResult(names);
+    return MS::kSuccess;
+}
+
+MStatus jointCreateCommand::loadSkeleton()
+{
+    std::string error;
+    if(m_templatePath == "humanoid")
+        m_skeleton = humanoidSkeleton();
+    else if(m_templatePath.length() > 0)
     {
-        if(i == 0) {
-            //First joint has no parent "MObject::kNullObj"
-            MObject newJointObj = m_dagModifier.createNode("joint", MObject::kNullObj, &status);
-            m_jointObjects.push_back(newJointObj);
-        }
-        else {
-            MObject newJointObj = m_dagModifier.createNode("joint", m_jointObjects[i-1], &status);
-            m_jointObjects.push_back(newJointObj);
+        if(!readSkeletonTemplate(m_templatePath.asChar(), m_skeleton, error))
+        {
+            MGlobal::displayError(MString("createJoint: ") + error.c_str());
+            return MS::kFailure;
         }
     }
-    return redoIt();
+    else
+        m_skeleton = chainSkeleton(m_length, m_jointDistance, m_jointOrientation);
+
+    if(m_trajectoryPath.length() > 0)
+        return placeOnTrajectory();
+
+    placeSkeleton(m_skeleton, std::vector<Vec3>(), m_worldPositions);
+    return MS::kSuccess;
+}
+
+MStatus jointCreateCommand::placeOnTrajectory()
+{
+    TrajectoryReader trajectory;
+    if(!trajectory.open(m_trajectoryPath.asChar()))
+    {
+        MGlobal::displayError(MString("createJoint: ") + trajectory.error().c_str());
+        return MS::kFailure;
+    }
+    if(trajectory.numFrames() == 0 || trajectory.numJoints() == 0)
+    {
+        MGlobal::displayError(MString("createJoint: ") + m_trajectoryPath + " has no tracked frames");
+        return MS::kFailure;
+    }
+
+    double frame = m_hasFrame ? m_frame - trajectory.startFrame() : 0;
+    if(frame < 0 || frame >= trajectory.numFrames())
+    {
+        MGlobal::displayError(MString("createJoint: -frame is outside ") + m_trajectoryPath);
+        return MS::kFailure;
+    }
+
+    std::vector<Vec3> tracked(trajectory.numJoints());
+    for(unsigned j = 0; j < trajectory.numJoints(); j++)
+        tracked[j] = trajectory.position(j, (unsigned)frame);
+
+    //Without a template the chain gets one joint per tracked joint, in
+    //the take's order. A template only knows where to go through its
+    //track entries.
+    if(m_templatePath.length() == 0)
+        m_skeleton = chainSkeleton(trajectory.numJoints(), m_jointDistance, m_jointOrientation, true);
+    unsigned numTracked = numTrackedJoints(m_skeleton);
+    if(numTracked == 0)
+    {
+        MGlobal::displayError(MString("createJoint: ") + m_templatePath
+                              + " has no tracked joints, add track <joint> to the joints to place with -fromTrajectory");
+        return MS::kFailure;
+    }
+
+    //Joints the take does not have, or lost on that frame, keep the
+    //template's offsets from their parents.
+    unsigned placed = placeSkeleton(m_skeleton, tracked, m_worldPositions);
+    if(placed < numTracked)
+        MGlobal::displayWarning(MString("createJoint: ") + (int)(numTracked - placed) + " of " + (int)numTracked
+                                + " tracked joints have no position on that frame");
+    return MS::kSuccess;
+}
+
+MStatus jointCreateCommand::createNodes()
+{
+    MStatus status;
+    for(const SkeletonJoint& joint : m_skeleton.joints)
+    {
+        //Roots have no parent "MObject::kNullObj"
+        MObject parent = joint.parent >= 0 ? m_jointObjects[joint.parent] : MObject::kNullObj;
+        MObject newJointObj = m_dagModifier.createNode("joint", parent, &status);
+        if(!status)
+            return status;
+        m_dagModifier.renameNode(newJointObj, m_prefix + joint.name.c_str());
+        m_jointObjects.push_back(newJointObj);
+    }
+
+    if(m_skeleton.ikHandles.empty())
+        return status;
+
+    //IK handles share the scene's rotate plane solver, made here if the
+    //scene does not have one yet.
+    MSelectionList solverList;
+    if(!solverList.add("ikRPsolver") || !solverList.getDependNode(0, m_solver))
+    {
+        MDGModifier& dgModifier = m_dagModifier;
+        m_solver = dgModifier.createNode("ikRPsolver", &status);
+        if(!status)
+            return status;
+        m_dagModifier.renameNode(m_solver, "ikRPsolver");
+    }
+
+    for(const SkeletonIkHandle& handle : m_skeleton.ikHandles)
+    {
+        status = createIkHandle(handle);
+        if(!status)
+            return status;
+    }
+    return status;
+}
+
+MStatus jointCreateCommand::createIkHandle(const SkeletonIkHandle& handle)
+{
+    MStatus status;
+
+    //The effector sits next to the end joint, under its parent, and
+    //follows its translate, the same as with the ikHandle command.
+    const SkeletonJoint& endJoint = m_skeleton.joints[handle.endJoint];
+    MObject effector = m_dagModifier.createNode("ikEffector", m_jointObjects[endJoint.parent], &status);
+    if(!status)
+        return status;
+    m_dagModifier.renameNode(effector, m_prefix + handle.name.c_str() + "Effector");
+
+    MPlug jointTranslate = MFnDependencyNode(m_jointObjects[handle.endJoint]).findPlug("translate", false, &status);
+    if(!status)
+        return status;
+    MPlug effectorTranslate = MFnDependencyNode(effector).findPlug("translate", false, &status);
+    if(!status)
+        return status;
+    status = m_dagModifier.connect(jointTranslate, effectorTranslate);
+    if(!status)
+        return status;
+
+    MObject ikHandle = m_dagModifier.createNode("ikHandle", MObject::kNullObj, &status);
+    if(!status)
+        return status;
+    m_dagModifier.renameNode(ikHandle, m_prefix + handle.name.c_str());
+
+    m_effectorObjects.push_back(effector);
+    m_ikHandleObjects.push_back(ikHandle);
+    return status;
 }
 
 MStatus jointCreateCommand::redoIt()
 {
-    MFnIkJoint jointFn;
+    MStatus status = m_dagModifier.doIt();
+    if(!status)
+        return status;
 
+    //The joints' values and the IK wiring are set through function sets,
+    //outside the modifier, so they are set again on every redo.
+    MFnIkJoint jointFn;
     for(unsigned long i = 0; i < m_jointObjects.size(); i++)
     {
+        const SkeletonJoint& joint = m_skeleton.joints[i];
+
         //Set Rotation
         jointFn.setObject(m_jointObjects[i]);
-        MAngle rotationAngle(m_jointOrientation, MAngle::kDegrees);
-        MEulerRotation eulerRotation(rotationAngle.asRadians(), 0, 0, MEulerRotation::kXYZ);
+        MEulerRotation eulerRotation(MAngle(joint.orient.x, MAngle::kDegrees).asRadians(),
+                                     MAngle(joint.orient.y, MAngle::kDegrees).asRadians(),
+                                     MAngle(joint.orient.z, MAngle::kDegrees).asRadians(), MEulerRotation::kXYZ);
         jointFn.setOrientation(eulerRotation);
 
         //Set Position/Translation
-        MVector translation(0, m_jointDistance, 0);
+        MVector translation(joint.translation.x, joint.translation.y, joint.translation.z);
         jointFn.setTranslation(translation, MSpace::kTransform);
-
     }
 
-    //Create an IKHandle with a MEL command
-    MString endEffectorArgument;
-    endEffectorArgument.set(m_jointObjects.size());
-    MString command = "ikHandle -sj joint1 -ee joint" + endEffectorArgument;
-    m_dagModifier.commandToExecute(command);
+    for(unsigned long i = 0; i < m_ikHandleObjects.size(); i++)
+    {
+        const SkeletonIkHandle& handle = m_skeleton.ikHandles[i];
+        MDagPath startJoint, effector;
+        status = MDagPath::getAPathTo(m_jointObjects[handle.startJoint], startJoint);
+        if(!status)
+            return status;
+        status = MDagPath::getAPathTo(m_effectorObjects[i], effector);
+        if(!status)
+            return status;
 
-    m_dagModifier.doIt();
+        //The handle goes on the end joint before it is hooked up, so the
+        //first solve leaves the chain where it is.
+        MFnIkHandle handleFn(m_ikHandleObjects[i], &status);
+        if(!status)
+            return status;
+        const Vec3& end = m_worldPositions[handle.endJoint];
+        handleFn.setTranslation(MVector(end.x, end.y, end.z), MSpace::kTransform);
+        status = handleFn.setStartJointAndEffector(startJoint, effector);
+        if(!status)
+            return status;
+        status = handleFn.setSolver(m_solver);
+        if(!status)
+            return status;
+    }
     return MS::kSuccess;
 }
 
@@ -132,6 +362,10 @@ MSyntax jointCreateCommand::cmdSyntax()
 {
     MSyntax syntax;
     syntax.addFlag(kLengthFlag, kLengthLongFlag, MSyntax::kUnsigned);
+    syntax.addFlag(kTemplateFlag, kTemplateLongFlag, MSyntax::kString);
+    syntax.addFlag(kFromTrajectoryFlag, kFromTrajectoryLongFlag, MSyntax::kString);
+    syntax.addFlag(kFrameFlag, kFrameLongFlag, MSyntax::kDouble);
+    syntax.addFlag(kPrefixFlag, kPrefixLongFlag, MSyntax::kString);
     return syntax;
 }
 
@@ -158,4 +392,4 @@ MStatus uninitializePlugin(MObject obj)
         stat.perror("deregisterCommand");
     }
     return stat;
-}
\ No newline at end of file
+}
@@ -0,0 +1,200 @@
+//
+// Collects tracked joint positions for a whole frame range in memory and
+// writes them out in one go as translateX/Y/Z anim curves.
+//
+#include "animCurveWriter.h"
+
+#include <maya/MDGContext.h>
+#include <maya/MDGContextGuard.h>
+#include <maya/MFnAnimCurve.h>
+#include <maya/MFnDependencyNode.h>
+#include <maya/MFnMatrixData.h>
+#include <maya/MMatrix.h>
+#include <maya/MPlug.h>
+#include <maya/MPlugArray.h>
+
+namespace
+{
+    const char* kTranslateAttributes[] = {"translateX", "translateY", "translateZ"};
+}
+
+MStatus AnimCurveWriter::setTargets(const MDagPathArray& targets)
+{
+    MStatus status;
+    m_tracks.clear();
+    m_tracks.resize(targets.length());
+
+    for(unsigned i = 0; i < targets.length(); i++)
+    {
+        m_tracks[i].path = targets[i];
+        if(targets[i].length() <= 1)
+            continue;
+
+        MFnDependencyNode targetFn(targets[i].node(), &status);
+        if(!status)
+            return status;
+        MPlug parentInverse = targetFn.findPlug("parentInverseMatrix", false, &status);
+        if(!status)
+            return status;
+        m_tracks[i].parentInverse = parentInverse.elementByLogicalIndex(targets[i].instanceNumber(), &status);
+        if(!status)
+            return status;
+    }
+    return status;
+}
+
+unsigned AnimCurveWriter::numTargets() const
+{
+    return (unsigned)m_tracks.size();
+}
+
+void AnimCurveWriter::addKey(unsigned target, const MTime& time, const MPoint& worldPosition)
+{
+    Track& track = m_tracks[target];
+    MPoint local = worldPosition;
+    if(!track.parentInverse.isNull())
+    {
+        //The parent can move over the range, so its matrix is read at the
+        //key's time without moving the timeline.
+        MObject data;
+        {
+            MDGContext context(time);
+            MDGContextGuard contextGuard(context);
+            data = track.parentInverse.asMObject();
+        }
+        MStatus status;
+        MFnMatrixData matrixData(data, &status);
+        if(status)
+            local = worldPosition * matrixData.matrix();
+    }
+
+    track.times.append(time);
+    track.values[0].append(local.x);
+    track.values[1].append(local.y);
+    track.values[2].append(local.z);
+}
+
+unsigned AnimCurveWriter::numKeys() const
+{
+    unsigned keys = 0;
+    for(const Track& track : m_tracks)
+        keys += track.times.length() * 3;
+    return keys;
+}
+
+MStatus AnimCurveWriter::write(MDGModifier& modifier)
+{
+    MStatus status;
+    for(const Track& track : m_tracks)
+    {
+        if(track.times.length() == 0)
+            continue;
+
+        //A jointTracker node from jointRig -node drives the whole
+        //translate, which has to let go before its axes can be keyed.
+        MFnDependencyNode targetFn(track.path.node(), &status);
+        if(!status)
+            return status;
+        MPlug translate = targetFn.findPlug("translate", false, &status);
+        if(!status)
+            return status;
+        MPlugArray sources;
+        bool drivenAsCompound = translate.connectedTo(sources, true, false) && sources.length() > 0;
+        if(drivenAsCompound)
+        {
+            status = modifier.disconnect(sources[0], translate);
+            if(!status)
+                return status;
+        }
+
+        for(unsigned axis = 0; axis < 3; axis++)
+        {
+            status = writeAxis(modifier, track, axis, drivenAsCompound);
+            if(!status)
+                return status;
+        }
+    }
+    return status;
+}
+
+MStatus AnimCurveWriter::writeAxis(MDGModifier& modifier, const Track& track, unsigned axis, bool drivenAsCompound)
+{
+    MStatus status;
+    MFnDependencyNode targetFn(track.path.node(), &status);
+    if(!status)
+        return status;
+
+    MPlug plug = targetFn.findPlug(kTranslateAttributes[axis], false, &status);
+    if(!status)
+        return status;
+
+    const MTime& firstTime = track.times[0];
+    const MTime& lastTime = track.times[track.times.length() - 1];
+
+    MTimeArray times;
+    MDoubleArray values;
+
+    //Swap out any curve already driving the plug, keeping the keys
+    //that fall outside the tracked range. Any other source is simply
+    //disconnected.
+    MFnAnimCurve oldCurve;
+    MPlugArray sources;
+    bool hasOldCurve = false;
+    if(!drivenAsCompound && plug.connectedTo(sources, true, false) && sources.length() > 0)
+    {
+        hasOldCurve = sources[0].node().hasFn(MFn::kAnimCurve);
+        if(hasOldCurve)
+            oldCurve.setObject(sources[0].node());
+        status = modifier.disconnect(sources[0], plug);
+        if(!status)
+            return status;
+    }
+
+    unsigned oldKey = 0;
+    unsigned numOldKeys = hasOldCurve ? oldCurve.numKeys() : 0;
+    for(; oldKey < numOldKeys && oldCurve.time(oldKey) < firstTime; oldKey++)
+    {
+        times.append(oldCurve.time(oldKey));
+        values.append(oldCurve.value(oldKey));
+    }
+    for(unsigned key = 0; key < track.times.length(); key++)
+    {
+        times.append(track.times[key]);
+        values.append(track.values[axis][key]);
+    }
+    for(; oldKey < numOldKeys; oldKey++)
+    {
+        if(oldCurve.time(oldKey) > lastTime)
+        {
+            times.append(oldCurve.time(oldKey));
+            values.append(oldCurve.value(oldKey));
+        }
+    }
+
+    if(hasOldCurve)
+    {
+        status = modifier.deleteNode(oldCurve.object());
+        if(!status)
+            return status;
+    }
+
+    MFnAnimCurve curve;
+    curve.create(MFnAnimCurve::kAnimCurveTL, &modifier, &status);
+    if(!status)
+        return status;
+
+    status = curve.addKeys(&times, &values);
+    if(!status)
+        return status;
+
+    MPlug output = curve.findPlug("output", false, &status);
+    if(!status)
+        return status;
+
+    return modifier.connect(output, plug);
+}
+
+void AnimCurveWriter::clear()
+{
+    m_tracks.clear();
+}
@@ -0,0 +1,64 @@
+//
+// Collects tracked joint positions for a whole frame range in memory and
+// writes them out in one go as translateX/Y/Z anim curves.
+//
+// All node creation, connection and deletion goes through the MDGModifier
+// handed to write(), so undoing the modifier removes the new curves and
+// restores whatever animation the targets had before, along with any
+// other connection, such as a jointTracker node's, the keys replaced.
+//
+#ifndef JOINTRIGANIM_ANIMCURVEWRITER_H
+#define JOINTRIGANIM_ANIMCURVEWRITER_H
+
+#include <maya/MStatus.h>
+#include <maya/MDagPath.h>
+#include <maya/MDagPathArray.h>
+#include <maya/MDGModifier.h>
+#include <maya/MPlug.h>
+#include <maya/MPoint.h>
+#include <maya/MTime.h>
+#include <maya/MTimeArray.h>
+#include <maya/MDoubleArray.h>
+
+#include <vector>
+
+class AnimCurveWriter
+{
+public:
+    //One target transform per tracked joint.
+    MStatus setTargets(const MDagPathArray& targets);
+    unsigned numTargets() const;
+
+    //Records the world space position of a target at the given time, in
+    //its parent's space at that time, so targets under animated parents
+    //key correctly. Times must be added in increasing order.
+    void addKey(unsigned target, const MTime& time, const MPoint& worldPosition);
+    unsigned numKeys() const;
+
+    //Queues a new translate curve per axis and target on the modifier.
+    //Existing translate curves are replaced, keeping their keys outside
+    //the recorded range. Anything else driving translate or one of its
+    //axes is disconnected.
+    MStatus write(MDGModifier& modifier);
+    void clear();
+
+private:
+    struct Track
+    {
+        MDagPath path;
+        //Positions are recorded in world space and keyed in the parent's
+        //space, evaluated from this plug at each key's time. Null for a
+        //target directly under the world.
+        MPlug parentInverse;
+        MTimeArray times;
+        MDoubleArray values[3];
+    };
+
+    //drivenAsCompound is set when translate itself had a source, which
+    //write() has already disconnected.
+    MStatus writeAxis(MDGModifier& modifier, const Track& track, unsigned axis, bool drivenAsCompound);
+
+    std::vector<Track> m_tracks;
+};
+
+#endif //JOINTRIGANIM_ANIMCURVEWRITER_H
@@ -0,0 +1,270 @@
+//
+// Sliding window of evaluated mesh frames used by jointRig -batch and the
+// jointTracker node.
+//
+#include "frameBuffer.h"
+#include "profiler.h"
+#include "topology.h"
+
+#include <maya/MSelectionList.h>
+#include <maya/MDagPath.h>
+#include <maya/MFnDagNode.h>
+#include <maya/MFnMesh.h>
+#include <maya/MDGContext.h>
+#include <maya/MDGContextGuard.h>
+#include <maya/MIntArray.h>
+
+MStatus FrameBuffer::setMesh(const MString& meshName)
+{
+    MStatus status;
+    MSelectionList meshList;
+    MDagPath node;
+
+    //Look the mesh up by name without touching the active selection.
+    status = meshList.add(meshName);
+    if (!status)
+        return status;
+    status = meshList.getDagPath(0, node);
+    if (!status)
+        return status;
+    status = node.extendToShape();
+    if (!status)
+        return status;
+
+    MFnDagNode shapeFn(node, &status);
+    if (!status)
+        return status;
+
+    MPlug worldMesh = shapeFn.findPlug("worldMesh", false, &status);
+    if (!status)
+        return status;
+
+    m_worldMesh = worldMesh.elementByLogicalIndex(node.instanceNumber(), &status);
+    clear();
+    return status;
+}
+
+void FrameBuffer::setPlug(const MPlug& plug)
+{
+    m_worldMesh = plug;
+    clear();
+}
+
+void FrameBuffer::setHistory(unsigned frames)
+{
+    m_history.setCapacity(frames);
+}
+
+const MeshFrame* FrameBuffer::load(const MTime& time, MStatus* status)
+{
+    if (status != NULL)
+        *status = MS::kSuccess;
+
+    const MeshFrame* cached = recall(time);
+    if (cached != NULL)
+        return cached;
+
+    MStatus evalStatus;
+    MObject meshData;
+
+    //Evaluate the mesh at the requested time without moving the timeline.
+    PROFILE_SCOPE("evaluateMesh");
+    PROFILE_COUNT("dgEvaluations", 1);
+    {
+        MDGContext context(time);
+        MDGContextGuard contextGuard(context);
+        meshData = m_worldMesh.asMObject(&evalStatus);
+    }
+    m_evaluations++;
+
+    if (!evalStatus)
+    {
+        if (status != NULL)
+            *status = evalStatus;
+        return NULL;
+    }
+    return store(time, meshData, status);
+}
+
+const MeshFrame* FrameBuffer::store(const MTime& time, const MObject& meshData, MStatus* status)
+{
+    if (status != NULL)
+        *status = MS::kSuccess;
+
+    MStatus evalStatus;
+    MeshFrame frame;
+    frame.time = time.value();
+    frame.meshData = meshData;
+
+    MFnMesh mesh(frame.meshData, &evalStatus);
+    const float* rawPoints = NULL;
+    if (evalStatus)
+        rawPoints = mesh.getRawPoints(&evalStatus);
+
+    if (!evalStatus || rawPoints == NULL)
+    {
+        if (status != NULL)
+            *status = evalStatus ? MStatus(MS::kFailure) : evalStatus;
+        return NULL;
+    }
+
+    frame.numVertices = (unsigned)mesh.numVertices();
+    frame.points.assign(rawPoints, rawPoints + frame.numVertices * 3);
+
+    evalStatus = loadTriangles(mesh, frame);
+    if (!evalStatus)
+    {
+        if (status != NULL)
+            *status = evalStatus;
+        return NULL;
+    }
+
+    frame.fingerprint = frameFingerprint(frame.topology, frame.points.data(), frame.numVertices);
+    const CachedFrame* kept = m_history.find(frame.time);
+    if (kept != NULL && kept->fingerprint != frame.fingerprint)
+        m_history.clear();
+    return insert(frame);
+}
+
+const MeshFrame* FrameBuffer::insert(const MeshFrame& frame)
+{
+    //Frames are normally requested in a forward sweep, so this is
+    //almost always an append.
+    std::deque<MeshFrame>::iterator it = m_frames.end();
+    while (it != m_frames.begin() && (it - 1)->time >= frame.time)
+        --it;
+    if (it != m_frames.end() && it->time == frame.time)
+    {
+        *it = frame;
+        return &*it;
+    }
+    return &*m_frames.insert(it, frame);
+}
+
+MStatus FrameBuffer::loadTriangles(const MFnMesh& mesh, MeshFrame& frame)
+{
+    //The vertex count alone, as isNewMesh uses, misses keyframe meshes
+    //that happen to have as many vertices as the last one, so hash the
+    //face vertex lists. Cheaper than triangulating every frame.
+    MStatus status;
+    MIntArray faceCounts;
+    MIntArray faceVertices;
+    status = mesh.getVertices(faceCounts, faceVertices);
+    if (!status)
+        return status;
+
+    std::vector<int> counts(faceCounts.length());
+    faceCounts.get(counts.data());
+    std::vector<int> vertices(faceVertices.length());
+    faceVertices.get(vertices.data());
+    frame.topology = topologyFingerprint(frame.numVertices, counts.data(), (unsigned)counts.size(),
+                                         vertices.data(), (unsigned)vertices.size());
+    if (m_lastTriangles && frame.topology == m_lastTopology)
+    {
+        frame.triangles = m_lastTriangles;
+        return MS::kSuccess;
+    }
+
+    PROFILE_COUNT("topologyReads", 1);
+    MIntArray triangleCounts;
+    MIntArray triangleVertices;
+    status = mesh.getTriangles(triangleCounts, triangleVertices);
+    if (!status)
+        return status;
+
+    std::shared_ptr<std::vector<int>> triangles = std::make_shared<std::vector<int>>(triangleVertices.length());
+    for (unsigned t = 0; t < triangleVertices.length(); t++)
+        (*triangles)[t] = triangleVertices[t];
+
+    frame.triangles = triangles;
+    m_lastTriangles = triangles;
+    m_lastTopology = frame.topology;
+    return status;
+}
+
+const MeshFrame* FrameBuffer::recall(const MTime& time)
+{
+    const MeshFrame* cached = find(time);
+    if (cached != NULL)
+        return cached;
+
+    //Decoding a kept frame is far cheaper than evaluating the mesh again.
+    MeshFrame frame;
+    const CachedFrame* kept = m_history.decode(time.value(), frame.points);
+    if (kept == NULL)
+        return NULL;
+
+    PROFILE_COUNT("historyReads", 1);
+    m_historyReads++;
+    frame.time = kept->time;
+    frame.numVertices = kept->numVertices;
+    frame.triangles = kept->triangles;
+    frame.topology = kept->topology;
+    frame.fingerprint = kept->fingerprint;
+    return insert(frame);
+}
+
+const MeshFrame* FrameBuffer::find(const MTime& time) const
+{
+    double value = time.value();
+    for (const MeshFrame& frame : m_frames)
+    {
+        if (frame.time == value)
+            return &frame;
+    }
+    return NULL;
+}
+
+void FrameBuffer::keep(const MeshFrame& frame)
+{
+    //Frames read back from the history are still there.
+    if (m_history.capacity() == 0 || m_history.find(frame.time) != NULL)
+        return;
+
+    PROFILE_SCOPE("keepFrame");
+    CachedFrame kept;
+    kept.time = frame.time;
+    kept.numVertices = frame.numVertices;
+    kept.triangles = frame.triangles;
+    kept.topology = frame.topology;
+    kept.fingerprint = frame.fingerprint;
+    m_history.add(kept, frame.points.data());
+}
+
+void FrameBuffer::releaseBefore(const MTime& time)
+{
+    double value = time.value();
+    while (!m_frames.empty() && m_frames.front().time < value)
+    {
+        keep(m_frames.front());
+        m_frames.pop_front();
+    }
+}
+
+void FrameBuffer::releaseAfter(const MTime& time)
+{
+    double value = time.value();
+    while (!m_frames.empty() && m_frames.back().time > value)
+    {
+        keep(m_frames.back());
+        m_frames.pop_back();
+    }
+}
+
+void FrameBuffer::clear()
+{
+    m_frames.clear();
+    m_history.clear();
+    m_lastTriangles.reset();
+    m_lastTopology = 0;
+}
+
+unsigned FrameBuffer::evaluations() const
+{
+    return m_evaluations;
+}
+
+unsigned FrameBuffer::historyReads() const
+{
+    return m_historyReads;
+}
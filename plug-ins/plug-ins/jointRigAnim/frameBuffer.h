@@ -0,0 +1,95 @@
+//
+// Sliding window of evaluated mesh frames used by jointRig -batch and the
+// jointTracker node.
+//
+// Each frame is pulled through the mesh's worldMesh plug, or the plug given
+// to setPlug(), under an MDGContext for that time, so the timeline never
+// moves and a forward sweep over the frame range evaluates every frame of
+// the 4DViews mesh exactly once.
+//
+// Frames released from the window can be kept in a compressed history,
+// see setHistory(), so going over them again decodes them instead of
+// evaluating the mesh.
+//
+#ifndef JOINTRIGANIM_FRAMEBUFFER_H
+#define JOINTRIGANIM_FRAMEBUFFER_H
+
+#include <maya/MStatus.h>
+#include <maya/MString.h>
+#include <maya/MObject.h>
+#include <maya/MPlug.h>
+#include <maya/MTime.h>
+
+#include "frameCache.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+class MFnMesh;
+
+struct MeshFrame
+{
+    double time = 0;
+    //World space mesh data, usable with MFnMesh in MSpace::kObject. Null
+    //for frames read back from the history.
+    MObject meshData;
+    //World space vertex positions as xyz triples.
+    std::vector<float> points;
+    unsigned numVertices = 0;
+    //Triangle vertex IDs, shared by consecutive frames with the same
+    //topology so the triangles are only read when it changes.
+    std::shared_ptr<const std::vector<int>> triangles;
+    //topologyFingerprint() of the mesh's polygons.
+    uint64_t topology = 0;
+    //frameFingerprint() of the points as evaluated, which frames read
+    //back from the history keep.
+    uint64_t fingerprint = 0;
+};
+
+//Frames live in a deque, so a pointer handed out by load(), recall() or
+//find() stays valid while frames are added after the last one held and
+//other frames are released, as in a forward sweep: jointRig -batch tracks
+//from these pointers while it loads the frames ahead and releases the
+//ones behind. The pointer goes when its own frame is released or cleared,
+//when store() replaces that frame, and for every frame when one is added
+//before a later frame already held, such as by going back over a range.
+class FrameBuffer
+{
+public:
+    MStatus setMesh(const MString& meshName);
+    //Pulls frames from a mesh plug instead, such as a node's own input.
+    void setPlug(const MPlug& plug);
+    //Frames kept after they are released, 0 for none. A frame of 200k
+    //vertices costs at most 1.2 MB there.
+    void setHistory(unsigned frames);
+    const MeshFrame* load(const MTime& time, MStatus* status = NULL);
+    //Adds a frame from mesh data that was already evaluated at time,
+    //replacing any frame loaded for that time before. A frame that differs
+    //from the one kept for its time means the mesh changed, and empties
+    //the history.
+    const MeshFrame* store(const MTime& time, const MObject& meshData, MStatus* status = NULL);
+    const MeshFrame* find(const MTime& time) const;
+    //Same as find(), or reads the frame back from the history, but never
+    //evaluates the mesh.
+    const MeshFrame* recall(const MTime& time);
+    void releaseBefore(const MTime& time);
+    void releaseAfter(const MTime& time);
+    void clear();
+    unsigned evaluations() const;
+    unsigned historyReads() const;
+private:
+    MStatus loadTriangles(const MFnMesh& mesh, MeshFrame& frame);
+    const MeshFrame* insert(const MeshFrame& frame);
+    void keep(const MeshFrame& frame);
+    MPlug m_worldMesh;
+    std::deque<MeshFrame> m_frames;
+    FrameCache m_history;
+    std::shared_ptr<const std::vector<int>> m_lastTriangles;
+    uint64_t m_lastTopology = 0;
+    unsigned m_evaluations = 0;
+    unsigned m_historyReads = 0;
+};
+
+#endif //JOINTRIGANIM_FRAMEBUFFER_H
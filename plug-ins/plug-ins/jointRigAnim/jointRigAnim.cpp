@@ -10,6 +10,7 @@
 #include <maya/MArgList.h>
 #include <maya/MDagPath.h>
 #include <maya/MDGModifier.h>
+#include <maya/MDagModifier.h>
 #include <maya/MFnDagNode.h>
 #include <maya/MGlobal.h>
 #include <maya/MFnTransform.h>
@@ -18,11 +19,35 @@
 #include <maya/MPlug.h>
 #include <maya/MItMeshVertex.h>
 #include <maya/MFnMesh.h>
-#include <maya/MAnimControl.h>
 #include <maya/MFnAnimCurve.h>
 #include <maya/MFnSet.h>
+#include <maya/MFnSingleIndexedComponent.h>
+#include <maya/MIntArray.h>
+#include <maya/MDagPathArray.h>
+#include <maya/MFnIntArrayData.h>
+#include <maya/MPlugArray.h>
+
+#include "frameBuffer.h"
+#include "jointTrackerNode.h"
+#include "landmarks.h"
+#include "log.h"
+#include "animCurveWriter.h"
+#include "checkpoint.h"
+#include "framePipeline.h"
+#include "mayaVec3.h"
+#include "motion.h"
+#include "motionFilter.h"
+#include "pointCache.h"
+#include "pointCacheStream.h"
+#include "profiler.h"
+#include "surfaceWalk.h"
+#include "trackingEngine.h"
+#include "trajectory.h"
+#include "vertexSets.h"
 
 #include <vector>
+#include <algorithm>
+#include <cstdio>
 #include <math.h>
 
 class JointRigAnimateCommand: public MPxCommand
@@ -32,6 +57,7 @@ public:
     ~JointRigAnimateCommand() override;
     MStatus	parseArgs(const MArgList& args);
     MStatus doIt (const MArgList& args) override;
+    MStatus redoIt() override;
     MStatus undoIt() override;
     MSyntax cmdSyntax();
     bool isUndoable() const override;
@@ -39,31 +65,164 @@ public:
 private:
     MVector centroid();
     MStatus meshBufferOps(unsigned i);
-    MStatus vertUpdateByClosest(std::vector<MPoint>& locations);
-    MStatus vertUpdateBySelection(std::vector<MPoint>& locations);
-    MPoint getProjectedPoint(unsigned i, MPoint* prevPoint, MPoint* currentPoint);
-    MPoint getAcceleration();
-    MStatus setVelocity(MPoint* prePoint, MPoint* cPoint);
+    MStatus vertUpdateByClosest(MPoint* locations);
+    MStatus vertUpdateBySelection(MPoint* locations);
+    MPoint getProjectedPoint(unsigned i, const MPoint& currentPoint);
     MStatus setNextActualPoints();
     unsigned getMeshVertices(MTime& frame);
+    MStatus getVertexPairPoints(MTime& frame, std::vector<MPoint>& points);
+    MStatus getClosestMeshPoint(unsigned i, MPoint& closest);
+    MStatus loadVertexSets();
+    MStatus getLocators(MDagPathArray& locators);
+    MStatus trackBatch(const MDagPathArray& locators);
+    MStatus loadBatchFrames(unsigned i, unsigned inFlight, TrackFrame& current, TrackFrame& next, MString& error);
+    MStatus resumeBatch(TrackingEngine& engine, TrajectoryWriter& trajectory, unsigned& resumeFrom);
+    MStatus keyFromTrajectory();
+    MStatus trackScrubbing(const MDagPathArray& locators);
+    MStatus exportCache();
+    MStatus createTrackerNode(const MDagPathArray& locators);
+    MStatus proposeJoints();
+    MStatus placeProposedJoints();
     unsigned m_vpIndex = 0;
     double m_startFrame = 1;
     double m_endFrame = 50;
     MDGModifier m_dagModifier;
+    //Scrubbing state, one slot per tracked point and two points per
+    //joint, sized once per run and updated in place.
     std::vector <MPoint> m_prevPoints;
     std::vector <MPoint> m_projPoints;
-    std::vector <MPoint> m_velocities;
-    MAnimControl m_animControl;
+    std::vector <MotionFilter> m_pointFilters;
+    //Closest point search, per topology: each point walks the surface
+    //from the triangle it was last found on, and only points that leave
+    //their search radius fall back to the BVH over the whole mesh.
+    SurfaceWalk m_surfaceWalk;
+    std::shared_ptr<const std::vector<int>> m_walkTriangles;
+    std::vector <int> m_walkStarts;
+    MeshBvh m_surfaceBvh;
+    double m_surfaceBvhTime = 0;
+    //Reused by getVertexPairPoints() so its capacity carries over.
+    std::vector <MPoint> m_pairPoints;
     unsigned m_prevMeshVertices;
     unsigned m_currentMeshVertices;
     unsigned m_nextMeshVertices;
     MTime m_prevFrame;
     MTime m_currentFrame;
     MTime m_nextFrame;
-    const char *kStartFrame;
-    const char *kEndFrame;
+    const char *kStartFrameFlag = "-s";
+    const char *kStartFrameLongFlag = "-startFrame";
+    const char *kEndFrameFlag = "-e";
+    const char *kEndFrameLongFlag = "-endFrame";
+    const char *kBatchFlag = "-b";
+    const char *kBatchLongFlag = "-batch";
+    const char *kThreadsFlag = "-t";
+    const char *kThreadsLongFlag = "-threads";
+    const char *kExportCacheFlag = "-x";
+    const char *kExportCacheLongFlag = "-exportCache";
+    const char *kCacheFlag = "-c";
+    const char *kCacheLongFlag = "-cache";
+    const char *kTrajectoryFlag = "-tr";
+    const char *kTrajectoryLongFlag = "-trajectory";
+    const char *kFromTrajectoryFlag = "-ft";
+    const char *kFromTrajectoryLongFlag = "-fromTrajectory";
+    const char *kVerbosityFlag = "-v";
+    const char *kVerbosityLongFlag = "-verbosity";
+    const char *kLogFileFlag = "-lf";
+    const char *kLogFileLongFlag = "-logFile";
+    const char *kProfileFlag = "-p";
+    const char *kProfileLongFlag = "-profile";
+    const char *kProfileTraceFlag = "-pt";
+    const char *kProfileTraceLongFlag = "-profileTrace";
+    const char *kNodeFlag = "-n";
+    const char *kNodeLongFlag = "-node";
+    const char *kDetectFlag = "-d";
+    const char *kDetectLongFlag = "-detect";
+    const char *kCheckpointFlag = "-cp";
+    const char *kCheckpointLongFlag = "-checkpoint";
+    const char *kCheckpointIntervalFlag = "-ci";
+    const char *kCheckpointIntervalLongFlag = "-checkpointInterval";
+    const char *kResumeFlag = "-rs";
+    const char *kResumeLongFlag = "-resume";
+    const char *kPipelineDepthFlag = "-pd";
+    const char *kPipelineDepthLongFlag = "-pipelineDepth";
     bool isNewMeshNext = false;
     bool isNewMesh = false;
+
+    //One vertex set (vp1, vp2, ...) and one locator per joint.
+    unsigned m_numJoints = 0;
+    std::vector<std::vector<int>> m_vpVertexIds;
+
+    //Every frame of the mesh is read once into m_frameBuffer, without
+    //moving the timeline. Batch mode also tracks all joints of a frame in
+    //parallel on m_numThreads threads (0 = all cores).
+    bool m_batch = false;
+    unsigned m_numThreads = 0;
+    FrameBuffer m_frameBuffer;
+
+    //With -exportCache the range is written to a point cache for the
+    //jointTrack command line tool instead of being tracked.
+    MString m_exportPath;
+
+    //With -cache the frames are streamed from a point cache instead of
+    //mesh_fdv, so the capture does not need to be in the scene. The
+    //vertex sets come from the .sets file written next to the cache.
+    MString m_cachePath;
+    PointCacheStream m_cacheStream;
+
+    //-trajectory also writes everything the batch tracker knows about
+    //each joint and frame to a trajectory file. -fromTrajectory keys the
+    //locators from such a file without tracking again.
+    MString m_trajectoryPath;
+    MString m_fromTrajectoryPath;
+    TrajectoryReader m_fromTrajectory;
+
+    //-checkpoint saves the batch track to a file every
+    //m_checkpointInterval frames, and -resume carries a run that stopped
+    //halfway on from there, keying the frames it had already tracked.
+    MString m_checkpointPath;
+    unsigned m_checkpointInterval = 100;
+    bool m_resume = false;
+
+    //Batch mode pulls frames up to m_pipelineDepth frames ahead of the
+    //one being tracked, see FramePipeline. Each frame in flight keeps its
+    //frames and, once tracked, its joints in a BatchSlot.
+    struct BatchSlot
+    {
+        TrackFrame current;
+        TrackFrame next;
+        std::vector<Vec3> positions;
+        std::vector<uint8_t> tracked;
+    };
+    unsigned m_pipelineDepth = FramePipeline::kDefaultDepth;
+
+    //Diagnostics level for this run (off, summary, debug or trace) and
+    //the file trace output is buffered to, if any.
+    LogLevel m_logLevel = kLogSummary;
+    MString m_logFile;
+
+    //-profile prints time per phase of the frame loop once the run is
+    //done; -profileTrace also writes every timed phase as Chrome trace
+    //JSON.
+    bool m_profile = false;
+    MString m_profileTracePath;
+
+    //-node drives the locators from a jointTracker node instead of
+    //keying them, so they follow the mesh live.
+    bool m_node = false;
+
+    //-detect proposes the vertex sets and locators from the mesh on the
+    //start frame instead of tracking. The sets and locators are created
+    //through m_landmarkModifier; their members and positions are set once
+    //it has run.
+    bool m_detect = false;
+    MDagModifier m_landmarkModifier;
+    MDagPath m_landmarkMesh;
+    std::vector<Landmark> m_landmarks;
+    std::vector<MObject> m_landmarkSets;
+    std::vector<MObject> m_landmarkLocators;
+
+    //Tracked positions for the whole range, keyed through m_dagModifier
+    //once tracking is done.
+    AnimCurveWriter m_curveWriter;
 };
 
 JointRigAnimateCommand::JointRigAnimateCommand() {}
@@ -79,169 +238,184 @@ bool JointRigAnimateCommand::isUndoable() const
     return true;
 }
 
+MStatus JointRigAnimateCommand::redoIt()
+{
+    if(m_detect)
+    {
+        MStatus status = m_landmarkModifier.doIt();
+        if(!status)
+            return status;
+        return placeProposedJoints();
+    }
+    return m_dagModifier.doIt();
+}
+
 MStatus JointRigAnimateCommand::undoIt()
 {
-    return MS::kSuccess;
+    //Set members and locator positions go with the nodes.
+    if(m_detect)
+        return m_landmarkModifier.undoIt();
+    return m_dagModifier.undoIt();
 }
 
 MStatus JointRigAnimateCommand::parseArgs(const MArgList &args)
 {
-    //~~~~~~~~~FUNCTION NOT USED~~~~~~~~~~~//
-    //Couldn't quite figure this out in the alotted time.
-    //Tried to make it so that the user could put in the
-    //start or endframe argument in either order.
-
+    //Get args from Maya command window.
+    //The flags can be given in any order.
     MStatus status;
     MArgParser argData(cmdSyntax(), args, &status);
+    if (!status)
+        return status;
 
-    if(args.asString(0) == "-s")
-    {
-        if(args.asDouble(1) >= 0)
-            m_startFrame = args.asDouble(1);
-    }
-    if(args.asString(0) == "-e")
-    {
-        if(args.asDouble(1) > 0 && args.asDouble(1) > m_startFrame)
-            m_endFrame = args.asDouble(1);
-    }
-    if(args.asString(3) == "-s")
+    double flagValue;
+
+    if(argData.isFlagSet(kStartFrameFlag))
     {
-        if(args.asDouble(4) >= 0)
-            m_startFrame = args.asDouble(4);
+        argData.getFlagArgument(kStartFrameFlag, 0, flagValue);
+        if(flagValue >= 0)
+            m_startFrame = flagValue;
     }
-    if(args.asString(3) == "-e")
+    if(argData.isFlagSet(kEndFrameFlag))
     {
-        if(args.asDouble(4) > 0 && args.asDouble(4) > m_startFrame)
-            m_endFrame = args.asDouble(4);
+        argData.getFlagArgument(kEndFrameFlag, 0, flagValue);
+        if(flagValue > 0 && flagValue > m_startFrame)
+            m_endFrame = flagValue;
     }
-    return status;
-}
 
-MPoint JointRigAnimateCommand::getAcceleration()
-{
-    MPoint currentAcceleration;
-
-    currentAcceleration = m_velocities[1] - m_velocities[0];
+    m_batch = argData.isFlagSet(kBatchFlag);
 
-    cout << "Current Acceleration: " << currentAcceleration.x << ", " << currentAcceleration.y << ", "
-        << currentAcceleration.z << endl;
+    if(argData.isFlagSet(kThreadsFlag))
+    {
+        unsigned threads;
+        argData.getFlagArgument(kThreadsFlag, 0, threads);
+        m_numThreads = threads;
+    }
 
-    return currentAcceleration;
-}
+    if(argData.isFlagSet(kExportCacheFlag))
+        argData.getFlagArgument(kExportCacheFlag, 0, m_exportPath);
 
-MStatus JointRigAnimateCommand::setVelocity(MPoint* prePoint, MPoint* cPoint)
-{
-    MPoint currentVelocity;
-    if(prePoint != NULL && cPoint != NULL)
+    if(argData.isFlagSet(kCacheFlag))
     {
-        MPoint currentPoint = *cPoint;
-        MPoint prevPoint = *prePoint;
-
-        currentVelocity = currentPoint - prevPoint;
+        argData.getFlagArgument(kCacheFlag, 0, m_cachePath);
+        m_batch = true;
+    }
 
-        if ((int)m_currentFrame.value() % 3 == 0)
-            m_velocities.clear();
+    if(argData.isFlagSet(kTrajectoryFlag))
+    {
+        argData.getFlagArgument(kTrajectoryFlag, 0, m_trajectoryPath);
+        m_batch = true;
+    }
 
-        m_velocities.push_back(currentVelocity);
+    if(argData.isFlagSet(kFromTrajectoryFlag))
+        argData.getFlagArgument(kFromTrajectoryFlag, 0, m_fromTrajectoryPath);
 
-        cout << "Current Velocity: " << currentVelocity.x << ", " << currentVelocity.y << ", " << currentVelocity.z
-            << endl;
+    if(argData.isFlagSet(kVerbosityFlag))
+    {
+        MString level;
+        argData.getFlagArgument(kVerbosityFlag, 0, level);
+        if(!Log::parseLevel(level.asChar(), m_logLevel))
+        {
+            MGlobal::displayError("jointRig: -verbosity must be off, summary, debug or trace");
+            return MS::kFailure;
+        }
     }
-    return MS::kSuccess;
-}
-
-MPoint JointRigAnimateCommand::getProjectedPoint(unsigned vi, MPoint* prePoint, MPoint* cPoint)
-{
-    MPoint projPoint;
-    int i;
 
-    if(vi == 0)
-       i = 2;
-    else
-        i = 3;
+    if(argData.isFlagSet(kLogFileFlag))
+        argData.getFlagArgument(kLogFileFlag, 0, m_logFile);
 
-    if(prePoint != NULL && cPoint != NULL)
+    m_profile = argData.isFlagSet(kProfileFlag);
+    if(argData.isFlagSet(kProfileTraceFlag))
     {
-        MPoint currentPoint = *cPoint;
-        MPoint prevPoint = *prePoint;
-        setVelocity(prePoint, cPoint);
-        MPoint currentVelocity = m_velocities[i];
-        MPoint acceleration = getAcceleration();
+        argData.getFlagArgument(kProfileTraceFlag, 0, m_profileTracePath);
+        m_profile = true;
+    }
 
-        projPoint.x = currentPoint.x + currentVelocity.x + (acceleration.x / 2);
-        projPoint.y = currentPoint.y + currentVelocity.y + (acceleration.y / 2);
-        projPoint.z = currentPoint.z + currentVelocity.z + (acceleration.z / 2);
+    m_node = argData.isFlagSet(kNodeFlag);
+    m_detect = argData.isFlagSet(kDetectFlag);
 
+    if(argData.isFlagSet(kCheckpointFlag))
+    {
+        argData.getFlagArgument(kCheckpointFlag, 0, m_checkpointPath);
+        m_batch = true;
+    }
+    if(argData.isFlagSet(kCheckpointIntervalFlag))
+    {
+        unsigned interval;
+        argData.getFlagArgument(kCheckpointIntervalFlag, 0, interval);
+        m_checkpointInterval = interval;
     }
+    if(argData.isFlagSet(kPipelineDepthFlag))
+    {
+        unsigned depth;
+        argData.getFlagArgument(kPipelineDepthFlag, 0, depth);
+        m_pipelineDepth = depth;
+    }
+    m_resume = argData.isFlagSet(kResumeFlag);
+    if(m_resume && m_checkpointPath.length() == 0)
+    {
+        MGlobal::displayError("jointRig: -resume needs the -checkpoint to resume from");
+        return MS::kFailure;
+    }
+    return status;
+}
 
-    return projPoint;
+MPoint JointRigAnimateCommand::getProjectedPoint(unsigned i, const MPoint& currentPoint)
+{
+    //Each point keeps its own filter state, so the prediction does not
+    //depend on the frame number or on the points tracked before it.
+    MotionFilter& filter = m_pointFilters[i];
+    filter.update(toVec3(currentPoint));
+
+    TRACKER_LOG(kLogTrace, "Filtered Velocity: " << filter.velocity().x << ", " << filter.velocity().y << ", "
+                << filter.velocity().z);
+    TRACKER_LOG(kLogTrace, "Filtered Acceleration: " << filter.acceleration().x << ", " << filter.acceleration().y
+                << ", " << filter.acceleration().z);
+    TRACKER_LOG(kLogTrace, "Search Radius: " << filter.searchRadius(TrackingEngine::kSearchSigmas));
+
+    return toMPoint(filter.predicted());
 }
 
-MStatus JointRigAnimateCommand::vertUpdateByClosest(std::vector<MPoint>& locations)
+MStatus JointRigAnimateCommand::vertUpdateByClosest(MPoint* locations)
 {
-    cout << "\nvertUpdateByClosest() has been called." << endl;
+    TRACKER_LOG(kLogTrace, "vertUpdateByClosest() has been called.");
 
-    //Get the mesh by selection.
     MStatus status;
-    MDagPath node;
-    MObject component;
-    MSelectionList meshList;
-    MGlobal::selectByName("mesh_fdv");
-    MGlobal::getActiveSelectionList(meshList);
-    meshList.getDagPath(0, node, component);
-    MFnMesh mesh(node, &status);
 
     //Use p1 and p2 to match the proper index values in
     //m_refrencePoints based on which vertexPair we're
     //working with.
-    unsigned p1, p2;
-    unsigned vi = 0;
-
-    switch(m_vpIndex) {
-        case 0: p1 = 0;
-            p2 = 1;
-            break;
-        case 1: p1 = 2;
-            p2 = 3;
-            break;
-        case 2: p1 = 4;
-            p2 = 5;
-            break;
-    }
+    unsigned p1 = m_vpIndex * 2;
+    unsigned p2 = p1 + 1;
 
     for(unsigned i = p1; i < p2+1; i++)
     {
         MPoint current;
         MPoint projected;
 
-        cout << "m_projPoints size = " << m_projPoints.size() << endl;
-        cout << "m_prevPoints size = " << m_prevPoints.size() << endl;
+        TRACKER_LOG(kLogTrace, "m_projPoints size = " << m_projPoints.size());
+        TRACKER_LOG(kLogTrace, "m_prevPoints size = " << m_prevPoints.size());
 
         //m_prevPoints and m_projPoint should hold all 3 vertex pairs.
-        cout << "Previous Point " << i << ": " << m_prevPoints[i].x << ", " << m_prevPoints[i].y << ", "
-             << m_prevPoints[i].z << endl;
-        cout << "Previous Projected Point " << i << ": " << m_projPoints[i].x << ", " << m_projPoints[i].y << ", "
-             << m_projPoints[i].z << endl;
+        TRACKER_LOG(kLogTrace, "Previous Point " << i << ": " << m_prevPoints[i].x << ", " << m_prevPoints[i].y
+                    << ", " << m_prevPoints[i].z);
+        TRACKER_LOG(kLogTrace, "Previous Projected Point " << i << ": " << m_projPoints[i].x << ", "
+                    << m_projPoints[i].y << ", " << m_projPoints[i].z);
 
         //Get closest current point on the mesh
         //to the projected point cached in the previous frame.
-        mesh.getClosestPoint(m_projPoints[i], current, MSpace::kWorld);
+        status = getClosestMeshPoint(i, current);
 
-        cout << "Actual Current Point: " << current.x << ", " << current.y << ", " << current.z << endl;
+        TRACKER_LOG(kLogTrace, "Actual Current Point: " << current.x << ", " << current.y << ", " << current.z);
 
-        projected = getProjectedPoint(i, &m_prevPoints[i], &current);
+        projected = getProjectedPoint(i, current);
 
-        cout << "Projected Point " << i << ": " << projected.x << ", " << projected.y << ", "
-             << projected.z << endl;
+        TRACKER_LOG(kLogTrace, "Projected Point " << i << ": " << projected.x << ", " << projected.y << ", "
+                    << projected.z);
 
         //Replace points.
-        m_prevPoints.erase(m_prevPoints.begin()+i);
-        m_prevPoints.emplace(m_prevPoints.begin()+i, current);
-        m_projPoints.erase(m_projPoints.begin()+i);
-        m_projPoints.emplace(m_projPoints.begin()+i, projected);
-        locations.push_back(current);
-
-        vi++;
+        m_prevPoints[i] = current;
+        m_projPoints[i] = projected;
+        locations[i - p1] = current;
     }
 
     return status;
@@ -249,115 +423,43 @@ MStatus JointRigAnimateCommand::vertUpdateByClosest(std::vector<MPoint>& locatio
 
 MStatus JointRigAnimateCommand::setNextActualPoints()
 {
-    cout << "setNextActualPoint() has been called." << endl;
-    //Select the vertex pair by name.
+    TRACKER_LOG(kLogTrace, "setNextActualPoint() has been called.");
     MStatus status;
-    MDagPath node;
-    MObject component;
-    MSelectionList vertexPair;
-    MString vpArg;
-    vpArg.set(m_vpIndex + 1);
-    MString vpName = "vp" + vpArg;
-    m_animControl.setCurrentTime(m_nextFrame);
-    MGlobal::executeCommand("select " + vpName);
-    MGlobal::getActiveSelectionList(vertexPair);
-    unsigned i;
-
-    switch(m_vpIndex) {
-        case 0: i = 0;
-                break;
-        case 1: i = 2;
-                break;
-        case 2: i = 4;
-                break;
-    }
-
-    //Get the mesh.
-    vertexPair.getDagPath(0, node, component);
-    MFnMesh mesh(node, &status);
-
-    //Get the indices for the selected vertices so
-    //we can iterate through them.
-    MItMeshVertex vertIt(node, component, &status);
-
-    for (; !vertIt.isDone(); vertIt.next())
-    {
-        MPoint next;
-        int vid = vertIt.index(&status);
-        mesh.getPoint(vid, next, MSpace::kWorld);
-
-        //Push to m_projPoints for vertUpdateByClosest() to use.
-        if(m_currentFrame.value() > m_startFrame)
-        {
-            m_projPoints.erase(m_projPoints.begin()+i);
-            m_projPoints.emplace(m_projPoints.begin()+i, next);
-        }else {
-            m_projPoints.push_back(next);
-        }
-        cout << "\nNext Point " << i << ": " << m_projPoints[i].x << ", " << m_projPoints[i].y << ", "
-             << m_projPoints[i].z << endl;
-        i++;
-    }
+    unsigned i = m_vpIndex * 2;
 
-    //Time to go back to the present.
-    m_animControl.setCurrentTime(m_currentFrame);
+    //Get the vertex pair on the next frame.
+    status = getVertexPairPoints(m_nextFrame, m_pairPoints);
+
+    //Stored in m_projPoints for vertUpdateByClosest() to use.
+    for (unsigned k = 0; k < 2 && k < m_pairPoints.size(); k++, i++)
+    {
+        m_projPoints[i] = m_pairPoints[k];
+        TRACKER_LOG(kLogTrace, "Next Point " << i << ": " << m_projPoints[i].x << ", " << m_projPoints[i].y << ", "
+                    << m_projPoints[i].z);
+    }
 
     return status;
 }
 
-MStatus JointRigAnimateCommand::vertUpdateBySelection(std::vector<MPoint>& locations)
+MStatus JointRigAnimateCommand::vertUpdateBySelection(MPoint* locations)
 {
-    cout << "\nvertUpdateBySelection() has been called." << endl;
-    //Select the vertex pair by name.
+    TRACKER_LOG(kLogTrace, "vertUpdateBySelection() has been called.");
     MStatus status;
-    MDagPath node;
-    MObject component;
-    MSelectionList vertexPair;
-    MString vpArg;
-    vpArg.set(m_vpIndex + 1);
-    MString vpName = "vp" + vpArg;
-    MGlobal::executeCommand("select " + vpName);
-    MGlobal::getActiveSelectionList(vertexPair);
-
-    //Get the mesh.
-    vertexPair.getDagPath(0, node, component);
-    MFnMesh mesh(node, &status);
+    unsigned i = m_vpIndex * 2;
 
-    //Get the indices for the selected vertices so
-    //we can iterate through them.
-    MItMeshVertex vertIt(node, component, &status);
+    //Get the vertex pair on the current frame.
+    status = getVertexPairPoints(m_currentFrame, m_pairPoints);
 
-    unsigned i;
-
-    switch(m_vpIndex) {
-        case 0: i = 0;
-            break;
-        case 1: i = 2;
-            break;
-        case 2: i = 4;
-            break;
-    }
-
-    for (; !vertIt.isDone(); vertIt.next())
+    for (unsigned k = 0; k < 2 && k < m_pairPoints.size(); k++, i++)
     {
-        MPoint current;
-        int vid = vertIt.index(&status);
-        mesh.getPoint(vid, current, MSpace::kWorld);
-        locations.push_back(current);
+        const MPoint& current = m_pairPoints[k];
+        locations[k] = current;
+        m_pointFilters[i].update(toVec3(current));
 
-        //Push to m_prevPoints for vertUpdateByClosest() to use.
-        if(m_currentFrame.value() > m_startFrame)
-        {
-            setVelocity(&m_prevPoints[i], &current);
-            m_prevPoints.erase(m_prevPoints.begin()+i);
-            m_prevPoints.emplace(m_prevPoints.begin()+i, current);
-        }else {
-            m_prevPoints.push_back(current);
-        }
+        //Stored in m_prevPoints for vertUpdateByClosest() to use.
+        m_prevPoints[i] = current;
 
-        cout << "Vertex ID: " << vid << endl;
-        cout << "New Location: " << current.x << ", " << current.y << ", " << current.z << endl;
-        i++;
+        TRACKER_LOG(kLogTrace, "New Location: " << current.x << ", " << current.y << ", " << current.z);
     }
 
     setNextActualPoints();
@@ -369,79 +471,211 @@ MVector JointRigAnimateCommand::centroid()
     MStatus status;
     MVector centroid;
     MTime thirdFrame((double) m_startFrame + 2.0);
-    cout << "m_currentFrame = " << m_currentFrame.value() << ", thirdFrame = " << thirdFrame.value() << endl;
-    if(isNewMesh)
-        cout << "isNewMesh" << endl;
-    else
-        cout << "!isNewMesh" << endl;
-
-    if(isNewMeshNext)
-        cout << "isNewMeshNext" << endl;
-    else
-        cout << "!isNewMeshNext" << endl;
+    TRACKER_LOG(kLogTrace, "m_currentFrame = " << m_currentFrame.value() << ", thirdFrame = " << thirdFrame.value());
+    TRACKER_LOG(kLogTrace, (isNewMesh ? "isNewMesh" : "!isNewMesh"));
+    TRACKER_LOG(kLogTrace, (isNewMeshNext ? "isNewMeshNext" : "!isNewMeshNext"));
 
     //Holds one vertex pair at a time.
-    std::vector <MPoint> locations;
+    MPoint locations[2];
 
+    //Once the points leave their vertices this path has no IDs to go
+    //back to, so it searches every frame, walking the surface from where
+    //each point was last found. -batch follows vertex IDs between
+    //topology changes instead, see TrackingEngine::trackFrame().
     if(m_currentFrame < thirdFrame)
         vertUpdateBySelection(locations);
     else
         vertUpdateByClosest(locations);
 
-    /*
-    //Update the vertex pair locations.
-    if(isNewMesh && !isNewMeshNext)
-        vertUpdateByClosest(locations);
+    Vec3 pair[] = {toVec3(locations[0]), toVec3(locations[1])};
+    centroid = toMVector(::centroid(pair, 2));
 
-    if(!isNewMesh && isNewMeshNext)
-        vertUpdateBySelection(locations);
+    TRACKER_LOG(kLogTrace, "Centroid : (" << centroid.x << ", " << centroid.y << ", " << centroid.z << ")");
 
-    if(isNewMesh && isNewMeshNext)
-        vertUpdateByClosest(locations);
+    if(m_vpIndex + 1 < m_numJoints)
+        m_vpIndex++;
+    else
+        m_vpIndex = 0;
 
-    if(!isNewMesh && !isNewMeshNext)
+    return centroid;
+}
+
+unsigned JointRigAnimateCommand::getMeshVertices(MTime& frame)
+{
+    const MeshFrame* meshFrame = m_frameBuffer.load(frame);
+    return meshFrame != NULL ? meshFrame->numVertices : 0;
+}
+
+MStatus JointRigAnimateCommand::getVertexPairPoints(MTime& frame, std::vector<MPoint>& points)
+{
+    PROFILE_SCOPE("getVertexPairPoints");
+    points.clear();
+
+    //Read the pair's vertices from the frame buffer by ID rather than
+    //selecting the set and moving the timeline to the frame.
+    MStatus status;
+    const MeshFrame* meshFrame = m_frameBuffer.load(frame, &status);
+    if(meshFrame == NULL)
+        return status;
+
+    for(int vid : m_vpVertexIds[m_vpIndex])
     {
-        if(m_currentFrame == firstFrame)
-            vertUpdateBySelection(locations);
-        else
-            vertUpdateByClosest(locations);
+        if(vid < 0 || (unsigned)vid >= meshFrame->numVertices)
+            return MS::kFailure;
+        const float* p = &meshFrame->points[vid * 3];
+        points.push_back(MPoint(p[0], p[1], p[2]));
+        TRACKER_LOG(kLogTrace, "Vertex ID: " << vid);
     }
-    */
 
-    centroid = (locations[0] + locations[1]) / 2;
-
-    cout << "Centroid : (" << centroid.x << ", " << centroid.y << ", " << centroid.z << ")" << endl;
+    return status;
+}
 
+MStatus JointRigAnimateCommand::getClosestMeshPoint(unsigned i, MPoint& closest)
+{
+    PROFILE_SCOPE("getClosestPoint");
+    PROFILE_COUNT("closestPointQueries", 1);
+
+    //The buffered points are already in world space.
+    const MeshFrame* meshFrame = m_frameBuffer.find(m_currentFrame);
+    if(meshFrame == NULL || !meshFrame->triangles)
+        return MS::kFailure;
+    const std::vector<int>& triangles = *meshFrame->triangles;
+
+    //Frames with the same topology share their triangles, so the walk's
+    //tables are only rebuilt when it changes. Triangles found on the old
+    //topology mean nothing on the new one.
+    if(meshFrame->triangles != m_walkTriangles)
+    {
+        PROFILE_SCOPE("surfaceWalkBuild");
+        m_walkTriangles = meshFrame->triangles;
+        m_surfaceWalk.build(meshFrame->numVertices, triangles.data(), (unsigned)triangles.size() / 3);
+        m_surfaceBvh.clear();
+        m_walkStarts.assign(m_projPoints.size(), -1);
+    }
 
-    //Clear locations for next vertex pair.
-    locations.pop_back();
-    locations.pop_back();
+    const MPoint& projected = m_projPoints[i];
+    float query[] = {(float)projected.x, (float)projected.y, (float)projected.z};
+    const MotionFilter& filter = m_pointFilters[i];
+    double radius = filter.searchRadius(TrackingEngine::kSearchSigmas);
+    float radiusSq = filter.started() ? (float)(radius * radius) : std::numeric_limits<float>::max();
+    BvhHit hit = m_surfaceWalk.closestPoint(meshFrame->points.data(), query, m_walkStarts[i], radiusSq);
 
-    if(m_vpIndex < 2)
-        m_vpIndex++;
-    else
-        m_vpIndex = 0;
+    //A point seen for the first time, or one that moved further than
+    //its filter expected, is searched for over the whole mesh.
+    if(hit.triangle < 0)
+    {
+        PROFILE_COUNT("surfaceWalkMisses", 1);
+        if(m_surfaceBvh.empty())
+        {
+            m_surfaceBvh.build(meshFrame->points.data(), meshFrame->numVertices, triangles.data(),
+                               (unsigned)triangles.size() / 3);
+        }
+        else if(m_surfaceBvhTime != meshFrame->time)
+        {
+            m_surfaceBvh.refit(meshFrame->points.data(), meshFrame->numVertices);
+        }
+        m_surfaceBvhTime = meshFrame->time;
+        hit = m_surfaceBvh.closestPoint(query);
+        if(hit.triangle < 0)
+            return MS::kFailure;
+    }
 
-    MString vp;
-    vp.set(m_vpIndex+1);
-    MGlobal::unselectByName("vp" + vp);
-    return centroid;
+    m_walkStarts[i] = hit.triangle;
+    closest = MPoint(hit.point[0], hit.point[1], hit.point[2]);
+    return MS::kSuccess;
 }
 
-unsigned JointRigAnimateCommand::getMeshVertices(MTime& frame)
+MStatus JointRigAnimateCommand::loadVertexSets()
 {
+    //Read the vertex IDs of vp1, vp2, ... vpN once up front. The
+    //sets are numbered from 1 and the first missing one ends the list.
     MStatus status;
-    MDagPath node;
-    MObject component;
-    MSelectionList meshList;
+    m_vpVertexIds.clear();
+
+    //A trajectory file carries the sets it was tracked with.
+    if(m_fromTrajectoryPath.length() > 0)
+    {
+        if(!m_fromTrajectory.open(m_fromTrajectoryPath.asChar()))
+        {
+            MGlobal::displayError(MString("jointRig: ") + m_fromTrajectory.error().c_str());
+            return MS::kFailure;
+        }
+
+        for(unsigned j = 0; j < m_fromTrajectory.numJoints(); j++)
+        {
+            const int32_t* ids = m_fromTrajectory.vertexIds(j);
+            m_vpVertexIds.push_back(std::vector<int>(ids, ids + m_fromTrajectory.numPoints(j)));
+        }
+        return MS::kSuccess;
+    }
 
-    m_animControl.setCurrentTime(frame);
-    MGlobal::selectByName("mesh_fdv");
-    MGlobal::getActiveSelectionList(meshList);
-    meshList.getDagPath(0, node, component);
-    MFnMesh mesh(node, &status);
+    if(m_cachePath.length() > 0)
+    {
+        std::string error;
+        if(!readVertexSets(vertexSetsPath(m_cachePath.asChar()), m_vpVertexIds, error))
+        {
+            MGlobal::displayError(MString("jointRig: ") + error.c_str());
+            return MS::kFailure;
+        }
+        return MS::kSuccess;
+    }
+
+    for(unsigned vp = 0; ; vp++)
+    {
+        MString vpArg;
+        vpArg.set(vp + 1);
+        MString vpName = "vp" + vpArg;
 
-    return mesh.numVertices();
+        MSelectionList setList;
+        MObject setObj;
+        if(!setList.add(vpName))
+            break;
+        setList.getDependNode(0, setObj);
+
+        MSelectionList members;
+        MFnSet setFn(setObj, &status);
+        if(!status)
+            return status;
+        setFn.getMembers(members, true);
+
+        MDagPath node;
+        MObject component;
+        members.getDagPath(0, node, component);
+        MItMeshVertex vertIt(node, component, &status);
+        if(!status)
+            return status;
+
+        std::vector<int> ids;
+        for (; !vertIt.isDone(); vertIt.next())
+            ids.push_back(vertIt.index());
+
+        m_vpVertexIds.push_back(ids);
+    }
+
+    if(m_vpVertexIds.empty())
+    {
+        MGlobal::displayError("jointRig: could not find vertex pair set vp1");
+        return MS::kFailure;
+    }
+    return MS::kSuccess;
+}
+
+MStatus JointRigAnimateCommand::getLocators(MDagPathArray& locators)
+{
+    //Only keep the transforms; "*locator*" matches the shapes as well.
+    MStatus status;
+    MSelectionList locGroup;
+    status = MGlobal::getSelectionListByName(/*"*joint*"*/"*locator*", locGroup);
+    if(!status)
+        return status;
+
+    for(unsigned i = 0; i < locGroup.length(); i++)
+    {
+        MDagPath node;
+        if(locGroup.getDagPath(i, node) && node.apiType() == MFn::kTransform)
+            locators.append(node);
+    }
+    return MS::kSuccess;
 }
 
 MStatus JointRigAnimateCommand::meshBufferOps(unsigned i)
@@ -456,74 +690,676 @@ MStatus JointRigAnimateCommand::meshBufferOps(unsigned i)
     //Used in centroid to update vertices
     //by selection on first frame.
 
+    //Only the frames i-1, i and i+1 are ever needed.
+    m_frameBuffer.releaseBefore(m_prevFrame);
+
     if(i > 1)
         m_prevMeshVertices = getMeshVertices(m_prevFrame);
 
     m_currentMeshVertices = getMeshVertices(m_currentFrame);
     m_nextMeshVertices = getMeshVertices(m_nextFrame);
 
-    m_animControl.setCurrentTime(m_currentFrame);
-    cout << "\n---------\n";
-    cout << "Frame: " << m_animControl.currentTime() << "\n";
-    cout << "---------\n";
+    if(m_frameBuffer.find(m_currentFrame) == NULL)
+        return MS::kFailure;
+
+    TRACKER_LOG(kLogDebug, "Frame: " << m_currentFrame.value());
 
     return status;
 }
 
+MStatus JointRigAnimateCommand::loadBatchFrames(unsigned i, unsigned inFlight, TrackFrame& current, TrackFrame& next,
+                                                MString& error)
+{
+    current = TrackFrame();
+    next = TrackFrame();
+    if(m_cachePath.length() > 0)
+    {
+        //The frames being tracked are up to inFlight frames back, so
+        //frames i-inFlight-1 to i+1 stay resident.
+        double index = i - m_cacheStream.startFrame();
+        if(index < 0 || !m_cacheStream.frame((unsigned)index, current))
+        {
+            error = "jointRig: frame ";
+            error += (int)i;
+            error += " is not in the cache";
+            return MS::kFailure;
+        }
+        m_cacheStream.setWindow(index > inFlight ? (unsigned)index - inFlight - 1 : 0, (unsigned)index + 1);
+        m_cacheStream.frame((unsigned)index + 1, next);
+        return MS::kSuccess;
+    }
+
+    //Pull the frames out of the DG on the main thread. They stay in
+    //m_frameBuffer until the frame has been keyed, and as frames are
+    //only ever added after them the track stage can keep reading them.
+    MTime currentTime;
+    MTime nextTime;
+    currentTime.setValue((double)i);
+    nextTime.setValue((double)i + 1);
+    const MeshFrame* currentMesh = m_frameBuffer.load(currentTime);
+    const MeshFrame* nextMesh = m_frameBuffer.load(nextTime);
+    if(currentMesh == NULL)
+    {
+        error = "jointRig: could not evaluate mesh_fdv on frame ";
+        error += (int)i;
+        return MS::kFailure;
+    }
+
+    current.points = currentMesh->points.data();
+    current.numVertices = currentMesh->numVertices;
+    current.triangles = currentMesh->triangles->data();
+    current.numTriangles = (unsigned)currentMesh->triangles->size() / 3;
+    current.topology = currentMesh->topology;
+
+    if(nextMesh != NULL)
+    {
+        next.points = nextMesh->points.data();
+        next.numVertices = nextMesh->numVertices;
+        next.topology = nextMesh->topology;
+    }
+    TRACKER_LOG(kLogDebug, "Frame: " << i);
+    return MS::kSuccess;
+}
+
+MStatus JointRigAnimateCommand::trackBatch(const MDagPathArray& locators)
+{
+    MStatus status;
+    if(m_cachePath.length() > 0)
+    {
+        if(!m_cacheStream.open(m_cachePath.asChar()))
+        {
+            MGlobal::displayError(MString("jointRig: ") + m_cacheStream.error().c_str());
+            return MS::kFailure;
+        }
+    }
+    else
+    {
+        status = m_frameBuffer.setMesh("mesh_fdv");
+        if(!status)
+        {
+            MGlobal::displayError("jointRig: could not find mesh_fdv");
+            return status;
+        }
+    }
+
+    TrackingEngine engine(m_numThreads);
+    engine.setJoints(std::vector<std::vector<int>>(m_vpVertexIds.begin(), m_vpVertexIds.begin() + m_numJoints));
+    TRACKER_LOG(kLogSummary, "jointRig: tracking " << engine.numJoints() << " joints on " << engine.numThreads()
+                << " threads.");
+
+    //Checkpoints carry every frame so far, so the trajectory is kept
+    //whenever there are checkpoints.
+    bool checkpoints = m_checkpointPath.length() > 0;
+    TrajectoryWriter trajectory;
+    unsigned firstFrame = (unsigned)m_startFrame;
+    unsigned numFrames = m_endFrame > firstFrame ? (unsigned)std::ceil(m_endFrame - firstFrame) : 0;
+    if(m_trajectoryPath.length() > 0 || checkpoints)
+        trajectory.begin(firstFrame, numFrames, std::vector<std::vector<int>>(m_vpVertexIds.begin(),
+                                                                                m_vpVertexIds.begin() + m_numJoints));
+
+    unsigned resumeFrom = firstFrame;
+    if(m_resume)
+    {
+        status = resumeBatch(engine, trajectory, resumeFrom);
+        if(!status)
+            return status;
+    }
+
+    //Frames are pulled, tracked and keyed up to m_pipelineDepth frames
+    //apart, each on its own thread. The DG pulls and the keys stay on
+    //Maya's main thread, which takes turns between them while the
+    //tracking runs alongside; reading a cache file moves off it too.
+    FramePipeline pipeline(m_pipelineDepth);
+    if(m_cachePath.length() == 0)
+        pipeline.runOnCaller(FramePipeline::kProduce);
+    pipeline.runOnCaller(FramePipeline::kCollect);
+    std::vector<BatchSlot> slots(pipeline.numSlots());
+    for(BatchSlot& slot : slots)
+    {
+        slot.positions.resize(m_numJoints);
+        slot.tracked.resize(m_numJoints);
+    }
+
+    MString error;
+    auto produce = [&](unsigned i, unsigned s) {
+        PROFILE_SCOPE("loadFrames");
+        return (bool)loadBatchFrames(i, pipeline.numSlots(), slots[s].current, slots[s].next, error);
+    };
+
+    //Only this stage touches the engine, so it also keeps the trajectory
+    //and writes the checkpoints. Nothing here may call into Maya.
+    std::string trackError;
+    auto track = [&](unsigned i, unsigned s) {
+        BatchSlot& slot = slots[s];
+        //Track every joint in parallel. The first two frames read the
+        //vertex sets by ID, the same as vertUpdateBySelection().
+        {
+            PROFILE_SCOPE("track");
+            engine.trackFrame(slot.current, slot.next);
+        }
+        for(unsigned j = 0; j < m_numJoints; j++)
+        {
+            slot.tracked[j] = engine.jointTracked(j);
+            slot.positions[j] = engine.jointPosition(j);
+        }
+        if(m_trajectoryPath.length() > 0 || checkpoints)
+            trajectory.recordFrame(i - firstFrame, engine);
+
+        if(checkpoints && m_checkpointInterval > 0 && (i + 1 - firstFrame) % m_checkpointInterval == 0
+           && i + 1 < m_endFrame)
+        {
+            PROFILE_SCOPE("checkpoint");
+            TrackingState state;
+            engine.saveState(state);
+            if(!writeCheckpoint(m_checkpointPath.asChar(), i + 1, state, trajectory, trackError))
+                return false;
+        }
+        return true;
+    };
+
+    //Only the keyframe writes happen back here on the main thread.
+    auto collect = [&](unsigned i, unsigned s) {
+        const BatchSlot& slot = slots[s];
+        MTime time;
+        time.setValue((double)i);
+        {
+            PROFILE_SCOPE("addKeys");
+            for(unsigned j = 0; j < m_numJoints; j++)
+            {
+                if(!slot.tracked[j])
+                {
+                    MString message = "jointRig: lost track of joint ";
+                    message += (int)j + 1;
+                    message += " on frame ";
+                    message += (int)i;
+                    MGlobal::displayWarning(message);
+                    continue;
+                }
+
+                const Vec3& position = slot.positions[j];
+                m_curveWriter.addKey(j, time, MPoint(position.x, position.y, position.z));
+            }
+        }
+        if(m_cachePath.length() == 0)
+            m_frameBuffer.releaseBefore(time);
+        Profiler::endFrame();
+        return true;
+    };
+
+    bool tracked = pipeline.run(resumeFrom, (unsigned)std::max((double)resumeFrom, std::ceil(m_endFrame)), produce,
+                                track, collect);
+
+    if(m_cachePath.length() > 0)
+        m_cacheStream.close();
+    else
+        TRACKER_LOG(kLogSummary, "jointRig: evaluated mesh_fdv " << m_frameBuffer.evaluations() << " times for "
+                    << m_endFrame - m_startFrame << " frames.");
+    TRACKER_LOG(kLogSummary, "jointRig: " << pipeline.busySeconds(FramePipeline::kProduce) << " s reading, "
+                << pipeline.busySeconds(FramePipeline::kTrack) << " s tracking and "
+                << pipeline.busySeconds(FramePipeline::kCollect) << " s keying in " << pipeline.seconds() << " s.");
+
+    if(!tracked)
+    {
+        if(pipeline.failedStage() == FramePipeline::kTrack)
+            error = MString("jointRig: ") + trackError.c_str();
+        MGlobal::displayError(error);
+        return MS::kFailure;
+    }
+
+    std::string writeError;
+    if(m_trajectoryPath.length() > 0 && !trajectory.write(m_trajectoryPath.asChar(), writeError))
+    {
+        MGlobal::displayError(MString("jointRig: ") + writeError.c_str());
+        return MS::kFailure;
+    }
+
+    //The track finished, so there is nothing left to resume.
+    if(checkpoints)
+        std::remove(m_checkpointPath.asChar());
+
+    return MS::kSuccess;
+}
+
+MStatus JointRigAnimateCommand::resumeBatch(TrackingEngine& engine, TrajectoryWriter& trajectory, unsigned& resumeFrom)
+{
+    double nextFrame;
+    TrackingState state;
+    TrajectoryWriter saved;
+    std::string error;
+    if(!readCheckpoint(m_checkpointPath.asChar(), nextFrame, state, saved, error))
+    {
+        MGlobal::displayError(MString("jointRig: ") + error.c_str());
+        return MS::kFailure;
+    }
+
+    if(saved.vertexSets() != trajectory.vertexSets())
+    {
+        MGlobal::displayError("jointRig: " + m_checkpointPath + " was saved with other vertex sets");
+        return MS::kFailure;
+    }
+    if(saved.startFrame() != trajectory.startFrame() || saved.numFrames() != trajectory.numFrames()
+       || nextFrame < m_startFrame || nextFrame >= m_endFrame)
+    {
+        MGlobal::displayError("jointRig: " + m_checkpointPath + " is for another frame range");
+        return MS::kFailure;
+    }
+    if(!engine.restoreState(state))
+    {
+        MGlobal::displayError("jointRig: " + m_checkpointPath + " has a bad tracking state");
+        return MS::kFailure;
+    }
+
+    //Key the frames the checkpoint had already tracked.
+    trajectory = saved;
+    resumeFrom = (unsigned)nextFrame;
+    for(unsigned j = 0; j < m_numJoints; j++)
+    {
+        for(unsigned f = 0; f + trajectory.startFrame() < resumeFrom; f++)
+        {
+            if(!trajectory.tracked(j, f))
+                continue;
+            MTime time;
+            time.setValue((double)(trajectory.startFrame() + f));
+            m_curveWriter.addKey(j, time, toMPoint(trajectory.position(j, f)));
+        }
+    }
+    MGlobal::displayInfo(MString("jointRig: resumed from frame ") + (int)resumeFrom);
+    return MS::kSuccess;
+}
+
+MStatus JointRigAnimateCommand::keyFromTrajectory()
+{
+    const TrajectoryReader& trajectory = m_fromTrajectory;
+
+    //Only the part of the file inside -startFrame/-endFrame is keyed.
+    for(unsigned j = 0; j < m_numJoints && j < trajectory.numJoints(); j++)
+    {
+        for(unsigned f = 0; f < trajectory.numFrames(); f++)
+        {
+            double frame = trajectory.startFrame() + f;
+            if(frame < m_startFrame || frame >= m_endFrame || !trajectory.tracked(j, f))
+                continue;
+
+            m_curveWriter.addKey(j, MTime(frame), toMPoint(trajectory.position(j, f)));
+        }
+    }
+    m_fromTrajectory.close();
+    return MS::kSuccess;
+}
+
 MStatus JointRigAnimateCommand::doIt(const MArgList& args)
+{
+    MStatus status = parseArgs(args);
+    if (status != MS::kSuccess) {
+        return status;
+    }
+    LogScope logScope(m_logLevel, m_logFile.asChar());
+    ProfileSession profileSession(m_profile, m_profileTracePath.length() > 0);
+
+    if(m_detect)
+        return proposeJoints();
+
+    status = loadVertexSets();
+    if(!status)
+        return status;
+
+    if(m_exportPath.length() > 0)
+        return exportCache();
+
+    MDagPathArray locators;
+    getLocators(locators);
+    TRACKER_LOG(kLogDebug, "locGroup size: " << locators.length());
+
+    //One locator per vertex set.
+    m_numJoints = std::min((unsigned)m_vpVertexIds.size(), locators.length());
+    if(m_numJoints != m_vpVertexIds.size())
+        MGlobal::displayWarning("jointRig: fewer locators than vertex sets, the extra sets are ignored.");
+
+    if(m_numJoints == 0)
+        return MS::kSuccess;
+
+    MDagPathArray targets;
+    for(unsigned j = 0; j < m_numJoints; j++)
+        targets.append(locators[j]);
+    if(m_node)
+        return createTrackerNode(targets);
+
+    status = m_curveWriter.setTargets(targets);
+    if(!status)
+        return status;
+
+    if(m_fromTrajectoryPath.length() > 0)
+        status = keyFromTrajectory();
+    else if(m_batch)
+        status = trackBatch(locators);
+    else
+        status = trackScrubbing(locators);
+    if(!status)
+        return status;
+
+    //Key the whole range at once.
+    {
+        PROFILE_SCOPE("writeCurves");
+        status = m_curveWriter.write(m_dagModifier);
+        if(!status)
+            return status;
+        PROFILE_COUNT("keysWritten", m_curveWriter.numKeys());
+    }
+    TRACKER_LOG(kLogSummary, "jointRig: wrote " << m_curveWriter.numKeys() << " keys.");
+
+    {
+        PROFILE_SCOPE("applyCurves");
+        status = redoIt();
+    }
+
+    if(m_profile)
+    {
+        Profiler::stop();
+        Log::write(kLogSummary, "jointRig " + Profiler::report());
+
+        std::string error;
+        if(m_profileTracePath.length() > 0 && !Profiler::writeChromeTrace(m_profileTracePath.asChar(), error))
+            MGlobal::displayWarning(MString("jointRig: ") + error.c_str());
+    }
+    return status;
+}
+
+MStatus JointRigAnimateCommand::trackScrubbing(const MDagPathArray& locators)
 {
     MStatus status;
     MDagPath node;
-    MObject component;
-    MSelectionList locGroup;
     MFnDagNode nodeFn;
-    MGlobal::selectByName(/*"*joint*"*/"*locator*");
-    MGlobal::getActiveSelectionList(locGroup);
-    cout << "locGroup size: " << locGroup.length() << "\n";
 
-    if(!locGroup.isEmpty())
+    //Frames are read through the frame buffer as in -batch, so the
+    //timeline and the selection are never touched.
+    status = m_frameBuffer.setMesh("mesh_fdv");
+    if(!status)
     {
-        for(unsigned i = m_startFrame; i < m_endFrame; i++)
-        {
-            meshBufferOps(i);
-
-            //Using total number of vertices in mesh
-            //to figure out if it's a brand new mesh
-            //or not.
-            if(m_currentMeshVertices == m_nextMeshVertices && m_prevMeshVertices == m_currentMeshVertices) {
-                isNewMeshNext = false;
-                isNewMesh = false;
-            }
-            if(m_currentMeshVertices != m_nextMeshVertices)
-                isNewMeshNext = true;
-            if(m_prevMeshVertices != m_currentMeshVertices)
-                isNewMesh = true;
+        MGlobal::displayError("jointRig: could not find mesh_fdv");
+        return status;
+    }
 
-            for (unsigned j = 0; j < 3; j++)
-            {
-                locGroup.getDagPath(j, node, component);
-                nodeFn.setObject(node);
-                MFnTransform location(node);
+    //Sized once up front; the frame loop only updates them in place.
+    m_prevPoints.assign(m_numJoints * 2, MPoint());
+    m_projPoints.assign(m_numJoints * 2, MPoint());
+    m_pointFilters.assign(m_numJoints * 2, MotionFilter());
+    m_pairPoints.reserve(2);
+
+    for(unsigned i = m_startFrame; i < m_endFrame; i++)
+    {
+        status = meshBufferOps(i);
+        if(!status)
+            return status;
+
+        //Using total number of vertices in mesh
+        //to figure out if it's a brand new mesh
+        //or not.
+        if(m_currentMeshVertices == m_nextMeshVertices && m_prevMeshVertices == m_currentMeshVertices) {
+            isNewMeshNext = false;
+            isNewMesh = false;
+        }
+        if(m_currentMeshVertices != m_nextMeshVertices)
+            isNewMeshNext = true;
+        if(m_prevMeshVertices != m_currentMeshVertices)
+            isNewMesh = true;
 
-                cout << "-----------------------------------------------------------" << endl;
-                cout << "Joint " << j+1 << ":\n" << endl;
+        for (unsigned j = 0; j < m_numJoints; j++)
+        {
+            node = locators[j];
+            nodeFn.setObject(node);
+            MFnTransform location(node);
 
-                //Get current location of the joint
+            //Get current location of the joint, only to report it.
+            if(Log::enabled(kLogTrace))
+            {
                 MVector translation = location.getTranslation(MSpace::kWorld);
-                cout << "Joint " << j+1 << "'s old location is (" << translation.x << " x, "
-                     << translation.y << " y, " << translation.z << " z) \n\n";
-
-                //Set new location
-                location.setTranslation(centroid(), MSpace::kWorld);
-                MVector newTranslation = location.getTranslation(MSpace::kWorld);
-                cout << "\nJoint " << j+1 << "'s new location is (" << newTranslation.x << " x, "
-                     << newTranslation.y << " y, " << newTranslation.z << " z) \n";
+                TRACKER_LOG(kLogTrace, "Joint " << j+1 << "'s old location is (" << translation.x << " x, "
+                            << translation.y << " y, " << translation.z << " z)");
             }
 
-            //Set the keyframe.
-            MGlobal::selectByName(/*"*joint*"*/"*locator*");
-            MGlobal::executeCommand("setKeyframe");
+            //Record new location
+            MVector newTranslation = centroid();
+            m_curveWriter.addKey(j, m_currentFrame, newTranslation);
+            TRACKER_LOG(kLogDebug, "Joint " << j+1 << "'s new location is (" << newTranslation.x << " x, "
+                        << newTranslation.y << " y, " << newTranslation.z << " z)");
         }
+        Profiler::endFrame();
+    }
+    return MS::kSuccess;
+}
+
+MStatus JointRigAnimateCommand::exportCache()
+{
+    MStatus status = m_frameBuffer.setMesh("mesh_fdv");
+    if(!status)
+    {
+        MGlobal::displayError("jointRig: could not find mesh_fdv");
+        return status;
+    }
+
+    std::string cachePath = m_exportPath.asChar();
+    std::string setsPath = vertexSetsPath(cachePath);
+
+    std::string error;
+    if(!writeVertexSets(setsPath, m_vpVertexIds, error))
+    {
+        MGlobal::displayError(MString("jointRig: ") + error.c_str());
+        return MS::kFailure;
+    }
+
+    PointCacheWriter writer;
+    if(!writer.open(cachePath, m_startFrame))
+    {
+        MGlobal::displayError(MString("jointRig: ") + writer.error().c_str());
+        return MS::kFailure;
+    }
+
+    //The end frame is included so jointTrack can read it as the next
+    //frame of the last tracked one, the same as trackBatch().
+    std::shared_ptr<const std::vector<int>> written;
+    for(unsigned i = m_startFrame; i <= m_endFrame; i++)
+    {
+        MTime frame((double)i);
+        const MeshFrame* meshFrame = m_frameBuffer.load(frame, &status);
+        if(meshFrame == NULL)
+            return status;
+
+        //Triangles only go in when the topology changes.
+        const std::vector<int>& triangles = *meshFrame->triangles;
+        bool newTopology = meshFrame->triangles != written;
+        if(!writer.writeFrame(meshFrame->points.data(), meshFrame->numVertices,
+                              newTopology ? triangles.data() : NULL, (unsigned)triangles.size() / 3))
+        {
+            MGlobal::displayError(MString("jointRig: ") + writer.error().c_str());
+            return MS::kFailure;
+        }
+        written = meshFrame->triangles;
+        m_frameBuffer.releaseBefore(frame);
+    }
+
+    if(!writer.close())
+    {
+        MGlobal::displayError(MString("jointRig: ") + writer.error().c_str());
+        return MS::kFailure;
+    }
+
+    TRACKER_LOG(kLogSummary, "jointRig: exported " << writer.numFrames() << " frames to " << cachePath << " and "
+                << m_vpVertexIds.size() << " vertex sets to " << setsPath << ".");
+    return MS::kSuccess;
+}
+
+MStatus JointRigAnimateCommand::createTrackerNode(const MDagPathArray& locators)
+{
+    MStatus status;
+    MSelectionList sceneList;
+    MDagPath meshPath;
+    MObject timeNode;
+    if(!sceneList.add("time1") || !sceneList.getDependNode(0, timeNode))
+    {
+        MGlobal::displayError("jointRig: could not find time1");
+        return MS::kFailure;
+    }
+    bool fromCache = m_cachePath.length() > 0;
+    if(!fromCache && (!sceneList.add("mesh_fdv") || !sceneList.getDagPath(1, meshPath) || !meshPath.extendToShape()))
+    {
+        MGlobal::displayError("jointRig: could not find mesh_fdv");
+        return MS::kFailure;
+    }
+
+    MObject tracker = m_dagModifier.createNode(JointTrackerNode::id, &status);
+    if(!status)
+        return status;
+
+    //The mesh, or with -cache the point cache, and the time drive the
+    //node. The start frame and vertex sets are set once and can be edited
+    //on the node afterwards.
+    if(fromCache)
+        m_dagModifier.newPlugValueString(MPlug(tracker, JointTrackerNode::cacheFile), m_cachePath);
+    else
+    {
+        MFnDagNode meshFn(meshPath);
+        MPlug worldMesh = meshFn.findPlug("worldMesh", false).elementByLogicalIndex(meshPath.instanceNumber());
+        m_dagModifier.connect(worldMesh, MPlug(tracker, JointTrackerNode::inMesh));
+    }
+    m_dagModifier.connect(MFnDependencyNode(timeNode).findPlug("outTime", false), MPlug(tracker, JointTrackerNode::time));
+    m_dagModifier.newPlugValueMTime(MPlug(tracker, JointTrackerNode::startTime), MTime(m_startFrame, MTime::uiUnit()));
+
+    MPlug setPlugs(tracker, JointTrackerNode::vertexSet);
+    MPlug translatePlugs(tracker, JointTrackerNode::outTranslate);
+    for(unsigned j = 0; j < m_numJoints; j++)
+    {
+        const std::vector<int>& ids = m_vpVertexIds[j];
+        MIntArray idArray((unsigned)ids.size());
+        for(unsigned i = 0; i < ids.size(); i++)
+            idArray[i] = ids[i];
+        MFnIntArrayData idData;
+        MObject idObject = idData.create(idArray, &status);
+        if(!status)
+            return status;
+        m_dagModifier.newPlugValue(setPlugs.elementByLogicalIndex(j), idObject);
+
+        //The locator's translate animation, keyed by an earlier run, is
+        //replaced by the node. Undo brings it back.
+        MFnDagNode locatorFn(locators[j]);
+        MPlug translate = locatorFn.findPlug("translate", false);
+        MPlugArray sources;
+        if(translate.connectedTo(sources, true, false))
+            m_dagModifier.disconnect(sources[0], translate);
+        for(unsigned c = 0; c < translate.numChildren(); c++)
+        {
+            MPlug child = translate.child(c);
+            if(child.connectedTo(sources, true, false))
+                m_dagModifier.disconnect(sources[0], child);
+        }
+        m_dagModifier.connect(translatePlugs.elementByLogicalIndex(j), translate);
+    }
+
+    status = redoIt();
+    if(!status)
+        return status;
+
+    MFnDependencyNode trackerFn(tracker);
+    TRACKER_LOG(kLogSummary, "jointRig: " << trackerFn.name().asChar() << " drives " << m_numJoints << " locators.");
+    setResult(trackerFn.name());
+    return MS::kSuccess;
+}
+
+MStatus JointRigAnimateCommand::proposeJoints()
+{
+    MStatus status;
+    MSelectionList sceneList;
+    if(sceneList.add("vp1"))
+    {
+        MGlobal::displayError("jointRig: vp1 already exists, delete the vertex sets before using -detect");
+        return MS::kFailure;
+    }
+    if(!sceneList.add("mesh_fdv") || !sceneList.getDagPath(0, m_landmarkMesh) || !m_landmarkMesh.extendToShape())
+    {
+        MGlobal::displayError("jointRig: could not find mesh_fdv");
+        return MS::kFailure;
+    }
+
+    status = m_frameBuffer.setMesh("mesh_fdv");
+    if(!status)
+        return status;
+    m_currentFrame.setValue(m_startFrame);
+    const MeshFrame* meshFrame = m_frameBuffer.load(m_currentFrame, &status);
+    if(meshFrame == NULL)
+    {
+        MString message = "jointRig: could not read mesh_fdv on frame ";
+        message += m_startFrame;
+        MGlobal::displayError(message);
+        return MS::kFailure;
+    }
+
+    LandmarkOptions options;
+    options.numThreads = m_numThreads;
+    m_landmarks = detectLandmarks(meshFrame->points.data(), meshFrame->numVertices, meshFrame->triangles->data(),
+                                  (unsigned)meshFrame->triangles->size() / 3, options);
+    if(m_landmarks.empty())
+    {
+        MGlobal::displayError("jointRig: found no limbs on mesh_fdv");
+        return MS::kFailure;
+    }
+
+    //One vertex set and one locator per joint, numbered the way
+    //loadVertexSets() and getLocators() read them back.
+    MDGModifier& dgModifier = m_landmarkModifier;
+    for(unsigned k = 0; k < m_landmarks.size(); k++)
+    {
+        MString index;
+        index.set((int)k + 1);
+
+        MObject set = dgModifier.createNode("objectSet", &status);
+        if(!status)
+            return status;
+        m_landmarkModifier.renameNode(set, "vp" + index);
+        m_landmarkSets.push_back(set);
+
+        MObject locator = m_landmarkModifier.createNode("locator", MObject::kNullObj, &status);
+        if(!status)
+            return status;
+        m_landmarkModifier.renameNode(locator, "locator" + index);
+        m_landmarkLocators.push_back(locator);
+    }
+
+    status = redoIt();
+    if(!status)
+        return status;
+
+    TRACKER_LOG(kLogSummary, "jointRig: proposed " << m_landmarks.size() << " joints on "
+                << m_landmarks.back().limb + 1 << " limbs.");
+    return MS::kSuccess;
+}
+
+MStatus JointRigAnimateCommand::placeProposedJoints()
+{
+    MStatus status;
+    for(unsigned k = 0; k < m_landmarks.size(); k++)
+    {
+        const Landmark& landmark = m_landmarks[k];
+        MIntArray ids((unsigned)landmark.vertices.size());
+        for(unsigned i = 0; i < landmark.vertices.size(); i++)
+            ids[i] = landmark.vertices[i];
+
+        MFnSingleIndexedComponent componentFn;
+        MObject component = componentFn.create(MFn::kMeshVertComponent, &status);
+        if(!status)
+            return status;
+        componentFn.addElements(ids);
+
+        MSelectionList members;
+        members.add(m_landmarkMesh, component);
+        MFnSet setFn(m_landmarkSets[k]);
+        status = setFn.addMembers(members);
+        if(!status)
+            return status;
+
+        //The locators are parented to the world, where the mesh points are.
+        MFnTransform locatorFn(m_landmarkLocators[k]);
+        status = locatorFn.setTranslation(toMVector(landmark.position), MSpace::kTransform);
+        if(!status)
+            return status;
     }
     return MS::kSuccess;
 }
@@ -531,7 +1367,24 @@ MStatus JointRigAnimateCommand::doIt(const MArgList& args)
 MSyntax JointRigAnimateCommand::cmdSyntax()
 {
     MSyntax syntax;
-    syntax.addFlag(kStartFrame, kEndFrame, MSyntax::kUnsigned);
+    syntax.addFlag(kStartFrameFlag, kStartFrameLongFlag, MSyntax::kDouble);
+    syntax.addFlag(kEndFrameFlag, kEndFrameLongFlag, MSyntax::kDouble);
+    syntax.addFlag(kBatchFlag, kBatchLongFlag);
+    syntax.addFlag(kThreadsFlag, kThreadsLongFlag, MSyntax::kUnsigned);
+    syntax.addFlag(kExportCacheFlag, kExportCacheLongFlag, MSyntax::kString);
+    syntax.addFlag(kCacheFlag, kCacheLongFlag, MSyntax::kString);
+    syntax.addFlag(kTrajectoryFlag, kTrajectoryLongFlag, MSyntax::kString);
+    syntax.addFlag(kFromTrajectoryFlag, kFromTrajectoryLongFlag, MSyntax::kString);
+    syntax.addFlag(kVerbosityFlag, kVerbosityLongFlag, MSyntax::kString);
+    syntax.addFlag(kLogFileFlag, kLogFileLongFlag, MSyntax::kString);
+    syntax.addFlag(kProfileFlag, kProfileLongFlag);
+    syntax.addFlag(kProfileTraceFlag, kProfileTraceLongFlag, MSyntax::kString);
+    syntax.addFlag(kNodeFlag, kNodeLongFlag);
+    syntax.addFlag(kDetectFlag, kDetectLongFlag);
+    syntax.addFlag(kCheckpointFlag, kCheckpointLongFlag, MSyntax::kString);
+    syntax.addFlag(kCheckpointIntervalFlag, kCheckpointIntervalLongFlag, MSyntax::kUnsigned);
+    syntax.addFlag(kResumeFlag, kResumeLongFlag);
+    syntax.addFlag(kPipelineDepthFlag, kPipelineDepthLongFlag, MSyntax::kUnsigned);
     return syntax;
 }
 
@@ -540,6 +1393,14 @@ MStatus initializePlugin(MObject obj)
     MStatus status;
     MFnPlugin plugin(obj, PLUGIN_COMPANY, "3.0", "Any");
 
+    status = plugin.registerNode(JointTrackerNode::kTypeName, JointTrackerNode::id, JointTrackerNode::creator,
+                                 JointTrackerNode::initialize);
+    if (!status)
+    {
+        status.perror("registerNode");
+        return status;
+    }
+
     status = plugin.registerCommand( "jointRig", JointRigAnimateCommand::creator);
     if (!status)
     {
@@ -557,5 +1418,10 @@ MStatus uninitializePlugin(MObject obj) {
     if (!status) {
         status.perror("deregisterCommand");
     }
+
+    status = plugin.deregisterNode(JointTrackerNode::id);
+    if (!status) {
+        status.perror("deregisterNode");
+    }
     return status;
 }
\ No newline at end of file
@@ -0,0 +1,370 @@
+//
+// jointTracker: tracks joints live in the dependency graph.
+//
+#include "jointTrackerNode.h"
+#include "log.h"
+#include "profiler.h"
+
+#include <maya/MFnTypedAttribute.h>
+#include <maya/MFnUnitAttribute.h>
+#include <maya/MFnNumericAttribute.h>
+#include <maya/MFnNumericData.h>
+#include <maya/MFnIntArrayData.h>
+#include <maya/MArrayDataHandle.h>
+#include <maya/MArrayDataBuilder.h>
+#include <maya/MDataHandle.h>
+#include <maya/MIntArray.h>
+#include <maya/MEvaluationManager.h>
+#include <maya/MProfiler.h>
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace
+{
+    //Frames are whole frames in the scene's time unit.
+    int toFrame(const MTime& time)
+    {
+        return (int)std::floor(time.as(MTime::uiUnit()) + 0.5);
+    }
+
+    MTime toTime(int frame)
+    {
+        return MTime((double)frame, MTime::uiUnit());
+    }
+
+    TrackFrame toTrackFrame(const MeshFrame& mesh)
+    {
+        TrackFrame frame;
+        frame.points = mesh.points.data();
+        frame.numVertices = mesh.numVertices;
+        frame.triangles = mesh.triangles->data();
+        frame.numTriangles = (unsigned)mesh.triangles->size() / 3;
+        frame.topology = mesh.topology;
+        return frame;
+    }
+
+    //Groups the node's events in the Evaluation Toolkit profiler.
+    int s_profilerCategory = 0;
+}
+
+//From the block of IDs Maya leaves for in-house plug-ins.
+MTypeId JointTrackerNode::id(0x0007F001);
+const char* JointTrackerNode::kTypeName = "jointTracker";
+
+MObject JointTrackerNode::inMesh;
+MObject JointTrackerNode::cacheFile;
+MObject JointTrackerNode::time;
+MObject JointTrackerNode::startTime;
+MObject JointTrackerNode::vertexSet;
+MObject JointTrackerNode::outTranslate;
+MObject JointTrackerNode::outTranslateX;
+MObject JointTrackerNode::outTranslateY;
+MObject JointTrackerNode::outTranslateZ;
+MObject JointTrackerNode::outConfidence;
+
+const unsigned JointTrackerNode::kTrackingThreads;
+
+JointTrackerNode::JointTrackerNode()
+    : m_cache(std::max(1u, std::min(kTrackingThreads, std::thread::hardware_concurrency())))
+{
+}
+
+JointTrackerNode::~JointTrackerNode() {}
+
+void* JointTrackerNode::creator()
+{
+    return new JointTrackerNode;
+}
+
+MPxNode::SchedulingType JointTrackerNode::schedulingType() const
+{
+    //All state is the node's own and guarded by m_mutex, and under the
+    //Evaluation Manager compute never pulls on other nodes.
+    return MPxNode::kParallel;
+}
+
+MStatus JointTrackerNode::initialize()
+{
+    MStatus status;
+    MFnTypedAttribute typedAttr;
+    MFnUnitAttribute unitAttr;
+    MFnNumericAttribute numericAttr;
+
+    inMesh = typedAttr.create("inMesh", "im", MFnData::kMesh, MObject::kNullObj, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    typedAttr.setStorable(false);
+
+    cacheFile = typedAttr.create("cacheFile", "cf", MFnData::kString, MObject::kNullObj, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    typedAttr.setUsedAsFilename(true);
+
+    time = unitAttr.create("time", "tm", MFnUnitAttribute::kTime, 0.0, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    startTime = unitAttr.create("startTime", "st", MTime(1.0, MTime::uiUnit()), &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    vertexSet = typedAttr.create("vertexSet", "vs", MFnData::kIntArray, MObject::kNullObj, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    typedAttr.setArray(true);
+
+    outTranslateX = numericAttr.create("outTranslateX", "otx", MFnNumericData::kDouble, 0.0, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    outTranslateY = numericAttr.create("outTranslateY", "oty", MFnNumericData::kDouble, 0.0, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    outTranslateZ = numericAttr.create("outTranslateZ", "otz", MFnNumericData::kDouble, 0.0, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    outTranslate = numericAttr.create("outTranslate", "ot", outTranslateX, outTranslateY, outTranslateZ, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    numericAttr.setArray(true);
+    numericAttr.setUsesArrayDataBuilder(true);
+    numericAttr.setWritable(false);
+    numericAttr.setStorable(false);
+
+    outConfidence = numericAttr.create("outConfidence", "oc", MFnNumericData::kFloat, 0.0, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    numericAttr.setArray(true);
+    numericAttr.setUsesArrayDataBuilder(true);
+    numericAttr.setWritable(false);
+    numericAttr.setStorable(false);
+
+    MObject inputs[] = {inMesh, cacheFile, time, startTime, vertexSet};
+    MObject outputs[] = {outTranslate, outConfidence};
+    for (const MObject& attribute : inputs)
+    {
+        status = addAttribute(attribute);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+    }
+    for (const MObject& attribute : outputs)
+    {
+        status = addAttribute(attribute);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+    }
+    for (const MObject& input : inputs)
+    {
+        for (const MObject& output : outputs)
+        {
+            status = attributeAffects(input, output);
+            CHECK_MSTATUS_AND_RETURN_IT(status);
+        }
+    }
+
+    s_profilerCategory = MProfiler::addCategory(kTypeName);
+    return MS::kSuccess;
+}
+
+MStatus JointTrackerNode::compute(const MPlug& plug, MDataBlock& data)
+{
+    MObject attribute = plug.attribute();
+    if (attribute != outTranslate && attribute != outTranslateX && attribute != outTranslateY
+        && attribute != outTranslateZ && attribute != outConfidence)
+        return MS::kUnknownParameter;
+
+    MProfilingScope profilingScope(s_profilerCategory, MProfiler::kColorE_L3, "compute", kTypeName);
+    PROFILE_SCOPE("jointTracker");
+    std::lock_guard<std::mutex> lock(m_mutex);
+    MStatus status;
+
+    std::vector<std::vector<int>> sets;
+    status = readVertexSets(data, sets);
+    if (!status)
+        return status;
+    m_cache.setJoints(sets);
+
+    int startFrame = toFrame(data.inputValue(startTime).asTime());
+    int frame = toFrame(data.inputValue(time).asTime());
+    m_cache.setStartFrame(startFrame);
+
+    status = setCacheFile(data.inputValue(cacheFile).asString());
+    if (!status)
+        return status;
+
+    //Before the start frame the joints hold where they are on it.
+    bool evaluated = frame >= startFrame;
+    if (!evaluated)
+        frame = startFrame;
+
+    if (m_cachePath.length() > 0)
+        trackFromFile(frame);
+    else
+    {
+        status = trackFromMesh(data, frame, evaluated);
+        if (!status)
+            return status;
+    }
+
+    status = writeOutputs(data, frame);
+    if (!status)
+        return status;
+    data.setClean(plug);
+    return MS::kSuccess;
+}
+
+MStatus JointTrackerNode::readVertexSets(MDataBlock& data, std::vector<std::vector<int>>& sets)
+{
+    MStatus status;
+    MArrayDataHandle setHandles = data.inputArrayValue(vertexSet, &status);
+    if (!status)
+        return status;
+
+    //Joints are numbered by vertexSet index. Unset indices in between
+    //are joints with no vertices, which are never tracked.
+    for (unsigned i = 0; i < setHandles.elementCount(); i++)
+    {
+        setHandles.jumpToArrayElement(i);
+        unsigned joint = setHandles.elementIndex();
+        if (joint >= sets.size())
+            sets.resize(joint + 1);
+
+        MFnIntArrayData idsData(setHandles.inputValue().data(), &status);
+        if (!status)
+            continue;
+        MIntArray ids = idsData.array();
+        sets[joint].resize(ids.length());
+        if (ids.length() > 0)
+            ids.get(sets[joint].data());
+    }
+    return MS::kSuccess;
+}
+
+MStatus JointTrackerNode::setCacheFile(const MString& path)
+{
+    if (path == m_cachePath)
+        return MS::kSuccess;
+
+    //Frames from another source are tracked from scratch.
+    m_cache.clear();
+    m_cacheStream.close();
+    m_cachePath = path;
+    //A cache that does not open leaves every frame untracked until the
+    //path changes again, rather than trying again on every frame.
+    if (path.length() > 0 && !m_cacheStream.open(path.asChar()))
+    {
+        TRACKER_LOG(kLogSummary, "jointTracker: " << m_cacheStream.error());
+        return MS::kFailure;
+    }
+    return MS::kSuccess;
+}
+
+void JointTrackerNode::trackFromFile(int frame)
+{
+    //Any frame of the cache can be read at any time, so frames are
+    //tracked the same whatever order they are evaluated in. Frames
+    //outside the cache are left untracked.
+    MProfilingScope profilingScope(s_profilerCategory, MProfiler::kColorE_L2, "trackFromFile");
+    while (!m_cache.cached(frame) && m_cache.numJoints() > 0)
+    {
+        int f = m_cache.nextFrame();
+        double index = f - m_cacheStream.startFrame();
+        TrackFrame current;
+        if (index < 0 || !m_cacheStream.frame((unsigned)index, current))
+            break;
+
+        //The next frame is only a stand in for a prediction until the
+        //track has history, and vertex IDs need none while the topology
+        //holds, so it is left out here and for inMesh alike.
+        m_cache.track(current, TrackFrame(), current.topology);
+        m_cacheStream.setWindow(index > 0 ? (unsigned)index - 1 : 0, (unsigned)index + 1);
+    }
+}
+
+MStatus JointTrackerNode::trackFromMesh(MDataBlock& data, int frame, bool evaluated)
+{
+    MProfilingScope profilingScope(s_profilerCategory, MProfiler::kColorE_L2, "trackFromMesh");
+    MStatus status;
+    if (!m_hasPlug)
+    {
+        m_frames.setPlug(MPlug(thisMObject(), inMesh));
+        m_frames.setHistory(kHistoryFrames);
+        m_hasPlug = true;
+    }
+
+    //The data block holds the mesh at the evaluated time. A cached frame
+    //tracked from a different mesh is dropped, along with everything
+    //tracked after it.
+    if (evaluated)
+    {
+        MObject meshData = data.inputValue(inMesh, &status).asMesh();
+        if (!status)
+            return status;
+        const MeshFrame* mesh = m_frames.store(toTime(frame), meshData, &status);
+        if (mesh == NULL)
+            return status;
+        m_cache.validate(frame, mesh->fingerprint);
+    }
+
+    //In DG mode the frames between the last tracked one and this one are
+    //pulled through inMesh at their own time. The Evaluation Manager
+    //evaluates nodes in parallel and does not allow that, so there they
+    //are tracked as they are evaluated, such as during playback, or read
+    //back from the frame buffer's history, and the frames waiting on them
+    //are kept until then.
+    bool pull = !MEvaluationManager::evaluationManagerActive(data.context());
+
+    while (!m_cache.cached(frame) && m_cache.numJoints() > 0)
+    {
+        int f = m_cache.nextFrame();
+        const MeshFrame* current = pull ? m_frames.load(toTime(f), &status) : m_frames.recall(toTime(f));
+        if (current == NULL)
+            break;
+
+        if (!m_cache.track(toTrackFrame(*current), TrackFrame(), current->fingerprint))
+            TRACKER_LOG(kLogDebug, "jointTracker: lost track of a joint on frame " << f);
+    }
+
+    m_frames.releaseBefore(toTime(m_cache.nextFrame()));
+    m_frames.releaseAfter(toTime(m_cache.nextFrame() + kMaxWaitingFrames));
+    return MS::kSuccess;
+}
+
+MStatus JointTrackerNode::writeOutputs(MDataBlock& data, int frame)
+{
+    MStatus status;
+    unsigned numJoints = m_cache.numJoints();
+    MArrayDataHandle translateHandles = data.outputArrayValue(outTranslate, &status);
+    if (!status)
+        return status;
+    MArrayDataHandle confidenceHandles = data.outputArrayValue(outConfidence, &status);
+    if (!status)
+        return status;
+
+    MArrayDataBuilder translates(&data, outTranslate, numJoints, &status);
+    if (!status)
+        return status;
+    MArrayDataBuilder confidences(&data, outConfidence, numJoints, &status);
+    if (!status)
+        return status;
+
+    //A frame that could not be tracked yet shows the last tracked one
+    //with no confidence.
+    bool cached = m_cache.cached(frame);
+    int shown = cached ? frame : std::min(frame, m_cache.endFrame() - 1);
+    bool hasShown = m_cache.cached(shown);
+    for (unsigned j = 0; j < numJoints; j++)
+    {
+        Vec3 position;
+        float confidence = 0;
+        if (hasShown)
+            position = m_cache.position(shown, j);
+        if (cached)
+            confidence = m_cache.confidence(frame, j);
+
+        MDataHandle translate = translates.addElement(j, &status);
+        if (!status)
+            return status;
+        translate.set3Double(position.x, position.y, position.z);
+
+        MDataHandle confidenceHandle = confidences.addElement(j, &status);
+        if (!status)
+            return status;
+        confidenceHandle.setFloat(confidence);
+    }
+
+    translateHandles.set(translates);
+    confidenceHandles.set(confidences);
+    translateHandles.setAllClean();
+    confidenceHandles.setAllClean();
+    return MS::kSuccess;
+}
@@ -0,0 +1,96 @@
+//
+// jointTracker: tracks joints live in the dependency graph.
+//
+// Takes the capture mesh and one vertex set per joint and outputs every
+// joint's world space position at the current time, so tracked joints can
+// drive locators or a skeleton directly instead of being baked by jointRig.
+// Tracked frames are cached on the node. Scrubbing back over them costs
+// nothing, and a change to an input only drops the frames it affects.
+//
+// The node only reads its inputs through its data block and has no side
+// effects on the scene, so the Evaluation Manager may run it in parallel
+// with the rest of the rig.
+//
+#ifndef JOINTRIGANIM_JOINTTRACKERNODE_H
+#define JOINTRIGANIM_JOINTTRACKERNODE_H
+
+#include <maya/MPxNode.h>
+#include <maya/MTypeId.h>
+#include <maya/MObject.h>
+#include <maya/MPlug.h>
+#include <maya/MDataBlock.h>
+#include <maya/MString.h>
+#include <maya/MTime.h>
+
+#include "frameBuffer.h"
+#include "pointCacheStream.h"
+#include "trackCache.h"
+
+#include <mutex>
+#include <vector>
+
+class JointTrackerNode: public MPxNode
+{
+public:
+    JointTrackerNode();
+    ~JointTrackerNode() override;
+    MStatus compute(const MPlug& plug, MDataBlock& data) override;
+    SchedulingType schedulingType() const override;
+    static void* creator();
+    static MStatus initialize();
+
+    static MTypeId id;
+    static const char* kTypeName;
+
+    //World space mesh, normally the capture mesh's worldMesh[0].
+    static MObject inMesh;
+    //Point cache written by jointRig -exportCache. When set the frames
+    //are read from it instead of inMesh.
+    static MObject cacheFile;
+    //Current time, normally time1.outTime.
+    static MObject time;
+    //Frame the vertex sets were picked on. Tracking starts here and
+    //earlier frames hold the joints where they are on this one.
+    static MObject startTime;
+    //One int array of vertex IDs per joint, indexed by joint.
+    static MObject vertexSet;
+
+    //Per joint outputs, at the vertexSet index of the joint.
+    static MObject outTranslate;
+    static MObject outTranslateX;
+    static MObject outTranslateY;
+    static MObject outTranslateZ;
+    //0 when the joint lost track, see TrackingEngine::jointConfidence(),
+    //or the frame could not be tracked yet.
+    static MObject outConfidence;
+
+    //Frames after the last tracked one that are held on to while the
+    //frames in between have not been evaluated yet.
+    static const int kMaxWaitingFrames = 32;
+    //Frames kept compressed after they are tracked, so a track started
+    //over, on new vertex sets or a new start time, reads them back
+    //instead of evaluating inMesh again.
+    static const unsigned kHistoryFrames = 120;
+    //Threads a node tracks on, counting the Evaluation Manager thread
+    //computing it. Nodes are evaluated side by side, so each takes a few
+    //rather than one per core.
+    static const unsigned kTrackingThreads = 4;
+
+private:
+    MStatus readVertexSets(MDataBlock& data, std::vector<std::vector<int>>& sets);
+    MStatus setCacheFile(const MString& path);
+    void trackFromFile(int frame);
+    MStatus trackFromMesh(MDataBlock& data, int frame, bool evaluated);
+    MStatus writeOutputs(MDataBlock& data, int frame);
+
+    //Compute can be called for several contexts at once, by cached
+    //playback for one, so the cache is only touched under m_mutex.
+    std::mutex m_mutex;
+    TrackCache m_cache;
+    FrameBuffer m_frames;
+    bool m_hasPlug = false;
+    MString m_cachePath;
+    PointCacheStream m_cacheStream;
+};
+
+#endif //JOINTRIGANIM_JOINTTRACKERNODE_H
@@ -0,0 +1,32 @@
+//
+// Conversions between Maya's point types and the trackerCore Vec3.
+//
+#ifndef JOINTRIGANIM_MAYAVEC3_H
+#define JOINTRIGANIM_MAYAVEC3_H
+
+#include <maya/MPoint.h>
+#include <maya/MVector.h>
+
+#include "vec3.h"
+
+inline Vec3 toVec3(const MPoint& point)
+{
+    return Vec3(point.x, point.y, point.z);
+}
+
+inline Vec3 toVec3(const MVector& vector)
+{
+    return Vec3(vector.x, vector.y, vector.z);
+}
+
+inline MPoint toMPoint(const Vec3& vec)
+{
+    return MPoint(vec.x, vec.y, vec.z);
+}
+
+inline MVector toMVector(const Vec3& vec)
+{
+    return MVector(vec.x, vec.y, vec.z);
+}
+
+#endif //JOINTRIGANIM_MAYAVEC3_H
@@ -1,9 +1,16 @@
 //
 // Created by Derek Roberts on 2019-06-20
 //
-// This plug-in takes three user created locators placed at joint locations,
-// computes the distance between the locators, computes the local joint angle
-// at the middle joint, and outputs the local angle in the console.
+// This plug-in takes user created locators placed at joint locations, or
+// the root joint of a skeleton, and computes the local joint angle at the
+// middle joint of every three joint chain.
+//
+// Without a frame range the angles at the current time are printed and
+// returned. With -startFrame and -endFrame every frame of the range is
+// sampled once, the angles of all chains and frames are computed in one
+// batch, and the result is keyed onto a localAngle attribute of each
+// chain's middle joint, or with -output written to a limb angle file
+// without touching the scene.
 //
 // Initially created as a test plug-in to better understand the Maya API.
 //
@@ -11,88 +18,467 @@
 #include <maya/MIOStream.h>
 #include <maya/MGlobal.h>
 #include <maya/MString.h>
-#include <maya/MSimple.h>
+#include <maya/MStringArray.h>
+#include <maya/MPxCommand.h>
+#include <maya/MSyntax.h>
+#include <maya/MArgParser.h>
+#include <maya/MArgList.h>
+#include <maya/MFnPlugin.h>
 #include <maya/MDagPath.h>
+#include <maya/MDagPathArray.h>
 #include <maya/MFnDagNode.h>
-#include <maya/MFnTransform.h>
-#include <maya/MDagModifier.h>
+#include <maya/MDGModifier.h>
+#include <maya/MDGContext.h>
+#include <maya/MDGContextGuard.h>
 #include <maya/MSelectionList.h>
-#include <maya/MVector.h>
+#include <maya/MAnimControl.h>
+#include <maya/MFnAnimCurve.h>
+#include <maya/MFnMatrixData.h>
+#include <maya/MFnNumericAttribute.h>
+#include <maya/MFnNumericData.h>
+#include <maya/MMatrix.h>
+#include <maya/MPlug.h>
+#include <maya/MPlugArray.h>
+#include <maya/MTime.h>
+#include <maya/MTimeArray.h>
+#include <maya/MDoubleArray.h>
 #include <vector>
-#include <math.h>
-
-DeclareSimpleCommand(limbLocalAngle, "Autodesk", "1.0")
-
-MStatus limbLocalAngle::doIt(const MArgList &)
-{
-    MDagPath node;
-    MObject component;
-    MSelectionList locGroup;
-    MFnDagNode nodeFn;
-    std::vector<MVector> locations;
-    std::vector<long double> distances;
-
-    // Select the locators
-    MGlobal::selectByName("locator*");
-    MGlobal::getActiveSelectionList(locGroup);
-    if(!locGroup.isEmpty()) {
-        for (unsigned int i = 0; i < locGroup.length(); i++) {
-
-            // Get the locations of the locators in the world space.
-            locGroup.getDagPath(i, node, component);
-            nodeFn.setObject(node);
-            MFnTransform location(node);
-            MVector translation = location.getTranslation(MSpace::kWorld);
-            locations.push_back(translation);
-            cout << nodeFn.name().asChar() << " is selected." << "\n";
+#include <cmath>
+
+#include "limbAngle.h"
+
+namespace
+{
+    //Keyed on the middle joint of each chain. Further chains through the
+    //same joint get localAngle1, localAngle2 and so on.
+    const char* kAngleAttribute = "localAngle";
+}
+
+class LimbLocalAngleCommand: public MPxCommand
+{
+public:
+    LimbLocalAngleCommand();
+    ~LimbLocalAngleCommand() override;
+    MStatus parseArgs(const MArgList& args);
+    MStatus doIt(const MArgList& args) override;
+    MStatus redoIt() override;
+    MStatus undoIt() override;
+    MSyntax cmdSyntax();
+    bool isUndoable() const override;
+    static void* creator();
+private:
+    MStatus findChains(const MSelectionList& objects);
+    void addSkeletonChains(const MDagPath& parent, const MDagPath& joint);
+    unsigned addJoint(const MDagPath& path);
+    MStatus sampleFrame(unsigned frame);
+    MStatus showAngles();
+    MStatus keyAngles();
+    const char *kStartFrameFlag = "-s";
+    const char *kStartFrameLongFlag = "-startFrame";
+    const char *kEndFrameFlag = "-e";
+    const char *kEndFrameLongFlag = "-endFrame";
+    const char *kOutputFlag = "-o";
+    const char *kOutputLongFlag = "-output";
+
+    //Locators and joints named on the command line, or the selection.
+    MSelectionList m_objects;
+
+    //A frame range turns on batch mode. A missing end of the range comes
+    //from the playback range.
+    bool m_batch = false;
+    double m_startFrame = 0;
+    double m_endFrame = 0;
+    MString m_outputPath;
+
+    //Every joint used by a chain, once, and its world matrix plug.
+    MDagPathArray m_joints;
+    std::vector<MPlug> m_worldMatrices;
+    std::vector<LimbChain> m_chains;
+
+    //World positions of the joints, joint after joint of m_numFrames
+    //values per axis, so each joint is a JointPositions for limbAngles().
+    unsigned m_numFrames = 0;
+    std::vector<float> m_x;
+    std::vector<float> m_y;
+    std::vector<float> m_z;
+    //Chain after chain of m_numFrames angles in degrees.
+    std::vector<float> m_angles;
+
+    //Attributes and curves added by keyAngles().
+    MDGModifier m_dgModifier;
+    bool m_keyed = false;
+};
+
+LimbLocalAngleCommand::LimbLocalAngleCommand() {}
+LimbLocalAngleCommand::~LimbLocalAngleCommand() {}
+
+void* LimbLocalAngleCommand::creator()
+{
+    return new LimbLocalAngleCommand;
+}
+
+bool LimbLocalAngleCommand::isUndoable() const
+{
+    return m_keyed;
+}
+
+MStatus LimbLocalAngleCommand::redoIt()
+{
+    return m_dgModifier.doIt();
+}
+
+MStatus LimbLocalAngleCommand::undoIt()
+{
+    return m_dgModifier.undoIt();
+}
+
+MStatus LimbLocalAngleCommand::parseArgs(const MArgList& args)
+{
+    MStatus status;
+    MArgParser argData(cmdSyntax(), args, &status);
+    if(!status)
+        return status;
+
+    m_batch = argData.isFlagSet(kStartFrameFlag) || argData.isFlagSet(kEndFrameFlag);
+    m_startFrame = MAnimControl::minTime().as(MTime::uiUnit());
+    m_endFrame = MAnimControl::maxTime().as(MTime::uiUnit());
+    if(argData.isFlagSet(kStartFrameFlag))
+        argData.getFlagArgument(kStartFrameFlag, 0, m_startFrame);
+    if(argData.isFlagSet(kEndFrameFlag))
+        argData.getFlagArgument(kEndFrameFlag, 0, m_endFrame);
+    if(m_batch && m_endFrame < m_startFrame)
+    {
+        MGlobal::displayError("limbLocalAngle: -endFrame is before -startFrame");
+        return MS::kFailure;
+    }
+
+    if(argData.isFlagSet(kOutputFlag))
+    {
+        argData.getFlagArgument(kOutputFlag, 0, m_outputPath);
+        if(!m_batch)
+        {
+            MGlobal::displayError("limbLocalAngle: -output needs a frame range");
+            return MS::kFailure;
+        }
+    }
+
+    //Named objects first, then the selection, then every locator in the
+    //scene the way the command has always worked.
+    MStringArray names;
+    argData.getObjects(names);
+    for(unsigned i = 0; i < names.length(); i++)
+    {
+        if(!m_objects.add(names[i]))
+        {
+            MGlobal::displayError(MString("limbLocalAngle: could not find ") + names[i]);
+            return MS::kFailure;
+        }
+    }
+    if(m_objects.isEmpty())
+        MGlobal::getActiveSelectionList(m_objects);
+    if(m_objects.isEmpty())
+        MGlobal::getSelectionListByName("locator*", m_objects);
+    return status;
+}
+
+MStatus LimbLocalAngleCommand::doIt(const MArgList& args)
+{
+    MStatus status = parseArgs(args);
+    if(!status)
+        return status;
+
+    status = findChains(m_objects);
+    if(!status)
+        return status;
+    if(m_chains.empty())
+    {
+        MGlobal::displayError("limbLocalAngle: select three locators per limb or the root joint of a skeleton");
+        return MS::kFailure;
+    }
+
+    //Every joint is evaluated once per frame, in the context of that
+    //frame, so the timeline never moves.
+    m_numFrames = m_batch ? (unsigned)std::floor(m_endFrame - m_startFrame) + 1 : 1;
+    size_t numValues = (size_t)m_joints.length() * m_numFrames;
+    m_x.resize(numValues);
+    m_y.resize(numValues);
+    m_z.resize(numValues);
+    for(unsigned frame = 0; frame < m_numFrames; frame++)
+    {
+        if(m_batch)
+        {
+            MDGContext context(MTime(m_startFrame + frame, MTime::uiUnit()));
+            MDGContextGuard contextGuard(context);
+            status = sampleFrame(frame);
         }
-        for (unsigned int i = 0; i < locGroup.length(); i++) {
-            if (!locations.empty()) {
-
-                // Output locator position in centimeters.
-                cout << "Locator " << i + 1 << ": " << "\n";
-                cout << locations[i].x * 100 << " cm\n";
-                cout << locations[i].y * 100 << " cm\n";
-                cout << locations[i].z * 100 << " cm\n";
-
-                if ((i + 1) % 3 == 0 && i > 0 && (i + 1) % 3 <= locGroup.length()) {
-
-                    // If this is the third locator, calculate the distance between
-                    // this locator and the first locator to get the third side
-                    // of the triangle we'll use to calculate the local joint angle.
-                    auto x = (locations[i].x - locations[i - 2].x) * 100;
-                    auto y = (locations[i].y - locations[i - 2].y) * 100;
-                    auto z = (locations[i].z - locations[i - 2].z) * 100;
-                    auto distance = sqrt(pow(x, 2) + pow(y, 2) + pow(z, 2));
-                    distances.push_back(distance);
-
-                    cout << "Distance between Locator " << i - 1 << " and Locator " << i + 1 << ": " << distance
-                         << " cm\n";
-
-                    // Use the law of cosines to derive the angle we want.
-                    auto theta = acos((pow(distances[i - 2], 2) + pow(distances[i - 1], 2) - pow(distances[i], 2)) /
-                                      (2 * distances[i - 2] * distances[i - 1])) * 180 / 3.1415;
-
-                    cout << "Computed momentary local angle " << theta << " degrees" << "\n";
-                }
-                if (i + 1 < locGroup.length() && (i + 1) % 3 != 0) {
-
-                    // Get the other sides of the triangle.
-                    auto x = (locations[i + 1].x - locations[i].x) * 100;
-                    auto y = (locations[i + 1].y - locations[i].y) * 100;
-                    auto z = (locations[i + 1].z - locations[i].z) * 100;
-                    auto distance = sqrt(pow(x, 2) + pow(y, 2) + pow(z, 2));
-                    distances.push_back(distance);
-
-                    cout << "Computed delta-x: " << abs(x) << " cm" << " Computed delta-y: " << abs(y) << " cm"
-                         << " Computed delta-z: " << abs(z) << " cm\n";
-                    cout << "Distance between Locator " << i + 1 << " and Locator " << i + 2 << ": " << distance
-                         << " cm\n";
-                }
+        else
+            status = sampleFrame(frame);
+        if(!status)
+            return status;
+    }
+
+    std::vector<JointPositions> joints(m_joints.length());
+    for(unsigned j = 0; j < m_joints.length(); j++)
+    {
+        size_t first = (size_t)j * m_numFrames;
+        joints[j] = {m_x.data() + first, m_y.data() + first, m_z.data() + first};
+    }
+    limbAngles(joints, m_chains, m_numFrames, m_angles);
+
+    if(!m_batch)
+        return showAngles();
+
+    if(m_outputPath.length() > 0)
+    {
+        std::string error;
+        if(!writeLimbAngles(m_outputPath.asChar(), m_startFrame, (unsigned)m_chains.size(), m_numFrames, m_angles,
+                            error))
+        {
+            MGlobal::displayError(MString("limbLocalAngle: ") + error.c_str());
+            return MS::kFailure;
+        }
+        MGlobal::displayInfo(MString("limbLocalAngle: wrote ") + (int)m_chains.size() + " chains over "
+                             + (int)m_numFrames + " frames to " + m_outputPath);
+        return MS::kSuccess;
+    }
+
+    status = keyAngles();
+    if(!status)
+        return status;
+    m_keyed = true;
+    return redoIt();
+}
+
+MStatus LimbLocalAngleCommand::findChains(const MSelectionList& objects)
+{
+    //Locators make a chain three at a time, in the order they are given.
+    std::vector<unsigned> limb;
+    for(unsigned i = 0; i < objects.length(); i++)
+    {
+        MDagPath path;
+        if(!objects.getDagPath(i, path))
+            continue;
+
+        if(path.hasFn(MFn::kJoint))
+        {
+            for(unsigned c = 0; c < path.childCount(); c++)
+            {
+                MDagPath child = path;
+                child.push(path.child(c));
+                if(child.hasFn(MFn::kJoint))
+                    addSkeletonChains(path, child);
             }
+            continue;
+        }
+
+        //"locator*" also matches the locator shapes.
+        if(!path.hasFn(MFn::kTransform))
+            continue;
+
+        limb.push_back(addJoint(path));
+        if(limb.size() == 3)
+        {
+            m_chains.push_back({limb[0], limb[1], limb[2]});
+            limb.clear();
         }
     }
+
+    if(!limb.empty())
+        MGlobal::displayWarning(MString("limbLocalAngle: ignoring ") + (int)limb.size()
+                                + " locators that do not make a full limb");
+    return MS::kSuccess;
+}
+
+void LimbLocalAngleCommand::addSkeletonChains(const MDagPath& parent, const MDagPath& joint)
+{
+    //Every joint between a parent and a child joint is the middle of a
+    //chain, one per child. Selecting joints of the same skeleton more
+    //than once finds the same chains again, so those are skipped.
+    for(unsigned c = 0; c < joint.childCount(); c++)
+    {
+        MDagPath child = joint;
+        child.push(joint.child(c));
+        if(!child.hasFn(MFn::kJoint))
+            continue;
+
+        LimbChain chain = {addJoint(parent), addJoint(joint), addJoint(child)};
+        bool found = false;
+        for(const LimbChain& known : m_chains)
+            found = found || (known.a == chain.a && known.b == chain.b && known.c == chain.c);
+        if(!found)
+            m_chains.push_back(chain);
+        addSkeletonChains(joint, child);
+    }
+}
+
+unsigned LimbLocalAngleCommand::addJoint(const MDagPath& path)
+{
+    for(unsigned j = 0; j < m_joints.length(); j++)
+    {
+        if(m_joints[j] == path)
+            return j;
+    }
+
+    MFnDagNode nodeFn(path);
+    MPlug worldMatrix = nodeFn.findPlug("worldMatrix", false);
+    m_worldMatrices.push_back(worldMatrix.elementByLogicalIndex(path.instanceNumber()));
+    m_joints.append(path);
+    return m_joints.length() - 1;
+}
+
+MStatus LimbLocalAngleCommand::sampleFrame(unsigned frame)
+{
+    MStatus status;
+    for(unsigned j = 0; j < m_joints.length(); j++)
+    {
+        MObject matrixData = m_worldMatrices[j].asMObject(&status);
+        if(!status)
+            return status;
+        MFnMatrixData matrixFn(matrixData, &status);
+        if(!status)
+            return status;
+
+        MMatrix matrix = matrixFn.matrix();
+        size_t index = (size_t)j * m_numFrames + frame;
+        m_x[index] = (float)matrix(3, 0);
+        m_y[index] = (float)matrix(3, 1);
+        m_z[index] = (float)matrix(3, 2);
+    }
+    return status;
+}
+
+MStatus LimbLocalAngleCommand::showAngles()
+{
+    MDoubleArray result;
+    for(unsigned i = 0; i < m_chains.size(); i++)
+    {
+        const LimbChain& chain = m_chains[i];
+        result.append(m_angles[i]);
+        MGlobal::displayInfo(MString("limbLocalAngle: ") + m_joints[chain.b].partialPathName() + " between "
+                             + m_joints[chain.a].partialPathName() + " and " + m_joints[chain.c].partialPathName()
+                             + " is at " + (double)m_angles[i] + " degrees");
+    }
+    setResult(result);
     return MS::kSuccess;
 }
 
+MStatus LimbLocalAngleCommand::keyAngles()
+{
+    MStatus status;
 
+    //One attribute per chain on its middle joint. The attributes have
+    //to exist before their plugs can be found, so they are added first.
+    std::vector<unsigned> chainsAtJoint(m_joints.length(), 0);
+    MStringArray attributeNames;
+    for(const LimbChain& chain : m_chains)
+    {
+        MString name = kAngleAttribute;
+        unsigned count = chainsAtJoint[chain.b]++;
+        if(count > 0)
+            name += (int)count;
+        attributeNames.append(name);
+
+        MFnDagNode nodeFn(m_joints[chain.b]);
+        if(nodeFn.hasAttribute(name))
+            continue;
+
+        MFnNumericAttribute attributeFn;
+        MObject attribute = attributeFn.create(name, name, MFnNumericData::kDouble, 0, &status);
+        if(!status)
+            return status;
+        attributeFn.setKeyable(true);
+        status = m_dgModifier.addAttribute(m_joints[chain.b].node(), attribute);
+        if(!status)
+            return status;
+    }
+    status = m_dgModifier.doIt();
+    if(!status)
+        return status;
+
+    for(unsigned i = 0; i < m_chains.size(); i++)
+    {
+        MFnDagNode nodeFn(m_joints[m_chains[i].b]);
+        MPlug plug = nodeFn.findPlug(attributeNames[i], false, &status);
+        if(!status)
+            return status;
+
+        //Frames where a joint could not be placed are left unkeyed.
+        MTimeArray times;
+        MDoubleArray values;
+        const float* angles = m_angles.data() + (size_t)i * m_numFrames;
+        for(unsigned frame = 0; frame < m_numFrames; frame++)
+        {
+            if(std::isnan(angles[frame]))
+                continue;
+            times.append(MTime(m_startFrame + frame, MTime::uiUnit()));
+            values.append(angles[frame]);
+        }
+
+        //A curve from an earlier run is replaced as a whole.
+        MPlugArray sources;
+        if(plug.connectedTo(sources, true, false) && sources.length() > 0
+           && sources[0].node().hasFn(MFn::kAnimCurve))
+        {
+            status = m_dgModifier.disconnect(sources[0], plug);
+            if(!status)
+                return status;
+            status = m_dgModifier.deleteNode(sources[0].node());
+            if(!status)
+                return status;
+        }
+
+        MFnAnimCurve curve;
+        curve.create(MFnAnimCurve::kAnimCurveTU, &m_dgModifier, &status);
+        if(!status)
+            return status;
+        status = curve.addKeys(&times, &values);
+        if(!status)
+            return status;
+
+        MPlug output = curve.findPlug("output", false, &status);
+        if(!status)
+            return status;
+        status = m_dgModifier.connect(output, plug);
+        if(!status)
+            return status;
+    }
+
+    MGlobal::displayInfo(MString("limbLocalAngle: keyed ") + (int)m_chains.size() + " chains over "
+                         + (int)m_numFrames + " frames");
+    return status;
+}
+
+MSyntax LimbLocalAngleCommand::cmdSyntax()
+{
+    MSyntax syntax;
+    syntax.addFlag(kStartFrameFlag, kStartFrameLongFlag, MSyntax::kDouble);
+    syntax.addFlag(kEndFrameFlag, kEndFrameLongFlag, MSyntax::kDouble);
+    syntax.addFlag(kOutputFlag, kOutputLongFlag, MSyntax::kString);
+    syntax.setObjectType(MSyntax::kStringObjects);
+    return syntax;
+}
+
+MStatus initializePlugin(MObject obj)
+{
+    MStatus status;
+    MFnPlugin plugin(obj, PLUGIN_COMPANY, "2.0", "Any");
+
+    status = plugin.registerCommand("limbLocalAngle", LimbLocalAngleCommand::creator);
+    if (!status)
+    {
+        status.perror("registerCommand");
+        return status;
+    }
+    return status;
+}
+
+MStatus uninitializePlugin(MObject obj) {
+    MStatus status;
+    MFnPlugin plugin(obj);
+
+    status = plugin.deregisterCommand("limbLocalAngle");
+    if (!status) {
+        status.perror("deregisterCommand");
+    }
+    return status;
+}
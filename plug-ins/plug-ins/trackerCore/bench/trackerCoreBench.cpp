@@ -0,0 +1,666 @@
+//
+// Throughput of the trackerCore building blocks on procedural meshes, and
+// speed, memory and accuracy of each tracking stage on a synthetic capture
+// with known joint positions.
+//
+#include "frameCache.h"
+#include "jointEstimate.h"
+#include "landmarks.h"
+#include "limbAngle.h"
+#include "meshBvh.h"
+#include "motionFilter.h"
+#include "surfaceWalk.h"
+#include "trackingEngine.h"
+#include "../tests/syntheticCapture.h"
+#include "../tests/testMesh.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <random>
+#include <string>
+
+//Every heap allocation in the process, so the tracking benchmarks can
+//show that a tracked frame allocates nothing. Blocks go straight to
+//malloc and free, the count is all that is kept. GCC would flag a
+//mismatched allocation wherever one of these is inlined into a caller
+//next to the other, so they are kept out of line.
+#if defined(__GNUC__)
+#define TRACKERCORE_NOINLINE __attribute__((noinline))
+#else
+#define TRACKERCORE_NOINLINE
+#endif
+
+static std::atomic<unsigned long> s_allocations(0);
+
+TRACKERCORE_NOINLINE void* operator new(std::size_t size)
+{
+    s_allocations++;
+    void* memory = std::malloc(size > 0 ? size : 1);
+    if (memory == nullptr)
+        throw std::bad_alloc();
+    return memory;
+}
+
+TRACKERCORE_NOINLINE void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+TRACKERCORE_NOINLINE void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+//A size field of /proc/self/status in kilobytes, 0 where there is none.
+static long long statusKilobytes(const std::string& field)
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, field.size(), field) == 0)
+            return std::atoll(line.c_str() + field.size());
+    }
+    return 0;
+}
+
+//Resets the process' peak resident memory, so the capture benchmarks can
+//report their own, and returns the memory resident now, from which
+//peakMegabytes() measures. Where the peak cannot be reset it is the
+//process' peak so far.
+static long long resetPeak()
+{
+    std::ofstream("/proc/self/clear_refs") << "5";
+    return statusKilobytes("VmRSS:");
+}
+
+static double peakMegabytes(long long baseline)
+{
+    return (double)std::max(0LL, statusKilobytes("VmHWM:") - baseline) / 1024;
+}
+
+static std::vector<std::vector<int>> makeJointSets(unsigned numJoints, unsigned numVertices)
+{
+    std::vector<std::vector<int>> sets;
+    for (unsigned j = 0; j < numJoints; j++)
+        sets.push_back({(int)((j * 1000 + 17) % numVertices), (int)((j * 1000 + 163) % numVertices)});
+    return sets;
+}
+
+static void BM_BvhBuild(benchmark::State& state)
+{
+    unsigned side = (unsigned)state.range(0);
+    TestMesh mesh = makeSphere(side, side, 1.0, Vec3());
+    MeshBvh bvh;
+    for (auto _ : state)
+        bvh.build(mesh.points.data(), mesh.numVertices(), mesh.triangles.data(), mesh.numTriangles());
+    state.counters["triangles"] = mesh.numTriangles();
+}
+BENCHMARK(BM_BvhBuild)->Arg(100)->Arg(300)->Unit(benchmark::kMillisecond);
+
+static void BM_BvhRefit(benchmark::State& state)
+{
+    unsigned side = (unsigned)state.range(0);
+    TestMesh mesh = makeSphere(side, side, 1.0, Vec3());
+    MeshBvh bvh;
+    bvh.build(mesh.points.data(), mesh.numVertices(), mesh.triangles.data(), mesh.numTriangles());
+    for (auto _ : state)
+        bvh.refit(mesh.points.data(), mesh.numVertices());
+}
+BENCHMARK(BM_BvhRefit)->Arg(100)->Arg(300)->Unit(benchmark::kMillisecond);
+
+static void BM_BvhClosestPoint(benchmark::State& state)
+{
+    TestMesh mesh = makeSphere(300, 300, 1.0, Vec3());
+    MeshBvh bvh;
+    bvh.build(mesh.points.data(), mesh.numVertices(), mesh.triangles.data(), mesh.numTriangles());
+
+    //Queries near the surface, like projected tracking points.
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> jitter(-0.02f, 0.02f);
+    std::vector<float> queries;
+    for (unsigned i = 0; i < 1024; i++)
+    {
+        Vec3 p = mesh.vertex((int)(random() % mesh.numVertices()));
+        queries.push_back((float)p.x + jitter(random));
+        queries.push_back((float)p.y + jitter(random));
+        queries.push_back((float)p.z + jitter(random));
+    }
+
+    std::vector<BvhHit> hits(1024);
+    for (auto _ : state)
+        bvh.closestPoints(queries.data(), 1024, hits.data());
+    state.SetItemsProcessed(state.iterations() * 1024);
+}
+BENCHMARK(BM_BvhClosestPoint);
+
+//The same queries as BM_BvhClosestPoint, each walked from where its point
+//was found a frame earlier, a few millimetres away on a 2m figure.
+static void BM_SurfaceWalk(benchmark::State& state)
+{
+    TestMesh mesh = makeSphere(300, 300, 1.0, Vec3());
+    MeshBvh bvh;
+    bvh.build(mesh.points.data(), mesh.numVertices(), mesh.triangles.data(), mesh.numTriangles());
+    SurfaceWalk walk;
+    walk.build(mesh.numVertices(), mesh.triangles.data(), mesh.numTriangles());
+
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> jitter(-0.02f, 0.02f);
+    std::uniform_real_distribution<float> motion(-0.005f, 0.005f);
+    std::vector<float> queries;
+    std::vector<int> starts;
+    for (unsigned i = 0; i < 1024; i++)
+    {
+        Vec3 p = mesh.vertex((int)(random() % mesh.numVertices()));
+        float query[] = {(float)p.x + jitter(random), (float)p.y + jitter(random), (float)p.z + jitter(random)};
+        queries.insert(queries.end(), query, query + 3);
+        float previous[] = {query[0] + motion(random), query[1] + motion(random), query[2] + motion(random)};
+        starts.push_back(bvh.closestPoint(previous).triangle);
+    }
+
+    for (auto _ : state)
+    {
+        for (unsigned i = 0; i < 1024; i++)
+            benchmark::DoNotOptimize(walk.closestPoint(mesh.points.data(), &queries[i * 3], starts[i]));
+    }
+    state.SetItemsProcessed(state.iterations() * 1024);
+}
+BENCHMARK(BM_SurfaceWalk);
+
+static void BM_RobustCentroid(benchmark::State& state)
+{
+    unsigned count = (unsigned)state.range(0);
+    std::mt19937 random(3);
+    std::normal_distribution<float> noise(0.0f, 0.05f);
+    std::vector<float> x(count), y(count), z(count), weights(count);
+    for (unsigned i = 0; i < count; i++)
+    {
+        double angle = 6.283185307179586 * i / count;
+        x[i] = (float)(50 + 4 * std::cos(angle)) + noise(random);
+        y[i] = 120 + noise(random);
+        z[i] = (float)(-10 + 4 * std::sin(angle)) + noise(random);
+    }
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(robustCentroid(x.data(), y.data(), z.data(), count, weights.data()));
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_RobustCentroid)->Arg(2)->Arg(16)->Arg(128)->Arg(1024);
+
+//A 20 joint rig with 19 chains over a take of range(0) frames.
+static void BM_LimbAngles(benchmark::State& state)
+{
+    unsigned numFrames = (unsigned)state.range(0);
+    const unsigned numJoints = 20;
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::vector<std::vector<float>> values(numJoints * 3, std::vector<float>(numFrames));
+    for (std::vector<float>& axis : values)
+        for (float& value : axis)
+            value = position(random);
+
+    std::vector<JointPositions> joints;
+    for (unsigned j = 0; j < numJoints; j++)
+        joints.push_back({values[j * 3].data(), values[j * 3 + 1].data(), values[j * 3 + 2].data()});
+    std::vector<LimbChain> chains;
+    for (unsigned j = 1; j + 1 < numJoints; j++)
+        chains.push_back({j - 1, j, j + 1});
+
+    std::vector<float> angles;
+    for (auto _ : state)
+    {
+        limbAngles(joints, chains, numFrames, angles);
+        benchmark::DoNotOptimize(angles.data());
+    }
+    state.SetItemsProcessed(state.iterations() * numFrames * chains.size());
+}
+BENCHMARK(BM_LimbAngles)->Arg(1000)->Arg(10000)->Unit(benchmark::kMicrosecond);
+
+//Joint proposals on a sphere of range(0) x range(0) vertices with
+//range(1) threads. 450 x 450 is about the size of a full body capture.
+static void BM_DetectLandmarks(benchmark::State& state)
+{
+    unsigned side = (unsigned)state.range(0);
+    TestMesh mesh = makeSphere(side, side, 1.0, Vec3());
+    LandmarkOptions options;
+    options.numThreads = (unsigned)state.range(1);
+    for (auto _ : state)
+    {
+        std::vector<Landmark> landmarks = detectLandmarks(mesh.points.data(), mesh.numVertices(),
+                                                          mesh.triangles.data(), mesh.numTriangles(), options);
+        benchmark::DoNotOptimize(landmarks.data());
+    }
+    state.SetItemsProcessed(state.iterations() * mesh.numVertices());
+}
+BENCHMARK(BM_DetectLandmarks)->Args({450, 1})->Args({450, 0})->Unit(benchmark::kMillisecond);
+
+static void BM_TrackFrame(benchmark::State& state)
+{
+    unsigned numJoints = (unsigned)state.range(0);
+    TestMesh mesh = makeSphere(300, 300, 1.0, Vec3());
+
+    TrackingEngine engine((unsigned)state.range(1));
+    engine.setJoints(makeJointSets(numJoints, mesh.numVertices()));
+    //Get past the selection frames and the first BVH build.
+    TrackFrame frame = mesh.trackFrame();
+    for (unsigned i = 0; i <= TrackingEngine::kSelectionFrames; i++)
+        engine.trackFrame(frame, frame);
+
+    unsigned long allocations = s_allocations;
+    for (auto _ : state)
+        engine.trackFrame(frame, frame);
+    state.counters["allocationsPerFrame"] = (double)(s_allocations - allocations) / state.iterations();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TrackFrame)
+    ->Args({3, 1})
+    ->Args({60, 1})
+    ->Args({60, 0})
+    ->Args({2000, 1})
+    ->Args({2000, 0})
+    ->Unit(benchmark::kMicrosecond);
+
+//Every frame a new topology, so every frame builds a BVH and searches.
+static void BM_TrackTopologyChange(benchmark::State& state)
+{
+    unsigned numJoints = (unsigned)state.range(0);
+    TestMesh mesh = makeSphere(300, 300, 1.0, Vec3());
+
+    TrackingEngine engine((unsigned)state.range(1));
+    engine.setJoints(makeJointSets(numJoints, mesh.numVertices()));
+    TrackFrame frame = mesh.trackFrame();
+    for (unsigned i = 0; i < TrackingEngine::kSelectionFrames; i++)
+        engine.trackFrame(frame, frame);
+
+    uint64_t topology = 1;
+    for (auto _ : state)
+    {
+        frame.topology = topology++;
+        engine.trackFrame(frame, frame);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TrackTopologyChange)->Args({60, 1})->Args({60, 0})->Unit(benchmark::kMicrosecond);
+
+//The surface points of every joint's vertex set on each frame, over the
+//first keyframe of capture, as x, y and z arrays of frame after frame of
+//joint after joint.
+struct CapturePoints
+{
+    unsigned pointsPerJoint;
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+
+    unsigned offset(const SyntheticCapture& capture, unsigned frame, unsigned joint) const
+    {
+        return (frame * capture.numJoints() + joint) * pointsPerJoint;
+    }
+};
+
+static CapturePoints gatherPoints(const SyntheticCapture& capture)
+{
+    std::vector<std::vector<int>> sets = capture.vertexSets();
+    CapturePoints gathered;
+    gathered.pointsPerJoint = (unsigned)sets[0].size();
+    std::vector<float> points;
+    for (unsigned f = 0; f < capture.numFrames(); f++)
+    {
+        capture.frame(f, points);
+        for (const std::vector<int>& set : sets)
+        {
+            for (int id : set)
+            {
+                gathered.x.push_back(points[id * 3]);
+                gathered.y.push_back(points[id * 3 + 1]);
+                gathered.z.push_back(points[id * 3 + 2]);
+            }
+        }
+    }
+    return gathered;
+}
+
+static void setErrorCounters(benchmark::State& state, double sum, double worst, unsigned count, const char* unit)
+{
+    state.counters[std::string("meanError") + unit] = count > 0 ? sum / count : 0.0;
+    state.counters[std::string("maxError") + unit] = worst;
+}
+
+//The whole tracker over a 240 frame capture of range(0) vertices around
+//each capsule, with a new keyframe mesh every 60 frames, on range(1)
+//threads. Items are frames; the error is every joint on every frame.
+static void BM_CaptureTrack(benchmark::State& state)
+{
+    CaptureOptions options;
+    options.numFrames = 240;
+    options.resolution = (unsigned)state.range(0);
+    options.remeshInterval = 60;
+    SyntheticCapture capture(options);
+    std::vector<std::vector<int>> sets = capture.vertexSets();
+    std::vector<float> current;
+    std::vector<float> next;
+
+    long long baseline = resetPeak();
+    double errorSum = 0;
+    double errorMax = 0;
+    unsigned errorCount = 0;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        TrackingEngine engine((unsigned)state.range(1));
+        engine.setJoints(sets);
+        TrackFrame nextFrame = capture.frame(0, next);
+        state.ResumeTiming();
+
+        for (unsigned f = 0; f < capture.numFrames(); f++)
+        {
+            state.PauseTiming();
+            current.swap(next);
+            TrackFrame currentFrame = nextFrame;
+            currentFrame.points = current.data();
+            nextFrame = f + 1 < capture.numFrames() ? capture.frame(f + 1, next) : TrackFrame();
+            state.ResumeTiming();
+
+            engine.trackFrame(currentFrame, nextFrame);
+
+            state.PauseTiming();
+            for (unsigned j = 0; j < engine.numJoints(); j++)
+            {
+                double error = (engine.jointPosition(j) - capture.joint(j, f)).length();
+                errorSum += error;
+                errorMax = std::max(errorMax, error);
+                errorCount++;
+            }
+            state.ResumeTiming();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * capture.numFrames());
+    state.counters["vertices"] = capture.numVertices(0);
+    state.counters["peakMegabytes"] = peakMegabytes(baseline);
+    setErrorCounters(state, errorSum, errorMax, errorCount, "Cm");
+}
+BENCHMARK(BM_CaptureTrack)
+    ->Args({32, 1})
+    ->Args({128, 1})
+    ->Args({128, 0})
+    ->Unit(benchmark::kMillisecond);
+
+//The closest point step: every tracked point of the capture in range(0)
+//resolution searched for on 8 frames, from where constant velocity
+//predicts it. Items are queries; the error is how far each hit lands from
+//where the vertex really is.
+static void BM_CaptureClosestPoint(benchmark::State& state)
+{
+    CaptureOptions options;
+    options.numFrames = 240;
+    options.resolution = (unsigned)state.range(0);
+    SyntheticCapture capture(options);
+    options.noise = 0;
+    SyntheticCapture truth(options);
+    std::vector<std::vector<int>> sets = capture.vertexSets();
+
+    long long baseline = resetPeak();
+    const unsigned numSamples = 8;
+    std::vector<MeshBvh> bvhs(numSamples);
+    std::vector<std::vector<float>> queries(numSamples);
+    std::vector<std::vector<float>> expected(numSamples);
+    std::vector<float> points;
+    std::vector<float> before;
+    std::vector<float> earlier;
+    for (unsigned s = 0; s < numSamples; s++)
+    {
+        unsigned f = 2 + s * (capture.numFrames() - 2) / numSamples;
+        TrackFrame frame = capture.frame(f, points);
+        bvhs[s].build(frame.points, frame.numVertices, frame.triangles, frame.numTriangles);
+        truth.frame(f - 1, before);
+        truth.frame(f - 2, earlier);
+        TrackFrame exact = truth.frame(f, points);
+        for (const std::vector<int>& set : sets)
+        {
+            for (int id : set)
+            {
+                for (unsigned axis = 0; axis < 3; axis++)
+                {
+                    queries[s].push_back(2 * before[id * 3 + axis] - earlier[id * 3 + axis]);
+                    expected[s].push_back(exact.points[id * 3 + axis]);
+                }
+            }
+        }
+    }
+
+    unsigned numQueries = (unsigned)queries[0].size() / 3;
+    std::vector<BvhHit> hits(numQueries);
+    double errorSum = 0;
+    double errorMax = 0;
+    for (unsigned s = 0; s < numSamples; s++)
+    {
+        bvhs[s].closestPoints(queries[s].data(), numQueries, hits.data());
+        for (unsigned q = 0; q < numQueries; q++)
+        {
+            const float* e = &expected[s][q * 3];
+            Vec3 error(hits[q].point[0] - e[0], hits[q].point[1] - e[1], hits[q].point[2] - e[2]);
+            errorSum += error.length();
+            errorMax = std::max(errorMax, error.length());
+        }
+    }
+
+    unsigned sample = 0;
+    for (auto _ : state)
+    {
+        bvhs[sample].closestPoints(queries[sample].data(), numQueries, hits.data());
+        benchmark::DoNotOptimize(hits.data());
+        sample = (sample + 1) % numSamples;
+    }
+    state.SetItemsProcessed(state.iterations() * numQueries);
+    state.counters["vertices"] = capture.numVertices(0);
+    state.counters["peakMegabytes"] = peakMegabytes(baseline);
+    setErrorCounters(state, errorSum, errorMax, numSamples * numQueries, "Cm");
+}
+BENCHMARK(BM_CaptureClosestPoint)->Arg(32)->Arg(128)->Unit(benchmark::kMicrosecond);
+
+//The prediction step: one motion filter per tracked point, fed the noisy
+//surface points of a 1000 frame capture. Items are filter updates; the
+//error is how far each prediction lands from the noiseless point on the
+//next frame.
+static void BM_CapturePrediction(benchmark::State& state)
+{
+    CaptureOptions options;
+    options.numFrames = 1000;
+    SyntheticCapture capture(options);
+    CapturePoints measured = gatherPoints(capture);
+    options.noise = 0;
+    CapturePoints exact = gatherPoints(SyntheticCapture(options));
+    unsigned numPoints = capture.numJoints() * measured.pointsPerJoint;
+
+    std::vector<MotionFilter> filters(numPoints);
+    double errorSum = 0;
+    double errorMax = 0;
+    unsigned errorCount = 0;
+    for (unsigned f = 0; f + 1 < capture.numFrames(); f++)
+    {
+        for (unsigned p = 0; p < numPoints; p++)
+        {
+            unsigned i = f * numPoints + p;
+            filters[p].update(Vec3(measured.x[i], measured.y[i], measured.z[i]));
+            //Let the filter settle before scoring it.
+            if (f < 10)
+                continue;
+            unsigned n = i + numPoints;
+            double error = (filters[p].predicted() - Vec3(exact.x[n], exact.y[n], exact.z[n])).length();
+            errorSum += error;
+            errorMax = std::max(errorMax, error);
+            errorCount++;
+        }
+    }
+
+    for (auto _ : state)
+    {
+        for (MotionFilter& filter : filters)
+            filter.reset();
+        for (unsigned i = 0; i < capture.numFrames() * numPoints; i++)
+            filters[i % numPoints].update(Vec3(measured.x[i], measured.y[i], measured.z[i]));
+        benchmark::DoNotOptimize(filters.data());
+    }
+    state.SetItemsProcessed(state.iterations() * capture.numFrames() * numPoints);
+    setErrorCounters(state, errorSum, errorMax, errorCount, "Cm");
+}
+BENCHMARK(BM_CapturePrediction)->Unit(benchmark::kMicrosecond);
+
+//The centroid step: every joint's robust centre of its noisy surface
+//points on every frame of a 1000 frame capture. Items are joint
+//estimates; the error is the distance from the true joint.
+static void BM_CaptureCentroid(benchmark::State& state)
+{
+    CaptureOptions options;
+    options.numFrames = 1000;
+    options.noise = 0.2;
+    SyntheticCapture capture(options);
+    CapturePoints measured = gatherPoints(capture);
+    std::vector<float> weights(measured.pointsPerJoint);
+
+    double errorSum = 0;
+    double errorMax = 0;
+    for (unsigned f = 0; f < capture.numFrames(); f++)
+    {
+        for (unsigned j = 0; j < capture.numJoints(); j++)
+        {
+            unsigned offset = measured.offset(capture, f, j);
+            Vec3 centre = robustCentroid(&measured.x[offset], &measured.y[offset], &measured.z[offset],
+                                         measured.pointsPerJoint, weights.data());
+            double error = (centre - capture.joint(j, f)).length();
+            errorSum += error;
+            errorMax = std::max(errorMax, error);
+        }
+    }
+
+    unsigned numEstimates = capture.numFrames() * capture.numJoints();
+    for (auto _ : state)
+    {
+        for (unsigned e = 0; e < numEstimates; e++)
+        {
+            unsigned offset = e * measured.pointsPerJoint;
+            benchmark::DoNotOptimize(robustCentroid(&measured.x[offset], &measured.y[offset], &measured.z[offset],
+                                                    measured.pointsPerJoint, weights.data()));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * numEstimates);
+    setErrorCounters(state, errorSum, errorMax, numEstimates, "Cm");
+}
+BENCHMARK(BM_CaptureCentroid)->Unit(benchmark::kMicrosecond);
+
+//The limb angle step: the angle at every inner joint over a 1000 frame
+//capture, from the joints the centroid step estimates. Items are angles;
+//the error is in degrees from the true angle.
+static void BM_CaptureLimbAngles(benchmark::State& state)
+{
+    CaptureOptions options;
+    options.numFrames = 1000;
+    options.noise = 0.2;
+    SyntheticCapture capture(options);
+    CapturePoints measured = gatherPoints(capture);
+    std::vector<float> weights(measured.pointsPerJoint);
+
+    unsigned numFrames = capture.numFrames();
+    std::vector<std::vector<float>> values(capture.numJoints() * 3, std::vector<float>(numFrames));
+    for (unsigned f = 0; f < numFrames; f++)
+    {
+        for (unsigned j = 0; j < capture.numJoints(); j++)
+        {
+            unsigned offset = measured.offset(capture, f, j);
+            Vec3 centre = robustCentroid(&measured.x[offset], &measured.y[offset], &measured.z[offset],
+                                         measured.pointsPerJoint, weights.data());
+            values[j * 3][f] = (float)centre.x;
+            values[j * 3 + 1][f] = (float)centre.y;
+            values[j * 3 + 2][f] = (float)centre.z;
+        }
+    }
+    std::vector<JointPositions> joints;
+    for (unsigned j = 0; j < capture.numJoints(); j++)
+        joints.push_back({values[j * 3].data(), values[j * 3 + 1].data(), values[j * 3 + 2].data()});
+    std::vector<LimbChain> chains = capture.chains();
+
+    std::vector<float> angles;
+    for (auto _ : state)
+    {
+        limbAngles(joints, chains, numFrames, angles);
+        benchmark::DoNotOptimize(angles.data());
+    }
+
+    double errorSum = 0;
+    double errorMax = 0;
+    for (unsigned c = 0; c < chains.size(); c++)
+    {
+        for (unsigned f = 0; f < numFrames; f++)
+        {
+            double error = std::fabs(angles[c * numFrames + f] - capture.jointAngle(chains[c].b, f));
+            errorSum += error;
+            errorMax = std::max(errorMax, error);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * numFrames * chains.size());
+    setErrorCounters(state, errorSum, errorMax, numFrames * (unsigned)chains.size(), "Degrees");
+}
+BENCHMARK(BM_CaptureLimbAngles)->Unit(benchmark::kMicrosecond);
+
+//The frame cache: a 120 frame window of the capture in range(0)
+//resolution, read forward when range(1) is 1, the way a track is gone
+//over again, or 7 frames apart otherwise. Items are vertices read; the
+//error is how far a read vertex lands from the one added.
+static void BM_CaptureFrameCache(benchmark::State& state)
+{
+    CaptureOptions options;
+    options.resolution = (unsigned)state.range(0);
+    SyntheticCapture capture(options);
+    FrameCache cache(capture.numFrames());
+
+    std::vector<float> points;
+    for (unsigned f = 0; f < capture.numFrames(); f++)
+    {
+        TrackFrame frame = capture.frame(f, points);
+        CachedFrame cached;
+        cached.time = f;
+        cached.numVertices = frame.numVertices;
+        cached.topology = frame.topology;
+        cache.add(cached, points.data());
+    }
+
+    std::vector<float> expected;
+    double errorSum = 0;
+    double errorMax = 0;
+    for (unsigned f = 0; f < capture.numFrames(); f++)
+    {
+        capture.frame(f, expected);
+        cache.decode(f, points);
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            double error = std::fabs(points[i] - expected[i]);
+            errorSum += error;
+            errorMax = std::max(errorMax, error);
+        }
+    }
+
+    unsigned stride = state.range(1) == 1 ? 1 : 7;
+    unsigned f = 0;
+    for (auto _ : state)
+    {
+        cache.decode(f, points);
+        benchmark::DoNotOptimize(points.data());
+        f = (f + stride) % capture.numFrames();
+    }
+    size_t floats = (size_t)capture.numFrames() * capture.numVertices(0) * 3 * sizeof(float);
+    state.SetItemsProcessed(state.iterations() * capture.numVertices(0));
+    state.counters["vertices"] = capture.numVertices(0);
+    state.counters["megabytes"] = cache.bytes() / (1024.0 * 1024.0);
+    state.counters["ofFloats"] = (double)cache.bytes() / floats;
+    setErrorCounters(state, errorSum, errorMax, capture.numFrames() * capture.numVertices(0) * 3, "Cm");
+}
+BENCHMARK(BM_CaptureFrameCache)->Args({32, 1})->Args({128, 1})->Args({128, 0})->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
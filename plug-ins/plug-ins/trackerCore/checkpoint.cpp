@@ -0,0 +1,192 @@
+//
+// Checkpoint of a track in progress.
+//
+#include "checkpoint.h"
+#include "motionFilter.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+    template <typename T>
+    void put(std::ofstream& file, const std::vector<T>& values)
+    {
+        file.write(reinterpret_cast<const char*>(values.data()), sizeof(T) * values.size());
+    }
+
+    template <typename T>
+    bool get(std::ifstream& file, std::vector<T>& values, size_t count)
+    {
+        values.resize(count);
+        file.read(reinterpret_cast<char*>(values.data()), sizeof(T) * count);
+        return (bool)file;
+    }
+}
+
+bool writeCheckpoint(const std::string& path, double nextFrame, const TrackingState& state,
+                     const TrajectoryWriter& trajectory, std::string& error)
+{
+    if (trajectory.vertexSets() != state.vertexSets)
+    {
+        error = "the trajectory of checkpoint " + path + " has other vertex sets than the track";
+        return false;
+    }
+
+    std::string partial = path + ".part";
+    {
+        std::ofstream file(partial.c_str(), std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            error = "could not open " + partial + " for writing";
+            return false;
+        }
+
+        CheckpointHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, kCheckpointMagic, sizeof(kCheckpointMagic));
+        header.version = kCheckpointVersion;
+        header.numJoints = (uint32_t)state.vertexSets.size();
+        header.numPoints = (uint32_t)state.anchored.size();
+        header.framesTracked = state.framesTracked;
+        header.topologyChanges = state.topologyChanges;
+        header.topology = state.topology;
+        header.numVertices = state.numVertices;
+        header.numTriangles = state.numTriangles;
+        header.nextFrame = nextFrame;
+        header.startFrame = trajectory.startFrame();
+        header.numFrames = trajectory.numFrames();
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        std::vector<uint32_t> counts;
+        for (const std::vector<int>& ids : state.vertexSets)
+            counts.push_back((uint32_t)ids.size());
+        put(file, counts);
+        for (const std::vector<int>& ids : state.vertexSets)
+            put(file, ids);
+
+        put(file, state.filters);
+        put(file, state.projected);
+        put(file, state.positions);
+        put(file, state.anchors);
+        put(file, state.weights);
+        put(file, state.anchored);
+
+        put(file, state.jointPositions);
+        put(file, state.jointVelocities);
+        put(file, state.jointAccelerations);
+        put(file, state.jointConfidence);
+        put(file, state.jointHasPosition);
+        put(file, state.jointTracked);
+
+        for (unsigned j = 0; j < header.numJoints; j++)
+            put(file, trajectory.columns(j));
+
+        if (!file.flush())
+        {
+            error = "could not write " + partial;
+            return false;
+        }
+    }
+
+    //rename() does not replace an existing file everywhere.
+    std::remove(path.c_str());
+    if (std::rename(partial.c_str(), path.c_str()) != 0)
+    {
+        error = "could not move " + partial + " to " + path;
+        return false;
+    }
+    return true;
+}
+
+bool readCheckpoint(const std::string& path, double& nextFrame, TrackingState& state, TrajectoryWriter& trajectory,
+                    std::string& error)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file)
+    {
+        error = "could not open " + path;
+        return false;
+    }
+
+    CheckpointHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || std::memcmp(header.magic, kCheckpointMagic, sizeof(kCheckpointMagic)) != 0)
+    {
+        error = path + " is not a checkpoint file";
+        return false;
+    }
+    if (header.version != kCheckpointVersion)
+    {
+        error = path + " has an unsupported checkpoint version";
+        return false;
+    }
+
+    //Sizes are checked against the file before anything is allocated.
+    file.seekg(0, std::ios::end);
+    uint64_t fileSize = (uint64_t)file.tellg();
+    file.seekg(sizeof(header));
+    uint64_t jointBytes = sizeof(uint32_t) + 9 * sizeof(double) + sizeof(float) + 2;
+    uint64_t pointBytes = sizeof(int32_t) + MotionFilter::kStateSize * sizeof(double) + 6 * sizeof(double)
+                          + 3 * sizeof(int32_t) + 3 * sizeof(float) + 1;
+    uint64_t columnBytes = sizeof(float) * (uint64_t)header.numFrames;
+    uint64_t size = sizeof(header) + jointBytes * header.numJoints + pointBytes * header.numPoints
+                    + columnBytes * (kNumJointChannels * (uint64_t)header.numJoints + 3 * (uint64_t)header.numPoints);
+    if (size != fileSize)
+    {
+        error = path + " is truncated";
+        return false;
+    }
+
+    std::vector<uint32_t> counts;
+    bool ok = get(file, counts, header.numJoints);
+    uint64_t numPoints = 0;
+    for (uint32_t count : counts)
+        numPoints += count;
+    if (!ok || numPoints != header.numPoints)
+    {
+        error = path + " has a bad joint table";
+        return false;
+    }
+
+    state = TrackingState();
+    state.vertexSets.resize(header.numJoints);
+    for (unsigned j = 0; j < header.numJoints; j++)
+        ok = ok && get(file, state.vertexSets[j], counts[j]);
+    state.framesTracked = header.framesTracked;
+    state.topologyChanges = header.topologyChanges;
+    state.topology = header.topology;
+    state.numVertices = header.numVertices;
+    state.numTriangles = header.numTriangles;
+
+    ok = ok && get(file, state.filters, numPoints * MotionFilter::kStateSize);
+    ok = ok && get(file, state.projected, numPoints);
+    ok = ok && get(file, state.positions, numPoints);
+    ok = ok && get(file, state.anchors, numPoints * 3);
+    ok = ok && get(file, state.weights, numPoints * 3);
+    ok = ok && get(file, state.anchored, numPoints);
+
+    ok = ok && get(file, state.jointPositions, header.numJoints);
+    ok = ok && get(file, state.jointVelocities, header.numJoints);
+    ok = ok && get(file, state.jointAccelerations, header.numJoints);
+    ok = ok && get(file, state.jointConfidence, header.numJoints);
+    ok = ok && get(file, state.jointHasPosition, header.numJoints);
+    ok = ok && get(file, state.jointTracked, header.numJoints);
+
+    trajectory.begin(header.startFrame, header.numFrames, state.vertexSets);
+    for (unsigned j = 0; ok && j < header.numJoints; j++)
+    {
+        std::vector<float>& columns = trajectory.columns(j);
+        file.read(reinterpret_cast<char*>(columns.data()), sizeof(float) * columns.size());
+        ok = (bool)file;
+    }
+    if (!ok)
+    {
+        error = path + " is truncated";
+        return false;
+    }
+
+    nextFrame = header.nextFrame;
+    return true;
+}
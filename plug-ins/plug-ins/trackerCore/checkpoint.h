@@ -0,0 +1,58 @@
+//
+// Checkpoint of a track in progress: the engine's state after the last
+// tracked frame and every frame recorded so far, so a long take that
+// stops halfway, on a crash or a lost joint, can be carried on from the
+// last checkpoint instead of from the start.
+//
+// Layout (little endian):
+//   CheckpointHeader
+//   numJoints uint32 point counts, then every joint's int32 vertex IDs
+//   per point: MotionFilter::kStateSize doubles of filter state
+//   per point: projected and surface point as double xyz
+//   per point: 3 int32 anchors, 3 float weights, uint8 anchored
+//   per joint: position, velocity and acceleration as double xyz, float
+//              confidence, uint8 has position, uint8 tracked
+//   per joint: the trajectory channels of the run, see trajectory.h
+//
+// The file is written next to its path and renamed over it, so a crash
+// while writing leaves the previous checkpoint whole.
+//
+#ifndef TRACKERCORE_CHECKPOINT_H
+#define TRACKERCORE_CHECKPOINT_H
+
+#include "trackingEngine.h"
+#include "trajectory.h"
+
+#include <cstdint>
+#include <string>
+
+const char kCheckpointMagic[4] = {'V', 'J', 'C', 'P'};
+const uint32_t kCheckpointVersion = 1;
+
+struct CheckpointHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t numJoints;
+    uint32_t numPoints;
+    uint32_t framesTracked;
+    uint32_t topologyChanges;
+    uint64_t topology;
+    uint32_t numVertices;
+    uint32_t numTriangles;
+    //Scene frame the track carries on from.
+    double nextFrame;
+    //Range of the run's trajectory.
+    double startFrame;
+    uint32_t numFrames;
+    uint32_t reserved;
+};
+
+//Saves the engine's state and the frames recorded so far. trajectory must
+//have been begun with the engine's vertex sets.
+bool writeCheckpoint(const std::string& path, double nextFrame, const TrackingState& state,
+                     const TrajectoryWriter& trajectory, std::string& error);
+bool readCheckpoint(const std::string& path, double& nextFrame, TrackingState& state, TrajectoryWriter& trajectory,
+                    std::string& error);
+
+#endif //TRACKERCORE_CHECKPOINT_H
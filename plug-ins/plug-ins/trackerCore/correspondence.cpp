@@ -0,0 +1,308 @@
+//
+// Dense correspondence across a topology change.
+//
+#include "correspondence.h"
+#include "meshBvh.h"
+#include "profiler.h"
+#include "vec3.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+    //Vertices per parallel task.
+    const unsigned kBlockSize = 1024;
+
+    inline Vec3 vertex(const TrackFrame& frame, int id)
+    {
+        const float* p = frame.points + id * 3;
+        return Vec3(p[0], p[1], p[2]);
+    }
+
+    bool validTriangle(const int* triangle, unsigned numVertices)
+    {
+        for (unsigned c = 0; c < 3; c++)
+        {
+            if (triangle[c] < 0 || (unsigned)triangle[c] >= numVertices)
+                return false;
+        }
+        return true;
+    }
+}
+
+unsigned computeCorrespondence(const TrackFrame& from, const TrackFrame& to, const TrackFrame* before,
+                               ThreadPool& pool, VertexCorrespondence& correspondence,
+                               const CorrespondenceOptions& options)
+{
+    PROFILE_SCOPE("correspondence");
+    unsigned numVertices = from.numVertices;
+    correspondence.anchors.assign(numVertices * 3, -1);
+    correspondence.weights.assign(numVertices * 3, 0);
+    if (numVertices == 0 || from.triangles == nullptr || to.numTriangles == 0 || to.triangles == nullptr)
+        return 0;
+
+    //Area weighted vertex normals of the old mesh, and its edge length
+    //to scale the reach by.
+    std::vector<Vec3> normals(numVertices);
+    double edgeLength = 0;
+    unsigned numEdges = 0;
+    for (unsigned t = 0; t < from.numTriangles; t++)
+    {
+        const int* triangle = from.triangles + t * 3;
+        if (!validTriangle(triangle, numVertices))
+            continue;
+        Vec3 a = vertex(from, triangle[0]);
+        Vec3 b = vertex(from, triangle[1]);
+        Vec3 c = vertex(from, triangle[2]);
+        Vec3 face = (b - a).cross(c - a);
+        for (unsigned k = 0; k < 3; k++)
+            normals[triangle[k]] += face;
+        edgeLength += (b - a).length() + (c - b).length() + (a - c).length();
+        numEdges += 3;
+    }
+    if (numEdges == 0)
+        return 0;
+    double reach = options.maxDistance * edgeLength / numEdges;
+    float reachSq = (float)(reach * reach);
+
+    MeshBvh bvh;
+    {
+        PROFILE_SCOPE("bvhUpdate");
+        bvh.build(to.points, to.numVertices, to.triangles, to.numTriangles);
+    }
+
+    if (before != nullptr && (before->numVertices != numVertices || before->points == nullptr))
+        before = nullptr;
+
+    unsigned numBlocks = (numVertices + kBlockSize - 1) / kBlockSize;
+    std::vector<unsigned> matched(numBlocks, 0);
+    pool.parallelFor(numBlocks, [&](unsigned block) {
+        unsigned last = std::min(numVertices, (block + 1) * kBlockSize);
+        for (unsigned v = block * kBlockSize; v < last; v++)
+        {
+            //Vertices on no triangle have no way to face.
+            double length = normals[v].length();
+            if (length <= 0)
+                continue;
+            Vec3 unit = normals[v] / length;
+            float normal[] = {(float)unit.x, (float)unit.y, (float)unit.z};
+
+            const float* point = from.points + v * 3;
+            float query[] = {point[0], point[1], point[2]};
+            if (before != nullptr)
+            {
+                const float* earlier = before->points + v * 3;
+                for (unsigned axis = 0; axis < 3; axis++)
+                    query[axis] += point[axis] - earlier[axis];
+            }
+
+            BvhHit hit = bvh.closestPointFacing(query, normal, (float)options.minNormalCos, reachSq);
+            if (hit.triangle < 0)
+                continue;
+
+            const int* triangle = to.triangles + hit.triangle * 3;
+            int* anchor = &correspondence.anchors[v * 3];
+            for (unsigned k = 0; k < 3; k++)
+                anchor[k] = triangle[k];
+            barycentricWeights(hit.point, to.points + triangle[0] * 3, to.points + triangle[1] * 3,
+                               to.points + triangle[2] * 3, &correspondence.weights[v * 3]);
+            matched[block]++;
+        }
+    });
+
+    unsigned total = 0;
+    for (unsigned count : matched)
+        total += count;
+    PROFILE_COUNT("correspondenceMisses", numVertices - total);
+    return total;
+}
+
+std::vector<std::vector<int>> carryVertexSets(const std::vector<std::vector<int>>& sets,
+                                              const VertexCorrespondence& correspondence)
+{
+    std::vector<std::vector<int>> carried(sets.size());
+    for (size_t j = 0; j < sets.size(); j++)
+    {
+        int fallback = -1;
+        carried[j].assign(sets[j].size(), -1);
+        for (size_t p = 0; p < sets[j].size(); p++)
+        {
+            int vertex = sets[j][p];
+            if (vertex < 0 || (unsigned)vertex >= correspondence.numVertices() || !correspondence.matched(vertex))
+                continue;
+            const float* weights = &correspondence.weights[vertex * 3];
+            unsigned closest = 0;
+            for (unsigned k = 1; k < 3; k++)
+            {
+                if (weights[k] > weights[closest])
+                    closest = k;
+            }
+            carried[j][p] = correspondence.anchors[vertex * 3 + closest];
+            if (fallback < 0)
+                fallback = carried[j][p];
+        }
+
+        if (fallback < 0)
+            carried[j].clear();
+        for (int& id : carried[j])
+        {
+            if (id < 0)
+                id = fallback;
+        }
+    }
+    return carried;
+}
+
+std::string correspondencePath(const std::string& cachePath)
+{
+    size_t extension = cachePath.find_last_of('.');
+    size_t directory = cachePath.find_last_of("/\\");
+    if (extension == std::string::npos || (directory != std::string::npos && extension < directory))
+        extension = cachePath.size();
+    return cachePath.substr(0, extension) + ".vjcr";
+}
+
+bool CorrespondenceCache::read(const std::string& path, std::string& error)
+{
+    clear();
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file)
+        return true;
+
+    CorrespondenceHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || std::memcmp(header.magic, kCorrespondenceMagic, sizeof(kCorrespondenceMagic)) != 0)
+    {
+        error = path + " is not a correspondence file";
+        return false;
+    }
+    if (header.version != kCorrespondenceVersion)
+    {
+        error = path + " has an unsupported correspondence version";
+        return false;
+    }
+
+    //Each map's size is checked against what is left of the file before
+    //it is allocated.
+    file.seekg(0, std::ios::end);
+    uint64_t remaining = (uint64_t)file.tellg() - sizeof(header);
+    file.seekg(sizeof(header));
+    for (uint32_t m = 0; m < header.numMaps; m++)
+    {
+        CorrespondenceMapHeader mapHeader;
+        uint64_t vertexBytes = 3 * (sizeof(int32_t) + sizeof(float));
+        if (remaining < sizeof(mapHeader) || !file.read(reinterpret_cast<char*>(&mapHeader), sizeof(mapHeader))
+            || remaining - sizeof(mapHeader) < vertexBytes * mapHeader.numVertices)
+        {
+            clear();
+            error = path + " is truncated";
+            return false;
+        }
+        remaining -= sizeof(mapHeader) + vertexBytes * mapHeader.numVertices;
+
+        VertexCorrespondence& correspondence = m_maps[std::make_pair(mapHeader.from, mapHeader.to)];
+        correspondence.anchors.resize(mapHeader.numVertices * 3);
+        correspondence.weights.resize(mapHeader.numVertices * 3);
+        file.read(reinterpret_cast<char*>(correspondence.anchors.data()),
+                  sizeof(int32_t) * correspondence.anchors.size());
+        file.read(reinterpret_cast<char*>(correspondence.weights.data()),
+                  sizeof(float) * correspondence.weights.size());
+        if (!file)
+        {
+            clear();
+            error = path + " is truncated";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CorrespondenceCache::write(const std::string& path, std::string& error) const
+{
+    std::string partial = path + ".part";
+    {
+        std::ofstream file(partial.c_str(), std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            error = "could not open " + partial + " for writing";
+            return false;
+        }
+
+        CorrespondenceHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, kCorrespondenceMagic, sizeof(kCorrespondenceMagic));
+        header.version = kCorrespondenceVersion;
+        header.numMaps = (uint32_t)m_maps.size();
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        for (const auto& entry : m_maps)
+        {
+            const VertexCorrespondence& correspondence = entry.second;
+            CorrespondenceMapHeader mapHeader;
+            std::memset(&mapHeader, 0, sizeof(mapHeader));
+            mapHeader.from = entry.first.first;
+            mapHeader.to = entry.first.second;
+            mapHeader.numVertices = correspondence.numVertices();
+            file.write(reinterpret_cast<const char*>(&mapHeader), sizeof(mapHeader));
+            file.write(reinterpret_cast<const char*>(correspondence.anchors.data()),
+                       sizeof(int32_t) * correspondence.anchors.size());
+            file.write(reinterpret_cast<const char*>(correspondence.weights.data()),
+                       sizeof(float) * correspondence.weights.size());
+        }
+
+        if (!file.flush())
+        {
+            error = "could not write " + partial;
+            return false;
+        }
+    }
+
+    //rename() does not replace an existing file everywhere.
+    std::remove(path.c_str());
+    if (std::rename(partial.c_str(), path.c_str()) != 0)
+    {
+        error = "could not move " + partial + " to " + path;
+        return false;
+    }
+    return true;
+}
+
+void CorrespondenceCache::clear()
+{
+    m_maps.clear();
+    m_added = 0;
+}
+
+const VertexCorrespondence* CorrespondenceCache::find(uint64_t from, uint64_t to) const
+{
+    auto it = m_maps.find(std::make_pair(from, to));
+    return it != m_maps.end() ? &it->second : nullptr;
+}
+
+const VertexCorrespondence* CorrespondenceCache::add(uint64_t from, uint64_t to,
+                                                     const VertexCorrespondence& correspondence)
+{
+    auto inserted = m_maps.insert(std::make_pair(std::make_pair(from, to), correspondence));
+    if (inserted.second)
+        m_added++;
+    return &inserted.first->second;
+}
+
+void CorrespondenceCache::merge(const CorrespondenceCache& other)
+{
+    for (const auto& entry : other.m_maps)
+        add(entry.first.first, entry.first.second, entry.second);
+}
+
+unsigned CorrespondenceCache::size() const
+{
+    return (unsigned)m_maps.size();
+}
+
+unsigned CorrespondenceCache::added() const
+{
+    return m_added;
+}
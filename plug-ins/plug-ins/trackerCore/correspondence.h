@@ -0,0 +1,120 @@
+//
+// Dense correspondence across a topology change. When a 4DViews sequence
+// switches to a new keyframe mesh, every vertex of the last frame of the
+// old topology is matched to a point of the first frame of the new one,
+// as the 3 vertex IDs of a new triangle and barycentric weights. Tracked
+// points anchored to old vertices are then carried over in constant time
+// per point, see TrackFrame::fromPrevious, instead of being searched for.
+//
+// A vertex is matched to the closest new surface that faces the same way
+// as the vertex normal, so surfaces that touch, such as a hand resting on
+// a thigh, do not swap points. Given the frame before the old one, each
+// vertex is matched from where its motion carries it, so the performer's
+// movement between the two frames is not lost. The vertices are matched
+// in parallel.
+//
+// Maps are cached per take in a correspondence file, keyed by the frame
+// fingerprints of the two meshes, so a rerun of the take reads them back.
+//
+// Layout (little endian):
+//   CorrespondenceHeader
+//   per map: CorrespondenceMapHeader, numVertices * 3 int32 vertex IDs,
+//            numVertices * 3 float weights
+//
+#ifndef TRACKERCORE_CORRESPONDENCE_H
+#define TRACKERCORE_CORRESPONDENCE_H
+
+#include "threadPool.h"
+#include "trackingEngine.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+const char kCorrespondenceMagic[4] = {'V', 'J', 'C', 'R'};
+const uint32_t kCorrespondenceVersion = 1;
+
+struct CorrespondenceHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t numMaps;
+    uint32_t reserved;
+};
+
+struct CorrespondenceMapHeader
+{
+    //frameFingerprint() of the old and the new frame.
+    uint64_t from;
+    uint64_t to;
+    uint32_t numVertices;
+    uint32_t reserved;
+};
+
+struct VertexCorrespondence
+{
+    //Per old vertex, 3 new vertex IDs and their weights. IDs are -1 for
+    //a vertex with no new surface facing its way within reach.
+    std::vector<int> anchors;
+    std::vector<float> weights;
+
+    unsigned numVertices() const { return (unsigned)anchors.size() / 3; }
+    bool matched(unsigned vertex) const { return anchors[vertex * 3] >= 0; }
+};
+
+struct CorrespondenceOptions
+{
+    //Farthest a vertex is matched, in mean edge lengths of the old mesh.
+    double maxDistance = 4;
+    //Smallest cosine between a vertex normal and the new triangle's.
+    double minNormalCos = 0.5;
+};
+
+//Matches every vertex of from to the surface of to, in parallel on pool.
+//before is the frame before from, with its topology, or nullptr. Returns
+//the number of vertices matched.
+unsigned computeCorrespondence(const TrackFrame& from, const TrackFrame& to, const TrackFrame* before,
+                               ThreadPool& pool, VertexCorrespondence& correspondence,
+                               const CorrespondenceOptions& options = CorrespondenceOptions());
+
+//Vertex sets of the old mesh moved onto the new one: each vertex becomes
+//the new vertex it is weighted to most, and an unmatched vertex the new
+//vertex of the first matched one in its set. Sets keep their size and
+//order, so point p of a joint stays point p, and two points can end up on
+//one vertex. A set with no matched vertex comes out empty.
+std::vector<std::vector<int>> carryVertexSets(const std::vector<std::vector<int>>& sets,
+                                              const VertexCorrespondence& correspondence);
+
+//Where the maps of a point cache live: the cache path with its extension
+//replaced by .vjcr.
+std::string correspondencePath(const std::string& cachePath);
+
+//The maps of one take.
+class CorrespondenceCache
+{
+public:
+    //A missing file reads as an empty cache.
+    bool read(const std::string& path, std::string& error);
+    //Written next to path and renamed over it.
+    bool write(const std::string& path, std::string& error) const;
+    void clear();
+
+    //nullptr when there is no map between the two frames.
+    const VertexCorrespondence* find(uint64_t from, uint64_t to) const;
+    //Returns the stored map, which stays valid until clear().
+    const VertexCorrespondence* add(uint64_t from, uint64_t to, const VertexCorrespondence& correspondence);
+    //Adds the maps of other this cache lacks.
+    void merge(const CorrespondenceCache& other);
+
+    unsigned size() const;
+    //Maps added since the last read().
+    unsigned added() const;
+
+private:
+    std::map<std::pair<uint64_t, uint64_t>, VertexCorrespondence> m_maps;
+    unsigned m_added = 0;
+};
+
+#endif //TRACKERCORE_CORRESPONDENCE_H
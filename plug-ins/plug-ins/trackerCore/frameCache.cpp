@@ -0,0 +1,402 @@
+//
+// Quantized, delta encoded window of mesh frames.
+//
+#include "frameCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRACKERCORE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const unsigned kBlockSize = 16;
+    const float kMaxCode = 65535;
+    //Room left around the first frame of a run, as a fraction of its
+    //size, for the performer to move into before a new run starts.
+    const float kPadding = 0.125f;
+    //Keeps a flat or single point frame from having a zero step.
+    const float kMinPadding = 1e-4f;
+
+    void frameBox(const float* points, unsigned numVertices, float origin[3], float scale[3])
+    {
+        for (unsigned axis = 0; axis < 3; axis++)
+        {
+            float low = numVertices > 0 ? points[axis] : 0;
+            float high = low;
+            for (unsigned v = 1; v < numVertices; v++)
+            {
+                low = std::min(low, points[v * 3 + axis]);
+                high = std::max(high, points[v * 3 + axis]);
+            }
+            float padding = (high - low) * kPadding + kMinPadding;
+            origin[axis] = low - padding;
+            scale[axis] = (high - low + 2 * padding) / kMaxCode;
+        }
+    }
+
+    //Rounds every coordinate to its code. Returns false when a point lies
+    //outside the box, clamping it to the box.
+    bool quantize(const float* points, size_t count, const float origin[3], const float scale[3], uint16_t* codes)
+    {
+        const float inverse[3] = {1 / scale[0], 1 / scale[1], 1 / scale[2]};
+        bool inside = true;
+        for (size_t i = 0; i < count; i++)
+        {
+            unsigned axis = i % 3;
+            float code = (points[i] - origin[axis]) * inverse[axis] + 0.5f;
+            if (!(code >= 0 && code < kMaxCode + 1))
+            {
+                inside = false;
+                code = code > 0 ? kMaxCode : 0;
+            }
+            codes[i] = (uint16_t)code;
+        }
+        return inside;
+    }
+
+    void dequantize(const uint16_t* codes, size_t count, const float origin[3], const float scale[3], float* points)
+    {
+        size_t i = 0;
+#ifdef TRACKERCORE_SSE2
+        //Four vertices at a time, as three lanes of xyzx, yzxy and zxyz.
+        const __m128 scales[3] = {_mm_setr_ps(scale[0], scale[1], scale[2], scale[0]),
+                                  _mm_setr_ps(scale[1], scale[2], scale[0], scale[1]),
+                                  _mm_setr_ps(scale[2], scale[0], scale[1], scale[2])};
+        const __m128 origins[3] = {_mm_setr_ps(origin[0], origin[1], origin[2], origin[0]),
+                                   _mm_setr_ps(origin[1], origin[2], origin[0], origin[1]),
+                                   _mm_setr_ps(origin[2], origin[0], origin[1], origin[2])};
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 12 <= count; i += 12)
+        {
+            __m128i first = _mm_loadu_si128((const __m128i*)(codes + i));
+            __m128i last = _mm_loadl_epi64((const __m128i*)(codes + i + 8));
+            __m128 lanes[3] = {_mm_cvtepi32_ps(_mm_unpacklo_epi16(first, zero)),
+                               _mm_cvtepi32_ps(_mm_unpackhi_epi16(first, zero)),
+                               _mm_cvtepi32_ps(_mm_unpacklo_epi16(last, zero))};
+            for (unsigned l = 0; l < 3; l++)
+                _mm_storeu_ps(points + i + l * 4, _mm_add_ps(origins[l], _mm_mul_ps(lanes[l], scales[l])));
+        }
+#endif
+        for (; i < count; i++)
+            points[i] = origin[i % 3] + codes[i] * scale[i % 3];
+    }
+
+    //What the codes of a frame are expected to be from the frame before,
+    //carried on at the speed from the one before that when there is one.
+    //Wraps around like the changes do. out may be beforeLast.
+    void predict(const uint16_t* last, const uint16_t* beforeLast, size_t count, uint16_t* out)
+    {
+        if (beforeLast == NULL)
+        {
+            std::copy(last, last + count, out);
+            return;
+        }
+        size_t i = 0;
+#ifdef TRACKERCORE_SSE2
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i*)(last + i));
+            __m128i b = _mm_loadu_si128((const __m128i*)(beforeLast + i));
+            _mm_storeu_si128((__m128i*)(out + i), _mm_sub_epi16(_mm_add_epi16(a, a), b));
+        }
+#endif
+        for (; i < count; i++)
+            out[i] = (uint16_t)(2 * last[i] - beforeLast[i]);
+    }
+
+    //Stores the change of every code from its prediction, wrapping around,
+    //with each block in the fewest bytes that hold all its changes.
+    void encodeChanges(const uint16_t* previous, const uint16_t* codes, size_t count, std::vector<uint8_t>& widths,
+                       std::vector<uint8_t>& changes)
+    {
+        widths.resize((count + kBlockSize - 1) / kBlockSize);
+        changes.clear();
+        for (size_t b = 0; b < widths.size(); b++)
+        {
+            size_t start = b * kBlockSize;
+            size_t end = std::min(start + kBlockSize, count);
+            int16_t block[kBlockSize];
+            int low = 0;
+            int high = 0;
+            for (size_t i = start; i < end; i++)
+            {
+                int16_t change = (int16_t)(uint16_t)(codes[i] - previous[i]);
+                block[i - start] = change;
+                low = std::min(low, (int)change);
+                high = std::max(high, (int)change);
+            }
+
+            uint8_t width = low == 0 && high == 0 ? 0 : (low >= -128 && high <= 127 ? 1 : 2);
+            widths[b] = width;
+            for (size_t i = 0; width > 0 && i < end - start; i++)
+            {
+                uint8_t bytes[2];
+                if (width == 1)
+                    bytes[0] = (uint8_t)(int8_t)block[i];
+                else
+                    std::memcpy(bytes, &block[i], 2);
+                changes.insert(changes.end(), bytes, bytes + width);
+            }
+        }
+        changes.shrink_to_fit();
+    }
+
+    void applyChanges(uint16_t* codes, size_t count, const std::vector<uint8_t>& widths,
+                      const std::vector<uint8_t>& changes)
+    {
+        const uint8_t* in = changes.data();
+        for (size_t b = 0; b < widths.size(); b++)
+        {
+            unsigned width = widths[b];
+            if (width == 0)
+                continue;
+            uint16_t* out = codes + b * kBlockSize;
+            size_t length = std::min((size_t)kBlockSize, count - b * kBlockSize);
+#ifdef TRACKERCORE_SSE2
+            if (length == kBlockSize)
+            {
+                __m128i low;
+                __m128i high;
+                if (width == 1)
+                {
+                    //Sign extend the bytes to 16 bits.
+                    __m128i bytes = _mm_loadu_si128((const __m128i*)in);
+                    __m128i sign = _mm_cmpgt_epi8(_mm_setzero_si128(), bytes);
+                    low = _mm_unpacklo_epi8(bytes, sign);
+                    high = _mm_unpackhi_epi8(bytes, sign);
+                }
+                else
+                {
+                    low = _mm_loadu_si128((const __m128i*)in);
+                    high = _mm_loadu_si128((const __m128i*)(in + 16));
+                }
+                _mm_storeu_si128((__m128i*)out, _mm_add_epi16(_mm_loadu_si128((const __m128i*)out), low));
+                _mm_storeu_si128((__m128i*)(out + 8), _mm_add_epi16(_mm_loadu_si128((const __m128i*)(out + 8)), high));
+                in += kBlockSize * width;
+                continue;
+            }
+#endif
+            for (size_t i = 0; i < length; i++)
+            {
+                int16_t change;
+                if (width == 1)
+                    change = (int8_t)in[i];
+                else
+                    std::memcpy(&change, in + i * 2, 2);
+                out[i] = (uint16_t)(out[i] + change);
+            }
+            in += length * width;
+        }
+    }
+}
+
+const unsigned FrameCache::kKeyInterval;
+
+FrameCache::FrameCache(unsigned capacity) : m_capacity(capacity)
+{
+}
+
+void FrameCache::setCapacity(unsigned frames)
+{
+    m_capacity = frames;
+    if (m_capacity == 0)
+        clear();
+    while (m_entries.size() > m_capacity)
+        dropOldest();
+}
+
+unsigned FrameCache::capacity() const
+{
+    return m_capacity;
+}
+
+void FrameCache::add(const CachedFrame& frame, const float* points)
+{
+    if (m_capacity == 0)
+        return;
+
+    for (Entry& entry : m_entries)
+    {
+        if (entry.live && entry.frame.time == frame.time)
+            entry.live = false;
+    }
+
+    Entry entry;
+    entry.frame = frame;
+    size_t count = (size_t)frame.numVertices * 3;
+    std::vector<uint16_t> codes(count);
+
+    //A frame carries on the run of the one before while it has the same
+    //mesh and fits in the run's box.
+    const Entry* last = m_entries.empty() ? NULL : &m_entries.back();
+    bool carryOn = last != NULL && m_runLength < kKeyInterval && last->frame.numVertices == frame.numVertices
+                   && last->frame.topology == frame.topology && m_lastCodes.size() == count;
+    if (carryOn)
+    {
+        std::copy(last->origin, last->origin + 3, entry.origin);
+        std::copy(last->scale, last->scale + 3, entry.scale);
+        carryOn = quantize(points, count, entry.origin, entry.scale, codes.data());
+    }
+
+    if (carryOn)
+    {
+        //The second frame of a run has only the first to go on.
+        entry.extrapolate = m_runLength > 1;
+        m_beforeLastCodes.resize(count);
+        predict(m_lastCodes.data(), entry.extrapolate ? m_beforeLastCodes.data() : NULL, count,
+                m_beforeLastCodes.data());
+        encodeChanges(m_beforeLastCodes.data(), codes.data(), count, entry.widths, entry.changes);
+        m_runLength++;
+    }
+    else
+    {
+        frameBox(points, frame.numVertices, entry.origin, entry.scale);
+        quantize(points, count, entry.origin, entry.scale, codes.data());
+        entry.key = true;
+        entry.codes = codes;
+        m_runLength = 1;
+    }
+    m_beforeLastCodes.swap(m_lastCodes);
+    m_lastCodes.swap(codes);
+
+    m_bytes += entryBytes(entry);
+    m_entries.push_back(std::move(entry));
+    while (m_entries.size() > m_capacity)
+        dropOldest();
+}
+
+void FrameCache::advance(const Entry& entry, std::vector<uint16_t>& last, std::vector<uint16_t>& beforeLast)
+{
+    size_t count = last.size();
+    beforeLast.resize(count);
+    predict(last.data(), entry.extrapolate ? beforeLast.data() : NULL, count, beforeLast.data());
+    applyChanges(beforeLast.data(), count, entry.widths, entry.changes);
+    last.swap(beforeLast);
+}
+
+size_t FrameCache::findIndex(double time) const
+{
+    for (size_t i = m_entries.size(); i > 0; i--)
+    {
+        const Entry& entry = m_entries[i - 1];
+        if (entry.live && entry.frame.time == time)
+            return i - 1;
+    }
+    return m_entries.size();
+}
+
+const CachedFrame* FrameCache::find(double time) const
+{
+    size_t index = findIndex(time);
+    return index < m_entries.size() ? &m_entries[index].frame : NULL;
+}
+
+const CachedFrame* FrameCache::decode(double time, std::vector<float>& points)
+{
+    size_t index = findIndex(time);
+    if (index == m_entries.size())
+        return NULL;
+
+    const Entry& entry = m_entries[index];
+    size_t key = index;
+    while (!m_entries[key].key)
+        key--;
+
+    //Reading forward within a run only goes through the frames since the
+    //last read.
+    size_t from = key;
+    uint64_t target = m_dropped + index;
+    if (m_hasDecoded && m_decoded >= m_dropped + key && m_decoded <= target)
+        from = (size_t)(m_decoded - m_dropped);
+    else
+        m_decodedCodes = m_entries[key].codes;
+
+    for (size_t i = from + 1; i <= index; i++)
+        advance(m_entries[i], m_decodedCodes, m_decodedBefore);
+    m_decoded = target;
+    m_hasDecoded = true;
+
+    size_t count = (size_t)entry.frame.numVertices * 3;
+    points.resize(count);
+    dequantize(m_decodedCodes.data(), count, entry.origin, entry.scale, points.data());
+    return &entry.frame;
+}
+
+float FrameCache::step(double time) const
+{
+    size_t index = findIndex(time);
+    if (index == m_entries.size())
+        return 0;
+    const float* scale = m_entries[index].scale;
+    return std::max(scale[0], std::max(scale[1], scale[2]));
+}
+
+void FrameCache::dropOldest()
+{
+    //The frame after the oldest becomes the start of its run, and the one
+    //after that, which went on the speed from the oldest, is stored as
+    //the change from it alone.
+    if (m_entries.size() > 1 && !m_entries[1].key)
+    {
+        Entry& next = m_entries[1];
+        std::vector<uint16_t> last = m_entries[0].codes;
+        std::vector<uint16_t> beforeLast;
+        advance(next, last, beforeLast);
+
+        if (m_entries.size() > 2 && m_entries[2].extrapolate)
+        {
+            Entry& after = m_entries[2];
+            std::vector<uint16_t> codes = last;
+            advance(after, codes, beforeLast);
+            m_bytes -= entryBytes(after);
+            after.extrapolate = false;
+            encodeChanges(last.data(), codes.data(), codes.size(), after.widths, after.changes);
+            m_bytes += entryBytes(after);
+        }
+
+        m_bytes -= entryBytes(next);
+        next.key = true;
+        next.extrapolate = false;
+        next.codes.swap(last);
+        std::vector<uint8_t>().swap(next.widths);
+        std::vector<uint8_t>().swap(next.changes);
+        m_bytes += entryBytes(next);
+    }
+    m_bytes -= entryBytes(m_entries.front());
+    m_entries.pop_front();
+    m_dropped++;
+}
+
+size_t FrameCache::entryBytes(const Entry& entry) const
+{
+    return sizeof(Entry) + entry.codes.capacity() * sizeof(uint16_t) + entry.widths.capacity()
+           + entry.changes.capacity();
+}
+
+unsigned FrameCache::size() const
+{
+    return (unsigned)m_entries.size();
+}
+
+size_t FrameCache::bytes() const
+{
+    size_t codes = m_lastCodes.capacity() + m_beforeLastCodes.capacity() + m_decodedCodes.capacity()
+                   + m_decodedBefore.capacity();
+    return m_bytes + codes * sizeof(uint16_t);
+}
+
+void FrameCache::clear()
+{
+    m_entries.clear();
+    std::vector<uint16_t>().swap(m_lastCodes);
+    std::vector<uint16_t>().swap(m_beforeLastCodes);
+    std::vector<uint16_t>().swap(m_decodedCodes);
+    std::vector<uint16_t>().swap(m_decodedBefore);
+    m_runLength = 0;
+    m_hasDecoded = false;
+    m_bytes = 0;
+}
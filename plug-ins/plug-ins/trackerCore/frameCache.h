@@ -0,0 +1,121 @@
+//
+// Compressed window of mesh frames kept in memory, so frames a tracker
+// has moved past can be read again without evaluating the scene, for
+// smoothing or for tracking a range over.
+//
+// Positions are quantized to 16 bits per axis against a box around the
+// first frame of a run, padded so the performer can move a little before
+// it has to start a new one. The frames after it hold only how far each
+// code is from where the frames before put it, the last frame's code
+// carried on at the speed from the one before, in blocks of 16 codes
+// stored in as few bytes as the block needs. A run lasts while the
+// topology stays the same and the frames stay in the box, and is
+// restarted every kKeyInterval frames to bound how many frames a read
+// has to go through.
+//
+// At 200k vertices a frame costs 1.2 MB as 16 bit codes against 2.4 MB as
+// floats and 6.4 MB as MPoints, and within a run a byte a code where the
+// motion is smooth and nothing where the performer holds still. A read goes
+// through the run from its start, or from the frame read before it when
+// reading forward, and turns the codes back into floats with SSE2.
+//
+#ifndef TRACKERCORE_FRAMECACHE_H
+#define TRACKERCORE_FRAMECACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+//What a frame was added with, other than its points.
+struct CachedFrame
+{
+    double time = 0;
+    unsigned numVertices = 0;
+    std::shared_ptr<const std::vector<int>> triangles;
+    uint64_t topology = 0;
+    //frameFingerprint() of the points as they were added. The decoded
+    //points are off by up to half a step and hash differently.
+    uint64_t fingerprint = 0;
+};
+
+class FrameCache
+{
+public:
+    //Frames per run of changes, the most a read ever applies.
+    static const unsigned kKeyInterval = 16;
+
+    //A capacity of 0 keeps nothing.
+    explicit FrameCache(unsigned capacity = 0);
+
+    //Frames held before the oldest is dropped.
+    void setCapacity(unsigned frames);
+    unsigned capacity() const;
+
+    //Adds a frame of numVertices xyz points, dropping the oldest past the
+    //capacity. A frame added for a time already held replaces it.
+    void add(const CachedFrame& frame, const float* points);
+    const CachedFrame* find(double time) const;
+    //Fills points with the frame at time, to within step() of what was
+    //added. Returns NULL when the time is not held. Not thread safe, as
+    //the last frame read is kept to read forward from.
+    const CachedFrame* decode(double time, std::vector<float>& points);
+
+    //Largest distance per axis between two codes of the frame at time,
+    //0 when the time is not held.
+    float step(double time) const;
+
+    unsigned size() const;
+    //Memory held by the frames and the codes kept to add and read with.
+    size_t bytes() const;
+    void clear();
+
+private:
+    struct Entry
+    {
+        CachedFrame frame;
+        //False once a later frame replaced it. Kept while the frames
+        //after it are stored as changes from it.
+        bool live = true;
+        //Codes of the first frame of a run.
+        bool key = false;
+        //Predicted from the two frames before rather than the last alone.
+        bool extrapolate = false;
+        float origin[3];
+        float scale[3];
+        std::vector<uint16_t> codes;
+        //Changes from the prediction: bytes per change of each block of
+        //16 codes, 0 when none changed, then the changes themselves.
+        std::vector<uint8_t> widths;
+        std::vector<uint8_t> changes;
+    };
+
+    //Turns last, the codes of the frame before entry, into entry's and
+    //beforeLast into the frame before's.
+    static void advance(const Entry& entry, std::vector<uint16_t>& last, std::vector<uint16_t>& beforeLast);
+    //Index of the live frame at time, size() when there is none.
+    size_t findIndex(double time) const;
+    //Drops the oldest frame, turning the one after it into the start of a
+    //run if it was not already.
+    void dropOldest();
+    size_t entryBytes(const Entry& entry) const;
+
+    unsigned m_capacity;
+    std::deque<Entry> m_entries;
+    //Frames dropped so far, so m_decoded survives dropOldest().
+    uint64_t m_dropped = 0;
+    //Codes of the last two frames added, to predict the next one from.
+    std::vector<uint16_t> m_lastCodes;
+    std::vector<uint16_t> m_beforeLastCodes;
+    unsigned m_runLength = 0;
+    //Codes of the last frame read, by m_dropped + index, and of the frame
+    //before it.
+    std::vector<uint16_t> m_decodedCodes;
+    std::vector<uint16_t> m_decodedBefore;
+    uint64_t m_decoded = 0;
+    bool m_hasDecoded = false;
+    size_t m_bytes = 0;
+};
+
+#endif //TRACKERCORE_FRAMECACHE_H
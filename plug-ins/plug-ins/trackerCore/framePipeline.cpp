@@ -0,0 +1,206 @@
+//
+// Three stage frame pipeline over a bounded ring of slots.
+//
+#include "framePipeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    //Progress of one run(), shared by the stage threads. Each stage only
+    //ever advances its own count of finished frames.
+    struct Progress
+    {
+        std::mutex mutex;
+        std::condition_variable changed;
+        unsigned finished[FramePipeline::kNumStages] = {0, 0, 0};
+        //Frames each stage is to run, cut short when a stage fails.
+        unsigned end[FramePipeline::kNumStages] = {0, 0, 0};
+        unsigned depth = 1;
+
+        bool done(unsigned stage) const
+        {
+            return finished[stage] >= end[stage];
+        }
+
+        //Whether stage can start on its next frame: a slot has to be free
+        //to produce into, and a frame has to have left the stage before.
+        bool ready(unsigned stage) const
+        {
+            unsigned frame = finished[stage];
+            if (frame >= end[stage])
+                return false;
+            if (stage == FramePipeline::kProduce)
+                return frame < finished[FramePipeline::kCollect] + depth;
+            return frame < finished[stage - 1];
+        }
+
+        //The failed stage and those before it stop where they are. The
+        //stages after it still finish the frames it got through, the same
+        //as a plain loop would have.
+        void fail(unsigned stage)
+        {
+            for (unsigned s = 0; s < FramePipeline::kNumStages; s++)
+                end[s] = std::min(end[s], s <= stage ? finished[s] : finished[stage]);
+        }
+    };
+}
+
+const unsigned FramePipeline::kDefaultDepth;
+
+FramePipeline::FramePipeline(unsigned depth) : m_depth(depth)
+{
+    for (unsigned s = 0; s < kNumStages; s++)
+    {
+        m_onCaller[s] = false;
+        m_busy[s] = 0;
+    }
+}
+
+unsigned FramePipeline::numSlots() const
+{
+    return m_depth > 0 ? m_depth : 1;
+}
+
+bool FramePipeline::sequential() const
+{
+    return m_depth == 0;
+}
+
+void FramePipeline::runOnCaller(Stage stage, bool onCaller)
+{
+    m_onCaller[stage] = onCaller;
+}
+
+bool FramePipeline::run(unsigned first, unsigned last, const StageFunction& produce, const StageFunction& track,
+                        const StageFunction& collect)
+{
+    const StageFunction* stages[] = {&produce, &track, &collect};
+    Clock::time_point begin = Clock::now();
+    for (unsigned s = 0; s < kNumStages; s++)
+        m_busy[s] = 0;
+    m_failed = kNumStages;
+
+    //Runs one frame of a stage and times it.
+    auto runStage = [&](unsigned stage, unsigned frame, unsigned slot) {
+        Clock::time_point start = Clock::now();
+        bool ok = (*stages[stage])(frame, slot);
+        m_busy[stage] += std::chrono::duration<double>(Clock::now() - start).count();
+        return ok;
+    };
+
+    if (sequential())
+    {
+        for (unsigned frame = first; frame < last && m_failed == kNumStages; frame++)
+        {
+            for (unsigned s = 0; s < kNumStages; s++)
+            {
+                if (!runStage(s, frame, 0))
+                {
+                    m_failed = (Stage)s;
+                    break;
+                }
+            }
+        }
+        m_seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+        return m_failed == kNumStages;
+    }
+
+    Progress progress;
+    for (unsigned s = 0; s < kNumStages; s++)
+        progress.end[s] = last > first ? last - first : 0;
+    progress.depth = m_depth;
+
+    //Finishes the frame a stage was running and wakes whoever waits on it.
+    auto finish = [&](unsigned stage, bool ok) {
+        std::lock_guard<std::mutex> lock(progress.mutex);
+        if (ok)
+        {
+            progress.finished[stage]++;
+        }
+        else
+        {
+            progress.fail(stage);
+            if (m_failed == kNumStages)
+                m_failed = (Stage)stage;
+        }
+        progress.changed.notify_all();
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned s = 0; s < kNumStages; s++)
+    {
+        if (m_onCaller[s])
+            continue;
+        threads.emplace_back([&, s]() {
+            for (;;)
+            {
+                unsigned index;
+                {
+                    std::unique_lock<std::mutex> lock(progress.mutex);
+                    progress.changed.wait(lock, [&]() { return progress.done(s) || progress.ready(s); });
+                    if (progress.done(s))
+                        return;
+                    index = progress.finished[s];
+                }
+                finish(s, runStage(s, first + index, index % m_depth));
+            }
+        });
+    }
+
+    //The calling thread takes turns between its own stages, furthest
+    //along first so slots are freed before new frames are asked for.
+    for (;;)
+    {
+        unsigned stage = kNumStages;
+        unsigned index = 0;
+        {
+            std::unique_lock<std::mutex> lock(progress.mutex);
+            bool waiting = false;
+            for (int s = kNumStages - 1; s >= 0 && stage == kNumStages; s--)
+            {
+                if (!m_onCaller[s] || progress.done(s))
+                    continue;
+                waiting = true;
+                if (progress.ready(s))
+                    stage = (unsigned)s;
+            }
+            if (!waiting)
+                break;
+            if (stage == kNumStages)
+            {
+                progress.changed.wait(lock);
+                continue;
+            }
+            index = progress.finished[stage];
+        }
+        finish(stage, runStage(stage, first + index, index % m_depth));
+    }
+
+    for (std::thread& thread : threads)
+        thread.join();
+    m_seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    return m_failed == kNumStages;
+}
+
+FramePipeline::Stage FramePipeline::failedStage() const
+{
+    return m_failed;
+}
+
+double FramePipeline::busySeconds(Stage stage) const
+{
+    return m_busy[stage];
+}
+
+double FramePipeline::seconds() const
+{
+    return m_seconds;
+}
@@ -0,0 +1,70 @@
+//
+// Runs a frame loop as three stages: one produces frames into a ring of
+// slots, from the scene or a cache file, one tracks them and one collects
+// the results for keying or output. Each stage runs on its own thread and
+// blocks when the ring is full ahead of it or empty behind it, so a frame
+// costs the slowest stage rather than the sum of all three, and no more
+// than depth() frames are ever in flight.
+//
+// Stages that must stay on the calling thread, like Maya's DG pulls and
+// keyframe writes, can be run there instead; the calling thread then
+// takes turns between them while the other stages run alongside.
+//
+// The pipeline only schedules. The caller keeps depth() slots of its own,
+// indexed by the slot each stage is handed.
+//
+#ifndef TRACKERCORE_FRAMEPIPELINE_H
+#define TRACKERCORE_FRAMEPIPELINE_H
+
+#include <functional>
+
+class FramePipeline
+{
+public:
+    enum Stage
+    {
+        kProduce,
+        kTrack,
+        kCollect,
+        kNumStages
+    };
+
+    //Called with a frame and the slot it occupies. Returning false stops
+    //the pipeline.
+    typedef std::function<bool(unsigned frame, unsigned slot)> StageFunction;
+
+    static const unsigned kDefaultDepth = 4;
+
+    //A depth of 0 runs every stage of a frame on the calling thread
+    //before the next frame, with a single slot, like a plain loop.
+    explicit FramePipeline(unsigned depth = kDefaultDepth);
+
+    //Slots the caller needs, at least 1.
+    unsigned numSlots() const;
+    bool sequential() const;
+    //Runs stage on the thread that calls run() rather than its own.
+    void runOnCaller(Stage stage, bool onCaller = true);
+
+    //Runs frames [first, last) through the three stages in order: every
+    //frame is produced, then tracked, then collected, and each stage sees
+    //the frames in order. Returns false when a stage does, once the
+    //stages after it have finished the frames before the failed one;
+    //failedStage() tells which stage it was.
+    bool run(unsigned first, unsigned last, const StageFunction& produce, const StageFunction& track,
+             const StageFunction& collect);
+    Stage failedStage() const;
+
+    //Seconds each stage spent in its function, and in all, during the
+    //last run().
+    double busySeconds(Stage stage) const;
+    double seconds() const;
+
+private:
+    unsigned m_depth;
+    bool m_onCaller[kNumStages];
+    double m_busy[kNumStages];
+    double m_seconds = 0;
+    Stage m_failed = kNumStages;
+};
+
+#endif //TRACKERCORE_FRAMEPIPELINE_H
@@ -0,0 +1,169 @@
+//
+// Robust joint estimate from the K tracked surface points of a joint.
+//
+#include "jointEstimate.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRACKERCORE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    //Sums are taken relative to the current centre so float lanes keep
+    //their precision far from the origin.
+    struct Centre
+    {
+        float x;
+        float y;
+        float z;
+    };
+
+#ifdef TRACKERCORE_SSE2
+    inline float horizontalSum(__m128 value)
+    {
+        float lanes[4];
+        _mm_storeu_ps(lanes, value);
+        return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+#endif
+
+    //Weighted mean of the points, as an offset from centre. Returns false
+    //when the weights sum to nothing.
+    bool weightedOffset(const float* x, const float* y, const float* z, const float* weights, unsigned count,
+                        const Centre& centre, Vec3& offset)
+    {
+        unsigned i = 0;
+        double sumW = 0;
+        double sumX = 0;
+        double sumY = 0;
+        double sumZ = 0;
+
+#ifdef TRACKERCORE_SSE2
+        __m128 cx = _mm_set1_ps(centre.x);
+        __m128 cy = _mm_set1_ps(centre.y);
+        __m128 cz = _mm_set1_ps(centre.z);
+        __m128 accW = _mm_setzero_ps();
+        __m128 accX = _mm_setzero_ps();
+        __m128 accY = _mm_setzero_ps();
+        __m128 accZ = _mm_setzero_ps();
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 w = _mm_loadu_ps(weights + i);
+            accW = _mm_add_ps(accW, w);
+            accX = _mm_add_ps(accX, _mm_mul_ps(w, _mm_sub_ps(_mm_loadu_ps(x + i), cx)));
+            accY = _mm_add_ps(accY, _mm_mul_ps(w, _mm_sub_ps(_mm_loadu_ps(y + i), cy)));
+            accZ = _mm_add_ps(accZ, _mm_mul_ps(w, _mm_sub_ps(_mm_loadu_ps(z + i), cz)));
+        }
+        sumW = horizontalSum(accW);
+        sumX = horizontalSum(accX);
+        sumY = horizontalSum(accY);
+        sumZ = horizontalSum(accZ);
+#endif
+
+        for (; i < count; i++)
+        {
+            sumW += weights[i];
+            sumX += weights[i] * (x[i] - centre.x);
+            sumY += weights[i] * (y[i] - centre.y);
+            sumZ += weights[i] * (z[i] - centre.z);
+        }
+
+        if (sumW <= 0)
+            return false;
+        offset = Vec3(sumX / sumW, sumY / sumW, sumZ / sumW);
+        return true;
+    }
+
+    //Writes each point's distance from centre into distances and returns
+    //their mean.
+    double distances(const float* x, const float* y, const float* z, unsigned count, const Centre& centre,
+                     float* distances)
+    {
+        unsigned i = 0;
+        double sum = 0;
+
+#ifdef TRACKERCORE_SSE2
+        __m128 cx = _mm_set1_ps(centre.x);
+        __m128 cy = _mm_set1_ps(centre.y);
+        __m128 cz = _mm_set1_ps(centre.z);
+        __m128 acc = _mm_setzero_ps();
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 dx = _mm_sub_ps(_mm_loadu_ps(x + i), cx);
+            __m128 dy = _mm_sub_ps(_mm_loadu_ps(y + i), cy);
+            __m128 dz = _mm_sub_ps(_mm_loadu_ps(z + i), cz);
+            __m128 d = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                                              _mm_mul_ps(dz, dz)));
+            _mm_storeu_ps(distances + i, d);
+            acc = _mm_add_ps(acc, d);
+        }
+        sum = horizontalSum(acc);
+#endif
+
+        for (; i < count; i++)
+        {
+            Vec3 delta(x[i] - centre.x, y[i] - centre.y, z[i] - centre.z);
+            distances[i] = (float)delta.length();
+            sum += distances[i];
+        }
+        return sum / count;
+    }
+
+    //Huber weights in place over the distances: 1 up to threshold,
+    //threshold / distance beyond it.
+    void huberWeights(float* weights, unsigned count, float threshold)
+    {
+        unsigned i = 0;
+
+#ifdef TRACKERCORE_SSE2
+        __m128 t = _mm_set1_ps(threshold);
+        __m128 one = _mm_set1_ps(1.0f);
+        for (; i + 4 <= count; i += 4)
+        {
+            //max() keeps points sitting on the centre away from 0 / 0.
+            __m128 d = _mm_max_ps(_mm_loadu_ps(weights + i), t);
+            _mm_storeu_ps(weights + i, _mm_min_ps(one, _mm_div_ps(t, d)));
+        }
+#endif
+
+        for (; i < count; i++)
+            weights[i] = weights[i] > threshold ? threshold / weights[i] : 1.0f;
+    }
+}
+
+Vec3 robustCentroid(const float* x, const float* y, const float* z, unsigned count, float* weights)
+{
+    if (count == 0)
+        return Vec3();
+
+    Centre centre = {x[0], y[0], z[0]};
+    for (unsigned i = 0; i < count; i++)
+        weights[i] = 1.0f;
+
+    Vec3 offset;
+    weightedOffset(x, y, z, weights, count, centre, offset);
+    Vec3 estimate = Vec3(centre.x, centre.y, centre.z) + offset;
+
+    for (unsigned iteration = 0; iteration < kRobustIterations && count > 2; iteration++)
+    {
+        centre.x = (float)estimate.x;
+        centre.y = (float)estimate.y;
+        centre.z = (float)estimate.z;
+
+        //Points all on the centre have nothing to reweight.
+        double meanDistance = distances(x, y, z, count, centre, weights);
+        if (meanDistance <= 0)
+        {
+            for (unsigned i = 0; i < count; i++)
+                weights[i] = 1.0f;
+            break;
+        }
+        huberWeights(weights, count, (float)(kHuberScale * meanDistance));
+
+        if (!weightedOffset(x, y, z, weights, count, centre, offset))
+            break;
+        estimate = Vec3(centre.x, centre.y, centre.z) + offset;
+    }
+    return estimate;
+}
@@ -0,0 +1,175 @@
+//
+// Headless joint tracker: tracks the joints defined in a vertex set file
+// over a point cache exported with jointRig -exportCache, without Maya.
+//
+// Usage: jointTrack <cache> <sets> [-s startFrame] [-e endFrame]
+//                   [-t threads] [-o output.csv] [-j output.vjtr]
+//                   [-c checkpoint] [-ci frames] [-r] [-m maps.vjcr]
+//                   [-q depth] [-p] [-pt trace.json]
+//
+// The cache is memory mapped and only the frames around the one being
+// tracked are kept resident, so memory stays flat on long takes. With -c
+// the track is checkpointed as it goes, and -r carries a track that
+// stopped halfway on from its last checkpoint. With -m tracked points are
+// carried over topology changes by dense correspondence maps, which are
+// kept in the given file for the next run.
+//
+// Frames are read, tracked and written out on three threads at once, with
+// up to -q frames read ahead of the one being tracked.
+//
+// Exits with 1 on bad input and 2 if any joint lost track on any frame.
+//
+#include "profiler.h"
+#include "take.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace
+{
+    void usage()
+    {
+        std::cerr << "Usage: jointTrack <cache> <sets> [-s startFrame] [-e endFrame] [-t threads] [-o output.csv]\n"
+                  << "                  [-j output.vjtr] [-c checkpoint] [-ci frames] [-r] [-m maps.vjcr]\n"
+                  << "                  [-q depth] [-p]\n"
+                  << "                  [-pt trace.json]\n"
+                  << "  -s  first frame to track (default: first cached frame)\n"
+                  << "  -e  frame to stop tracking at (default: last cached frame)\n"
+                  << "  -t  tracking threads, 0 for one per core (default 0)\n"
+                  << "  -o  write frame,joint,x,y,z rows to this CSV file\n"
+                  << "  -j  write the full trajectories to this binary trajectory file\n"
+                  << "  -c  save the track to this checkpoint file as it goes\n"
+                  << "  -ci frames between checkpoints (default 100)\n"
+                  << "  -r  carry on from the checkpoint instead of starting over\n"
+                  << "  -m  carry points over topology changes with the correspondence maps in this file,\n"
+                  << "      adding any it lacks\n"
+                  << "  -q  frames read ahead of the one being tracked, 0 to read, track and write out\n"
+                  << "      one frame at a time on one thread (default 4)\n"
+                  << "  -p  print where the time went, per phase\n"
+                  << "  -pt also write the timed phases as Chrome trace JSON\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string cachePath;
+    std::string setsPath;
+    std::string outputPath;
+    std::string trajectoryPath;
+    std::string profileTracePath;
+    std::string checkpointPath;
+    std::string mapsPath;
+    unsigned checkpointInterval = 100;
+    bool resume = false;
+    bool profile = false;
+    double startFrame = -1;
+    double endFrame = -1;
+    unsigned numThreads = 0;
+    unsigned pipelineDepth = FramePipeline::kDefaultDepth;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "-s") == 0 && hasValue)
+            startFrame = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "-e") == 0 && hasValue)
+            endFrame = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "-t") == 0 && hasValue)
+            numThreads = (unsigned)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "-o") == 0 && hasValue)
+            outputPath = argv[++i];
+        else if (std::strcmp(argv[i], "-j") == 0 && hasValue)
+            trajectoryPath = argv[++i];
+        else if (std::strcmp(argv[i], "-c") == 0 && hasValue)
+            checkpointPath = argv[++i];
+        else if (std::strcmp(argv[i], "-ci") == 0 && hasValue)
+            checkpointInterval = (unsigned)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "-r") == 0)
+            resume = true;
+        else if (std::strcmp(argv[i], "-m") == 0 && hasValue)
+            mapsPath = argv[++i];
+        else if (std::strcmp(argv[i], "-q") == 0 && hasValue)
+            pipelineDepth = (unsigned)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "-p") == 0)
+            profile = true;
+        else if (std::strcmp(argv[i], "-pt") == 0 && hasValue)
+        {
+            profileTracePath = argv[++i];
+            profile = true;
+        }
+        else if (argv[i][0] == '-')
+        {
+            usage();
+            return 1;
+        }
+        else if (cachePath.empty())
+            cachePath = argv[i];
+        else if (setsPath.empty())
+            setsPath = argv[i];
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if (cachePath.empty() || setsPath.empty() || (resume && checkpointPath.empty()))
+    {
+        usage();
+        return 1;
+    }
+
+    TakeJob job;
+    job.name = cachePath;
+    job.cachePath = cachePath;
+    job.setsPath = setsPath;
+    job.trajectoryPath = trajectoryPath;
+    job.csvPath = outputPath;
+    job.startFrame = startFrame;
+    job.endFrame = endFrame;
+    job.numThreads = numThreads;
+    job.checkpointPath = checkpointPath;
+    job.checkpointInterval = checkpointInterval;
+    job.resume = resume;
+    job.correspondencePath = mapsPath;
+    job.pipelineDepth = pipelineDepth;
+
+    ProfileSession profileSession(profile, !profileTracePath.empty());
+    TakeResult result = trackTake(job);
+    if (!result.ok)
+    {
+        std::cerr << "jointTrack: " << result.error << "\n";
+        return 1;
+    }
+
+    std::cout << "jointTrack: tracked " << result.numJoints << " joints over " << result.numFrames << " frames in "
+              << result.seconds << " s (" << (result.seconds > 0 ? result.numFrames / result.seconds : 0)
+              << " frames/s, " << result.numThreads << " threads, " << result.topologyChanges << " topology changes)";
+    if (result.resumedFrames > 0)
+        std::cout << ", " << result.resumedFrames << " frames from the checkpoint";
+    if (result.mapsComputed + result.mapsReused > 0)
+        std::cout << ", " << result.mapsComputed << " correspondence maps computed and " << result.mapsReused
+                  << " reused";
+    if (result.lost > 0)
+        std::cout << ", " << result.lost << " lost joint samples";
+    std::cout << std::endl;
+
+    if (profile)
+    {
+        Profiler::stop();
+        std::cout << Profiler::report();
+        std::cout << "stages: read " << result.stageSeconds[FramePipeline::kProduce] << " s, track "
+                  << result.stageSeconds[FramePipeline::kTrack] << " s, write "
+                  << result.stageSeconds[FramePipeline::kCollect] << " s busy" << std::endl;
+        std::string error;
+        if (!profileTracePath.empty() && !Profiler::writeChromeTrace(profileTracePath, error))
+        {
+            std::cerr << "jointTrack: " << error << "\n";
+            return 1;
+        }
+    }
+
+    return result.lost > 0 ? 2 : 0;
+}
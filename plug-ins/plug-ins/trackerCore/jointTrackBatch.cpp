@@ -0,0 +1,233 @@
+//
+// Tracks every take of a manifest headless, several takes at a time.
+//
+// Usage: jointTrackBatch <manifest> [-j jobs] [-t threads] [-r report.csv]
+//                        [-k chunkFrames] [-w overlap] [-m]
+//        jointTrackBatch -stitch <output.vjtr> <part.vjtr>...
+//
+// See take.h for the manifest format. Each take writes its own trajectory
+// file. Takes run on a pool of jobs workers, one tracking thread each by
+// default, so a farm node stays busy with one take per core rather than
+// one take spread thinly over all of them. With -k long takes are split
+// into chunks that go to the workers like takes of their own, and are
+// stitched back together once all of a take's chunks are done. With -m
+// points are carried over topology changes by correspondence maps kept
+// next to each cache, so a rerun of the session only tracks. -stitch
+// joins trajectories of chunks tracked elsewhere, for example with
+// jointTrack -s/-e on other machines.
+//
+// Exits with 1 if any take failed and 2 if any take lost track of a joint.
+//
+#include "correspondence.h"
+#include "take.h"
+#include "threadPool.h"
+#include "trajectory.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    void usage()
+    {
+        std::cerr << "Usage: jointTrackBatch <manifest> [-j jobs] [-t threads] [-r report.csv] [-k chunkFrames]\n"
+                  << "                       [-w overlap] [-m]\n"
+                  << "       jointTrackBatch -stitch <output.vjtr> <part.vjtr>...\n"
+                  << "  -j  takes or chunks tracked at once, 0 for one per core (default 0)\n"
+                  << "  -t  tracking threads per take or chunk (default 1)\n"
+                  << "  -r  write one take,status,joints,frames,lost,seconds,error row per take\n"
+                  << "  -k  split takes into chunks of this many frames (default 0, no split)\n"
+                  << "  -w  frames each chunk starts tracking early to overlap the one before (default 10)\n"
+                  << "  -m  carry points over topology changes with the correspondence maps next to each\n"
+                  << "      cache (cache.vjcr), computing and saving any that are missing\n"
+                  << "  -stitch  join trajectories of parts of one take into output\n";
+    }
+
+    bool writeReport(const std::string& path, const std::vector<TakeJob>& jobs,
+                     const std::vector<TakeResult>& results)
+    {
+        std::ofstream report(path.c_str());
+        report << "take,status,joints,frames,lost,seconds,error\n";
+        for (size_t t = 0; t < jobs.size(); t++)
+        {
+            const TakeResult& result = results[t];
+            const char* status = !result.ok ? "failed" : result.lost > 0 ? "lost" : "ok";
+            std::string message = result.error;
+            for (size_t quote = message.find('"'); quote != std::string::npos; quote = message.find('"', quote + 2))
+                message.insert(quote, 1, '"');
+            report << jobs[t].name << "," << status << "," << result.numJoints << "," << result.numFrames << ","
+                   << result.lost << "," << result.seconds << ",\"" << message << "\"\n";
+        }
+        return report.good();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && std::strcmp(argv[1], "-stitch") == 0)
+    {
+        if (argc < 4)
+        {
+            usage();
+            return 1;
+        }
+        std::string error;
+        if (!stitchTrajectories(std::vector<std::string>(argv + 3, argv + argc), argv[2], error))
+        {
+            std::cerr << "jointTrackBatch: " << error << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    std::string manifestPath;
+    std::string reportPath;
+    unsigned numJobs = 0;
+    unsigned numThreads = 1;
+    unsigned chunkFrames = 0;
+    unsigned overlap = 10;
+    bool maps = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "-j") == 0 && hasValue)
+            numJobs = (unsigned)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "-t") == 0 && hasValue)
+            numThreads = (unsigned)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "-r") == 0 && hasValue)
+            reportPath = argv[++i];
+        else if (std::strcmp(argv[i], "-k") == 0 && hasValue)
+            chunkFrames = (unsigned)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "-w") == 0 && hasValue)
+            overlap = (unsigned)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "-m") == 0)
+            maps = true;
+        else if (argv[i][0] == '-' || !manifestPath.empty())
+        {
+            usage();
+            return 1;
+        }
+        else
+            manifestPath = argv[i];
+    }
+
+    if (manifestPath.empty())
+    {
+        usage();
+        return 1;
+    }
+
+    std::vector<TakeJob> jobs;
+    std::string error;
+    if (!readTakeManifest(manifestPath, jobs, error))
+    {
+        std::cerr << "jointTrackBatch: " << error << "\n";
+        return 1;
+    }
+    for (TakeJob& job : jobs)
+    {
+        job.numThreads = numThreads;
+        if (maps)
+            job.correspondencePath = correspondencePath(job.cachePath);
+    }
+
+    //Work items are whole takes, or with -k their chunks. A take that
+    //cannot be split fails on its own.
+    std::vector<TakeResult> results(jobs.size());
+    std::vector<std::vector<TakeJob>> chunks(jobs.size());
+    std::vector<TakeJob> work;
+    for (size_t t = 0; t < jobs.size(); t++)
+    {
+        if (chunkFrames == 0)
+            chunks[t].push_back(jobs[t]);
+        else if (!splitTake(jobs[t], chunkFrames, overlap, chunks[t], results[t].error))
+        {
+            std::cout << jobs[t].name << ": failed, " << results[t].error << std::endl;
+            chunks[t].clear();
+            continue;
+        }
+        work.insert(work.end(), chunks[t].begin(), chunks[t].end());
+    }
+
+    //No point in more workers than work items.
+    if (numJobs == 0)
+        numJobs = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+    if (numJobs > work.size())
+        numJobs = work.size() > 0 ? (unsigned)work.size() : 1;
+
+    std::cout << "jointTrackBatch: " << jobs.size() << " takes";
+    if (chunkFrames > 0)
+        std::cout << " in " << work.size() << " chunks";
+    std::cout << ", " << numJobs << " at a time" << std::endl;
+
+    std::vector<TakeResult> workResults(work.size());
+    std::mutex progressMutex;
+    unsigned finished = 0;
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    ThreadPool pool(numJobs);
+    pool.parallelFor((unsigned)work.size(), [&](unsigned w) {
+        workResults[w] = trackTake(work[w]);
+
+        const TakeResult& result = workResults[w];
+        std::lock_guard<std::mutex> lock(progressMutex);
+        finished++;
+        std::cout << "[" << finished << "/" << work.size() << "] " << work[w].name << ": ";
+        if (!result.ok)
+            std::cout << "failed, " << result.error;
+        else
+        {
+            std::cout << result.numFrames << " frames in " << result.seconds << " s";
+            if (result.lost > 0)
+                std::cout << ", " << result.lost << " lost joint samples";
+            if (result.mapsComputed > 0)
+                std::cout << ", " << result.mapsComputed << " correspondence maps computed";
+        }
+        std::cout << std::endl;
+    });
+
+    for (size_t t = 0, w = 0; t < jobs.size(); t++)
+    {
+        if (chunks[t].empty())
+            continue;
+        std::vector<TakeResult> chunkResults(workResults.begin() + w, workResults.begin() + w + chunks[t].size());
+        results[t] = chunkFrames == 0 ? chunkResults[0] : joinTake(jobs[t], chunks[t], chunkResults);
+        w += chunks[t].size();
+        if (!results[t].ok && chunkFrames > 0)
+            std::cout << jobs[t].name << ": failed, " << results[t].error << std::endl;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    unsigned frames = 0;
+    unsigned failedTakes = 0;
+    unsigned lostTakes = 0;
+    for (const TakeResult& result : results)
+    {
+        frames += result.numFrames;
+        failedTakes += result.ok ? 0 : 1;
+        lostTakes += result.ok && result.lost > 0 ? 1 : 0;
+    }
+
+    std::cout << "jointTrackBatch: " << frames << " frames over " << jobs.size() << " takes in " << seconds << " s ("
+              << (seconds > 0 ? frames / seconds : 0) << " frames/s)";
+    if (failedTakes > 0)
+        std::cout << ", " << failedTakes << " failed";
+    if (lostTakes > 0)
+        std::cout << ", " << lostTakes << " with lost joints";
+    std::cout << std::endl;
+
+    if (!reportPath.empty() && !writeReport(reportPath, jobs, results))
+    {
+        std::cerr << "jointTrackBatch: could not write " << reportPath << "\n";
+        return 1;
+    }
+    return failedTakes > 0 ? 1 : lostTakes > 0 ? 2 : 0;
+}
@@ -0,0 +1,379 @@
+//
+// Joint proposals from the first frame of a capture.
+//
+#include "landmarks.h"
+#include "meshAdjacency.h"
+#include "profiler.h"
+#include "threadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+namespace
+{
+    //A connected piece of one slice: a ring around a limb, or on the
+    //body near the start point a patch of it.
+    struct Ring
+    {
+        unsigned slice = 0;
+        std::vector<int> vertices;
+        Vec3 centre;
+        //The ring this one grew from, -1 for the first.
+        int parent = -1;
+        std::vector<unsigned> children;
+        //Slices from this ring out to the furthest tip beyond it.
+        double height = 0;
+    };
+
+    inline Vec3 point(const float* points, int vertex)
+    {
+        return Vec3(points[vertex * 3], points[vertex * 3 + 1], points[vertex * 3 + 2]);
+    }
+
+    //Vertices of the largest connected piece of the mesh, so stray bits
+    //of a volumetric capture are left out.
+    std::vector<int> largestPiece(const MeshAdjacency& adjacency)
+    {
+        unsigned numVertices = adjacency.numVertices();
+        std::vector<bool> visited(numVertices, false);
+        std::vector<int> largest;
+        std::vector<int> piece;
+        for (unsigned start = 0; start < numVertices; start++)
+        {
+            if (visited[start] || adjacency.degree(start) == 0)
+                continue;
+
+            piece.clear();
+            piece.push_back((int)start);
+            visited[start] = true;
+            for (size_t i = 0; i < piece.size(); i++)
+            {
+                for (const int* n = adjacency.begin(piece[i]); n != adjacency.end(piece[i]); n++)
+                {
+                    if (!visited[*n])
+                    {
+                        visited[*n] = true;
+                        piece.push_back(*n);
+                    }
+                }
+            }
+            if (piece.size() > largest.size())
+                largest.swap(piece);
+        }
+        return largest;
+    }
+
+    //The vertex nearest the centre of the piece, which on a person is on
+    //the torso.
+    int centralVertex(const float* points, const std::vector<int>& piece)
+    {
+        Vec3 centre;
+        for (int v : piece)
+            centre += point(points, v);
+        centre = centre / (double)piece.size();
+
+        int central = piece[0];
+        double nearest = std::numeric_limits<double>::max();
+        for (int v : piece)
+        {
+            Vec3 offset = point(points, v) - centre;
+            if (offset.dot(offset) < nearest)
+            {
+                nearest = offset.dot(offset);
+                central = v;
+            }
+        }
+        return central;
+    }
+
+    //Distance along the mesh edges from source, infinite where the mesh
+    //does not reach.
+    std::vector<double> geodesicDistances(const float* points, const MeshAdjacency& adjacency, int source)
+    {
+        typedef std::pair<double, int> Entry;
+        std::vector<double> distances(adjacency.numVertices(), std::numeric_limits<double>::infinity());
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+        distances[source] = 0;
+        queue.push(Entry(0, source));
+        while (!queue.empty())
+        {
+            Entry entry = queue.top();
+            queue.pop();
+            int v = entry.second;
+            if (entry.first > distances[v])
+                continue;
+
+            Vec3 p = point(points, v);
+            for (const int* n = adjacency.begin(v); n != adjacency.end(v); n++)
+            {
+                double distance = entry.first + (point(points, *n) - p).length();
+                if (distance < distances[*n])
+                {
+                    distances[*n] = distance;
+                    queue.push(Entry(distance, *n));
+                }
+            }
+        }
+        return distances;
+    }
+
+    //Up to count of the ring's vertices, spread evenly by angle around the
+    //limb's axis.
+    std::vector<int> supportVertices(const float* points, const Ring& ring, Vec3 axis, unsigned count)
+    {
+        double length = axis.length();
+        axis = length > 0 ? axis / length : Vec3(0, 1, 0);
+        Vec3 other = std::fabs(axis.x) < 0.6 ? Vec3(1, 0, 0) : Vec3(0, 1, 0);
+        Vec3 u = axis.cross(other);
+        u = u / u.length();
+        Vec3 w = axis.cross(u);
+
+        std::vector<std::pair<double, int>> byAngle;
+        for (int v : ring.vertices)
+        {
+            Vec3 offset = point(points, v) - ring.centre;
+            byAngle.push_back(std::make_pair(std::atan2(offset.dot(w), offset.dot(u)), v));
+        }
+        std::sort(byAngle.begin(), byAngle.end());
+
+        std::vector<int> vertices;
+        size_t numPicked = std::min((size_t)count, byAngle.size());
+        for (size_t i = 0; i < numPicked; i++)
+            vertices.push_back(byAngle[i * byAngle.size() / numPicked].second);
+        return vertices;
+    }
+}
+
+std::vector<Landmark> detectLandmarks(const float* points, unsigned numVertices, const int* triangles,
+                                      unsigned numTriangles, const LandmarkOptions& options)
+{
+    PROFILE_SCOPE("landmarks");
+    std::vector<Landmark> landmarks;
+
+    MeshAdjacency adjacency;
+    adjacency.build(numVertices, triangles, numTriangles);
+    std::vector<int> piece = largestPiece(adjacency);
+    if (piece.size() < 3)
+        return landmarks;
+
+    int source = centralVertex(points, piece);
+    std::vector<double> distances = geodesicDistances(points, adjacency, source);
+
+    double maxDistance = 0;
+    double edgeLengths = 0;
+    size_t numEdges = 0;
+    for (int v : piece)
+    {
+        maxDistance = std::max(maxDistance, distances[v]);
+        for (const int* n = adjacency.begin(v); n != adjacency.end(v); n++)
+        {
+            if (*n > v)
+            {
+                edgeLengths += (point(points, *n) - point(points, v)).length();
+                numEdges++;
+            }
+        }
+    }
+    if (maxDistance <= 0)
+        return landmarks;
+
+    //Slices thinner than an edge would let edges skip them and break the
+    //rings apart.
+    double width = std::max(maxDistance / std::max(options.numSlices, 1u), 2 * edgeLengths / numEdges);
+    unsigned numSlices = (unsigned)(maxDistance / width) + 1;
+
+    std::vector<int> slice(numVertices, -1);
+    std::vector<unsigned> sliceStart(numSlices + 1, 0);
+    for (int v : piece)
+    {
+        slice[v] = std::min((int)(distances[v] / width), (int)numSlices - 1);
+        sliceStart[slice[v] + 1]++;
+    }
+    for (unsigned s = 0; s < numSlices; s++)
+        sliceStart[s + 1] += sliceStart[s];
+    std::vector<int> sliceVertices(piece.size());
+    std::vector<unsigned> fill(sliceStart.begin(), sliceStart.end() - 1);
+    for (int v : piece)
+        sliceVertices[fill[slice[v]]++] = v;
+
+    //Rings of each slice, numbered within the slice, and then in slice
+    //order across the mesh. Every vertex belongs to one slice, so the
+    //slices can be split into rings side by side.
+    ThreadPool pool(options.numThreads);
+    std::vector<int> ringInSlice(numVertices, -1);
+    std::vector<unsigned> ringStart(numSlices + 1, 0);
+    {
+        PROFILE_SCOPE("landmarkSlices");
+        pool.parallelFor(numSlices, [&](unsigned s) {
+            unsigned numRings = 0;
+            std::vector<int> stack;
+            for (unsigned i = sliceStart[s]; i < sliceStart[s + 1]; i++)
+            {
+                int start = sliceVertices[i];
+                if (ringInSlice[start] >= 0)
+                    continue;
+
+                ringInSlice[start] = (int)numRings;
+                stack.push_back(start);
+                while (!stack.empty())
+                {
+                    int v = stack.back();
+                    stack.pop_back();
+                    for (const int* n = adjacency.begin(v); n != adjacency.end(v); n++)
+                    {
+                        if (slice[*n] == (int)s && ringInSlice[*n] < 0)
+                        {
+                            ringInSlice[*n] = (int)numRings;
+                            stack.push_back(*n);
+                        }
+                    }
+                }
+                numRings++;
+            }
+            ringStart[s + 1] = numRings;
+        });
+    }
+    for (unsigned s = 0; s < numSlices; s++)
+        ringStart[s + 1] += ringStart[s];
+
+    std::vector<Ring> rings(ringStart[numSlices]);
+    for (unsigned s = 0; s < numSlices; s++)
+    {
+        for (unsigned i = sliceStart[s]; i < sliceStart[s + 1]; i++)
+        {
+            Ring& ring = rings[ringStart[s] + ringInSlice[sliceVertices[i]]];
+            ring.slice = s;
+            ring.vertices.push_back(sliceVertices[i]);
+        }
+    }
+
+    //Each ring grew from the ring it touches in the nearest slice below
+    //it, the one it shares the most edges with if there are several.
+    //Where a hand touches the body the mesh has loops, and this cuts them.
+    {
+        PROFILE_SCOPE("landmarkRings");
+        pool.parallelFor((unsigned)rings.size(), [&](unsigned r) {
+            Ring& ring = rings[r];
+            std::vector<std::pair<unsigned, unsigned>> links;
+            for (int v : ring.vertices)
+            {
+                ring.centre += point(points, v);
+                for (const int* n = adjacency.begin(v); n != adjacency.end(v); n++)
+                {
+                    if (slice[*n] < 0 || slice[*n] >= (int)ring.slice)
+                        continue;
+                    unsigned below = ringStart[slice[*n]] + ringInSlice[*n];
+                    size_t l = 0;
+                    while (l < links.size() && links[l].first != below)
+                        l++;
+                    if (l == links.size())
+                        links.push_back(std::make_pair(below, 0u));
+                    links[l].second++;
+                }
+            }
+            ring.centre = ring.centre / (double)ring.vertices.size();
+
+            for (const std::pair<unsigned, unsigned>& link : links)
+            {
+                if (ring.parent < 0 || rings[link.first].slice > rings[ring.parent].slice)
+                    ring.parent = (int)link.first;
+            }
+            unsigned mostLinks = 0;
+            for (const std::pair<unsigned, unsigned>& link : links)
+            {
+                if (rings[link.first].slice == rings[ring.parent].slice && link.second > mostLinks)
+                {
+                    mostLinks = link.second;
+                    ring.parent = (int)link.first;
+                }
+            }
+        });
+    }
+
+    //Rings only link to lower slices, which have lower indices, so one
+    //pass from the tips in gives every ring its height.
+    for (size_t r = rings.size(); r-- > 0;)
+    {
+        if (rings[r].parent < 0)
+            continue;
+        Ring& parent = rings[rings[r].parent];
+        parent.height = std::max(parent.height, rings[r].height + (rings[r].slice - parent.slice));
+    }
+    for (unsigned r = 0; r < rings.size(); r++)
+    {
+        if (rings[r].parent >= 0)
+            rings[rings[r].parent].children.push_back(r);
+    }
+
+    //Where a ring splits, branches shorter than a limb are dropped. If
+    //they all are, the tallest one carries on.
+    double minLimbSlices = options.minLimbFraction * maxDistance / width;
+    for (Ring& ring : rings)
+    {
+        if (ring.children.size() < 2)
+            continue;
+
+        std::vector<unsigned> kept;
+        unsigned tallest = ring.children[0];
+        for (unsigned child : ring.children)
+        {
+            double height = rings[child].height + (rings[child].slice - ring.slice);
+            if (height >= minLimbSlices)
+                kept.push_back(child);
+            if (rings[child].height > rings[tallest].height)
+                tallest = child;
+        }
+        if (kept.empty())
+            kept.push_back(tallest);
+        ring.children.swap(kept);
+    }
+
+    //Limbs run from a tip in to the ring after the nearest split.
+    unsigned root = ringStart[slice[source]] + ringInSlice[source];
+    std::vector<unsigned> tips;
+    std::vector<unsigned> stack(1, root);
+    while (!stack.empty())
+    {
+        unsigned r = stack.back();
+        stack.pop_back();
+        if (rings[r].children.empty())
+            tips.push_back(r);
+        stack.insert(stack.end(), rings[r].children.begin(), rings[r].children.end());
+    }
+    std::sort(tips.begin(), tips.end());
+
+    for (unsigned limb = 0; limb < tips.size(); limb++)
+    {
+        std::vector<unsigned> path(1, tips[limb]);
+        while (rings[path.back()].parent >= 0 && rings[rings[path.back()].parent].children.size() < 2)
+            path.push_back((unsigned)rings[path.back()].parent);
+        std::reverse(path.begin(), path.end());
+
+        double baseSlice = rings[path.front()].slice;
+        double span = rings[path.back()].slice - baseSlice;
+        for (double fraction : options.jointFractions)
+        {
+            double target = baseSlice + fraction * span;
+            size_t i = 0;
+            while (i + 1 < path.size() && std::fabs(rings[path[i + 1]].slice - target)
+                                          <= std::fabs(rings[path[i]].slice - target))
+                i++;
+
+            const Ring& ring = rings[path[i]];
+            Vec3 axis = rings[path[std::min(i + 1, path.size() - 1)]].centre - rings[path[i > 0 ? i - 1 : 0]].centre;
+
+            Landmark landmark;
+            landmark.limb = limb;
+            landmark.vertices = supportVertices(points, ring, axis, options.maxSupportVertices);
+            for (int v : landmark.vertices)
+                landmark.position += point(points, v);
+            landmark.position = landmark.position / (double)landmark.vertices.size();
+            landmarks.push_back(landmark);
+        }
+    }
+    return landmarks;
+}
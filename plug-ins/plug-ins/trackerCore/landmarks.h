@@ -0,0 +1,57 @@
+//
+// Joint proposals from the first frame of a capture, so the vp sets that
+// tell the tracker what to follow do not have to be picked by hand.
+//
+// The surface is sliced by geodesic distance from a point on the torso.
+// Along a limb each slice is a ring around it, and where a limb meets the
+// body its rings merge with the body's, so linking every ring to the ring
+// it grew from gives a tree whose branches out to the tips are the limbs:
+// arms, legs and head on a person. Short side branches such as fingers or
+// cloth folds are folded into the branch they leave. Each limb gets a
+// joint at fixed fractions of its length, placed at the centre of the
+// ring there, and an even spread of the ring's vertices as its support
+// vertices.
+//
+// Distances come from one Dijkstra pass over the mesh edges. Slicing the
+// rings and linking them runs one slice per task on a ThreadPool.
+//
+#ifndef TRACKERCORE_LANDMARKS_H
+#define TRACKERCORE_LANDMARKS_H
+
+#include "vec3.h"
+
+#include <vector>
+
+struct LandmarkOptions
+{
+    //Slices over the longest geodesic distance. A slice is never thinner
+    //than two mean edge lengths, so coarse meshes get fewer.
+    unsigned numSlices = 120;
+    //Branches shorter than this fraction of the longest distance are
+    //detail of the branch they leave, not limbs.
+    double minLimbFraction = 0.12;
+    //Where the joints of a limb go, from 0 where it leaves the body to 1
+    //at its tip. The default gives shoulder, elbow and wrist on an arm.
+    std::vector<double> jointFractions = {0.05, 0.5, 0.9};
+    //Most support vertices per joint.
+    unsigned maxSupportVertices = 16;
+    //0 means one per hardware thread.
+    unsigned numThreads = 0;
+};
+
+struct Landmark
+{
+    Vec3 position;
+    //Support vertices, in order around the limb.
+    std::vector<int> vertices;
+    //Limbs are numbered from 0. A limb's joints are consecutive and run
+    //from the body out.
+    unsigned limb = 0;
+};
+
+//Joints of every limb found on a triangle mesh with xyz points. Only the
+//largest connected piece of the mesh is searched.
+std::vector<Landmark> detectLandmarks(const float* points, unsigned numVertices, const int* triangles,
+                                      unsigned numTriangles, const LandmarkOptions& options = LandmarkOptions());
+
+#endif //TRACKERCORE_LANDMARKS_H
@@ -0,0 +1,244 @@
+//
+// Limb geometry used by limbLocalAngle: distances between joints and the
+// local angle at the middle joint of a three joint chain.
+//
+#include "limbAngle.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRACKERCORE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const double kRadiansToDegrees = 180.0 / 3.14159265358979323846;
+    const float kPi = 3.14159265358979f;
+    const float kHalfPi = 1.57079632679490f;
+
+    //Polynomial for atan(t) on [0, 1], good to about 1e-5 radians. The
+    //SSE2 lanes and the scalar tail both use it, so a frame's angle does
+    //not depend on where in the take it falls.
+    const float kAtan1 = 0.99997726f;
+    const float kAtan3 = -0.33262347f;
+    const float kAtan5 = 0.19354346f;
+    const float kAtan7 = -0.11643287f;
+    const float kAtan9 = 0.05265332f;
+    const float kAtan11 = -0.01172120f;
+
+    inline float atanUnit(float t)
+    {
+        float t2 = t * t;
+        return t * (kAtan1 + t2 * (kAtan3 + t2 * (kAtan5 + t2 * (kAtan7 + t2 * (kAtan9 + t2 * kAtan11)))));
+    }
+
+    //atan2(y, x) in degrees for y >= 0, 0 when both are 0.
+    inline float upperAtan2Degrees(float y, float x)
+    {
+        float absX = std::fabs(x);
+        float high = std::max(y, absX);
+        float low = std::min(y, absX);
+        float angle = atanUnit(low / std::max(high, FLT_MIN));
+        if (y > absX)
+            angle = kHalfPi - angle;
+        if (x < 0)
+            angle = kPi - angle;
+        return angle * (float)kRadiansToDegrees;
+    }
+
+#ifdef TRACKERCORE_SSE2
+    inline __m128 select(__m128 mask, __m128 ifTrue, __m128 ifFalse)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, ifTrue), _mm_andnot_ps(mask, ifFalse));
+    }
+
+    inline __m128 upperAtan2Degrees(__m128 y, __m128 x)
+    {
+        __m128 absX = _mm_andnot_ps(_mm_set1_ps(-0.0f), x);
+        __m128 high = _mm_max_ps(y, absX);
+        __m128 low = _mm_min_ps(y, absX);
+        __m128 t = _mm_div_ps(low, _mm_max_ps(high, _mm_set1_ps(FLT_MIN)));
+
+        __m128 t2 = _mm_mul_ps(t, t);
+        __m128 angle = _mm_add_ps(_mm_set1_ps(kAtan9), _mm_mul_ps(t2, _mm_set1_ps(kAtan11)));
+        angle = _mm_add_ps(_mm_set1_ps(kAtan7), _mm_mul_ps(t2, angle));
+        angle = _mm_add_ps(_mm_set1_ps(kAtan5), _mm_mul_ps(t2, angle));
+        angle = _mm_add_ps(_mm_set1_ps(kAtan3), _mm_mul_ps(t2, angle));
+        angle = _mm_add_ps(_mm_set1_ps(kAtan1), _mm_mul_ps(t2, angle));
+        angle = _mm_mul_ps(t, angle);
+
+        angle = select(_mm_cmpgt_ps(y, absX), _mm_sub_ps(_mm_set1_ps(kHalfPi), angle), angle);
+        angle = select(_mm_cmplt_ps(x, _mm_setzero_ps()), _mm_sub_ps(_mm_set1_ps(kPi), angle), angle);
+        return _mm_mul_ps(angle, _mm_set1_ps((float)kRadiansToDegrees));
+    }
+#endif
+}
+
+double distance(const Vec3& a, const Vec3& b)
+{
+    return (b - a).length();
+}
+
+double lawOfCosinesAngle(double a, double b, double c)
+{
+    if (a <= 0 || b <= 0)
+        return 0;
+
+    //Rounding can push the cosine just outside [-1, 1] for a
+    //straight or fully folded limb.
+    double cosine = (a * a + b * b - c * c) / (2 * a * b);
+    cosine = std::max(-1.0, std::min(1.0, cosine));
+    return std::acos(cosine) * kRadiansToDegrees;
+}
+
+double localJointAngle(const Vec3& a, const Vec3& b, const Vec3& c)
+{
+    return lawOfCosinesAngle(distance(a, b), distance(b, c), distance(a, c));
+}
+
+void localJointAngles(const JointPositions& a, const JointPositions& b, const JointPositions& c, unsigned count,
+                      float* angles)
+{
+    unsigned i = 0;
+
+#ifdef TRACKERCORE_SSE2
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 bx = _mm_loadu_ps(b.x + i);
+        __m128 by = _mm_loadu_ps(b.y + i);
+        __m128 bz = _mm_loadu_ps(b.z + i);
+        __m128 ux = _mm_sub_ps(_mm_loadu_ps(a.x + i), bx);
+        __m128 uy = _mm_sub_ps(_mm_loadu_ps(a.y + i), by);
+        __m128 uz = _mm_sub_ps(_mm_loadu_ps(a.z + i), bz);
+        __m128 vx = _mm_sub_ps(_mm_loadu_ps(c.x + i), bx);
+        __m128 vy = _mm_sub_ps(_mm_loadu_ps(c.y + i), by);
+        __m128 vz = _mm_sub_ps(_mm_loadu_ps(c.z + i), bz);
+
+        __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ux, vx), _mm_mul_ps(uy, vy)), _mm_mul_ps(uz, vz));
+        __m128 nx = _mm_sub_ps(_mm_mul_ps(uy, vz), _mm_mul_ps(uz, vy));
+        __m128 ny = _mm_sub_ps(_mm_mul_ps(uz, vx), _mm_mul_ps(ux, vz));
+        __m128 nz = _mm_sub_ps(_mm_mul_ps(ux, vy), _mm_mul_ps(uy, vx));
+        __m128 cross = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)),
+                                              _mm_mul_ps(nz, nz)));
+
+        //min() and max() drop NaNs, so lost joints are put back here.
+        __m128 known = _mm_cmpord_ps(dot, cross);
+        __m128 angle = select(known, upperAtan2Degrees(cross, dot),
+                              _mm_set1_ps(std::numeric_limits<float>::quiet_NaN()));
+        _mm_storeu_ps(angles + i, angle);
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        float ux = a.x[i] - b.x[i];
+        float uy = a.y[i] - b.y[i];
+        float uz = a.z[i] - b.z[i];
+        float vx = c.x[i] - b.x[i];
+        float vy = c.y[i] - b.y[i];
+        float vz = c.z[i] - b.z[i];
+
+        float dot = ux * vx + uy * vy + uz * vz;
+        float nx = uy * vz - uz * vy;
+        float ny = uz * vx - ux * vz;
+        float nz = ux * vy - uy * vx;
+        float cross = std::sqrt(nx * nx + ny * ny + nz * nz);
+
+        if (std::isnan(dot) || std::isnan(cross))
+            angles[i] = std::numeric_limits<float>::quiet_NaN();
+        else
+            angles[i] = upperAtan2Degrees(cross, dot);
+    }
+}
+
+void limbAngles(const std::vector<JointPositions>& joints, const std::vector<LimbChain>& chains, unsigned numFrames,
+                std::vector<float>& angles)
+{
+    angles.resize(chains.size() * numFrames);
+    for (size_t i = 0; i < chains.size(); i++)
+    {
+        const LimbChain& chain = chains[i];
+        localJointAngles(joints[chain.a], joints[chain.b], joints[chain.c], numFrames, angles.data() + i * numFrames);
+    }
+}
+
+bool writeLimbAngles(const std::string& path, double startFrame, unsigned numChains, unsigned numFrames,
+                     const std::vector<float>& angles, std::string& error)
+{
+    if (angles.size() != (size_t)numChains * numFrames)
+    {
+        error = "limb angles do not match their chains and frames";
+        return false;
+    }
+
+    std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        error = "could not open " + path + " for writing";
+        return false;
+    }
+
+    LimbAngleHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kLimbAngleMagic, sizeof(kLimbAngleMagic));
+    header.version = kLimbAngleVersion;
+    header.numChains = numChains;
+    header.numFrames = numFrames;
+    header.startFrame = startFrame;
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(angles.data()), sizeof(float) * angles.size());
+    if (!file)
+    {
+        error = "could not write " + path;
+        return false;
+    }
+    return true;
+}
+
+bool readLimbAngles(const std::string& path, LimbAngleHeader& header, std::vector<float>& angles,
+                    std::string& error)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file)
+    {
+        error = "could not open " + path;
+        return false;
+    }
+
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || std::memcmp(header.magic, kLimbAngleMagic, sizeof(kLimbAngleMagic)) != 0)
+    {
+        error = path + " is not a limb angle file";
+        return false;
+    }
+    if (header.version != kLimbAngleVersion)
+    {
+        error = path + " has an unsupported limb angle version";
+        return false;
+    }
+
+    //Checked against what is left of the file before it is allocated.
+    file.seekg(0, std::ios::end);
+    uint64_t remaining = (uint64_t)file.tellg() - sizeof(header);
+    file.seekg(sizeof(header));
+    if (remaining / sizeof(float) / (header.numChains > 0 ? header.numChains : 1) < header.numFrames)
+    {
+        error = path + " is truncated";
+        return false;
+    }
+
+    angles.resize((size_t)header.numChains * header.numFrames);
+    if (!file.read(reinterpret_cast<char*>(angles.data()), sizeof(float) * angles.size()))
+    {
+        error = path + " is truncated";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,79 @@
+//
+// Limb geometry used by limbLocalAngle: distances between joints and the
+// local angle at the middle joint of a three joint chain.
+//
+// The batch functions take a whole take at once: every joint's positions
+// over the frames as separate x, y and z float arrays, the way trajectory
+// files and the limbLocalAngle command hold them, so the angles of a
+// chain come out 4 frames at a time on SSE2, with a plain loop elsewhere.
+//
+#ifndef TRACKERCORE_LIMBANGLE_H
+#define TRACKERCORE_LIMBANGLE_H
+
+#include "vec3.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+double distance(const Vec3& a, const Vec3& b);
+
+//Angle in degrees between the sides a and b of a triangle whose third
+//side is c, from the law of cosines.
+double lawOfCosinesAngle(double a, double b, double c);
+
+//Local angle in degrees at joint b of the chain a-b-c.
+double localJointAngle(const Vec3& a, const Vec3& b, const Vec3& c);
+
+//Positions of one joint over a run of frames.
+struct JointPositions
+{
+    const float* x;
+    const float* y;
+    const float* z;
+};
+
+//Three joints a-b-c, as indices into a list of JointPositions. The angle
+//is taken at b.
+struct LimbChain
+{
+    unsigned a;
+    unsigned b;
+    unsigned c;
+};
+
+//Local angle in degrees at joint b of the chain a-b-c for count frames.
+//Taken as atan2(|u x v|, u . v) of the limb segments u and v, which
+//stays accurate for straight and folded limbs where the law of cosines
+//loses its digits. Frames where a joint is NaN, like frames a tracked
+//joint lost, come out NaN; frames where a segment has no length come out
+//0, the same as lawOfCosinesAngle().
+void localJointAngles(const JointPositions& a, const JointPositions& b, const JointPositions& c, unsigned count,
+                      float* angles);
+
+//Angles of every chain over numFrames frames, chain after chain of
+//numFrames floats.
+void limbAngles(const std::vector<JointPositions>& joints, const std::vector<LimbChain>& chains, unsigned numFrames,
+                std::vector<float>& angles);
+
+//Binary file of limb angles (little endian): LimbAngleHeader, then per
+//chain numFrames floats, in the order the chains were given.
+const char kLimbAngleMagic[4] = {'V', 'J', 'L', 'A'};
+const uint32_t kLimbAngleVersion = 1;
+
+struct LimbAngleHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t numChains;
+    uint32_t numFrames;
+    //Scene frame number of the first frame.
+    double startFrame;
+};
+
+bool writeLimbAngles(const std::string& path, double startFrame, unsigned numChains, unsigned numFrames,
+                     const std::vector<float>& angles, std::string& error);
+bool readLimbAngles(const std::string& path, LimbAngleHeader& header, std::vector<float>& angles,
+                    std::string& error);
+
+#endif //TRACKERCORE_LIMBANGLE_H
@@ -0,0 +1,118 @@
+//
+// Leveled diagnostics for the tracker.
+//
+#include "log.h"
+
+#include <fstream>
+#include <iostream>
+#include <mutex>
+
+namespace
+{
+    //Trace output is written to the file once this much has built up.
+    const size_t kTraceBufferSize = 1 << 20;
+
+    std::mutex s_mutex;
+    std::ofstream s_traceFile;
+    std::string s_traceBuffer;
+
+    void flushTrace()
+    {
+        s_traceFile.write(s_traceBuffer.data(), (std::streamsize)s_traceBuffer.size());
+        s_traceBuffer.clear();
+    }
+}
+
+LogLevel Log::s_level = kLogSummary;
+
+LogLevel Log::level()
+{
+    return s_level;
+}
+
+void Log::setLevel(LogLevel level)
+{
+    s_level = level;
+}
+
+bool Log::parseLevel(const std::string& name, LogLevel& level)
+{
+    static const char* const names[] = {"off", "summary", "debug", "trace"};
+    for (int i = kLogOff; i <= kLogTrace; i++)
+    {
+        if (name == names[i])
+        {
+            level = (LogLevel)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Log::openTraceFile(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (s_traceFile.is_open())
+    {
+        flushTrace();
+        s_traceFile.close();
+    }
+
+    s_traceFile.open(path.c_str(), std::ios::trunc);
+    s_traceBuffer.reserve(kTraceBufferSize);
+    return s_traceFile.is_open();
+}
+
+void Log::closeTraceFile()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (!s_traceFile.is_open())
+        return;
+
+    flushTrace();
+    s_traceFile.close();
+    s_traceBuffer.shrink_to_fit();
+}
+
+void Log::write(LogLevel level, const std::string& line)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    //The trace file gets every line so it reads in order on its own.
+    if (s_traceFile.is_open())
+    {
+        s_traceBuffer += line;
+        s_traceBuffer += '\n';
+        if (s_traceBuffer.size() >= kTraceBufferSize)
+            flushTrace();
+        if (level == kLogTrace)
+            return;
+    }
+
+    //No endl: flushing every line is what made the old output slow.
+    std::cout << line << '\n';
+}
+
+Log::Line::~Line()
+{
+    Log::write(m_level, m_stream.str());
+}
+
+LogScope::LogScope(LogLevel level, const std::string& traceFile)
+    : m_previous(Log::level()), m_traceFile(!traceFile.empty())
+{
+    Log::setLevel(level);
+    if (m_traceFile && !Log::openTraceFile(traceFile))
+    {
+        m_traceFile = false;
+        TRACKER_LOG(kLogSummary, "could not open trace file " << traceFile);
+    }
+}
+
+LogScope::~LogScope()
+{
+    if (m_traceFile)
+        Log::closeTraceFile();
+    std::cout.flush();
+    Log::setLevel(m_previous);
+}
@@ -0,0 +1,91 @@
+//
+// Leveled diagnostics for the tracker. Summary and debug lines go to the
+// console; trace lines go to a buffered trace file when one is open and
+// to the console otherwise.
+//
+// Use the TRACKER_LOG macro: when its level is disabled the message is
+// never built, so the only cost left on the hot path is one comparison.
+//
+#ifndef TRACKERCORE_LOG_H
+#define TRACKERCORE_LOG_H
+
+#include <sstream>
+#include <string>
+
+enum LogLevel
+{
+    kLogOff,
+    //A few lines per run.
+    kLogSummary,
+    //A few lines per frame.
+    kLogDebug,
+    //Everything, down to single vertices.
+    kLogTrace
+};
+
+class Log
+{
+public:
+    static LogLevel level();
+    static void setLevel(LogLevel level);
+    static bool enabled(LogLevel level)
+    {
+        return level <= s_level;
+    }
+
+    //Accepts off, summary, debug or trace.
+    static bool parseLevel(const std::string& name, LogLevel& level);
+
+    //Trace lines are collected in memory and written out in large blocks.
+    static bool openTraceFile(const std::string& path);
+    static void closeTraceFile();
+
+    static void write(LogLevel level, const std::string& line);
+
+    //Builds one line and hands it to write() when it goes out of scope.
+    class Line
+    {
+    public:
+        explicit Line(LogLevel level) : m_level(level) {}
+        ~Line();
+
+        template <typename T>
+        Line& operator<<(const T& value)
+        {
+            m_stream << value;
+            return *this;
+        }
+
+    private:
+        LogLevel m_level;
+        std::ostringstream m_stream;
+    };
+
+private:
+    static LogLevel s_level;
+};
+
+//Sets the level and trace file for one run and restores the previous
+//level and flushes the trace file when it goes out of scope.
+class LogScope
+{
+public:
+    LogScope(LogLevel level, const std::string& traceFile);
+    ~LogScope();
+
+    LogScope(const LogScope&) = delete;
+    LogScope& operator=(const LogScope&) = delete;
+
+private:
+    LogLevel m_previous;
+    bool m_traceFile;
+};
+
+#define TRACKER_LOG(level, message)            \
+    do                                         \
+    {                                          \
+        if (Log::enabled(level))               \
+            Log::Line(level) << message;       \
+    } while (0)
+
+#endif //TRACKERCORE_LOG_H
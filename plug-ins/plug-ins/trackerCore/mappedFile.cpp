@@ -0,0 +1,182 @@
+//
+// Read only memory mapping of a whole file.
+//
+#include "mappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    uint64_t pageSize()
+    {
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwPageSize;
+#else
+        return (uint64_t)sysconf(_SC_PAGESIZE);
+#endif
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string& path, std::string& error)
+{
+    close();
+
+#ifdef _WIN32
+    m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                         FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (m_file == INVALID_HANDLE_VALUE)
+    {
+        m_file = nullptr;
+        error = "could not open " + path;
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+    {
+        close();
+        error = path + " is empty";
+        return false;
+    }
+
+    m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (m_mapping != nullptr)
+        m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_data == nullptr)
+    {
+        close();
+        error = "could not map " + path;
+        return false;
+    }
+    m_size = (uint64_t)size.QuadPart;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        error = "could not open " + path;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        ::close(fd);
+        error = path + " is empty";
+        return false;
+    }
+
+    //The mapping keeps the file alive after the descriptor is closed.
+    void* data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        error = "could not map " + path;
+        return false;
+    }
+    m_data = static_cast<const uint8_t*>(data);
+    m_size = (uint64_t)info.st_size;
+#endif
+    return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if (m_data != nullptr)
+        UnmapViewOfFile(m_data);
+    if (m_mapping != nullptr)
+        CloseHandle(m_mapping);
+    if (m_file != nullptr)
+        CloseHandle(m_file);
+    m_mapping = nullptr;
+    m_file = nullptr;
+#else
+    if (m_data != nullptr)
+        munmap(const_cast<uint8_t*>(m_data), (size_t)m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+bool MappedFile::isOpen() const
+{
+    return m_data != nullptr;
+}
+
+const uint8_t* MappedFile::data() const
+{
+    return m_data;
+}
+
+uint64_t MappedFile::size() const
+{
+    return m_size;
+}
+
+void MappedFile::adviseSequential()
+{
+#ifndef _WIN32
+    if (m_data != nullptr)
+        madvise(const_cast<uint8_t*>(m_data), (size_t)m_size, MADV_SEQUENTIAL);
+#endif
+}
+
+void MappedFile::willNeed(uint64_t offset, uint64_t length)
+{
+    if (m_data == nullptr || offset >= m_size)
+        return;
+    if (length > m_size - offset)
+        length = m_size - offset;
+
+    //madvise wants a page aligned start.
+    uint64_t page = pageSize();
+    uint64_t begin = offset / page * page;
+#ifdef _WIN32
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = const_cast<uint8_t*>(m_data + begin);
+    range.NumberOfBytes = (SIZE_T)(offset + length - begin);
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    madvise(const_cast<uint8_t*>(m_data + begin), (size_t)(offset + length - begin), MADV_WILLNEED);
+#endif
+}
+
+void MappedFile::release(uint64_t offset, uint64_t length)
+{
+    if (m_data == nullptr || offset >= m_size)
+        return;
+    if (length > m_size - offset)
+        length = m_size - offset;
+
+    //Only whole pages, so neighbouring data still in use stays put.
+    uint64_t page = pageSize();
+    uint64_t begin = (offset + page - 1) / page * page;
+    uint64_t end = (offset + length) / page * page;
+    if (offset + length == m_size)
+        end = offset + length;
+    if (end <= begin)
+        return;
+
+#ifdef _WIN32
+    //Unlocking pages that are not locked takes them out of the working set.
+    VirtualUnlock(const_cast<uint8_t*>(m_data + begin), (SIZE_T)(end - begin));
+#else
+    madvise(const_cast<uint8_t*>(m_data + begin), (size_t)(end - begin), MADV_DONTNEED);
+#endif
+}
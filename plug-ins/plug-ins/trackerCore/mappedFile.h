@@ -0,0 +1,45 @@
+//
+// Read only memory mapping of a whole file, with hints to page ranges in
+// ahead of use and to drop them again once they are done with.
+//
+#ifndef TRACKERCORE_MAPPEDFILE_H
+#define TRACKERCORE_MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path, std::string& error);
+    void close();
+
+    bool isOpen() const;
+    const uint8_t* data() const;
+    uint64_t size() const;
+
+    //The file will mostly be read front to back.
+    void adviseSequential();
+    //Starts reading [offset, offset + length) in the background.
+    void willNeed(uint64_t offset, uint64_t length);
+    //Drops the pages lying wholly inside [offset, offset + length) from
+    //this process. They are read back in from the file if touched again.
+    void release(uint64_t offset, uint64_t length);
+
+private:
+    const uint8_t* m_data = nullptr;
+    uint64_t m_size = 0;
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+};
+
+#endif //TRACKERCORE_MAPPEDFILE_H
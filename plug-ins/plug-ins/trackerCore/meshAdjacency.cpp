@@ -0,0 +1,90 @@
+//
+// Vertex adjacency of a triangle mesh as compressed sparse rows.
+//
+#include "meshAdjacency.h"
+
+#include <algorithm>
+
+namespace
+{
+    bool validTriangle(const int* triangle, unsigned numVertices)
+    {
+        for (unsigned c = 0; c < 3; c++)
+        {
+            if (triangle[c] < 0 || (unsigned)triangle[c] >= numVertices)
+                return false;
+        }
+        return true;
+    }
+}
+
+void MeshAdjacency::build(unsigned numVertices, const int* triangles, unsigned numTriangles)
+{
+    //Every triangle gives each of its vertices two neighbours. Edges
+    //shared by two triangles show up twice and are removed per row after.
+    std::vector<unsigned> counts(numVertices + 1, 0);
+    for (unsigned t = 0; t < numTriangles; t++)
+    {
+        const int* triangle = triangles + t * 3;
+        if (!validTriangle(triangle, numVertices))
+            continue;
+        for (unsigned c = 0; c < 3; c++)
+            counts[triangle[c] + 1] += 2;
+    }
+    for (unsigned v = 0; v < numVertices; v++)
+        counts[v + 1] += counts[v];
+
+    std::vector<int> all(counts[numVertices]);
+    std::vector<unsigned> fill(counts.begin(), counts.end() - 1);
+    for (unsigned t = 0; t < numTriangles; t++)
+    {
+        const int* triangle = triangles + t * 3;
+        if (!validTriangle(triangle, numVertices))
+            continue;
+        for (unsigned c = 0; c < 3; c++)
+        {
+            all[fill[triangle[c]]++] = triangle[(c + 1) % 3];
+            all[fill[triangle[c]]++] = triangle[(c + 2) % 3];
+        }
+    }
+
+    m_offsets.resize(numVertices + 1);
+    m_neighbours.clear();
+    m_neighbours.reserve(all.size() / 2);
+    m_offsets[0] = 0;
+    for (unsigned v = 0; v < numVertices; v++)
+    {
+        int* first = all.data() + counts[v];
+        int* last = all.data() + counts[v + 1];
+        std::sort(first, last);
+        last = std::unique(first, last);
+        m_neighbours.insert(m_neighbours.end(), first, last);
+        m_offsets[v + 1] = (unsigned)m_neighbours.size();
+    }
+}
+
+void MeshAdjacency::clear()
+{
+    m_offsets.clear();
+    m_neighbours.clear();
+}
+
+unsigned MeshAdjacency::numVertices() const
+{
+    return m_offsets.empty() ? 0 : (unsigned)m_offsets.size() - 1;
+}
+
+const int* MeshAdjacency::begin(unsigned vertex) const
+{
+    return m_neighbours.data() + m_offsets[vertex];
+}
+
+const int* MeshAdjacency::end(unsigned vertex) const
+{
+    return m_neighbours.data() + m_offsets[vertex + 1];
+}
+
+unsigned MeshAdjacency::degree(unsigned vertex) const
+{
+    return m_offsets[vertex + 1] - m_offsets[vertex];
+}
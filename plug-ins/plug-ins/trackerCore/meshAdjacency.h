@@ -0,0 +1,30 @@
+//
+// Vertex adjacency of a triangle mesh: for every vertex the vertices it
+// shares an edge with, kept as compressed sparse rows (one array of
+// neighbours and one offset per vertex) so a walk over the surface reads
+// memory in order and the table is built once per topology.
+//
+#ifndef TRACKERCORE_MESHADJACENCY_H
+#define TRACKERCORE_MESHADJACENCY_H
+
+#include <vector>
+
+class MeshAdjacency
+{
+public:
+    //Triangles with a vertex ID outside [0, numVertices) are skipped.
+    void build(unsigned numVertices, const int* triangles, unsigned numTriangles);
+    void clear();
+
+    unsigned numVertices() const;
+    //Neighbours of vertex, sorted and without repeats.
+    const int* begin(unsigned vertex) const;
+    const int* end(unsigned vertex) const;
+    unsigned degree(unsigned vertex) const;
+
+private:
+    std::vector<unsigned> m_offsets;
+    std::vector<int> m_neighbours;
+};
+
+#endif //TRACKERCORE_MESHADJACENCY_H
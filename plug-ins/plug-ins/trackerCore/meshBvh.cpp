@@ -0,0 +1,383 @@
+//
+// Bounding volume hierarchy over the triangles of one mesh frame.
+//
+#include "meshBvh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    const unsigned kLeafSize = 4;
+    const unsigned kMaxDepth = 64;
+
+    inline float dot(const float* a, const float* b)
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    inline void sub(const float* a, const float* b, float* out)
+    {
+        out[0] = a[0] - b[0];
+        out[1] = a[1] - b[1];
+        out[2] = a[2] - b[2];
+    }
+
+    //Squared distance from a point to an axis aligned box, 0 inside it.
+    inline float boxDistanceSq(const float* p, const float* boundsMin, const float* boundsMax)
+    {
+        float distanceSq = 0;
+        for (unsigned axis = 0; axis < 3; axis++)
+        {
+            float d = 0;
+            if (p[axis] < boundsMin[axis])
+                d = boundsMin[axis] - p[axis];
+            else if (p[axis] > boundsMax[axis])
+                d = p[axis] - boundsMax[axis];
+            distanceSq += d * d;
+        }
+        return distanceSq;
+    }
+}
+
+//From Ericson's "Real-Time Collision Detection" section 5.1.5.
+void closestPointOnTriangle(const float* p, const float* a, const float* b, const float* c, float* out)
+{
+    float ab[3], ac[3], ap[3];
+    sub(b, a, ab);
+    sub(c, a, ac);
+    sub(p, a, ap);
+
+    float d1 = dot(ab, ap);
+    float d2 = dot(ac, ap);
+    if (d1 <= 0 && d2 <= 0)
+    {
+        std::copy(a, a + 3, out);
+        return;
+    }
+
+    float bp[3];
+    sub(p, b, bp);
+    float d3 = dot(ab, bp);
+    float d4 = dot(ac, bp);
+    if (d3 >= 0 && d4 <= d3)
+    {
+        std::copy(b, b + 3, out);
+        return;
+    }
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0)
+    {
+        float v = d1 / (d1 - d3);
+        for (unsigned axis = 0; axis < 3; axis++)
+            out[axis] = a[axis] + v * ab[axis];
+        return;
+    }
+
+    float cp[3];
+    sub(p, c, cp);
+    float d5 = dot(ab, cp);
+    float d6 = dot(ac, cp);
+    if (d6 >= 0 && d5 <= d6)
+    {
+        std::copy(c, c + 3, out);
+        return;
+    }
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0)
+    {
+        float w = d2 / (d2 - d6);
+        for (unsigned axis = 0; axis < 3; axis++)
+            out[axis] = a[axis] + w * ac[axis];
+        return;
+    }
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+    {
+        float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        for (unsigned axis = 0; axis < 3; axis++)
+            out[axis] = b[axis] + w * (c[axis] - b[axis]);
+        return;
+    }
+
+    float denom = 1.0f / (va + vb + vc);
+    float v = vb * denom;
+    float w = vc * denom;
+    for (unsigned axis = 0; axis < 3; axis++)
+        out[axis] = a[axis] + ab[axis] * v + ac[axis] * w;
+}
+
+void barycentricWeights(const float* p, const float* a, const float* b, const float* c, float* weights)
+{
+    double ab[3], ac[3], ap[3];
+    for (unsigned axis = 0; axis < 3; axis++)
+    {
+        ab[axis] = (double)b[axis] - a[axis];
+        ac[axis] = (double)c[axis] - a[axis];
+        ap[axis] = (double)p[axis] - a[axis];
+    }
+    double d00 = ab[0] * ab[0] + ab[1] * ab[1] + ab[2] * ab[2];
+    double d01 = ab[0] * ac[0] + ab[1] * ac[1] + ab[2] * ac[2];
+    double d11 = ac[0] * ac[0] + ac[1] * ac[1] + ac[2] * ac[2];
+    double d20 = ap[0] * ab[0] + ap[1] * ab[1] + ap[2] * ab[2];
+    double d21 = ap[0] * ac[0] + ap[1] * ac[1] + ap[2] * ac[2];
+    double denominator = d00 * d11 - d01 * d01;
+    if (denominator <= 0)
+    {
+        weights[0] = 1;
+        weights[1] = weights[2] = 0;
+        return;
+    }
+
+    double v = (d11 * d20 - d01 * d21) / denominator;
+    double w = (d00 * d21 - d01 * d20) / denominator;
+    weights[0] = (float)(1 - v - w);
+    weights[1] = (float)v;
+    weights[2] = (float)w;
+}
+
+void MeshBvh::build(const float* points, unsigned numPoints, const int* triangles, unsigned numTriangles)
+{
+    clear();
+    if (numTriangles == 0)
+        return;
+
+    //Split on triangle centroids.
+    std::vector<float> centroids(numTriangles * 3);
+    for (unsigned tri = 0; tri < numTriangles; tri++)
+    {
+        const float* a = points + triangles[tri * 3] * 3;
+        const float* b = points + triangles[tri * 3 + 1] * 3;
+        const float* c = points + triangles[tri * 3 + 2] * 3;
+        for (unsigned axis = 0; axis < 3; axis++)
+            centroids[tri * 3 + axis] = (a[axis] + b[axis] + c[axis]) / 3.0f;
+    }
+
+    m_triangleIds.resize(numTriangles);
+    for (unsigned tri = 0; tri < numTriangles; tri++)
+        m_triangleIds[tri] = tri;
+
+    m_nodes.reserve(2 * numTriangles / kLeafSize + 1);
+    buildNode(0, numTriangles, centroids);
+
+    //Lay the triangles out in leaf order.
+    m_triangles.resize(numTriangles * 3);
+    for (unsigned tri = 0; tri < numTriangles; tri++)
+    {
+        const int* source = triangles + m_triangleIds[tri] * 3;
+        std::copy(source, source + 3, m_triangles.begin() + tri * 3);
+    }
+
+    refit(points, numPoints);
+}
+
+unsigned MeshBvh::buildNode(unsigned start, unsigned count, std::vector<float>& centroids)
+{
+    unsigned index = (unsigned)m_nodes.size();
+    m_nodes.push_back(Node());
+    m_nodes[index].start = start;
+    m_nodes[index].count = count;
+
+    if (count <= kLeafSize)
+        return index;
+
+    //Split at the median along the widest axis of the centroids.
+    float centroidMin[3], centroidMax[3];
+    for (unsigned axis = 0; axis < 3; axis++)
+    {
+        centroidMin[axis] = std::numeric_limits<float>::max();
+        centroidMax[axis] = -std::numeric_limits<float>::max();
+    }
+    for (unsigned i = start; i < start + count; i++)
+    {
+        const float* centroid = &centroids[m_triangleIds[i] * 3];
+        for (unsigned axis = 0; axis < 3; axis++)
+        {
+            centroidMin[axis] = std::min(centroidMin[axis], centroid[axis]);
+            centroidMax[axis] = std::max(centroidMax[axis], centroid[axis]);
+        }
+    }
+
+    unsigned splitAxis = 0;
+    for (unsigned axis = 1; axis < 3; axis++)
+    {
+        if (centroidMax[axis] - centroidMin[axis] > centroidMax[splitAxis] - centroidMin[splitAxis])
+            splitAxis = axis;
+    }
+    if (centroidMax[splitAxis] - centroidMin[splitAxis] <= 0)
+        return index;
+
+    unsigned mid = start + count / 2;
+    std::nth_element(m_triangleIds.begin() + start, m_triangleIds.begin() + mid,
+                     m_triangleIds.begin() + start + count,
+                     [&centroids, splitAxis](int a, int b) {
+                         return centroids[a * 3 + splitAxis] < centroids[b * 3 + splitAxis];
+                     });
+
+    //The left child is always index + 1.
+    buildNode(start, mid - start, centroids);
+    unsigned right = buildNode(mid, start + count - mid, centroids);
+
+    m_nodes[index].start = right;
+    m_nodes[index].count = 0;
+    return index;
+}
+
+void MeshBvh::refit(const float* points, unsigned numPoints)
+{
+    m_points.assign(points, points + numPoints * 3);
+
+    //Children always come after their parent, so walking the array
+    //backwards visits them first.
+    for (size_t i = m_nodes.size(); i-- > 0;)
+        computeBounds(m_nodes[i]);
+}
+
+void MeshBvh::computeBounds(Node& node) const
+{
+    if (node.count == 0)
+    {
+        const Node& left = *(&node + 1);
+        const Node& right = m_nodes[node.start];
+        for (unsigned axis = 0; axis < 3; axis++)
+        {
+            node.boundsMin[axis] = std::min(left.boundsMin[axis], right.boundsMin[axis]);
+            node.boundsMax[axis] = std::max(left.boundsMax[axis], right.boundsMax[axis]);
+        }
+        return;
+    }
+
+    for (unsigned axis = 0; axis < 3; axis++)
+    {
+        node.boundsMin[axis] = std::numeric_limits<float>::max();
+        node.boundsMax[axis] = -std::numeric_limits<float>::max();
+    }
+    for (unsigned i = node.start * 3; i < (node.start + node.count) * 3; i++)
+    {
+        const float* p = &m_points[m_triangles[i] * 3];
+        for (unsigned axis = 0; axis < 3; axis++)
+        {
+            node.boundsMin[axis] = std::min(node.boundsMin[axis], p[axis]);
+            node.boundsMax[axis] = std::max(node.boundsMax[axis], p[axis]);
+        }
+    }
+}
+
+void MeshBvh::clear()
+{
+    m_nodes.clear();
+    m_triangles.clear();
+    m_triangleIds.clear();
+    m_points.clear();
+}
+
+bool MeshBvh::empty() const
+{
+    return m_nodes.empty();
+}
+
+unsigned MeshBvh::numPoints() const
+{
+    return (unsigned)(m_points.size() / 3);
+}
+
+unsigned MeshBvh::numTriangles() const
+{
+    return (unsigned)m_triangleIds.size();
+}
+
+void MeshBvh::closestOnTriangle(const float* query, unsigned tri, BvhHit& hit, const float* normal,
+                                float minCos) const
+{
+    const int* vertices = &m_triangles[tri * 3];
+    if (normal != nullptr)
+    {
+        float ab[3], ac[3];
+        sub(&m_points[vertices[1] * 3], &m_points[vertices[0] * 3], ab);
+        sub(&m_points[vertices[2] * 3], &m_points[vertices[0] * 3], ac);
+        float face[] = {ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0]};
+        if (dot(face, normal) < minCos * std::sqrt(dot(face, face)))
+            return;
+    }
+
+    float candidate[3];
+    closestPointOnTriangle(query, &m_points[vertices[0] * 3], &m_points[vertices[1] * 3],
+                           &m_points[vertices[2] * 3], candidate);
+
+    float delta[3];
+    sub(candidate, query, delta);
+    float distanceSq = dot(delta, delta);
+    if (distanceSq < hit.distanceSq)
+    {
+        std::copy(candidate, candidate + 3, hit.point);
+        hit.distanceSq = distanceSq;
+        hit.triangle = m_triangleIds[tri];
+    }
+}
+
+BvhHit MeshBvh::closestPoint(const float* query, float maxDistanceSq) const
+{
+    return search(query, maxDistanceSq, nullptr, 0);
+}
+
+BvhHit MeshBvh::closestPointFacing(const float* query, const float* normal, float minCos, float maxDistanceSq) const
+{
+    return search(query, maxDistanceSq, normal, minCos);
+}
+
+BvhHit MeshBvh::search(const float* query, float maxDistanceSq, const float* normal, float minCos) const
+{
+    //Starting from the radius prunes every box beyond it straight away.
+    BvhHit hit;
+    std::copy(query, query + 3, hit.point);
+    hit.distanceSq = maxDistanceSq;
+    hit.triangle = -1;
+
+    if (m_nodes.empty())
+        return hit;
+
+    unsigned stack[kMaxDepth];
+    unsigned stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        const Node& node = m_nodes[stack[--stackSize]];
+        if (boxDistanceSq(query, node.boundsMin, node.boundsMax) >= hit.distanceSq)
+            continue;
+
+        if (node.count > 0)
+        {
+            for (unsigned tri = node.start; tri < node.start + node.count; tri++)
+                closestOnTriangle(query, tri, hit, normal, minCos);
+            continue;
+        }
+
+        //Visit the nearer child first so the far one is more likely pruned.
+        unsigned left = (unsigned)(&node - &m_nodes[0]) + 1;
+        unsigned right = node.start;
+        float leftDistanceSq = boxDistanceSq(query, m_nodes[left].boundsMin, m_nodes[left].boundsMax);
+        float rightDistanceSq = boxDistanceSq(query, m_nodes[right].boundsMin, m_nodes[right].boundsMax);
+        if (leftDistanceSq < rightDistanceSq)
+            std::swap(left, right);
+        stack[stackSize++] = left;
+        stack[stackSize++] = right;
+    }
+    return hit;
+}
+
+void MeshBvh::closestPoints(const float* queries, unsigned numQueries, BvhHit* hits,
+                            const float* maxDistancesSq) const
+{
+    for (unsigned i = 0; i < numQueries; i++)
+    {
+        if (maxDistancesSq != nullptr)
+            hits[i] = closestPoint(queries + i * 3, maxDistancesSq[i]);
+        else
+            hits[i] = closestPoint(queries + i * 3);
+    }
+}
@@ -0,0 +1,81 @@
+//
+// Bounding volume hierarchy over the triangles of one mesh frame.
+//
+// The tree is stored as a flat, depth-first array of nodes: a node's left
+// child directly follows it and only the right child index is stored, and
+// each leaf owns a contiguous run of triangles. build() is only needed when
+// the topology changes; between 4DViews keyframe meshes the vertex positions
+// move but the triangles stay the same, so refit() just recomputes the boxes.
+//
+#ifndef TRACKERCORE_MESHBVH_H
+#define TRACKERCORE_MESHBVH_H
+
+#include <limits>
+#include <vector>
+
+struct BvhHit
+{
+    float point[3];
+    float distanceSq;
+    //Index of the triangle in the array given to build().
+    int triangle;
+};
+
+//Closest point on triangle abc to p, all xyz triples.
+void closestPointOnTriangle(const float* p, const float* a, const float* b, const float* c, float* out);
+//Barycentric weights of p, a point on triangle abc. Degenerate triangles
+//put all the weight on a.
+void barycentricWeights(const float* p, const float* a, const float* b, const float* c, float* weights);
+
+class MeshBvh
+{
+public:
+    //points holds numPoints xyz triples, triangles holds 3 vertex
+    //indices per triangle.
+    void build(const float* points, unsigned numPoints, const int* triangles, unsigned numTriangles);
+    void refit(const float* points, unsigned numPoints);
+    void clear();
+
+    bool empty() const;
+    unsigned numPoints() const;
+    unsigned numTriangles() const;
+
+    //Only surface within maxDistanceSq of the query is searched. When
+    //there is none the hit's triangle is -1.
+    BvhHit closestPoint(const float* query, float maxDistanceSq = std::numeric_limits<float>::max()) const;
+    //Same, but only triangles facing within minCos (a cosine) of the unit
+    //vector normal count, so a point is not matched to the back of a
+    //nearby surface, such as a hand resting on a thigh.
+    BvhHit closestPointFacing(const float* query, const float* normal, float minCos,
+                              float maxDistanceSq = std::numeric_limits<float>::max()) const;
+    //Answers numQueries closest point queries (xyz triples) in one pass,
+    //each optionally bounded by its own squared search radius.
+    void closestPoints(const float* queries, unsigned numQueries, BvhHit* hits,
+                       const float* maxDistancesSq = nullptr) const;
+
+private:
+    struct Node
+    {
+        float boundsMin[3];
+        float boundsMax[3];
+        //Leaves: first triangle and count > 0.
+        //Inner nodes: index of the right child and count == 0.
+        unsigned start;
+        unsigned count;
+    };
+
+    unsigned buildNode(unsigned start, unsigned count, std::vector<float>& centroids);
+    void computeBounds(Node& node) const;
+    BvhHit search(const float* query, float maxDistanceSq, const float* normal, float minCos) const;
+    //Only triangles facing normal count, when it is given.
+    void closestOnTriangle(const float* query, unsigned tri, BvhHit& hit, const float* normal, float minCos) const;
+
+    std::vector<Node> m_nodes;
+    //Triangle vertex indices, reordered so each leaf is contiguous.
+    std::vector<int> m_triangles;
+    //Original index of each reordered triangle.
+    std::vector<int> m_triangleIds;
+    std::vector<float> m_points;
+};
+
+#endif //TRACKERCORE_MESHBVH_H
@@ -0,0 +1,31 @@
+//
+// Motion prediction and joint estimation math shared by the tracking
+// engine and the jointRig scrubbing path.
+//
+#include "motion.h"
+
+Vec3 computeVelocity(const Vec3& prevPoint, const Vec3& currentPoint)
+{
+    return currentPoint - prevPoint;
+}
+
+Vec3 computeAcceleration(const Vec3& prevVelocity, const Vec3& currentVelocity)
+{
+    return currentVelocity - prevVelocity;
+}
+
+Vec3 projectPoint(const Vec3& currentPoint, const Vec3& velocity, const Vec3& acceleration)
+{
+    return currentPoint + velocity + acceleration / 2;
+}
+
+Vec3 centroid(const Vec3* points, unsigned count)
+{
+    Vec3 sum;
+    if (count == 0)
+        return sum;
+
+    for (unsigned i = 0; i < count; i++)
+        sum += points[i];
+    return sum / (double)count;
+}
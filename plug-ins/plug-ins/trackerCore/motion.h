@@ -0,0 +1,23 @@
+//
+// Motion prediction and joint estimation math shared by the tracking
+// engine and the jointRig scrubbing path.
+//
+#ifndef TRACKERCORE_MOTION_H
+#define TRACKERCORE_MOTION_H
+
+#include "vec3.h"
+
+//Per-frame velocity of a point between two frames.
+Vec3 computeVelocity(const Vec3& prevPoint, const Vec3& currentPoint);
+
+//Per-frame acceleration between two consecutive velocities.
+Vec3 computeAcceleration(const Vec3& prevVelocity, const Vec3& currentVelocity);
+
+//Where a point moving with constant acceleration will be on the next
+//frame: current + v + a/2.
+Vec3 projectPoint(const Vec3& currentPoint, const Vec3& velocity, const Vec3& acceleration);
+
+//Mean of count points, the joint estimate for a set of surface points.
+Vec3 centroid(const Vec3* points, unsigned count);
+
+#endif //TRACKERCORE_MOTION_H
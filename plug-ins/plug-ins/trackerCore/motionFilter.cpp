@@ -0,0 +1,183 @@
+//
+// Constant acceleration Kalman filter for one tracked point.
+//
+#include "motionFilter.h"
+
+#include <cmath>
+
+namespace
+{
+    //Covariance given to the velocity and acceleration the first
+    //measurement knows nothing about.
+    const double kUnknownVariance = 100;
+
+    enum
+    {
+        kPP,
+        kPV,
+        kPA,
+        kVV,
+        kVA,
+        kAA
+    };
+
+    //P = F P F^T + Q for F = [1 1 1/2; 0 1 1; 0 0 1] and the discrete
+    //white jerk Q = q [1/20 1/8 1/6; 1/8 1/3 1/2; 1/6 1/2 1].
+    void predictCovariance(const double* p, double q, double* out)
+    {
+        //Rows of F P.
+        double fp00 = p[kPP] + p[kPV] + 0.5 * p[kPA];
+        double fp01 = p[kPV] + p[kVV] + 0.5 * p[kVA];
+        double fp02 = p[kPA] + p[kVA] + 0.5 * p[kAA];
+        double fp11 = p[kVV] + p[kVA];
+        double fp12 = p[kVA] + p[kAA];
+        double fp22 = p[kAA];
+
+        out[kPP] = fp00 + fp01 + 0.5 * fp02 + q / 20;
+        out[kPV] = fp01 + fp02 + q / 8;
+        out[kPA] = fp02 + q / 6;
+        out[kVV] = fp11 + fp12 + q / 3;
+        out[kVA] = fp12 + q / 2;
+        out[kAA] = fp22 + q;
+    }
+}
+
+const double MotionFilter::kDefaultProcessNoise = 0.1;
+const double MotionFilter::kDefaultMeasurementNoise = 1e-4;
+const unsigned MotionFilter::kStateSize;
+
+MotionFilter::MotionFilter()
+    : m_processNoise(kDefaultProcessNoise),
+      m_measurementNoise(kDefaultMeasurementNoise)
+{
+    reset();
+}
+
+void MotionFilter::setNoise(double processNoise, double measurementNoise)
+{
+    m_processNoise = processNoise;
+    m_measurementNoise = measurementNoise;
+}
+
+void MotionFilter::reset()
+{
+    for (double& value : m_covariance)
+        value = 0;
+    m_position = m_velocity = m_acceleration = m_predicted = Vec3();
+    m_predictedVariance = 0;
+    m_started = false;
+}
+
+void MotionFilter::update(const Vec3& measured)
+{
+    if (!m_started)
+    {
+        m_position = measured;
+        m_velocity = m_acceleration = Vec3();
+        m_covariance[kPP] = m_measurementNoise;
+        m_covariance[kPV] = m_covariance[kPA] = m_covariance[kVA] = 0;
+        m_covariance[kVV] = m_covariance[kAA] = kUnknownVariance;
+        m_started = true;
+    }
+    else
+    {
+        //The prior for this frame is last frame's prediction.
+        double prior[6];
+        predictCovariance(m_covariance, m_processNoise, prior);
+        Vec3 velocity = m_velocity + m_acceleration;
+
+        //Only position is measured, so the gain is the first column of
+        //the prior over the innovation variance.
+        double innovationVariance = prior[kPP] + m_measurementNoise;
+        double gainP = prior[kPP] / innovationVariance;
+        double gainV = prior[kPV] / innovationVariance;
+        double gainA = prior[kPA] / innovationVariance;
+
+        Vec3 innovation = measured - m_predicted;
+        m_position = m_predicted + innovation * gainP;
+        m_velocity = velocity + innovation * gainV;
+        m_acceleration = m_acceleration + innovation * gainA;
+
+        m_covariance[kPP] = prior[kPP] - gainP * prior[kPP];
+        m_covariance[kPV] = prior[kPV] - gainP * prior[kPV];
+        m_covariance[kPA] = prior[kPA] - gainP * prior[kPA];
+        m_covariance[kVV] = prior[kVV] - gainV * prior[kPV];
+        m_covariance[kVA] = prior[kVA] - gainV * prior[kPA];
+        m_covariance[kAA] = prior[kAA] - gainA * prior[kPA];
+    }
+
+    double next[6];
+    predictCovariance(m_covariance, m_processNoise, next);
+    m_predicted = m_position + m_velocity + m_acceleration * 0.5;
+    m_predictedVariance = next[kPP];
+}
+
+bool MotionFilter::started() const
+{
+    return m_started;
+}
+
+const Vec3& MotionFilter::position() const
+{
+    return m_position;
+}
+
+const Vec3& MotionFilter::velocity() const
+{
+    return m_velocity;
+}
+
+const Vec3& MotionFilter::acceleration() const
+{
+    return m_acceleration;
+}
+
+const Vec3& MotionFilter::predicted() const
+{
+    return m_predicted;
+}
+
+double MotionFilter::predictedVariance() const
+{
+    return m_predictedVariance;
+}
+
+double MotionFilter::searchRadius(double sigmas) const
+{
+    //The miss is 3 dimensional, so the bound covers all three axes.
+    return sigmas * std::sqrt(3 * m_predictedVariance);
+}
+
+void MotionFilter::saveState(double* state) const
+{
+    const Vec3* vectors[] = {&m_position, &m_velocity, &m_acceleration, &m_predicted};
+    for (unsigned i = 0; i < 6; i++)
+        *state++ = m_covariance[i];
+    for (const Vec3* vector : vectors)
+    {
+        *state++ = vector->x;
+        *state++ = vector->y;
+        *state++ = vector->z;
+    }
+    *state++ = m_predictedVariance;
+    *state++ = m_processNoise;
+    *state++ = m_measurementNoise;
+    *state = m_started ? 1 : 0;
+}
+
+void MotionFilter::restoreState(const double* state)
+{
+    Vec3* vectors[] = {&m_position, &m_velocity, &m_acceleration, &m_predicted};
+    for (unsigned i = 0; i < 6; i++)
+        m_covariance[i] = *state++;
+    for (Vec3* vector : vectors)
+    {
+        vector->x = *state++;
+        vector->y = *state++;
+        vector->z = *state++;
+    }
+    m_predictedVariance = *state++;
+    m_processNoise = *state++;
+    m_measurementNoise = *state++;
+    m_started = *state != 0;
+}
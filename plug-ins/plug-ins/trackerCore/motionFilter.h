@@ -0,0 +1,69 @@
+//
+// Constant acceleration Kalman filter for one tracked point.
+//
+// Each axis carries position, velocity and acceleration, driven by white
+// jerk noise and measured with white position noise. Both noises are the
+// same on every axis, so the three axes share one 3x3 covariance and an
+// update costs a handful of multiplies. The state is a fixed size value,
+// meant to be held in preallocated per-point and per-joint arrays.
+//
+// Frames are the time unit and the default noises assume centimetres,
+// Maya's default working unit.
+//
+#ifndef TRACKERCORE_MOTIONFILTER_H
+#define TRACKERCORE_MOTIONFILTER_H
+
+#include "vec3.h"
+
+class MotionFilter
+{
+public:
+    //Variance of the per-frame change in acceleration, in units^2.
+    static const double kDefaultProcessNoise;
+    //Variance of a measured position, in units^2.
+    static const double kDefaultMeasurementNoise;
+
+    MotionFilter();
+    void setNoise(double processNoise, double measurementNoise);
+    //Forgets the track. The next update() starts it again.
+    void reset();
+
+    //Folds in where the point was measured this frame and predicts where
+    //it will be on the next one.
+    void update(const Vec3& measured);
+    bool started() const;
+
+    //Filtered state for the frame last given to update().
+    const Vec3& position() const;
+    const Vec3& velocity() const;
+    const Vec3& acceleration() const;
+
+    //Predicted position on the next frame and its variance along each
+    //axis.
+    const Vec3& predicted() const;
+    double predictedVariance() const;
+    //Distance from predicted() that the next measurement falls within
+    //unless the motion is sigmas standard deviations off the model.
+    double searchRadius(double sigmas) const;
+
+    //The whole filter as kStateSize doubles, so a track can be saved and
+    //carried on later exactly where it left off.
+    static const unsigned kStateSize = 22;
+    void saveState(double* state) const;
+    void restoreState(const double* state);
+
+private:
+    //Upper triangle of the shared covariance of (position, velocity,
+    //acceleration): 00, 01, 02, 11, 12, 22.
+    double m_covariance[6];
+    Vec3 m_position;
+    Vec3 m_velocity;
+    Vec3 m_acceleration;
+    Vec3 m_predicted;
+    double m_predictedVariance;
+    double m_processNoise;
+    double m_measurementNoise;
+    bool m_started;
+};
+
+#endif //TRACKERCORE_MOTIONFILTER_H
@@ -0,0 +1,189 @@
+//
+// Binary point cache holding the vertex positions of a mesh sequence.
+//
+#include "pointCache.h"
+
+#include <cstring>
+
+PointCacheWriter::~PointCacheWriter()
+{
+    if (m_file.is_open())
+        close();
+}
+
+bool PointCacheWriter::open(const std::string& path, double startFrame)
+{
+    m_entries.clear();
+    m_error.clear();
+    m_file.open(path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!m_file)
+        return fail("could not open " + path + " for writing");
+
+    std::memset(&m_header, 0, sizeof(m_header));
+    std::memcpy(m_header.magic, kPointCacheMagic, sizeof(kPointCacheMagic));
+    m_header.version = kPointCacheVersion;
+    m_header.startFrame = startFrame;
+
+    //Written again with the frame count and table offset on close().
+    m_file.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+    return m_file.good() || fail("could not write the header");
+}
+
+bool PointCacheWriter::writeFrame(const float* points, unsigned numVertices, const int* triangles,
+                                  unsigned numTriangles)
+{
+    if (!m_file.is_open())
+        return fail("the cache is not open");
+
+    PointCacheFrameEntry entry;
+    std::memset(&entry, 0, sizeof(entry));
+    entry.offset = (uint64_t)m_file.tellp();
+    entry.numVertices = numVertices;
+
+    if (triangles != nullptr)
+    {
+        entry.numTriangles = numTriangles;
+        entry.topologyFrame = (uint32_t)m_entries.size();
+    }
+    else
+    {
+        if (m_entries.empty())
+            return fail("the first frame needs triangles");
+
+        const PointCacheFrameEntry& previous = m_entries.back();
+        if (previous.numVertices != numVertices)
+            return fail("the vertex count changed without new triangles");
+        entry.numTriangles = previous.numTriangles;
+        entry.topologyFrame = previous.topologyFrame;
+    }
+
+    m_file.write(reinterpret_cast<const char*>(points), sizeof(float) * 3 * numVertices);
+    if (triangles != nullptr)
+        m_file.write(reinterpret_cast<const char*>(triangles), sizeof(int32_t) * 3 * numTriangles);
+    if (!m_file)
+        return fail("could not write frame data");
+
+    m_entries.push_back(entry);
+    return true;
+}
+
+bool PointCacheWriter::close()
+{
+    if (!m_file.is_open())
+        return false;
+
+    m_header.numFrames = (uint32_t)m_entries.size();
+    m_header.tableOffset = (uint64_t)m_file.tellp();
+    m_file.write(reinterpret_cast<const char*>(m_entries.data()), sizeof(PointCacheFrameEntry) * m_entries.size());
+    m_file.seekp(0);
+    m_file.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+
+    bool ok = m_file.good();
+    m_file.close();
+    return ok || fail("could not write the frame table");
+}
+
+unsigned PointCacheWriter::numFrames() const
+{
+    return (unsigned)m_entries.size();
+}
+
+const std::string& PointCacheWriter::error() const
+{
+    return m_error;
+}
+
+bool PointCacheWriter::fail(const std::string& message)
+{
+    m_error = message;
+    return false;
+}
+
+bool PointCacheReader::open(const std::string& path)
+{
+    close();
+    m_file.open(path.c_str(), std::ios::binary);
+    if (!m_file)
+        return fail("could not open " + path);
+
+    m_file.read(reinterpret_cast<char*>(&m_header), sizeof(m_header));
+    if (!m_file || std::memcmp(m_header.magic, kPointCacheMagic, sizeof(kPointCacheMagic)) != 0)
+        return fail(path + " is not a point cache");
+    if (m_header.version != kPointCacheVersion)
+        return fail(path + " has an unsupported point cache version");
+
+    m_entries.resize(m_header.numFrames);
+    m_file.seekg((std::streamoff)m_header.tableOffset);
+    m_file.read(reinterpret_cast<char*>(m_entries.data()), sizeof(PointCacheFrameEntry) * m_entries.size());
+    if (!m_file)
+        return fail(path + " has a truncated frame table");
+
+    return true;
+}
+
+void PointCacheReader::close()
+{
+    if (m_file.is_open())
+        m_file.close();
+    m_file.clear();
+    m_entries.clear();
+    m_triangles.reset();
+    m_error.clear();
+}
+
+unsigned PointCacheReader::numFrames() const
+{
+    return (unsigned)m_entries.size();
+}
+
+double PointCacheReader::startFrame() const
+{
+    return m_header.startFrame;
+}
+
+const PointCacheFrameEntry& PointCacheReader::entry(unsigned frame) const
+{
+    return m_entries[frame];
+}
+
+bool PointCacheReader::readFrame(unsigned frame, PointCacheFrame& out)
+{
+    if (frame >= m_entries.size())
+        return fail("frame out of range");
+
+    const PointCacheFrameEntry& entry = m_entries[frame];
+    out.numVertices = entry.numVertices;
+    out.points.resize(entry.numVertices * 3);
+    m_file.seekg((std::streamoff)entry.offset);
+    m_file.read(reinterpret_cast<char*>(out.points.data()), sizeof(float) * 3 * entry.numVertices);
+    if (!m_file)
+        return fail("could not read frame data");
+
+    if (!m_triangles || m_trianglesFrame != entry.topologyFrame)
+    {
+        const PointCacheFrameEntry& topology = m_entries[entry.topologyFrame];
+        std::shared_ptr<std::vector<int>> triangles = std::make_shared<std::vector<int>>(topology.numTriangles * 3);
+        m_file.seekg((std::streamoff)(topology.offset + sizeof(float) * 3 * topology.numVertices));
+        m_file.read(reinterpret_cast<char*>(triangles->data()), sizeof(int32_t) * triangles->size());
+        if (!m_file)
+            return fail("could not read triangles");
+
+        m_triangles = triangles;
+        m_trianglesFrame = entry.topologyFrame;
+    }
+
+    out.triangles = m_triangles;
+    out.topologyFrame = entry.topologyFrame;
+    return true;
+}
+
+const std::string& PointCacheReader::error() const
+{
+    return m_error;
+}
+
+bool PointCacheReader::fail(const std::string& message)
+{
+    m_error = message;
+    return false;
+}
@@ -0,0 +1,108 @@
+//
+// Binary point cache holding the vertex positions of a mesh sequence, so
+// a take can be tracked without Maya.
+//
+// Layout (little endian):
+//   PointCacheHeader
+//   per frame: numVertices xyz float triples, followed by numTriangles
+//              int32 vertex index triples when the topology changed
+//   PointCacheFrameEntry table, one per frame, at header.tableOffset
+//
+// Triangles are only stored on frames where the topology changes; every
+// other frame points at the frame whose triangles it shares.
+//
+#ifndef TRACKERCORE_POINTCACHE_H
+#define TRACKERCORE_POINTCACHE_H
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+//Identify the file and its layout in PointCacheHeader.
+const char kPointCacheMagic[4] = {'V', 'J', 'P', 'C'};
+const uint32_t kPointCacheVersion = 1;
+
+struct PointCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t numFrames;
+    uint32_t reserved;
+    //Scene frame number of the first cached frame.
+    double startFrame;
+    uint64_t tableOffset;
+};
+
+struct PointCacheFrameEntry
+{
+    uint64_t offset;
+    uint32_t numVertices;
+    uint32_t numTriangles;
+    //Frame whose triangles this frame uses. Equal to the frame's own
+    //index when its triangles are stored with it.
+    uint32_t topologyFrame;
+    uint32_t reserved;
+};
+
+struct PointCacheFrame
+{
+    //numVertices xyz triples in world space.
+    std::vector<float> points;
+    unsigned numVertices = 0;
+    //Shared by all frames read with the same topology.
+    std::shared_ptr<const std::vector<int>> triangles;
+    unsigned topologyFrame = 0;
+};
+
+class PointCacheWriter
+{
+public:
+    ~PointCacheWriter();
+
+    bool open(const std::string& path, double startFrame);
+    //triangles may be null when the topology matches the previous frame.
+    bool writeFrame(const float* points, unsigned numVertices, const int* triangles, unsigned numTriangles);
+    //Writes the frame table; the file is not readable until this is done.
+    bool close();
+
+    unsigned numFrames() const;
+    const std::string& error() const;
+
+private:
+    bool fail(const std::string& message);
+
+    std::ofstream m_file;
+    PointCacheHeader m_header;
+    std::vector<PointCacheFrameEntry> m_entries;
+    std::string m_error;
+};
+
+class PointCacheReader
+{
+public:
+    bool open(const std::string& path);
+    void close();
+
+    unsigned numFrames() const;
+    double startFrame() const;
+    const PointCacheFrameEntry& entry(unsigned frame) const;
+
+    //Reads one frame. The triangles are only read from disk when the
+    //frame's topology differs from the last one read.
+    bool readFrame(unsigned frame, PointCacheFrame& out);
+    const std::string& error() const;
+
+private:
+    bool fail(const std::string& message);
+
+    std::ifstream m_file;
+    PointCacheHeader m_header;
+    std::vector<PointCacheFrameEntry> m_entries;
+    std::shared_ptr<const std::vector<int>> m_triangles;
+    unsigned m_trianglesFrame = 0;
+    std::string m_error;
+};
+
+#endif //TRACKERCORE_POINTCACHE_H
@@ -0,0 +1,155 @@
+//
+// Streams a point cache through a memory mapping.
+//
+#include "pointCacheStream.h"
+
+#include <cstring>
+
+namespace
+{
+    //Frames read ahead of the window.
+    const unsigned kReadAhead = 2;
+}
+
+bool PointCacheStream::open(const std::string& path)
+{
+    close();
+    if (!m_file.open(path, m_error))
+        return false;
+
+    if (m_file.size() < sizeof(m_header))
+        return fail(path + " is not a point cache");
+    std::memcpy(&m_header, m_file.data(), sizeof(m_header));
+    if (std::memcmp(m_header.magic, kPointCacheMagic, sizeof(kPointCacheMagic)) != 0)
+        return fail(path + " is not a point cache");
+    if (m_header.version != kPointCacheVersion)
+        return fail(path + " has an unsupported point cache version");
+
+    uint64_t tableSize = sizeof(PointCacheFrameEntry) * (uint64_t)m_header.numFrames;
+    if (m_header.tableOffset > m_file.size() || tableSize > m_file.size() - m_header.tableOffset)
+        return fail(path + " has a truncated frame table");
+
+    m_entries.resize(m_header.numFrames);
+    std::memcpy(m_entries.data(), m_file.data() + m_header.tableOffset, (size_t)tableSize);
+
+    //Check every frame up front so frame() can hand out pointers blindly.
+    for (unsigned i = 0; i < m_entries.size(); i++)
+    {
+        const PointCacheFrameEntry& entry = m_entries[i];
+        if (entry.topologyFrame > i || m_entries[entry.topologyFrame].numTriangles != entry.numTriangles
+            || m_entries[entry.topologyFrame].numVertices != entry.numVertices)
+            return fail(path + " has a bad topology reference");
+        if (entry.offset % sizeof(float) != 0 || entry.offset > m_header.tableOffset
+            || frameEnd(i) > m_header.tableOffset)
+            return fail(path + " has a truncated frame");
+    }
+
+    m_file.adviseSequential();
+    return true;
+}
+
+void PointCacheStream::close()
+{
+    m_file.close();
+    m_entries.clear();
+    m_topology = kNoTopology;
+    m_hasWindow = false;
+    m_error.clear();
+}
+
+unsigned PointCacheStream::numFrames() const
+{
+    return (unsigned)m_entries.size();
+}
+
+double PointCacheStream::startFrame() const
+{
+    return m_header.startFrame;
+}
+
+const PointCacheFrameEntry& PointCacheStream::entry(unsigned frame) const
+{
+    return m_entries[frame];
+}
+
+bool PointCacheStream::frame(unsigned index, TrackFrame& frame) const
+{
+    if (index >= m_entries.size())
+        return false;
+
+    const PointCacheFrameEntry& entry = m_entries[index];
+    const PointCacheFrameEntry& topology = m_entries[entry.topologyFrame];
+    const uint8_t* data = m_file.data();
+
+    frame.points = reinterpret_cast<const float*>(data + entry.offset);
+    frame.numVertices = entry.numVertices;
+    frame.triangles = reinterpret_cast<const int*>(data + topology.offset + sizeof(float) * 3 * topology.numVertices);
+    frame.numTriangles = topology.numTriangles;
+
+    if (m_topology == kNoTopology || m_topologyFrame != entry.topologyFrame)
+    {
+        m_topology = topologyFingerprint(frame.numVertices, frame.triangles, frame.numTriangles);
+        m_topologyFrame = entry.topologyFrame;
+    }
+    frame.topology = m_topology;
+    return true;
+}
+
+void PointCacheStream::setWindow(unsigned first, unsigned last)
+{
+    if (m_entries.empty())
+        return;
+    if (last >= m_entries.size())
+        last = (unsigned)m_entries.size() - 1;
+
+    if (m_hasWindow)
+    {
+        unsigned topologyInUse = m_entries[first < m_entries.size() ? first : last].topologyFrame;
+        for (unsigned i = m_windowFirst; i < first && i <= m_windowLast; i++)
+            releaseFrame(i, topologyInUse);
+    }
+
+    unsigned ahead = last + 1;
+    unsigned aheadEnd = ahead + kReadAhead < m_entries.size() ? ahead + kReadAhead : (unsigned)m_entries.size();
+    if (ahead < aheadEnd)
+        m_file.willNeed(m_entries[ahead].offset, frameEnd(aheadEnd - 1) - m_entries[ahead].offset);
+
+    m_windowFirst = first;
+    m_windowLast = last;
+    m_hasWindow = true;
+}
+
+const std::string& PointCacheStream::error() const
+{
+    return m_error;
+}
+
+bool PointCacheStream::fail(const std::string& message)
+{
+    m_error = message;
+    m_file.close();
+    m_entries.clear();
+    return false;
+}
+
+uint64_t PointCacheStream::frameEnd(unsigned index) const
+{
+    const PointCacheFrameEntry& entry = m_entries[index];
+    uint64_t end = entry.offset + sizeof(float) * 3 * (uint64_t)entry.numVertices;
+    if (entry.topologyFrame == index)
+        end += sizeof(int32_t) * 3 * (uint64_t)entry.numTriangles;
+    return end;
+}
+
+void PointCacheStream::releaseFrame(unsigned index, unsigned topologyInUse)
+{
+    const PointCacheFrameEntry& entry = m_entries[index];
+    uint64_t end = frameEnd(index);
+
+    //A frame that carries triangles keeps them while later frames of the
+    //same topology still use them.
+    if (index == topologyInUse)
+        end = entry.offset + sizeof(float) * 3 * (uint64_t)entry.numVertices;
+
+    m_file.release(entry.offset, end - entry.offset);
+}
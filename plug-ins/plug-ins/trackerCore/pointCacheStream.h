@@ -0,0 +1,56 @@
+//
+// Streams a point cache through a memory mapping, handing out frames that
+// point straight into the file. Only a small window of frames around the
+// one being tracked is kept resident, so memory use stays flat however
+// long the take is.
+//
+#ifndef TRACKERCORE_POINTCACHESTREAM_H
+#define TRACKERCORE_POINTCACHESTREAM_H
+
+#include "mappedFile.h"
+#include "pointCache.h"
+#include "trackingEngine.h"
+
+#include <string>
+#include <vector>
+
+class PointCacheStream
+{
+public:
+    bool open(const std::string& path);
+    void close();
+
+    unsigned numFrames() const;
+    double startFrame() const;
+    const PointCacheFrameEntry& entry(unsigned frame) const;
+
+    //Points frame at the cached data for index, without copying. The
+    //pointers stay valid until close(). The topology fingerprint is
+    //worked out once per run of frames sharing triangles.
+    bool frame(unsigned index, TrackFrame& frame) const;
+
+    //Keeps frames [first, last] resident, drops the ones before first
+    //that were in the previous window and reads ahead past last. Meant
+    //for a forward sweep like jointTrack's window of [f-1, f+1].
+    void setWindow(unsigned first, unsigned last);
+
+    const std::string& error() const;
+
+private:
+    bool fail(const std::string& message);
+    uint64_t frameEnd(unsigned index) const;
+    void releaseFrame(unsigned index, unsigned topologyInUse);
+
+    MappedFile m_file;
+    PointCacheHeader m_header;
+    std::vector<PointCacheFrameEntry> m_entries;
+    //Fingerprint of the last topology frame() handed out.
+    mutable unsigned m_topologyFrame = 0;
+    mutable uint64_t m_topology = kNoTopology;
+    unsigned m_windowFirst = 0;
+    unsigned m_windowLast = 0;
+    bool m_hasWindow = false;
+    std::string m_error;
+};
+
+#endif //TRACKERCORE_POINTCACHESTREAM_H
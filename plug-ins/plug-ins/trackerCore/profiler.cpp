@@ -0,0 +1,256 @@
+//
+// Per-phase timers and event counters.
+//
+#include "profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct Phase
+    {
+        std::string name;
+        uint64_t calls = 0;
+        double totalMs = 0;
+        double frameMs = 0;
+        //Time spent in the phase on each finished frame.
+        std::vector<double> frames;
+    };
+
+    struct Counter
+    {
+        std::string name;
+        uint64_t count = 0;
+    };
+
+    struct Event
+    {
+        unsigned phase;
+        double beginUs;
+        double durationUs;
+        unsigned thread;
+    };
+
+    std::mutex s_mutex;
+    std::vector<Phase> s_phases;
+    std::vector<Counter> s_counters;
+    std::vector<Event> s_events;
+    std::vector<std::thread::id> s_threads;
+    bool s_recordEvents = false;
+    unsigned s_numFrames = 0;
+    Profiler::Clock::time_point s_start;
+    Profiler::Clock::time_point s_stop;
+
+    unsigned threadIndex()
+    {
+        std::thread::id id = std::this_thread::get_id();
+        for (size_t i = 0; i < s_threads.size(); i++)
+        {
+            if (s_threads[i] == id)
+                return (unsigned)i;
+        }
+        s_threads.push_back(id);
+        return (unsigned)s_threads.size() - 1;
+    }
+
+    double percentile95(std::vector<double> values)
+    {
+        if (values.empty())
+            return 0;
+        std::sort(values.begin(), values.end());
+        size_t rank = (size_t)std::ceil(0.95 * values.size());
+        return values[rank > 0 ? rank - 1 : 0];
+    }
+
+    std::string jsonEscape(const std::string& text)
+    {
+        std::string escaped;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+}
+
+std::atomic<bool> Profiler::s_enabled(false);
+
+void Profiler::start(bool recordEvents)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    for (Phase& phase : s_phases)
+    {
+        phase.calls = 0;
+        phase.totalMs = 0;
+        phase.frameMs = 0;
+        phase.frames.clear();
+    }
+    for (Counter& counter : s_counters)
+        counter.count = 0;
+    s_events.clear();
+    s_threads.clear();
+    s_recordEvents = recordEvents;
+    s_numFrames = 0;
+    s_start = Clock::now();
+    s_stop = s_start;
+    s_enabled = true;
+}
+
+void Profiler::stop()
+{
+    if (!s_enabled)
+        return;
+    s_enabled = false;
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_stop = Clock::now();
+}
+
+unsigned Profiler::phase(const char* name)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    for (size_t i = 0; i < s_phases.size(); i++)
+    {
+        if (s_phases[i].name == name)
+            return (unsigned)i;
+    }
+    s_phases.push_back(Phase());
+    s_phases.back().name = name;
+    return (unsigned)s_phases.size() - 1;
+}
+
+unsigned Profiler::counter(const char* name)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    for (size_t i = 0; i < s_counters.size(); i++)
+    {
+        if (s_counters[i].name == name)
+            return (unsigned)i;
+    }
+    s_counters.push_back(Counter());
+    s_counters.back().name = name;
+    return (unsigned)s_counters.size() - 1;
+}
+
+void Profiler::record(unsigned phase, Clock::time_point begin, Clock::time_point end)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (!s_enabled)
+        return;
+
+    double ms = std::chrono::duration<double, std::milli>(end - begin).count();
+    Phase& entry = s_phases[phase];
+    entry.calls++;
+    entry.totalMs += ms;
+    entry.frameMs += ms;
+
+    if (s_recordEvents)
+    {
+        Event event;
+        event.phase = phase;
+        event.beginUs = std::chrono::duration<double, std::micro>(begin - s_start).count();
+        event.durationUs = ms * 1000;
+        event.thread = threadIndex();
+        s_events.push_back(event);
+    }
+}
+
+void Profiler::addCount(unsigned counter, uint64_t amount)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_counters[counter].count += amount;
+}
+
+void Profiler::endFrame()
+{
+    if (!s_enabled)
+        return;
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    for (Phase& phase : s_phases)
+    {
+        phase.frames.push_back(phase.frameMs);
+        phase.frameMs = 0;
+    }
+    s_numFrames++;
+}
+
+std::string Profiler::report()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    Clock::time_point stop = s_enabled ? Clock::now() : s_stop;
+    double seconds = std::chrono::duration<double>(stop - s_start).count();
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    out << "profile: " << s_numFrames << " frames in " << seconds << " s\n";
+    out << std::left << std::setw(24) << "phase" << std::right << std::setw(10) << "calls" << std::setw(14)
+        << "total ms" << std::setw(16) << "mean/frame ms" << std::setw(15) << "p95/frame ms" << "\n";
+
+    for (const Phase& phase : s_phases)
+    {
+        if (phase.calls == 0)
+            continue;
+        double mean = s_numFrames > 0 ? phase.totalMs / s_numFrames : 0;
+        out << std::left << std::setw(24) << phase.name << std::right << std::setw(10) << phase.calls
+            << std::setw(14) << phase.totalMs << std::setw(16) << mean << std::setw(15)
+            << percentile95(phase.frames) << "\n";
+    }
+
+    for (const Counter& counter : s_counters)
+    {
+        if (counter.count > 0)
+            out << std::left << std::setw(24) << counter.name << std::right << std::setw(10) << counter.count << "\n";
+    }
+    return out.str();
+}
+
+bool Profiler::writeChromeTrace(const std::string& path, std::string& error)
+{
+    std::ofstream file(path.c_str(), std::ios::trunc);
+    if (!file)
+    {
+        error = "could not open " + path + " for writing";
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    file << std::fixed << std::setprecision(3);
+    file << "{\"traceEvents\":[";
+    for (size_t i = 0; i < s_events.size(); i++)
+    {
+        const Event& event = s_events[i];
+        file << (i > 0 ? ",\n" : "\n") << "{\"name\":\"" << jsonEscape(s_phases[event.phase].name)
+             << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":" << event.beginUs
+             << ",\"dur\":" << event.durationUs << "}";
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    if (!file)
+    {
+        error = "could not write " + path;
+        return false;
+    }
+    return true;
+}
+
+ProfileSession::ProfileSession(bool enabled, bool recordEvents)
+    : m_enabled(enabled)
+{
+    if (m_enabled)
+        Profiler::start(recordEvents);
+}
+
+ProfileSession::~ProfileSession()
+{
+    if (m_enabled)
+        Profiler::stop();
+}
@@ -0,0 +1,107 @@
+//
+// Per-phase timers and event counters for finding where a tracking run
+// spends its time. Everything is a no-op until Profiler::start(), and a
+// disabled timer costs one flag test.
+//
+// PROFILE_SCOPE("phase") times the rest of the enclosing block. Frames
+// are delimited with Profiler::endFrame() so the report can give per
+// frame means and 95th percentiles next to the totals.
+//
+#ifndef TRACKERCORE_PROFILER_H
+#define TRACKERCORE_PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+class Profiler
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static bool enabled()
+    {
+        return s_enabled;
+    }
+
+    //Clears all timings and counts. With recordEvents every timed scope
+    //is also kept for writeChromeTrace().
+    static void start(bool recordEvents);
+    static void stop();
+
+    //Ids are handed out once per name and stay valid across runs.
+    static unsigned phase(const char* name);
+    static unsigned counter(const char* name);
+
+    static void record(unsigned phase, Clock::time_point begin, Clock::time_point end);
+    static void addCount(unsigned counter, uint64_t amount);
+    static void endFrame();
+
+    //Table of calls, total, mean per frame and p95 per frame for every
+    //phase, followed by the counters.
+    static std::string report();
+    //Chrome trace event JSON, for chrome://tracing or Perfetto.
+    static bool writeChromeTrace(const std::string& path, std::string& error);
+
+private:
+    static std::atomic<bool> s_enabled;
+};
+
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(unsigned phase)
+        : m_phase(phase), m_running(Profiler::enabled())
+    {
+        if (m_running)
+            m_begin = Profiler::Clock::now();
+    }
+
+    ~ScopedTimer()
+    {
+        if (m_running)
+            Profiler::record(m_phase, m_begin, Profiler::Clock::now());
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    unsigned m_phase;
+    bool m_running;
+    Profiler::Clock::time_point m_begin;
+};
+
+//Ends profiling however the run returns.
+class ProfileSession
+{
+public:
+    ProfileSession(bool enabled, bool recordEvents);
+    ~ProfileSession();
+
+    ProfileSession(const ProfileSession&) = delete;
+    ProfileSession& operator=(const ProfileSession&) = delete;
+
+private:
+    bool m_enabled;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#define PROFILE_SCOPE(name)                                                                  \
+    static const unsigned PROFILE_CONCAT(profilePhase, __LINE__) = Profiler::phase(name);    \
+    ScopedTimer PROFILE_CONCAT(profileTimer, __LINE__)(PROFILE_CONCAT(profilePhase, __LINE__))
+
+#define PROFILE_COUNT(name, amount)                              \
+    do                                                           \
+    {                                                            \
+        if (Profiler::enabled())                                 \
+        {                                                        \
+            static const unsigned counterId = Profiler::counter(name); \
+            Profiler::addCount(counterId, amount);               \
+        }                                                        \
+    } while (0)
+
+#endif //TRACKERCORE_PROFILER_H
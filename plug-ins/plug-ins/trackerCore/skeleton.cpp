@@ -0,0 +1,307 @@
+//
+// Skeleton templates for jointCreate.
+//
+#include "skeleton.h"
+
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    const double kDegreesToRadians = 3.14159265358979323846 / 180.0;
+
+    //The centre line and the left side of the humanoid. The right side is
+    //its mirror image, see humanoidSkeleton().
+    const char* kHumanoidTemplate =
+        "root          -             0     0     0\n"
+        "hips          root          0     1.0   0\n"
+        "spine1        hips          0     0.1   0\n"
+        "spine2        spine1        0     0.12  0\n"
+        "spine3        spine2        0     0.12  0\n"
+        "chest         spine3        0     0.12  0\n"
+        "neck          chest         0     0.14  0\n"
+        "head          neck          0     0.1   0\n"
+        "headEnd       head          0     0.2   0\n"
+        "leftClavicle  chest         0.03  0.1   0\n"
+        "leftShoulder  leftClavicle  0.15  0     0\n"
+        "leftElbow     leftShoulder  0.28  0     0\n"
+        "leftWrist     leftElbow     0.25  0     0\n"
+        "leftThumb1    leftWrist     0.025 -0.01 0.03\n"
+        "leftThumb2    leftThumb1    0.035 0     0.02\n"
+        "leftThumb3    leftThumb2    0.03  0     0.01\n"
+        "leftIndex1    leftWrist     0.09  0     0.025\n"
+        "leftIndex2    leftIndex1    0.04  0     0\n"
+        "leftIndex3    leftIndex2    0.025 0     0\n"
+        "leftMiddle1   leftWrist     0.09  0     0.008\n"
+        "leftMiddle2   leftMiddle1   0.045 0     0\n"
+        "leftMiddle3   leftMiddle2   0.028 0     0\n"
+        "leftRing1     leftWrist     0.085 0     -0.008\n"
+        "leftRing2     leftRing1     0.04  0     0\n"
+        "leftRing3     leftRing2     0.026 0     0\n"
+        "leftPinky1    leftWrist     0.08  0     -0.024\n"
+        "leftPinky2    leftPinky1    0.03  0     0\n"
+        "leftPinky3    leftPinky2    0.02  0     0\n"
+        "leftHip       hips          0.1   -0.05 0\n"
+        "leftKnee      leftHip       0     -0.42 0.01\n"
+        "leftAnkle     leftKnee      0     -0.42 -0.01\n"
+        "leftBall      leftAnkle     0     -0.06 0.12\n"
+        "leftToe       leftBall      0     0     0.06\n"
+        "ik leftArmIk  leftShoulder  leftWrist\n"
+        "ik leftLegIk  leftHip       leftAnkle\n";
+
+    //Rotation with row vectors, the same as MMatrix: v * m.
+    struct Rotation
+    {
+        Vec3 rows[3] = {Vec3(1, 0, 0), Vec3(0, 1, 0), Vec3(0, 0, 1)};
+
+        Vec3 apply(const Vec3& v) const
+        {
+            return rows[0] * v.x + rows[1] * v.y + rows[2] * v.z;
+        }
+
+        Vec3 applyInverse(const Vec3& v) const
+        {
+            return Vec3(rows[0].dot(v), rows[1].dot(v), rows[2].dot(v));
+        }
+
+        Rotation operator*(const Rotation& o) const
+        {
+            Rotation result;
+            for (unsigned i = 0; i < 3; i++)
+                result.rows[i] = o.apply(rows[i]);
+            return result;
+        }
+    };
+
+    //Joint orient in degrees, XYZ order: x is applied first.
+    Rotation orientRotation(const Vec3& degrees)
+    {
+        double x = degrees.x * kDegreesToRadians;
+        double y = degrees.y * kDegreesToRadians;
+        double z = degrees.z * kDegreesToRadians;
+        Rotation rx, ry, rz;
+        rx.rows[1] = Vec3(0, std::cos(x), std::sin(x));
+        rx.rows[2] = Vec3(0, -std::sin(x), std::cos(x));
+        ry.rows[0] = Vec3(std::cos(y), 0, -std::sin(y));
+        ry.rows[2] = Vec3(std::sin(y), 0, std::cos(y));
+        rz.rows[0] = Vec3(std::cos(z), std::sin(z), 0);
+        rz.rows[1] = Vec3(-std::sin(z), std::cos(z), 0);
+        return rx * ry * rz;
+    }
+
+    bool fail(const std::string& source, unsigned lineNumber, const std::string& message, std::string& error)
+    {
+        std::ostringstream stream;
+        stream << source << ":" << lineNumber << ": " << message;
+        error = stream.str();
+        return false;
+    }
+
+    bool below(const SkeletonTemplate& skeleton, unsigned joint, unsigned ancestor)
+    {
+        for (int parent = skeleton.joints[joint].parent; parent >= 0; parent = skeleton.joints[parent].parent)
+        {
+            if ((unsigned)parent == ancestor)
+                return true;
+        }
+        return false;
+    }
+
+    std::string mirrorName(const std::string& name)
+    {
+        return name.compare(0, 4, "left") == 0 ? "right" + name.substr(4) : name;
+    }
+}
+
+int SkeletonTemplate::find(const std::string& name) const
+{
+    for (size_t j = 0; j < joints.size(); j++)
+    {
+        if (joints[j].name == name)
+            return (int)j;
+    }
+    return -1;
+}
+
+bool parseSkeletonTemplate(std::istream& in, const std::string& source, SkeletonTemplate& skeleton,
+                           std::string& error)
+{
+    skeleton = SkeletonTemplate();
+    std::string line;
+    unsigned lineNumber = 0;
+    while (std::getline(in, line))
+    {
+        lineNumber++;
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#')
+            continue;
+
+        std::istringstream fields(line);
+        std::string name;
+        fields >> name;
+
+        if (name == "ik")
+        {
+            SkeletonIkHandle handle;
+            std::string start, end, extra;
+            if (!(fields >> handle.name >> start >> end) || (fields >> extra))
+                return fail(source, lineNumber, "expected ik <name> <start joint> <end joint>", error);
+
+            int startJoint = skeleton.find(start);
+            int endJoint = skeleton.find(end);
+            if (startJoint < 0 || endJoint < 0)
+                return fail(source, lineNumber, "unknown joint " + (startJoint < 0 ? start : end), error);
+            if (!below(skeleton, (unsigned)endJoint, (unsigned)startJoint))
+                return fail(source, lineNumber, end + " is not below " + start, error);
+
+            handle.startJoint = (unsigned)startJoint;
+            handle.endJoint = (unsigned)endJoint;
+            skeleton.ikHandles.push_back(handle);
+            continue;
+        }
+
+        SkeletonJoint joint;
+        joint.name = name;
+        std::string parent;
+        if (!(fields >> parent >> joint.translation.x >> joint.translation.y >> joint.translation.z))
+            return fail(source, lineNumber, "expected <name> <parent> <tx> <ty> <tz>", error);
+        if (skeleton.find(name) >= 0)
+            return fail(source, lineNumber, "duplicate joint " + name, error);
+        if (parent != "-")
+        {
+            joint.parent = skeleton.find(parent);
+            if (joint.parent < 0)
+                return fail(source, lineNumber, "unknown parent " + parent, error);
+        }
+
+        std::string option;
+        while (fields >> option)
+        {
+            if (option == "orient")
+            {
+                if (!(fields >> joint.orient.x >> joint.orient.y >> joint.orient.z))
+                    return fail(source, lineNumber, "expected orient <rx> <ry> <rz>", error);
+            }
+            else if (option == "track")
+            {
+                if (!(fields >> joint.trackedJoint) || joint.trackedJoint < 0)
+                    return fail(source, lineNumber, "expected track <joint>", error);
+            }
+            else
+                return fail(source, lineNumber, "unknown option " + option, error);
+        }
+        skeleton.joints.push_back(joint);
+    }
+
+    if (skeleton.joints.empty())
+        return fail(source, lineNumber, "no joints", error);
+    return true;
+}
+
+bool readSkeletonTemplate(const std::string& path, SkeletonTemplate& skeleton, std::string& error)
+{
+    std::ifstream file(path.c_str());
+    if (!file)
+    {
+        error = "could not open " + path;
+        return false;
+    }
+    return parseSkeletonTemplate(file, path, skeleton, error);
+}
+
+SkeletonTemplate chainSkeleton(unsigned length, double spacing, double orient, bool tracked)
+{
+    SkeletonTemplate skeleton;
+    for (unsigned j = 0; j < length; j++)
+    {
+        SkeletonJoint joint;
+        joint.name = "joint" + std::to_string(j + 1);
+        joint.parent = (int)j - 1;
+        joint.translation = Vec3(0, spacing, 0);
+        joint.orient = Vec3(orient, 0, 0);
+        joint.trackedJoint = tracked ? (int)j : -1;
+        skeleton.joints.push_back(joint);
+    }
+
+    if (length > 1)
+    {
+        SkeletonIkHandle handle;
+        handle.name = "ikHandle1";
+        handle.endJoint = length - 1;
+        skeleton.ikHandles.push_back(handle);
+    }
+    return skeleton;
+}
+
+unsigned numTrackedJoints(const SkeletonTemplate& skeleton)
+{
+    unsigned count = 0;
+    for (const SkeletonJoint& joint : skeleton.joints)
+        count += joint.trackedJoint >= 0 ? 1 : 0;
+    return count;
+}
+
+SkeletonTemplate humanoidSkeleton()
+{
+    SkeletonTemplate skeleton;
+    std::istringstream text(kHumanoidTemplate);
+    std::string error;
+    parseSkeletonTemplate(text, "humanoid", skeleton, error);
+
+    //Mirrored across x. Parents on the left come before their children,
+    //so the mirrored parents do too.
+    size_t numJoints = skeleton.joints.size();
+    for (size_t j = 0; j < numJoints; j++)
+    {
+        SkeletonJoint joint = skeleton.joints[j];
+        if (mirrorName(joint.name) == joint.name)
+            continue;
+
+        joint.name = mirrorName(joint.name);
+        joint.parent = skeleton.find(mirrorName(skeleton.joints[joint.parent].name));
+        joint.translation.x = -joint.translation.x;
+        joint.orient = Vec3(joint.orient.x, -joint.orient.y, -joint.orient.z);
+        skeleton.joints.push_back(joint);
+    }
+
+    size_t numHandles = skeleton.ikHandles.size();
+    for (size_t i = 0; i < numHandles; i++)
+    {
+        SkeletonIkHandle handle = skeleton.ikHandles[i];
+        handle.name = mirrorName(handle.name);
+        handle.startJoint = (unsigned)skeleton.find(mirrorName(skeleton.joints[handle.startJoint].name));
+        handle.endJoint = (unsigned)skeleton.find(mirrorName(skeleton.joints[handle.endJoint].name));
+        skeleton.ikHandles.push_back(handle);
+    }
+    return skeleton;
+}
+
+unsigned placeSkeleton(SkeletonTemplate& skeleton, const std::vector<Vec3>& tracked,
+                       std::vector<Vec3>& worldPositions)
+{
+    //Space each joint's children are translated in.
+    std::vector<Rotation> frames(skeleton.joints.size());
+    worldPositions.resize(skeleton.joints.size());
+
+    unsigned placed = 0;
+    for (size_t j = 0; j < skeleton.joints.size(); j++)
+    {
+        SkeletonJoint& joint = skeleton.joints[j];
+        Rotation parentFrame = joint.parent >= 0 ? frames[joint.parent] : Rotation();
+        Vec3 parentPosition = joint.parent >= 0 ? worldPositions[joint.parent] : Vec3();
+
+        if (joint.trackedJoint >= 0 && (size_t)joint.trackedJoint < tracked.size())
+        {
+            const Vec3& position = tracked[joint.trackedJoint];
+            if (!std::isnan(position.x) && !std::isnan(position.y) && !std::isnan(position.z))
+            {
+                joint.translation = parentFrame.applyInverse(position - parentPosition);
+                placed++;
+            }
+        }
+
+        worldPositions[j] = parentPosition + parentFrame.apply(joint.translation);
+        frames[j] = orientRotation(joint.orient) * parentFrame;
+    }
+    return placed;
+}
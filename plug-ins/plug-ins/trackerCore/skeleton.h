@@ -0,0 +1,83 @@
+//
+// Skeleton templates for jointCreate: a compact text description of a
+// joint hierarchy and the IK handles on it, and where its joints end up.
+//
+// One joint or IK handle per line. Blank lines and lines starting with
+// '#' are ignored:
+//
+//   <name> <parent or -> <tx> <ty> <tz> [orient <rx> <ry> <rz>] [track <joint>]
+//   ik <name> <start joint> <end joint>
+//
+// A joint's translation is relative to its parent and in its parent's
+// space, the same as a Maya joint's translate, and orient is its joint
+// orient in degrees, XYZ order. A joint with track is moved to where that
+// tracked joint (a vp set of jointRig, or a joint of a trajectory file) is
+// when placeSkeleton() is given tracked positions. Parents come before
+// their children and an IK handle's end joint lies below its start joint.
+//
+#ifndef TRACKERCORE_SKELETON_H
+#define TRACKERCORE_SKELETON_H
+
+#include "vec3.h"
+
+#include <istream>
+#include <string>
+#include <vector>
+
+struct SkeletonJoint
+{
+    std::string name;
+    //Index of the parent joint, -1 for a root.
+    int parent = -1;
+    Vec3 translation;
+    Vec3 orient;
+    //Index of the tracked joint this joint follows, -1 for none.
+    int trackedJoint = -1;
+};
+
+struct SkeletonIkHandle
+{
+    std::string name;
+    unsigned startJoint = 0;
+    unsigned endJoint = 0;
+};
+
+struct SkeletonTemplate
+{
+    std::vector<SkeletonJoint> joints;
+    std::vector<SkeletonIkHandle> ikHandles;
+
+    //Index of the joint with this name, -1 if there is none.
+    int find(const std::string& name) const;
+};
+
+//source names the template in error messages.
+bool parseSkeletonTemplate(std::istream& in, const std::string& source, SkeletonTemplate& skeleton,
+                           std::string& error);
+bool readSkeletonTemplate(const std::string& path, SkeletonTemplate& skeleton, std::string& error);
+
+//A straight chain of length joints, joint1 to jointN, each spacing along
+//its parent's y axis and oriented orient degrees about x, with one IK
+//handle from the first joint to the last. With tracked, joint N follows
+//tracked joint N - 1, so a chain as long as a take's joints is placed on
+//all of them.
+SkeletonTemplate chainSkeleton(unsigned length, double spacing, double orient, bool tracked = false);
+
+//Joints with a trackedJoint.
+unsigned numTrackedJoints(const SkeletonTemplate& skeleton);
+
+//A 57 joint humanoid in metres, y up and facing +z: root, hips, a three
+//joint spine to the chest, neck and head, arms from the clavicles down to
+//five three joint fingers, and legs down to the toes. IK handles run from
+//the shoulders to the wrists and from the hips to the ankles.
+SkeletonTemplate humanoidSkeleton();
+
+//World position of every joint. Joints with a trackedJoint that has a
+//position in tracked are moved there, changing their translation so
+//their parent reaches them, and the joints below them follow. NaN
+//positions, like joints that lost track, are skipped. Returns how many
+//joints were moved.
+unsigned placeSkeleton(SkeletonTemplate& skeleton, const std::vector<Vec3>& tracked,
+                       std::vector<Vec3>& worldPositions);
+
+#endif //TRACKERCORE_SKELETON_H
@@ -0,0 +1,165 @@
+//
+// Closest point queries that walk the surface from where a point was last
+// found.
+//
+#include "surfaceWalk.h"
+
+#include <algorithm>
+
+namespace
+{
+    inline float distanceSq(const float* points, int vertex, const float* query)
+    {
+        const float* p = points + vertex * 3;
+        float dx = p[0] - query[0];
+        float dy = p[1] - query[1];
+        float dz = p[2] - query[2];
+        return dx * dx + dy * dy + dz * dz;
+    }
+
+    bool validTriangle(const int* triangle, unsigned numVertices)
+    {
+        for (unsigned c = 0; c < 3; c++)
+        {
+            if (triangle[c] < 0 || (unsigned)triangle[c] >= numVertices)
+                return false;
+        }
+        return true;
+    }
+}
+
+const unsigned SurfaceWalk::kMaxSteps;
+
+void SurfaceWalk::build(unsigned numVertices, const int* triangles, unsigned numTriangles)
+{
+    m_adjacency.build(numVertices, triangles, numTriangles);
+    m_triangles.assign(triangles, triangles + numTriangles * 3);
+
+    m_fanOffsets.assign(numVertices + 1, 0);
+    for (unsigned t = 0; t < numTriangles; t++)
+    {
+        const int* triangle = triangles + t * 3;
+        if (!validTriangle(triangle, numVertices))
+            continue;
+        for (unsigned c = 0; c < 3; c++)
+            m_fanOffsets[triangle[c] + 1]++;
+    }
+    for (unsigned v = 0; v < numVertices; v++)
+        m_fanOffsets[v + 1] += m_fanOffsets[v];
+
+    m_fans.resize(m_fanOffsets[numVertices]);
+    std::vector<unsigned> fill(m_fanOffsets.begin(), m_fanOffsets.end() - 1);
+    for (unsigned t = 0; t < numTriangles; t++)
+    {
+        const int* triangle = triangles + t * 3;
+        if (!validTriangle(triangle, numVertices))
+            continue;
+        for (unsigned c = 0; c < 3; c++)
+            m_fans[fill[triangle[c]]++] = (int)t;
+    }
+}
+
+void SurfaceWalk::clear()
+{
+    m_adjacency.clear();
+    m_triangles.clear();
+    m_fanOffsets.clear();
+    m_fans.clear();
+}
+
+bool SurfaceWalk::empty() const
+{
+    return m_fans.empty();
+}
+
+unsigned SurfaceWalk::numVertices() const
+{
+    return m_adjacency.numVertices();
+}
+
+unsigned SurfaceWalk::numTriangles() const
+{
+    return (unsigned)m_triangles.size() / 3;
+}
+
+void SurfaceWalk::closestAround(const float* points, const float* query, int vertex, BvhHit& hit) const
+{
+    for (unsigned f = m_fanOffsets[vertex]; f < m_fanOffsets[vertex + 1]; f++)
+    {
+        int t = m_fans[f];
+        const int* triangle = &m_triangles[t * 3];
+        float candidate[3];
+        closestPointOnTriangle(query, points + triangle[0] * 3, points + triangle[1] * 3, points + triangle[2] * 3,
+                               candidate);
+
+        float dx = candidate[0] - query[0];
+        float dy = candidate[1] - query[1];
+        float dz = candidate[2] - query[2];
+        float candidateSq = dx * dx + dy * dy + dz * dz;
+        if (candidateSq < hit.distanceSq)
+        {
+            std::copy(candidate, candidate + 3, hit.point);
+            hit.distanceSq = candidateSq;
+            hit.triangle = t;
+        }
+    }
+}
+
+BvhHit SurfaceWalk::closestPoint(const float* points, const float* query, int start, float maxDistanceSq) const
+{
+    BvhHit miss;
+    std::copy(query, query + 3, miss.point);
+    miss.distanceSq = maxDistanceSq;
+    miss.triangle = -1;
+    if (start < 0 || (unsigned)start >= numTriangles() || !validTriangle(&m_triangles[start * 3], numVertices()))
+        return miss;
+
+    //Vertices are cheap to compare, so cover the distance on them first:
+    //step to whichever neighbour is nearest the query until none is.
+    const int* corners = &m_triangles[start * 3];
+    int vertex = corners[0];
+    float vertexSq = distanceSq(points, vertex, query);
+    for (unsigned c = 1; c < 3; c++)
+    {
+        float cornerSq = distanceSq(points, corners[c], query);
+        if (cornerSq < vertexSq)
+        {
+            vertex = corners[c];
+            vertexSq = cornerSq;
+        }
+    }
+
+    for (unsigned steps = 0; ; steps++)
+    {
+        int next = -1;
+        for (const int* n = m_adjacency.begin(vertex); n != m_adjacency.end(vertex); n++)
+        {
+            float neighbourSq = distanceSq(points, *n, query);
+            if (neighbourSq < vertexSq)
+            {
+                next = *n;
+                vertexSq = neighbourSq;
+            }
+        }
+        if (next < 0)
+            break;
+        if (steps == kMaxSteps)
+            return miss;
+        vertex = next;
+    }
+
+    //The closest surface point can sit on a triangle that does not touch
+    //the nearest vertex, on large or thin triangles, so keep moving to the
+    //triangles around the corners of the best one while they get closer.
+    BvhHit hit = miss;
+    hit.distanceSq = std::numeric_limits<float>::max();
+    closestAround(points, query, vertex, hit);
+    for (int triangle = -1; hit.triangle != triangle; )
+    {
+        triangle = hit.triangle;
+        for (unsigned c = 0; c < 3; c++)
+            closestAround(points, query, m_triangles[triangle * 3 + c], hit);
+    }
+
+    return hit.distanceSq <= maxDistanceSq ? hit : miss;
+}
@@ -0,0 +1,53 @@
+//
+// Closest point queries that start from where a point was last found and
+// walk over the surface towards the query, so following a point from one
+// frame to the next costs the few triangles it moved across rather than a
+// search of the whole mesh. The tables are built once per topology; the
+// vertex positions are passed with every query since they change every
+// frame.
+//
+#ifndef TRACKERCORE_SURFACEWALK_H
+#define TRACKERCORE_SURFACEWALK_H
+
+#include "meshAdjacency.h"
+#include "meshBvh.h"
+
+#include <limits>
+#include <vector>
+
+class SurfaceWalk
+{
+public:
+    //Edges a walk may cross before it gives up. A point that moved
+    //further than that is found sooner by searching the whole mesh.
+    static const unsigned kMaxSteps = 64;
+
+    //Triangles with a vertex ID outside [0, numVertices) are never
+    //walked onto.
+    void build(unsigned numVertices, const int* triangles, unsigned numTriangles);
+    void clear();
+
+    bool empty() const;
+    unsigned numVertices() const;
+    unsigned numTriangles() const;
+
+    //Walks from triangle start over points (numVertices() xyz triples)
+    //down to the nearest vertex to query, then on over the triangles
+    //around it while they get closer, and stops at the first local
+    //minimum. When the walk gives up, or the minimum is farther than
+    //maxDistanceSq from the query, the hit's triangle is -1 and the
+    //caller should search the whole mesh instead.
+    BvhHit closestPoint(const float* points, const float* query, int start,
+                        float maxDistanceSq = std::numeric_limits<float>::max()) const;
+
+private:
+    void closestAround(const float* points, const float* query, int vertex, BvhHit& hit) const;
+
+    MeshAdjacency m_adjacency;
+    std::vector<int> m_triangles;
+    //Triangles around each vertex, as compressed sparse rows.
+    std::vector<unsigned> m_fanOffsets;
+    std::vector<int> m_fans;
+};
+
+#endif //TRACKERCORE_SURFACEWALK_H
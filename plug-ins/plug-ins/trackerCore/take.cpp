@@ -0,0 +1,514 @@
+//
+// Headless tracking of one take, and the take manifest.
+//
+#include "take.h"
+#include "checkpoint.h"
+#include "correspondence.h"
+#include "framePipeline.h"
+#include "pointCacheStream.h"
+#include "profiler.h"
+#include "threadPool.h"
+#include "topology.h"
+#include "trackingEngine.h"
+#include "trajectory.h"
+#include "vertexSets.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    //One frame on its way through trackTake(): the frames read for it,
+    //then where its joints were tracked to.
+    struct TakeSlot
+    {
+        TrackFrame current;
+        TrackFrame next;
+        std::vector<Vec3> positions;
+        std::vector<uint8_t> tracked;
+    };
+
+    TakeResult failed(TakeResult& result, const std::string& error)
+    {
+        result.ok = false;
+        result.error = error;
+        return result;
+    }
+
+    size_t fileNameStart(const std::string& path)
+    {
+        size_t directory = path.find_last_of("/\\");
+        return directory == std::string::npos ? 0 : directory + 1;
+    }
+
+    std::string withExtension(const std::string& path, const std::string& extension)
+    {
+        size_t dot = path.find_last_of('.');
+        if (dot == std::string::npos || dot < fileNameStart(path))
+            dot = path.size();
+        return path.substr(0, dot) + extension;
+    }
+
+    std::string resolve(const std::string& directory, const std::string& path)
+    {
+        bool absolute = !path.empty() && (path[0] == '/' || path[0] == '\\' || path.find(':') != std::string::npos);
+        return absolute || directory.empty() ? path : directory + path;
+    }
+
+    //Carries sets from frame first of cache to frame last, over every
+    //change to a new mesh between them. Maps maps lacks are computed the
+    //way trackTake() computes them and added to it.
+    bool carrySets(const PointCacheStream& cache, unsigned first, unsigned last, CorrespondenceCache& maps,
+                   ThreadPool& pool, std::vector<std::vector<int>>& sets, std::string& error)
+    {
+        VertexCorrespondence computed;
+        for (unsigned i = first + 1; i <= last; i++)
+        {
+            if (cache.entry(i).topologyFrame == cache.entry(i - 1).topologyFrame)
+                continue;
+            TrackFrame previous;
+            TrackFrame current;
+            if (!cache.frame(i - 1, previous) || !cache.frame(i, current))
+            {
+                error = cache.error();
+                return false;
+            }
+            if (previous.topology == current.topology)
+                continue;
+
+            uint64_t from = frameFingerprint(previous.topology, previous.points, previous.numVertices);
+            uint64_t to = frameFingerprint(current.topology, current.points, current.numVertices);
+            const VertexCorrespondence* map = maps.find(from, to);
+            if (map == nullptr)
+            {
+                TrackFrame before;
+                bool hasBefore = i > 1 && cache.entry(i - 2).topologyFrame == cache.entry(i - 1).topologyFrame
+                                 && cache.frame(i - 2, before);
+                computeCorrespondence(previous, current, hasBefore ? &before : nullptr, pool, computed);
+                map = maps.add(from, to, computed);
+            }
+
+            sets = carryVertexSets(sets, *map);
+            for (size_t j = 0; j < sets.size(); j++)
+            {
+                if (sets[j].empty())
+                {
+                    std::ostringstream message;
+                    message << "joint " << j + 1 << " has no vertices left on the new mesh of frame "
+                            << cache.startFrame() + i;
+                    error = message.str();
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+}
+
+TakeResult trackTake(const TakeJob& job)
+{
+    TakeResult result;
+
+    PointCacheStream cache;
+    if (!cache.open(job.cachePath))
+        return failed(result, cache.error());
+
+    std::vector<std::vector<int>> sets;
+    std::string error;
+    if (!readVertexSets(job.setsPath, sets, error))
+        return failed(result, error);
+
+    //Frame numbers are scene frames, the same as jointRig -s/-e.
+    double firstCached = cache.startFrame();
+    double lastCached = firstCached + cache.numFrames() - 1;
+    double startFrame = job.startFrame < firstCached ? firstCached : job.startFrame;
+    double endFrame = job.endFrame < 0 || job.endFrame > lastCached ? lastCached : job.endFrame;
+
+    std::ofstream output;
+    if (!job.csvPath.empty())
+    {
+        output.open(job.csvPath.c_str());
+        if (!output)
+            return failed(result, "could not open " + job.csvPath);
+        output << "frame,joint,x,y,z\n";
+    }
+
+    //The trajectory keeps the sets as read, whatever the tracking starts
+    //from, so the chunks of a take stitch back together.
+    if (!job.startSets.empty())
+    {
+        bool matches = job.startSets.size() == sets.size();
+        for (size_t j = 0; matches && j < sets.size(); j++)
+            matches = job.startSets[j].size() == sets[j].size();
+        if (!matches)
+            return failed(result, "the start vertex sets do not match " + job.setsPath);
+    }
+    const std::vector<std::vector<int>>& startSets = job.startSets.empty() ? sets : job.startSets;
+
+    TrackingEngine engine(job.numThreads);
+    engine.setJoints(startSets);
+
+    unsigned first = (unsigned)(startFrame - firstCached);
+    unsigned last = (unsigned)(endFrame - firstCached);
+
+    //Checkpoints carry every frame so far, so the trajectory is kept
+    //whenever there are checkpoints, even if it is not written out.
+    bool checkpoints = !job.checkpointPath.empty();
+    TrajectoryWriter trajectory;
+    if (!job.trajectoryPath.empty() || checkpoints)
+        trajectory.begin(firstCached + first, last > first ? last - first : 0, sets);
+
+    unsigned resumeFrom = first;
+    if (checkpoints && job.resume)
+    {
+        double nextFrame;
+        TrackingState state;
+        TrajectoryWriter saved;
+        if (!readCheckpoint(job.checkpointPath, nextFrame, state, saved, error))
+            return failed(result, error);
+        if (state.vertexSets != startSets)
+            return failed(result, job.checkpointPath + " was saved with other vertex sets");
+        if (saved.startFrame() != trajectory.startFrame() || saved.numFrames() != trajectory.numFrames()
+            || nextFrame < saved.startFrame() || nextFrame > saved.startFrame() + saved.numFrames())
+            return failed(result, job.checkpointPath + " was saved for another frame range");
+
+        if (!engine.restoreState(state))
+            return failed(result, job.checkpointPath + " has a bad tracking state");
+        trajectory = saved;
+        resumeFrom = (unsigned)(nextFrame - firstCached);
+        result.resumedFrames = resumeFrom - first;
+
+        for (unsigned i = first; i < resumeFrom; i++)
+        {
+            for (unsigned j = 0; j < engine.numJoints(); j++)
+            {
+                if (!trajectory.tracked(j, i - first))
+                {
+                    result.lost++;
+                    continue;
+                }
+                if (output.is_open())
+                {
+                    Vec3 p = trajectory.position(j, i - first);
+                    output << firstCached + i << "," << j + 1 << "," << p.x << "," << p.y << "," << p.z << "\n";
+                }
+            }
+        }
+    }
+
+    //Maps are matched on the produce stage, on the tracking threads' pool.
+    bool correspondences = !job.correspondencePath.empty();
+    CorrespondenceCache maps;
+    if (correspondences && !maps.read(job.correspondencePath, error))
+        return failed(result, error);
+    ThreadPool pool(correspondences ? job.numThreads : 1);
+    VertexCorrespondence computed;
+
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    //Frames are read, tracked and written out on three threads at once,
+    //up to pipelineDepth frames apart.
+    FramePipeline pipeline(job.pipelineDepth);
+    std::vector<TakeSlot> slots(pipeline.numSlots());
+    for (TakeSlot& slot : slots)
+    {
+        slot.positions.resize(engine.numJoints());
+        slot.tracked.resize(engine.numJoints());
+    }
+
+    auto produce = [&](unsigned i, unsigned s) {
+        TakeSlot& slot = slots[s];
+        slot.current = TrackFrame();
+        slot.next = TrackFrame();
+        {
+            PROFILE_SCOPE("loadFrames");
+            //The track stage may still be up to numSlots() frames back, on
+            //the frame before that one, so frames are released only once
+            //it is past them.
+            unsigned behind = (correspondences ? 2 : 1) + pipeline.numSlots();
+            cache.setWindow(i > behind ? i - behind : 0, i + 1);
+            cache.frame(i, slot.current);
+            cache.frame(i + 1, slot.next);
+        }
+
+        //The first frame of a new topology is carried over from the last
+        //frame of the old one, moving as it did from the frame before.
+        TrackFrame& current = slot.current;
+        TrackFrame previous;
+        if (correspondences && i > first && cache.entry(i).topologyFrame != cache.entry(i - 1).topologyFrame
+            && cache.frame(i - 1, previous) && previous.topology != current.topology)
+        {
+            TrackFrame before;
+            bool hasBefore = i > 1 && cache.entry(i - 2).topologyFrame == cache.entry(i - 1).topologyFrame
+                             && cache.frame(i - 2, before);
+            uint64_t from = frameFingerprint(previous.topology, previous.points, previous.numVertices);
+            uint64_t to = frameFingerprint(current.topology, current.points, current.numVertices);
+            current.fromPrevious = maps.find(from, to);
+            if (current.fromPrevious != nullptr)
+            {
+                result.mapsReused++;
+            }
+            else
+            {
+                computeCorrespondence(previous, current, hasBefore ? &before : nullptr, pool, computed);
+                current.fromPrevious = maps.add(from, to, computed);
+                result.mapsComputed++;
+            }
+        }
+        return true;
+    };
+
+    //The engine is only touched here, so the trajectory and checkpoints
+    //are kept on this stage too.
+    std::string trackError;
+    auto track = [&](unsigned i, unsigned s) {
+        TakeSlot& slot = slots[s];
+        {
+            PROFILE_SCOPE("track");
+            engine.trackFrame(slot.current, slot.next);
+        }
+        for (unsigned j = 0; j < engine.numJoints(); j++)
+        {
+            slot.tracked[j] = engine.jointTracked(j);
+            slot.positions[j] = engine.jointPosition(j);
+        }
+        if (!job.trajectoryPath.empty() || checkpoints)
+            trajectory.recordFrame(i - first, engine);
+
+        if (checkpoints && job.checkpointInterval > 0 && (i + 1 - first) % job.checkpointInterval == 0 && i + 1 < last)
+        {
+            PROFILE_SCOPE("checkpoint");
+            TrackingState state;
+            engine.saveState(state);
+            if (!writeCheckpoint(job.checkpointPath, firstCached + i + 1, state, trajectory, trackError))
+                return false;
+        }
+        return true;
+    };
+
+    auto collect = [&](unsigned i, unsigned s) {
+        const TakeSlot& slot = slots[s];
+        PROFILE_SCOPE("output");
+        double frameNumber = firstCached + i;
+        for (unsigned j = 0; j < slot.tracked.size(); j++)
+        {
+            if (!slot.tracked[j])
+            {
+                result.lost++;
+                continue;
+            }
+            if (output.is_open())
+            {
+                const Vec3& p = slot.positions[j];
+                output << frameNumber << "," << j + 1 << "," << p.x << "," << p.y << "," << p.z << "\n";
+            }
+        }
+        Profiler::endFrame();
+        return true;
+    };
+
+    //Same range as jointRig: every frame before endFrame, with endFrame
+    //itself only read as the next frame.
+    if (!pipeline.run(resumeFrom, std::max(resumeFrom, last), produce, track, collect))
+        return failed(result, trackError);
+    for (unsigned s = 0; s < FramePipeline::kNumStages; s++)
+        result.stageSeconds[s] = pipeline.busySeconds((FramePipeline::Stage)s);
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    result.numJoints = engine.numJoints();
+    result.numFrames = last > first ? last - first : 0;
+    result.topologyChanges = engine.topologyChanges();
+    result.numThreads = engine.numThreads();
+
+    if (!job.trajectoryPath.empty() && !trajectory.write(job.trajectoryPath, error))
+        return failed(result, error);
+    if (output.is_open() && !output.flush())
+        return failed(result, "could not write " + job.csvPath);
+    if (checkpoints)
+        std::remove(job.checkpointPath.c_str());
+    if (maps.added() > 0
+        && !maps.write(job.correspondenceOutput.empty() ? job.correspondencePath : job.correspondenceOutput, error))
+        return failed(result, error);
+
+    result.ok = true;
+    return result;
+}
+
+bool splitTake(const TakeJob& job, unsigned chunkFrames, unsigned overlap, std::vector<TakeJob>& chunks,
+               std::string& error)
+{
+    PointCacheStream cache;
+    if (!cache.open(job.cachePath))
+    {
+        error = cache.error();
+        return false;
+    }
+
+    //The same range trackTake() would track.
+    double firstCached = cache.startFrame();
+    double lastCached = firstCached + cache.numFrames() - 1;
+    double startFrame = job.startFrame < firstCached ? firstCached : job.startFrame;
+    double endFrame = job.endFrame < 0 || job.endFrame > lastCached ? lastCached : job.endFrame;
+    unsigned first = (unsigned)(startFrame - firstCached);
+    unsigned last = (unsigned)(endFrame - firstCached);
+
+    //Chunks that start on a new mesh track from the vertex sets carried
+    //over to it by the maps trackTake() carries points with. Maps the
+    //correspondence file lacks are saved to it for the chunks to reuse.
+    std::vector<std::vector<int>> takeSets;
+    if (!readVertexSets(job.setsPath, takeSets, error))
+        return false;
+    std::vector<std::vector<int>> sets = takeSets;
+    CorrespondenceCache maps;
+    if (!job.correspondencePath.empty() && !maps.read(job.correspondencePath, error))
+        return false;
+    ThreadPool pool(job.numThreads);
+    unsigned carriedTo = first;
+
+    chunks.clear();
+    unsigned numChunks = chunkFrames > 0 && last > first ? (last - first + chunkFrames - 1) / chunkFrames : 1;
+    for (unsigned c = 0; c < numChunks; c++)
+    {
+        unsigned start = first + c * chunkFrames;
+        unsigned warmup = c == 0 ? first : start - std::min(overlap, start - first);
+        //The first two frames of a chunk are read by vertex ID, so they
+        //start no later than the frame before a change of mesh.
+        while (warmup > first && cache.entry(warmup + 1).topologyFrame != cache.entry(warmup).topologyFrame)
+            warmup--;
+        if (!carrySets(cache, carriedTo, warmup, maps, pool, sets, error))
+        {
+            error = job.cachePath + ": chunk " + std::to_string(c + 1) + ": " + error;
+            return false;
+        }
+        carriedTo = warmup;
+
+        TakeJob chunk = job;
+        if (sets != takeSets)
+            chunk.startSets = sets;
+        chunk.startFrame = firstCached + warmup;
+        chunk.endFrame = c + 1 < numChunks ? firstCached + start + chunkFrames : endFrame;
+        chunk.trajectoryPath = chunkTrajectoryPath(job.trajectoryPath, c);
+        chunk.csvPath.clear();
+        chunk.checkpointPath.clear();
+        if (!job.correspondencePath.empty())
+            chunk.correspondenceOutput = chunkTrajectoryPath(job.correspondencePath, c);
+        std::ostringstream name;
+        name << job.name << " [" << c + 1 << "/" << numChunks << "]";
+        chunk.name = name.str();
+        chunks.push_back(chunk);
+    }
+    return job.correspondencePath.empty() || maps.added() == 0 || maps.write(job.correspondencePath, error);
+}
+
+std::string chunkTrajectoryPath(const std::string& trajectoryPath, unsigned chunk)
+{
+    std::ostringstream path;
+    path << trajectoryPath << ".chunk" << chunk + 1;
+    return path.str();
+}
+
+TakeResult joinTake(const TakeJob& job, const std::vector<TakeJob>& chunks, const std::vector<TakeResult>& results)
+{
+    TakeResult result;
+    std::vector<std::string> paths;
+    for (size_t c = 0; c < chunks.size(); c++)
+    {
+        if (!results[c].ok)
+            return failed(result, chunks[c].name + ": " + results[c].error);
+
+        //Chunks run side by side, so the take took as long as the longest.
+        //Joints lost in an overlap count once per chunk.
+        result.numJoints = results[c].numJoints;
+        result.lost += results[c].lost;
+        result.topologyChanges += results[c].topologyChanges;
+        result.numThreads += results[c].numThreads;
+        result.seconds = std::max(result.seconds, results[c].seconds);
+        result.mapsReused += results[c].mapsReused;
+        result.mapsComputed += results[c].mapsComputed;
+        for (unsigned s = 0; s < FramePipeline::kNumStages; s++)
+            result.stageSeconds[s] += results[c].stageSeconds[s];
+        paths.push_back(chunks[c].trajectoryPath);
+    }
+
+    std::string error;
+    bool stitched = stitchTrajectories(paths, job.trajectoryPath, error);
+    for (const std::string& path : paths)
+        std::remove(path.c_str());
+    if (!stitched)
+        return failed(result, error);
+
+    //Chunks only wrote the maps they computed; the take keeps them all.
+    if (!job.correspondencePath.empty())
+    {
+        CorrespondenceCache maps;
+        if (!maps.read(job.correspondencePath, error))
+            return failed(result, error);
+        bool merged = true;
+        for (const TakeJob& chunk : chunks)
+        {
+            CorrespondenceCache chunkMaps;
+            merged = merged && chunkMaps.read(chunk.correspondenceOutput, error);
+            maps.merge(chunkMaps);
+            std::remove(chunk.correspondenceOutput.c_str());
+        }
+        if (!merged || (maps.added() > 0 && !maps.write(job.correspondencePath, error)))
+            return failed(result, error);
+    }
+
+    TrajectoryReader reader;
+    if (!reader.open(job.trajectoryPath))
+        return failed(result, reader.error());
+    result.numFrames = reader.numFrames();
+
+    result.ok = true;
+    return result;
+}
+
+bool readTakeManifest(const std::string& path, std::vector<TakeJob>& jobs, std::string& error)
+{
+    std::ifstream file(path.c_str());
+    if (!file)
+    {
+        error = "could not open " + path;
+        return false;
+    }
+
+    std::string directory = path.substr(0, fileNameStart(path));
+    jobs.clear();
+    std::string line;
+    unsigned lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#')
+            continue;
+
+        std::istringstream fields(line);
+        std::vector<std::string> values;
+        std::string value;
+        while (fields >> value)
+            values.push_back(value);
+
+        if (values.size() > 3)
+        {
+            std::ostringstream message;
+            message << path << ":" << lineNumber << ": expected cache [sets [trajectory]]";
+            error = message.str();
+            return false;
+        }
+
+        TakeJob job;
+        job.cachePath = resolve(directory, values[0]);
+        job.name = job.cachePath.substr(fileNameStart(job.cachePath));
+        job.setsPath = values.size() > 1 && values[1] != "-" ? resolve(directory, values[1])
+                                                            : vertexSetsPath(job.cachePath);
+        job.trajectoryPath = values.size() > 2 && values[2] != "-" ? resolve(directory, values[2])
+                                                                  : withExtension(job.cachePath, ".vjtr");
+        jobs.push_back(job);
+    }
+    return true;
+}
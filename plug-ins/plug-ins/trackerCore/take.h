@@ -0,0 +1,109 @@
+//
+// One take of a capture session: a point cache exported with jointRig
+// -exportCache, the vertex sets of its joints and where to write the
+// tracked result. trackTake() runs the whole take headless; jointTrack
+// runs one, jointTrackBatch runs a manifest of them in parallel.
+//
+// A take manifest is a text file with one take per line:
+//
+//   cache [sets [trajectory]]
+//
+// sets defaults to the cache's .sets file and trajectory to the cache path
+// with a .vjtr extension; "-" also asks for the default. Relative paths
+// are relative to the manifest. Lines starting with '#' are comments.
+//
+#ifndef TRACKERCORE_TAKE_H
+#define TRACKERCORE_TAKE_H
+
+#include "framePipeline.h"
+
+#include <string>
+#include <vector>
+
+struct TakeJob
+{
+    //Shown in progress reports, the cache file name by default.
+    std::string name;
+    std::string cachePath;
+    std::string setsPath;
+    //Outputs, each optional.
+    std::string trajectoryPath;
+    std::string csvPath;
+    //Scene frames, -1 for the cached range.
+    double startFrame = -1;
+    double endFrame = -1;
+    //Tracking threads for this take, 0 for one per core.
+    unsigned numThreads = 0;
+    //With a checkpoint path the track is saved there every
+    //checkpointInterval frames, and with resume it carries on from the
+    //checkpoint there rather than from the start. The checkpoint is
+    //removed once the take is done.
+    std::string checkpointPath;
+    unsigned checkpointInterval = 100;
+    bool resume = false;
+    //With a correspondence path, tracked points are carried over topology
+    //changes by the dense maps of correspondence.h, read from the file
+    //there. Maps the file lacks are computed and saved to
+    //correspondenceOutput, or back to the same file when that is empty.
+    std::string correspondencePath;
+    std::string correspondenceOutput;
+    //Frames read ahead of the one being tracked, see framePipeline.h. 0
+    //reads, tracks and writes out each frame in turn on one thread.
+    unsigned pipelineDepth = FramePipeline::kDefaultDepth;
+    //Vertex sets on the mesh of startFrame, when it is not the mesh the
+    //sets file was made on. splitTake() fills them in for chunks starting
+    //after a change to a new mesh. The trajectory records the sets file's.
+    std::vector<std::vector<int>> startSets;
+};
+
+struct TakeResult
+{
+    //False when the take could not be read or written, see error.
+    bool ok = false;
+    std::string error;
+    unsigned numJoints = 0;
+    unsigned numFrames = 0;
+    //Joint samples that lost track, over all frames.
+    unsigned lost = 0;
+    unsigned topologyChanges = 0;
+    unsigned numThreads = 0;
+    double seconds = 0;
+    //Frames read back from a checkpoint instead of tracked.
+    unsigned resumedFrames = 0;
+    //Topology changes carried over by a map from the correspondence
+    //file, and by one computed for this run.
+    unsigned mapsReused = 0;
+    unsigned mapsComputed = 0;
+    //Seconds spent reading, tracking and writing out frames, by
+    //FramePipeline::Stage. With the stages overlapping, the slowest one
+    //sets the pace.
+    double stageSeconds[FramePipeline::kNumStages] = {0, 0, 0};
+};
+
+TakeResult trackTake(const TakeJob& job);
+
+//Splits a take into chunks of about chunkFrames frames that can be
+//tracked independently, on other cores or machines, and joined again
+//with joinTake(). Each chunk starts tracking overlap frames before its
+//part of the take, so its filters have settled by then and the
+//trajectories can be crossfaded over the overlap. Chunks only write
+//trajectories, to chunkTrajectoryPath(), and correspondence maps, to
+//chunkTrajectoryPath() of the correspondence file. A chunk starts
+//earlier rather than have its first two frames on different meshes. One
+//starting on another mesh than the take's first frame gets the vertex
+//sets carried over to it in startSets, by the correspondence maps of
+//every change of mesh before it. Those are read from and saved to the take's
+//correspondence file when it has one, and computed here otherwise.
+//Splitting fails if a joint's set has no vertices left on a chunk's mesh.
+bool splitTake(const TakeJob& job, unsigned chunkFrames, unsigned overlap, std::vector<TakeJob>& chunks,
+               std::string& error);
+std::string chunkTrajectoryPath(const std::string& trajectoryPath, unsigned chunk);
+//Stitches the chunks' trajectories into the take's with
+//stitchTrajectories(), adds the chunks' new maps to the take's
+//correspondence file, removes the chunk files and sums up the chunks'
+//results.
+TakeResult joinTake(const TakeJob& job, const std::vector<TakeJob>& chunks, const std::vector<TakeResult>& results);
+
+bool readTakeManifest(const std::string& path, std::vector<TakeJob>& jobs, std::string& error);
+
+#endif //TRACKERCORE_TAKE_H
@@ -0,0 +1,165 @@
+#include "checkpoint.h"
+#include "testMesh.h"
+#include "topology.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+
+namespace
+{
+    const unsigned kColumns = 24;
+
+    std::vector<std::vector<int>> testSets()
+    {
+        return {{(int)(5 * kColumns + 3), (int)(5 * kColumns + 15)}, {(int)(12 * kColumns), (int)(12 * kColumns + 7),
+                                                                      (int)(14 * kColumns + 11)}};
+    }
+
+    //A sphere moving with constant acceleration, one mesh per frame.
+    std::vector<TestMesh> testFrames(unsigned numFrames)
+    {
+        std::vector<TestMesh> frames;
+        TestMesh mesh = makeSphere(20, kColumns, 1.0, Vec3());
+        for (unsigned i = 0; i < numFrames; i++)
+        {
+            frames.push_back(mesh);
+            translateMesh(mesh, Vec3(0.01 * i, 0.02, 0));
+        }
+        return frames;
+    }
+
+    TrackFrame fingerprinted(const TestMesh& mesh)
+    {
+        TrackFrame frame = mesh.trackFrame();
+        frame.topology = topologyFingerprint(frame.numVertices, frame.triangles, frame.numTriangles);
+        return frame;
+    }
+
+    void track(TrackingEngine& engine, const std::vector<TestMesh>& frames, unsigned first, unsigned last,
+               TrajectoryWriter& trajectory)
+    {
+        for (unsigned i = first; i < last; i++)
+        {
+            engine.trackFrame(fingerprinted(frames[i]), fingerprinted(frames[i + 1]));
+            trajectory.recordFrame(i, engine);
+        }
+    }
+}
+
+TEST(Checkpoint, CarriesTheTrackOnWhereItStopped)
+{
+    std::vector<TestMesh> frames = testFrames(13);
+    std::string path = ::testing::TempDir() + "track.vjcp";
+
+    TrackingEngine straight(2);
+    straight.setJoints(testSets());
+    TrajectoryWriter straightTrajectory;
+    straightTrajectory.begin(1, 12, testSets());
+    track(straight, frames, 0, 12, straightTrajectory);
+
+    //Stop after frame 6 and save.
+    {
+        TrackingEngine engine(2);
+        engine.setJoints(testSets());
+        TrajectoryWriter trajectory;
+        trajectory.begin(1, 12, testSets());
+        track(engine, frames, 0, 7, trajectory);
+
+        TrackingState state;
+        engine.saveState(state);
+        std::string error;
+        ASSERT_TRUE(writeCheckpoint(path, 8, state, trajectory, error)) << error;
+    }
+
+    double nextFrame = 0;
+    TrackingState state;
+    TrajectoryWriter trajectory;
+    std::string error;
+    ASSERT_TRUE(readCheckpoint(path, nextFrame, state, trajectory, error)) << error;
+    EXPECT_EQ(nextFrame, 8.0);
+    EXPECT_EQ(state.vertexSets, testSets());
+    EXPECT_EQ(state.framesTracked, 7u);
+
+    TrackingEngine resumed(1);
+    ASSERT_TRUE(resumed.restoreState(state));
+    track(resumed, frames, 7, 12, trajectory);
+    EXPECT_EQ(resumed.framesTracked(), 12u);
+    EXPECT_EQ(resumed.topologyChanges(), 0u);
+
+    for (unsigned j = 0; j < 2; j++)
+    {
+        EXPECT_EQ(trajectory.columns(j), straightTrajectory.columns(j)) << "joint " << j;
+        EXPECT_EQ(resumed.jointSearchRadius(j), straight.jointSearchRadius(j));
+    }
+    std::remove(path.c_str());
+}
+
+TEST(Checkpoint, SearchesWhenTheTopologyIsUnknown)
+{
+    std::vector<TestMesh> frames = testFrames(10);
+    TrackingEngine engine(1);
+    engine.setJoints(testSets());
+    for (unsigned i = 0; i < 5; i++)
+        engine.trackFrame(frames[i].trackFrame(), frames[i + 1].trackFrame());
+
+    //Without fingerprints only the triangle pointer told the frames
+    //apart, and that is gone after a restore.
+    TrackingState state;
+    engine.saveState(state);
+    TrackingEngine resumed(1);
+    ASSERT_TRUE(resumed.restoreState(state));
+    ASSERT_TRUE(resumed.trackFrame(frames[5].trackFrame(), frames[6].trackFrame()));
+    EXPECT_EQ(resumed.topologyChanges(), state.topologyChanges + 1);
+
+    engine.trackFrame(frames[5].trackFrame(), frames[6].trackFrame());
+    for (unsigned j = 0; j < 2; j++)
+        EXPECT_LT((resumed.jointPosition(j) - engine.jointPosition(j)).length(), 1e-4);
+}
+
+TEST(Checkpoint, RejectsStatesThatDoNotFit)
+{
+    TrackingEngine engine(1);
+    engine.setJoints(testSets());
+    TrackingState state;
+    engine.saveState(state);
+    state.anchored.pop_back();
+
+    TrackingEngine other(1);
+    other.setJoints({{1, 2}});
+    EXPECT_FALSE(other.restoreState(state));
+    EXPECT_EQ(other.numJoints(), 1u);
+}
+
+TEST(Checkpoint, RejectsOtherAndTruncatedFiles)
+{
+    std::string path = ::testing::TempDir() + "bad.vjcp";
+    {
+        std::ofstream file(path.c_str(), std::ios::binary);
+        file << "not a checkpoint at all, just some text";
+    }
+    double nextFrame;
+    TrackingState state;
+    TrajectoryWriter trajectory;
+    std::string error;
+    EXPECT_FALSE(readCheckpoint(path, nextFrame, state, trajectory, error));
+    EXPECT_NE(error.find("is not a checkpoint"), std::string::npos) << error;
+
+    TrackingEngine engine(1);
+    engine.setJoints(testSets());
+    engine.saveState(state);
+    trajectory.begin(1, 10, testSets());
+    ASSERT_TRUE(writeCheckpoint(path, 1, state, trajectory, error)) << error;
+    {
+        std::ifstream in(path.c_str(), std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), bytes.size() - 8);
+    }
+    EXPECT_FALSE(readCheckpoint(path, nextFrame, state, trajectory, error));
+    EXPECT_NE(error.find("truncated"), std::string::npos) << error;
+
+    EXPECT_FALSE(readCheckpoint(path + ".missing", nextFrame, state, trajectory, error));
+    std::remove(path.c_str());
+}
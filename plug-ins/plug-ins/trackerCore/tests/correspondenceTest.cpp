@@ -0,0 +1,168 @@
+#include "correspondence.h"
+#include "testMesh.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+
+namespace
+{
+    Vec3 mapped(const TestMesh& mesh, const VertexCorrespondence& map, unsigned vertex)
+    {
+        Vec3 point;
+        for (unsigned k = 0; k < 3; k++)
+            point += mesh.vertex(map.anchors[vertex * 3 + k]) * map.weights[vertex * 3 + k];
+        return point;
+    }
+
+    //size x size grid of unit quads at height z, facing +z or -z.
+    void addGrid(TestMesh& mesh, unsigned size, float z, bool up)
+    {
+        int base = (int)mesh.numVertices();
+        for (unsigned y = 0; y <= size; y++)
+        {
+            for (unsigned x = 0; x <= size; x++)
+            {
+                float point[] = {(float)x, (float)y, z};
+                mesh.points.insert(mesh.points.end(), point, point + 3);
+            }
+        }
+        for (int y = 0; y < (int)size; y++)
+        {
+            for (int x = 0; x < (int)size; x++)
+            {
+                int a = base + y * (size + 1) + x;
+                int b = a + 1;
+                int c = a + size + 1;
+                int d = c + 1;
+                int quad[] = {a, b, d, a, d, c};
+                if (!up)
+                {
+                    std::swap(quad[1], quad[2]);
+                    std::swap(quad[4], quad[5]);
+                }
+                mesh.triangles.insert(mesh.triangles.end(), quad, quad + 6);
+            }
+        }
+    }
+}
+
+TEST(Correspondence, MatchesARemeshedSurface)
+{
+    TestMesh from = makeSphere(30, 40, 1.0, Vec3());
+    TestMesh to = makeSphere(37, 45, 1.0, Vec3(0.01, 0, 0));
+    ThreadPool pool(4);
+    VertexCorrespondence map;
+    ASSERT_EQ(computeCorrespondence(from.trackFrame(), to.trackFrame(), nullptr, pool, map), from.numVertices());
+
+    for (unsigned v = 0; v < from.numVertices(); v++)
+    {
+        ASSERT_TRUE(map.matched(v)) << v;
+        EXPECT_LT((mapped(to, map, v) - from.vertex(v)).length(), 0.02) << v;
+        EXPECT_NEAR(map.weights[v * 3] + map.weights[v * 3 + 1] + map.weights[v * 3 + 2], 1, 1e-5) << v;
+    }
+}
+
+TEST(Correspondence, SkipsSurfacesFacingAway)
+{
+    //A palm over a thigh: the palm's vertices face down, and on the new
+    //frame the thigh has come closer than the new palm has.
+    TestMesh from;
+    addGrid(from, 4, 0, false);
+    TestMesh to;
+    addGrid(to, 4, 0.5f, false);
+    addGrid(to, 4, -0.1f, true);
+
+    ThreadPool pool(1);
+    VertexCorrespondence map;
+    ASSERT_EQ(computeCorrespondence(from.trackFrame(), to.trackFrame(), nullptr, pool, map), from.numVertices());
+    for (unsigned v = 0; v < from.numVertices(); v++)
+    {
+        EXPECT_LT(map.anchors[v * 3], 25) << v;
+        EXPECT_NEAR(mapped(to, map, v).z, 0.5, 1e-6) << v;
+    }
+
+    //Out of reach, nothing matches.
+    CorrespondenceOptions options;
+    options.maxDistance = 0.25;
+    EXPECT_EQ(computeCorrespondence(from.trackFrame(), to.trackFrame(), nullptr, pool, map, options), 0u);
+    EXPECT_FALSE(map.matched(0));
+}
+
+TEST(Correspondence, CarriesVertexSets)
+{
+    //Old vertex 0 lands on new 5, 1 next to it on new 5 again, 2 on new 8
+    //and 3 on nothing.
+    VertexCorrespondence map;
+    map.anchors = {4, 5, 6, 5, 7, 6, 8, 9, 4, -1, -1, -1};
+    map.weights = {0.2f, 0.7f, 0.1f, 0.6f, 0.3f, 0.1f, 0.5f, 0.3f, 0.2f, 0, 0, 0};
+
+    //Every point keeps its place in its set.
+    std::vector<std::vector<int>> carried = carryVertexSets({{0, 1, 2}, {3}, {3, 2, 7}}, map);
+    ASSERT_EQ(carried.size(), 3u);
+    EXPECT_EQ(carried[0], std::vector<int>({5, 5, 8}));
+    EXPECT_TRUE(carried[1].empty());
+    EXPECT_EQ(carried[2], std::vector<int>({8, 8, 8}));
+}
+
+TEST(Correspondence, CacheRoundTrips)
+{
+    TestMesh from = makeSphere(10, 12, 1.0, Vec3());
+    TestMesh to = makeSphere(11, 13, 1.0, Vec3());
+    ThreadPool pool(1);
+    VertexCorrespondence map;
+    computeCorrespondence(from.trackFrame(), to.trackFrame(), nullptr, pool, map);
+
+    std::string path = ::testing::TempDir() + "correspondence_test.vjcr";
+    std::remove(path.c_str());
+    std::string error;
+    CorrespondenceCache cache;
+    EXPECT_TRUE(cache.read(path, error)) << error;
+    EXPECT_EQ(cache.size(), 0u);
+    cache.add(7, 9, map);
+    cache.add(7, 9, VertexCorrespondence());
+    EXPECT_EQ(cache.added(), 1u);
+    ASSERT_TRUE(cache.write(path, error)) << error;
+
+    CorrespondenceCache back;
+    ASSERT_TRUE(back.read(path, error)) << error;
+    EXPECT_EQ(back.added(), 0u);
+    EXPECT_EQ(back.find(9, 7), nullptr);
+    const VertexCorrespondence* found = back.find(7, 9);
+    ASSERT_NE(found, nullptr);
+    EXPECT_EQ(found->anchors, map.anchors);
+    EXPECT_EQ(found->weights, map.weights);
+
+    CorrespondenceCache merged;
+    merged.add(1, 2, map);
+    merged.merge(back);
+    EXPECT_EQ(merged.size(), 2u);
+    std::remove(path.c_str());
+}
+
+TEST(Correspondence, RejectsBadFiles)
+{
+    std::string path = ::testing::TempDir() + "correspondence_bad.vjcr";
+    {
+        std::ofstream file(path.c_str(), std::ios::binary);
+        file << "not a correspondence file";
+    }
+    CorrespondenceCache cache;
+    std::string error;
+    EXPECT_FALSE(cache.read(path, error));
+    EXPECT_NE(error.find("is not a correspondence file"), std::string::npos) << error;
+
+    //A map header promising more vertices than the file holds.
+    {
+        std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+        CorrespondenceHeader header = {{'V', 'J', 'C', 'R'}, kCorrespondenceVersion, 1, 0};
+        CorrespondenceMapHeader map = {1, 2, 1000000, 0};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(&map), sizeof(map));
+    }
+    EXPECT_FALSE(cache.read(path, error));
+    EXPECT_NE(error.find("is truncated"), std::string::npos) << error;
+    EXPECT_EQ(cache.size(), 0u);
+    std::remove(path.c_str());
+}
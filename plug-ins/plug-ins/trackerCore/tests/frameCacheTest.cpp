@@ -0,0 +1,159 @@
+#include "frameCache.h"
+#include "syntheticCapture.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    CachedFrame cachedFrame(const SyntheticCapture& capture, unsigned f, std::vector<float>& points)
+    {
+        TrackFrame frame = capture.frame(f, points);
+        CachedFrame cached;
+        cached.time = f;
+        cached.numVertices = frame.numVertices;
+        cached.topology = frame.topology;
+        cached.fingerprint = f + 100;
+        return cached;
+    }
+
+    //Largest difference between a decoded frame and the one added.
+    float decodeError(FrameCache& cache, const SyntheticCapture& capture, unsigned f)
+    {
+        std::vector<float> expected;
+        capture.frame(f, expected);
+        std::vector<float> points;
+        const CachedFrame* frame = cache.decode(f, points);
+        EXPECT_TRUE(frame != NULL) << "frame " << f;
+        if (frame == NULL || points.size() != expected.size())
+            return INFINITY;
+        EXPECT_EQ(frame->numVertices * 3, points.size());
+        EXPECT_EQ(frame->fingerprint, f + 100);
+
+        float error = 0;
+        for (size_t i = 0; i < points.size(); i++)
+            error = std::max(error, std::fabs(points[i] - expected[i]));
+        return error;
+    }
+
+    void fill(FrameCache& cache, const SyntheticCapture& capture, unsigned first, unsigned last)
+    {
+        std::vector<float> points;
+        for (unsigned f = first; f < last; f++)
+        {
+            CachedFrame frame = cachedFrame(capture, f, points);
+            cache.add(frame, points.data());
+        }
+    }
+}
+
+TEST(FrameCache, DecodesWithinAStep)
+{
+    CaptureOptions options;
+    options.numFrames = 40;
+    SyntheticCapture capture(options);
+    FrameCache cache(64);
+    fill(cache, capture, 0, 40);
+    EXPECT_EQ(cache.size(), 40u);
+
+    //Forward, which reads on from the last frame, then out of order.
+    for (unsigned f = 0; f < 40; f++)
+        EXPECT_LE(decodeError(cache, capture, f), cache.step(f)) << "frame " << f;
+    const unsigned order[] = {39, 3, 17, 16, 0, 31, 32, 15};
+    for (unsigned f : order)
+        EXPECT_LE(decodeError(cache, capture, f), cache.step(f)) << "frame " << f;
+
+    //Well under a tenth of a millimetre.
+    EXPECT_LT(cache.step(0), 0.01f);
+}
+
+TEST(FrameCache, StartsARunOnANewMesh)
+{
+    CaptureOptions options;
+    options.numFrames = 30;
+    options.remeshInterval = 10;
+    SyntheticCapture capture(options);
+    FrameCache cache(30);
+    fill(cache, capture, 0, 30);
+
+    for (unsigned f = 0; f < 30; f++)
+        EXPECT_LE(decodeError(cache, capture, f), cache.step(f)) << "frame " << f;
+    std::vector<float> points;
+    EXPECT_EQ(cache.decode(9, points)->numVertices, capture.numVertices(9));
+    EXPECT_EQ(cache.decode(10, points)->numVertices, capture.numVertices(10));
+}
+
+TEST(FrameCache, DropsTheOldestFrames)
+{
+    SyntheticCapture capture;
+    FrameCache cache(5);
+    fill(cache, capture, 0, 12);
+    EXPECT_EQ(cache.size(), 5u);
+    EXPECT_TRUE(cache.find(6) == NULL);
+
+    //The frames left were stored as changes from the ones dropped.
+    for (unsigned f = 11; f >= 7; f--)
+        EXPECT_LE(decodeError(cache, capture, f), cache.step(f)) << "frame " << f;
+
+    cache.setCapacity(2);
+    EXPECT_EQ(cache.size(), 2u);
+    EXPECT_LE(decodeError(cache, capture, 10), cache.step(10));
+
+    cache.setCapacity(0);
+    fill(cache, capture, 0, 2);
+    EXPECT_EQ(cache.size(), 0u);
+    EXPECT_EQ(cache.bytes(), 0u);
+}
+
+TEST(FrameCache, ReplacesAFrameAddedAgain)
+{
+    SyntheticCapture capture;
+    FrameCache cache(10);
+    fill(cache, capture, 0, 4);
+
+    //Frame 9 added again as frame 2.
+    std::vector<float> points;
+    CachedFrame frame = cachedFrame(capture, 9, points);
+    frame.time = 2;
+    cache.add(frame, points.data());
+    EXPECT_EQ(cache.find(2)->fingerprint, 109u);
+
+    std::vector<float> decoded;
+    cache.decode(2, decoded);
+    ASSERT_EQ(decoded.size(), points.size());
+    for (size_t i = 0; i < points.size(); i++)
+        ASSERT_NEAR(decoded[i], points[i], cache.step(2));
+    EXPECT_LE(decodeError(cache, capture, 3), cache.step(3));
+}
+
+TEST(FrameCache, HoldsLessThanFloats)
+{
+    CaptureOptions options;
+    options.numFrames = 48;
+    options.resolution = 64;
+    SyntheticCapture capture(options);
+    FrameCache cache(48);
+    fill(cache, capture, 0, 48);
+
+    //No frame costs more than its 16 bit codes and a byte a block, about
+    //half its floats, even where the capture moves too fast for its
+    //changes to fit in a byte.
+    size_t floats = (size_t)48 * capture.numVertices(0) * 3 * sizeof(float);
+    EXPECT_LT(cache.bytes(), floats * 0.55);
+
+    //A performer holding still costs a byte a block.
+    FrameCache still(4);
+    std::vector<float> points;
+    CachedFrame frame = cachedFrame(capture, 0, points);
+    for (unsigned f = 0; f < 3; f++)
+    {
+        frame.time = f;
+        still.add(frame, points.data());
+    }
+    size_t before = still.bytes();
+    frame.time = 3;
+    still.add(frame, points.data());
+    EXPECT_LT(still.bytes() - before, points.size() / 8);
+}
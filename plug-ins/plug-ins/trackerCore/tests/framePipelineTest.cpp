@@ -0,0 +1,193 @@
+#include "framePipeline.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    void pause(unsigned milliseconds)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+    }
+}
+
+TEST(FramePipeline, RunsEveryFrameThroughEveryStageInOrder)
+{
+    FramePipeline pipeline(3);
+    ASSERT_EQ(pipeline.numSlots(), 3u);
+
+    //The frame in each slot, -1 once collected.
+    std::vector<int> slots(pipeline.numSlots(), -1);
+    std::vector<unsigned> produced;
+    std::vector<unsigned> tracked;
+    std::vector<unsigned> collected;
+    std::atomic<int> inFlight(0);
+    std::atomic<int> mostInFlight(0);
+    bool ok = pipeline.run(
+        5, 45,
+        [&](unsigned frame, unsigned slot) {
+            EXPECT_EQ(slots[slot], -1) << frame;
+            slots[slot] = (int)frame;
+            produced.push_back(frame);
+            int count = ++inFlight;
+            if (count > mostInFlight)
+                mostInFlight = count;
+            return true;
+        },
+        [&](unsigned frame, unsigned slot) {
+            EXPECT_EQ(slots[slot], (int)frame);
+            tracked.push_back(frame);
+            if (frame % 7 == 0)
+                pause(1);
+            return true;
+        },
+        [&](unsigned frame, unsigned slot) {
+            EXPECT_EQ(slots[slot], (int)frame);
+            slots[slot] = -1;
+            collected.push_back(frame);
+            inFlight--;
+            return true;
+        });
+    ASSERT_TRUE(ok);
+    EXPECT_EQ(pipeline.failedStage(), FramePipeline::kNumStages);
+
+    ASSERT_EQ(collected.size(), 40u);
+    for (unsigned i = 0; i < 40; i++)
+    {
+        EXPECT_EQ(produced[i], 5 + i);
+        EXPECT_EQ(tracked[i], 5 + i);
+        EXPECT_EQ(collected[i], 5 + i);
+    }
+    EXPECT_LE(mostInFlight.load(), 3);
+}
+
+TEST(FramePipeline, StopsWhenAStageFails)
+{
+    FramePipeline pipeline(2);
+    std::atomic<unsigned> lastCollected(0);
+    std::atomic<unsigned> lastProduced(0);
+    bool ok = pipeline.run(
+        0, 100,
+        [&](unsigned frame, unsigned) {
+            lastProduced = frame;
+            return true;
+        },
+        [&](unsigned frame, unsigned) { return frame != 10; },
+        [&](unsigned frame, unsigned) {
+            lastCollected = frame;
+            return true;
+        });
+    EXPECT_FALSE(ok);
+    EXPECT_EQ(pipeline.failedStage(), FramePipeline::kTrack);
+    EXPECT_EQ(lastCollected.load(), 9u);
+    //The producer can only have run as far ahead as the ring allows.
+    EXPECT_LE(lastProduced.load(), 12u);
+}
+
+TEST(FramePipeline, RunsChosenStagesOnTheCaller)
+{
+    FramePipeline pipeline;
+    pipeline.runOnCaller(FramePipeline::kProduce);
+    pipeline.runOnCaller(FramePipeline::kCollect);
+
+    std::thread::id caller = std::this_thread::get_id();
+    std::mutex mutex;
+    std::vector<std::thread::id> trackers;
+    unsigned frames = 0;
+    bool ok = pipeline.run(
+        0, 50,
+        [&](unsigned, unsigned) {
+            EXPECT_EQ(std::this_thread::get_id(), caller);
+            return true;
+        },
+        [&](unsigned, unsigned) {
+            std::lock_guard<std::mutex> lock(mutex);
+            trackers.push_back(std::this_thread::get_id());
+            return true;
+        },
+        [&](unsigned, unsigned) {
+            EXPECT_EQ(std::this_thread::get_id(), caller);
+            frames++;
+            return true;
+        });
+    ASSERT_TRUE(ok);
+    EXPECT_EQ(frames, 50u);
+    ASSERT_EQ(trackers.size(), 50u);
+    EXPECT_NE(trackers[0], caller);
+
+    //A failure on the caller stops the other threads too.
+    ok = pipeline.run(
+        0, 50, [&](unsigned frame, unsigned) { return frame < 20; }, [&](unsigned, unsigned) { return true; },
+        [&](unsigned, unsigned) { return true; });
+    EXPECT_FALSE(ok);
+    EXPECT_EQ(pipeline.failedStage(), FramePipeline::kProduce);
+}
+
+TEST(FramePipeline, DepthZeroIsAPlainLoop)
+{
+    FramePipeline pipeline(0);
+    EXPECT_TRUE(pipeline.sequential());
+    EXPECT_EQ(pipeline.numSlots(), 1u);
+
+    std::thread::id caller = std::this_thread::get_id();
+    std::vector<int> calls;
+    auto stage = [&](int id) {
+        return [&, id](unsigned frame, unsigned slot) {
+            EXPECT_EQ(slot, 0u);
+            EXPECT_EQ(std::this_thread::get_id(), caller);
+            calls.push_back((int)frame * 10 + id);
+            return true;
+        };
+    };
+    ASSERT_TRUE(pipeline.run(1, 3, stage(0), stage(1), stage(2)));
+    std::vector<int> expected = {10, 11, 12, 20, 21, 22};
+    EXPECT_EQ(calls, expected);
+
+    EXPECT_TRUE(pipeline.run(4, 4, stage(0), stage(1), stage(2)));
+    EXPECT_EQ(calls.size(), 6u);
+}
+
+TEST(FramePipeline, OverlapsTheStages)
+{
+    //When each stage runs, by stage and frame. A stage of one frame runs
+    //alongside the stage before it of the next frame, which a loop never
+    //does. Checked on the times rather than the total, which depends on
+    //how loaded the machine is.
+    typedef std::chrono::steady_clock Clock;
+    const unsigned numFrames = 30;
+    std::vector<Clock::time_point> starts[FramePipeline::kNumStages];
+    std::vector<Clock::time_point> ends[FramePipeline::kNumStages];
+    for (unsigned s = 0; s < FramePipeline::kNumStages; s++)
+    {
+        starts[s].resize(numFrames);
+        ends[s].resize(numFrames);
+    }
+    auto stage = [&](unsigned s) {
+        return [&, s](unsigned frame, unsigned) {
+            starts[s][frame] = Clock::now();
+            pause(4);
+            ends[s][frame] = Clock::now();
+            return true;
+        };
+    };
+    FramePipeline pipeline;
+    ASSERT_TRUE(pipeline.run(0, numFrames, stage(FramePipeline::kProduce), stage(FramePipeline::kTrack),
+                             stage(FramePipeline::kCollect)));
+    EXPECT_GE(pipeline.busySeconds(FramePipeline::kTrack), numFrames * 0.004);
+
+    for (unsigned s = 1; s < FramePipeline::kNumStages; s++)
+    {
+        unsigned overlapping = 0;
+        for (unsigned f = 0; f + 1 < numFrames; f++)
+        {
+            if (starts[s][f] < ends[s - 1][f + 1] && starts[s - 1][f + 1] < ends[s][f])
+                overlapping++;
+        }
+        EXPECT_GT(overlapping, 0u) << "stage " << s;
+    }
+}
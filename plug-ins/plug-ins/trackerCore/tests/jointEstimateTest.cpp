@@ -0,0 +1,93 @@
+#include "jointEstimate.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    struct PointArrays
+    {
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+
+        void add(const Vec3& point)
+        {
+            x.push_back((float)point.x);
+            y.push_back((float)point.y);
+            z.push_back((float)point.z);
+        }
+        unsigned size() const { return (unsigned)x.size(); }
+    };
+
+    //Ring of points around a limb cross-section.
+    PointArrays crossSection(unsigned count, const Vec3& centre, double radius)
+    {
+        PointArrays points;
+        for (unsigned i = 0; i < count; i++)
+        {
+            double angle = 2 * 3.14159265358979323846 * i / count;
+            points.add(centre + Vec3(radius * std::cos(angle), 0, radius * std::sin(angle)));
+        }
+        return points;
+    }
+}
+
+TEST(JointEstimate, TwoPointsGiveTheirMidpoint)
+{
+    PointArrays points;
+    points.add(Vec3(1, 2, 3));
+    points.add(Vec3(3, 6, -1));
+    std::vector<float> weights(2);
+
+    Vec3 centre = robustCentroid(points.x.data(), points.y.data(), points.z.data(), 2, weights.data());
+    EXPECT_NEAR(centre.x, 2, 1e-6);
+    EXPECT_NEAR(centre.y, 4, 1e-6);
+    EXPECT_NEAR(centre.z, 1, 1e-6);
+}
+
+TEST(JointEstimate, RingCentreAtAnyCount)
+{
+    //Counts on and off the 4 wide vector width.
+    const Vec3 expected(120.5, 87.25, -40);
+    for (unsigned count : {3u, 4u, 5u, 7u, 64u, 257u})
+    {
+        PointArrays points = crossSection(count, expected, 4.0);
+        std::vector<float> weights(count);
+        Vec3 centre = robustCentroid(points.x.data(), points.y.data(), points.z.data(), count, weights.data());
+        EXPECT_LT((centre - expected).length(), 1e-4) << count << " points";
+        for (float weight : weights)
+            EXPECT_FLOAT_EQ(weight, 1.0f);
+    }
+}
+
+TEST(JointEstimate, OutlierIsDownWeighted)
+{
+    const Vec3 expected(0, 10, 0);
+    PointArrays points = crossSection(40, expected, 1.0);
+    //A closest point hit on the wrong limb.
+    points.add(Vec3(30, 10, 0));
+    unsigned count = points.size();
+    std::vector<float> weights(count);
+
+    Vec3 centre = robustCentroid(points.x.data(), points.y.data(), points.z.data(), count, weights.data());
+    double meanError = 30.0 / count;
+    EXPECT_LT((centre - expected).length(), meanError / 4);
+    EXPECT_LT(weights.back(), 0.2f);
+    EXPECT_FLOAT_EQ(weights.front(), 1.0f);
+}
+
+TEST(JointEstimate, CoincidentPoints)
+{
+    PointArrays points;
+    for (int i = 0; i < 6; i++)
+        points.add(Vec3(5, 5, 5));
+    std::vector<float> weights(6);
+
+    Vec3 centre = robustCentroid(points.x.data(), points.y.data(), points.z.data(), 6, weights.data());
+    EXPECT_EQ(centre.x, 5);
+    EXPECT_EQ(centre.z, 5);
+    EXPECT_EQ(robustCentroid(nullptr, nullptr, nullptr, 0, nullptr).length(), 0);
+}
@@ -0,0 +1,187 @@
+#include "landmarks.h"
+#include "testMesh.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <tuple>
+
+namespace
+{
+    struct Box
+    {
+        int min[3];
+        int max[3];
+    };
+
+    //Surface of a union of boxes, built from cubes of 1 / resolution box
+    //units with vertices shared at the cube corners.
+    class VoxelFigure
+    {
+    public:
+        explicit VoxelFigure(int resolution) : m_resolution(resolution) {}
+
+        void add(const Box& box)
+        {
+            for (int x = box.min[0] * m_resolution; x < box.max[0] * m_resolution; x++)
+                for (int y = box.min[1] * m_resolution; y < box.max[1] * m_resolution; y++)
+                    for (int z = box.min[2] * m_resolution; z < box.max[2] * m_resolution; z++)
+                        m_voxels[std::make_tuple(x, y, z)] = true;
+        }
+
+        TestMesh mesh(double scale)
+        {
+            scale /= m_resolution;
+            TestMesh mesh;
+            std::map<std::tuple<int, int, int>, int> corners;
+            auto corner = [&](int x, int y, int z) {
+                auto found = corners.find(std::make_tuple(x, y, z));
+                if (found != corners.end())
+                    return found->second;
+                int id = (int)mesh.numVertices();
+                corners[std::make_tuple(x, y, z)] = id;
+                mesh.points.push_back((float)(x * scale));
+                mesh.points.push_back((float)(y * scale));
+                mesh.points.push_back((float)(z * scale));
+                return id;
+            };
+
+            for (const auto& voxel : m_voxels)
+            {
+                int cell[3] = {std::get<0>(voxel.first), std::get<1>(voxel.first), std::get<2>(voxel.first)};
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    for (int side = 0; side < 2; side++)
+                    {
+                        int neighbour[3] = {cell[0], cell[1], cell[2]};
+                        neighbour[axis] += side ? 1 : -1;
+                        if (m_voxels.count(std::make_tuple(neighbour[0], neighbour[1], neighbour[2])))
+                            continue;
+
+                        //Corners of the open face, walking around it.
+                        int u = (axis + 1) % 3;
+                        int v = (axis + 2) % 3;
+                        int quad[4];
+                        for (int k = 0; k < 4; k++)
+                        {
+                            int at[3] = {cell[0], cell[1], cell[2]};
+                            at[axis] += side;
+                            at[u] += (k == 1 || k == 2) ? 1 : 0;
+                            at[v] += (k >= 2) ? 1 : 0;
+                            quad[k] = corner(at[0], at[1], at[2]);
+                        }
+                        int triangles[] = {quad[0], quad[1], quad[2], quad[0], quad[2], quad[3]};
+                        mesh.triangles.insert(mesh.triangles.end(), triangles, triangles + 6);
+                    }
+                }
+            }
+            return mesh;
+        }
+
+    private:
+        int m_resolution;
+        std::map<std::tuple<int, int, int>, bool> m_voxels;
+    };
+
+    //Blocky figure standing on y = 0 with its arms out along x.
+    TestMesh stickFigure()
+    {
+        VoxelFigure figure(3);
+        figure.add({{0, 10, 0}, {6, 20, 3}});   //torso
+        figure.add({{0, 0, 0}, {2, 10, 2}});    //legs
+        figure.add({{4, 0, 0}, {6, 10, 2}});
+        figure.add({{-10, 17, 0}, {0, 19, 2}}); //arms
+        figure.add({{6, 17, 0}, {16, 19, 2}});
+        figure.add({{2, 20, 0}, {4, 26, 2}});   //head
+        return figure.mesh(0.1);
+    }
+}
+
+TEST(Landmarks, EmptyMeshHasNoLandmarks)
+{
+    EXPECT_TRUE(detectLandmarks(nullptr, 0, nullptr, 0).empty());
+}
+
+TEST(Landmarks, FindsLimbsOfFigure)
+{
+    TestMesh mesh = stickFigure();
+    LandmarkOptions options;
+    options.numThreads = 2;
+    std::vector<Landmark> landmarks =
+        detectLandmarks(mesh.points.data(), mesh.numVertices(), mesh.triangles.data(), mesh.numTriangles(), options);
+
+    //Arms, legs and head, three joints each, with each limb's joints together.
+    ASSERT_EQ(landmarks.size(), 15u);
+    for (unsigned i = 0; i < landmarks.size(); i++)
+    {
+        EXPECT_EQ(landmarks[i].limb, i / 3);
+        EXPECT_FALSE(landmarks[i].vertices.empty());
+        EXPECT_LE(landmarks[i].vertices.size(), options.maxSupportVertices);
+    }
+
+    //The last joint of each limb is near its tip.
+    unsigned head = 0, feet = 0, rightHand = 0, leftHand = 0;
+    for (unsigned i = 2; i < landmarks.size(); i += 3)
+    {
+        const Vec3& tip = landmarks[i].position;
+        if (tip.y > 2.3)
+            head++;
+        else if (tip.y < 0.3)
+            feet++;
+        else if (tip.x < -0.6)
+            rightHand++;
+        else if (tip.x > 1.2)
+            leftHand++;
+    }
+    EXPECT_EQ(head, 1u);
+    EXPECT_EQ(feet, 2u);
+    EXPECT_EQ(rightHand, 1u);
+    EXPECT_EQ(leftHand, 1u);
+
+    //Joints sit inside the limb, not on its surface.
+    for (unsigned i = 0; i < landmarks.size(); i += 3)
+    {
+        const Vec3& elbow = landmarks[i + 1].position;
+        EXPECT_GT(elbow.z, 0.05) << i;
+        EXPECT_LT(elbow.z, 0.25) << i;
+    }
+}
+
+TEST(Landmarks, SameResultOnAnyThreadCount)
+{
+    TestMesh mesh = stickFigure();
+    LandmarkOptions serial;
+    serial.numThreads = 1;
+    LandmarkOptions parallel;
+    parallel.numThreads = 4;
+    std::vector<Landmark> a =
+        detectLandmarks(mesh.points.data(), mesh.numVertices(), mesh.triangles.data(), mesh.numTriangles(), serial);
+    std::vector<Landmark> b =
+        detectLandmarks(mesh.points.data(), mesh.numVertices(), mesh.triangles.data(), mesh.numTriangles(), parallel);
+
+    ASSERT_EQ(a.size(), b.size());
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        EXPECT_EQ(a[i].vertices, b[i].vertices);
+        EXPECT_EQ(a[i].limb, b[i].limb);
+    }
+}
+
+TEST(Landmarks, IgnoresStrayPieces)
+{
+    TestMesh mesh = stickFigure();
+    TestMesh stray = makeSphere(6, 8, 0.2, Vec3(5, 5, 5));
+    int offset = (int)mesh.numVertices();
+    mesh.points.insert(mesh.points.end(), stray.points.begin(), stray.points.end());
+    for (int id : stray.triangles)
+        mesh.triangles.push_back(id + offset);
+
+    std::vector<Landmark> landmarks =
+        detectLandmarks(mesh.points.data(), mesh.numVertices(), mesh.triangles.data(), mesh.numTriangles());
+    ASSERT_EQ(landmarks.size(), 15u);
+    for (const Landmark& landmark : landmarks)
+    {
+        for (int v : landmark.vertices)
+            EXPECT_LT(v, offset);
+    }
+}
@@ -0,0 +1,168 @@
+#include "limbAngle.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+TEST(LimbAngle, LawOfCosines)
+{
+    EXPECT_NEAR(lawOfCosinesAngle(3, 4, 5), 90.0, 1e-9);
+    EXPECT_NEAR(lawOfCosinesAngle(1, 1, 1), 60.0, 1e-9);
+}
+
+TEST(LimbAngle, StraightAndFoldedLimbs)
+{
+    //Rounding must not push acos outside its domain.
+    EXPECT_NEAR(localJointAngle(Vec3(0, 0, 0), Vec3(0, 1, 0), Vec3(0, 2, 0)), 180.0, 1e-6);
+    EXPECT_NEAR(localJointAngle(Vec3(0, 0, 0), Vec3(0, 1, 0), Vec3(0, 0, 0)), 0.0, 1e-6);
+}
+
+TEST(LimbAngle, DegenerateSideGivesZero)
+{
+    EXPECT_EQ(lawOfCosinesAngle(0, 1, 1), 0.0);
+    EXPECT_DOUBLE_EQ(distance(Vec3(1, 2, 3), Vec3(1, 2, 5)), 2.0);
+}
+
+namespace
+{
+    //Joint positions over frames, stored the way the batch functions
+    //read them.
+    struct JointTrack
+    {
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+
+        void add(const Vec3& position)
+        {
+            x.push_back((float)position.x);
+            y.push_back((float)position.y);
+            z.push_back((float)position.z);
+        }
+
+        JointPositions positions() const
+        {
+            return {x.data(), y.data(), z.data()};
+        }
+    };
+}
+
+TEST(LimbAngle, BatchMatchesSingleAngles)
+{
+    //An elbow bending from straight to folded, away from the origin, over
+    //a frame count that leaves a scalar tail.
+    const unsigned numFrames = 183;
+    JointTrack shoulder, elbow, wrist;
+    for (unsigned f = 0; f < numFrames; f++)
+    {
+        double bend = 3.14159265358979 * f / (numFrames - 1);
+        Vec3 origin(100 + f * 0.01, 20, -30);
+        shoulder.add(origin + Vec3(0, 0.3, 0));
+        elbow.add(origin);
+        wrist.add(origin + Vec3(0.25 * std::sin(bend), -0.25 * std::cos(bend), 0.01 * f / numFrames));
+    }
+
+    std::vector<float> angles(numFrames);
+    localJointAngles(shoulder.positions(), elbow.positions(), wrist.positions(), numFrames, angles.data());
+    for (unsigned f = 0; f < numFrames; f++)
+    {
+        Vec3 a(shoulder.x[f], shoulder.y[f], shoulder.z[f]);
+        Vec3 b(elbow.x[f], elbow.y[f], elbow.z[f]);
+        Vec3 c(wrist.x[f], wrist.y[f], wrist.z[f]);
+        EXPECT_NEAR(angles[f], localJointAngle(a, b, c), 2e-3) << "frame " << f;
+    }
+    EXPECT_FLOAT_EQ(angles[0], 180.0f);
+}
+
+TEST(LimbAngle, BatchLostAndDegenerateFrames)
+{
+    JointTrack a, b, c;
+    for (unsigned f = 0; f < 6; f++)
+    {
+        a.add(Vec3(1, 0, 0));
+        b.add(Vec3(0, 0, 0));
+        c.add(Vec3(0, 1, 0));
+    }
+    //A lost joint in the SSE2 block and in the tail, and a chain folded
+    //onto its own joint.
+    a.x[1] = std::numeric_limits<float>::quiet_NaN();
+    c.z[5] = std::numeric_limits<float>::quiet_NaN();
+    a.x[2] = 0;
+
+    std::vector<float> angles(6);
+    localJointAngles(a.positions(), b.positions(), c.positions(), 6, angles.data());
+    EXPECT_NEAR(angles[0], 90.0f, 1e-3);
+    EXPECT_TRUE(std::isnan(angles[1]));
+    EXPECT_EQ(angles[2], 0.0f);
+    EXPECT_NEAR(angles[4], 90.0f, 1e-3);
+    EXPECT_TRUE(std::isnan(angles[5]));
+}
+
+TEST(LimbAngle, ChainsShareJoints)
+{
+    //A straight arm whose hand is bent back on itself.
+    JointTrack joints[4];
+    const Vec3 positions[] = {Vec3(0, 3, 0), Vec3(0, 2, 0), Vec3(0, 1, 0), Vec3(0, 2, 0)};
+    for (unsigned j = 0; j < 4; j++)
+        for (unsigned f = 0; f < 5; f++)
+            joints[j].add(positions[j]);
+
+    std::vector<JointPositions> tracks;
+    for (const JointTrack& joint : joints)
+        tracks.push_back(joint.positions());
+    std::vector<LimbChain> chains = {{0, 1, 2}, {1, 2, 3}};
+
+    std::vector<float> angles;
+    limbAngles(tracks, chains, 5, angles);
+    ASSERT_EQ(angles.size(), 10u);
+    EXPECT_FLOAT_EQ(angles[4], 180.0f);
+    EXPECT_NEAR(angles[5], 0.0f, 1e-3);
+}
+
+TEST(LimbAngle, FileRoundTrip)
+{
+    std::string path = ::testing::TempDir() + "limbAngles.bin";
+    std::vector<float> angles = {10, 20, 30, 40, 50, 60};
+    std::string error;
+    ASSERT_TRUE(writeLimbAngles(path, 12, 2, 3, angles, error)) << error;
+    EXPECT_FALSE(writeLimbAngles(path, 12, 2, 4, angles, error));
+
+    LimbAngleHeader header;
+    std::vector<float> read;
+    ASSERT_TRUE(readLimbAngles(path, header, read, error)) << error;
+    EXPECT_EQ(header.numChains, 2u);
+    EXPECT_EQ(header.numFrames, 3u);
+    EXPECT_EQ(header.startFrame, 12.0);
+    EXPECT_EQ(read, angles);
+    std::remove(path.c_str());
+}
+
+TEST(LimbAngle, RejectsOversizedHeader)
+{
+    //A header asking for far more angles than the file holds fails
+    //before anything is allocated.
+    std::string path = ::testing::TempDir() + "limbAnglesBad.bin";
+    std::string error;
+    ASSERT_TRUE(writeLimbAngles(path, 0, 2, 3, {1, 2, 3, 4, 5, 6}, error)) << error;
+    {
+        std::fstream file(path.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+        LimbAngleHeader header;
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        header.numChains = 0x40000000;
+        header.numFrames = 0x40000000;
+        file.seekp(0);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    LimbAngleHeader header;
+    std::vector<float> read;
+    EXPECT_FALSE(readLimbAngles(path, header, read, error));
+    EXPECT_NE(error.find("truncated"), std::string::npos) << error;
+    EXPECT_TRUE(read.empty());
+    std::remove(path.c_str());
+}
@@ -0,0 +1,71 @@
+#include "log.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    int s_evaluations = 0;
+
+    int countedValue()
+    {
+        s_evaluations++;
+        return 42;
+    }
+
+    std::string readFile(const std::string& path)
+    {
+        std::ifstream file(path.c_str());
+        std::stringstream contents;
+        contents << file.rdbuf();
+        return contents.str();
+    }
+}
+
+TEST(Log, DisabledLevelsAreNotBuilt)
+{
+    LogScope scope(kLogSummary, "");
+    s_evaluations = 0;
+    TRACKER_LOG(kLogDebug, "value " << countedValue());
+    TRACKER_LOG(kLogTrace, "value " << countedValue());
+    EXPECT_EQ(s_evaluations, 0);
+
+    TRACKER_LOG(kLogSummary, "value " << countedValue());
+    EXPECT_EQ(s_evaluations, 1);
+}
+
+TEST(Log, ScopeRestoresLevel)
+{
+    Log::setLevel(kLogDebug);
+    {
+        LogScope scope(kLogOff, "");
+        EXPECT_FALSE(Log::enabled(kLogSummary));
+    }
+    EXPECT_EQ(Log::level(), kLogDebug);
+}
+
+TEST(Log, ParseLevel)
+{
+    LogLevel level = kLogOff;
+    EXPECT_TRUE(Log::parseLevel("trace", level));
+    EXPECT_EQ(level, kLogTrace);
+    EXPECT_TRUE(Log::parseLevel("summary", level));
+    EXPECT_EQ(level, kLogSummary);
+    EXPECT_FALSE(Log::parseLevel("loud", level));
+}
+
+TEST(Log, TraceFileGetsEveryLineInOrder)
+{
+    std::string path = ::testing::TempDir() + "trace.log";
+    {
+        LogScope scope(kLogTrace, path);
+        TRACKER_LOG(kLogTrace, "vertex " << 1);
+        TRACKER_LOG(kLogSummary, "summary");
+        TRACKER_LOG(kLogTrace, "vertex " << 2);
+    }
+    EXPECT_EQ(readFile(path), "vertex 1\nsummary\nvertex 2\n");
+    std::remove(path.c_str());
+}
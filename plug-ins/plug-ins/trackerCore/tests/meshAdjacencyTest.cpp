@@ -0,0 +1,52 @@
+#include "meshAdjacency.h"
+#include "testMesh.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+TEST(MeshAdjacency, NeighboursAreSortedAndUnique)
+{
+    //Two triangles sharing the edge 1-2.
+    int triangles[] = {0, 1, 2, 2, 1, 3};
+    MeshAdjacency adjacency;
+    adjacency.build(4, triangles, 2);
+
+    ASSERT_EQ(adjacency.numVertices(), 4u);
+    EXPECT_EQ(std::vector<int>(adjacency.begin(0), adjacency.end(0)), (std::vector<int>{1, 2}));
+    EXPECT_EQ(std::vector<int>(adjacency.begin(1), adjacency.end(1)), (std::vector<int>{0, 2, 3}));
+    EXPECT_EQ(std::vector<int>(adjacency.begin(2), adjacency.end(2)), (std::vector<int>{0, 1, 3}));
+    EXPECT_EQ(adjacency.degree(3), 2u);
+}
+
+TEST(MeshAdjacency, SkipsTrianglesOutOfRange)
+{
+    int triangles[] = {0, 1, 2, 1, 2, 7, -1, 0, 1};
+    MeshAdjacency adjacency;
+    adjacency.build(4, triangles, 3);
+
+    EXPECT_EQ(adjacency.degree(0), 2u);
+    EXPECT_EQ(adjacency.degree(1), 2u);
+    EXPECT_EQ(adjacency.degree(3), 0u);
+
+    adjacency.clear();
+    EXPECT_EQ(adjacency.numVertices(), 0u);
+}
+
+TEST(MeshAdjacency, ClosedMeshIsSymmetric)
+{
+    TestMesh sphere = makeSphere(10, 16, 1.0, Vec3());
+    MeshAdjacency adjacency;
+    adjacency.build(sphere.numVertices(), sphere.triangles.data(), sphere.numTriangles());
+
+    for (unsigned v = 0; v < adjacency.numVertices(); v++)
+    {
+        for (const int* n = adjacency.begin(v); n != adjacency.end(v); n++)
+        {
+            const int* back = adjacency.begin(*n);
+            while (back != adjacency.end(*n) && *back != (int)v)
+                back++;
+            EXPECT_NE(back, adjacency.end(*n)) << v << " " << *n;
+        }
+    }
+}
@@ -0,0 +1,114 @@
+#include "meshBvh.h"
+#include "testMesh.h"
+
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <random>
+
+namespace
+{
+    //Closest point by testing every triangle.
+    float bruteForceDistanceSq(const TestMesh& mesh, const float* query)
+    {
+        float best = std::numeric_limits<float>::max();
+        for (unsigned tri = 0; tri < mesh.numTriangles(); tri++)
+        {
+            float points[9];
+            for (unsigned corner = 0; corner < 3; corner++)
+            {
+                for (unsigned axis = 0; axis < 3; axis++)
+                    points[corner * 3 + axis] = mesh.points[mesh.triangles[tri * 3 + corner] * 3 + axis];
+            }
+            int indices[] = {0, 1, 2};
+            MeshBvh single;
+            single.build(points, 3, indices, 1);
+            best = std::min(best, single.closestPoint(query).distanceSq);
+        }
+        return best;
+    }
+}
+
+TEST(MeshBvh, EmptyTreeReturnsNoTriangle)
+{
+    MeshBvh bvh;
+    float query[] = {0, 0, 0};
+    EXPECT_TRUE(bvh.empty());
+    EXPECT_EQ(bvh.closestPoint(query).triangle, -1);
+}
+
+TEST(MeshBvh, ClosestPointOnSingleTriangle)
+{
+    float points[] = {0, 0, 0, 1, 0, 0, 0, 1, 0};
+    int triangles[] = {0, 1, 2};
+    MeshBvh bvh;
+    bvh.build(points, 3, triangles, 1);
+
+    float above[] = {0.25f, 0.25f, 2};
+    BvhHit hit = bvh.closestPoint(above);
+    EXPECT_EQ(hit.triangle, 0);
+    EXPECT_FLOAT_EQ(hit.point[0], 0.25f);
+    EXPECT_FLOAT_EQ(hit.point[1], 0.25f);
+    EXPECT_FLOAT_EQ(hit.point[2], 0);
+    EXPECT_FLOAT_EQ(hit.distanceSq, 4);
+
+    float pastCorner[] = {2, -1, 0};
+    hit = bvh.closestPoint(pastCorner);
+    EXPECT_FLOAT_EQ(hit.point[0], 1);
+    EXPECT_FLOAT_EQ(hit.point[1], 0);
+}
+
+TEST(MeshBvh, MatchesBruteForce)
+{
+    TestMesh mesh = makeSphere(24, 32, 1.0, Vec3());
+    MeshBvh bvh;
+    bvh.build(mesh.points.data(), mesh.numVertices(), mesh.triangles.data(), mesh.numTriangles());
+    EXPECT_EQ(bvh.numTriangles(), mesh.numTriangles());
+
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> coordinate(-1.5f, 1.5f);
+    std::vector<float> queries(3 * 40);
+    for (float& value : queries)
+        value = coordinate(random);
+
+    std::vector<BvhHit> hits(40);
+    bvh.closestPoints(queries.data(), 40, hits.data());
+    for (unsigned i = 0; i < 40; i++)
+        EXPECT_NEAR(hits[i].distanceSq, bruteForceDistanceSq(mesh, &queries[i * 3]), 1e-5f);
+}
+
+TEST(MeshBvh, SearchRadiusBoundsTheHit)
+{
+    float points[] = {0, 0, 0, 1, 0, 0, 0, 1, 0};
+    int triangles[] = {0, 1, 2};
+    MeshBvh bvh;
+    bvh.build(points, 3, triangles, 1);
+
+    float above[] = {0.25f, 0.25f, 2};
+    EXPECT_EQ(bvh.closestPoint(above, 3.9f).triangle, -1);
+    EXPECT_EQ(bvh.closestPoint(above, 4.1f).triangle, 0);
+
+    float queries[] = {0.25f, 0.25f, 2, 0.25f, 0.25f, 0.5f};
+    float radiiSq[] = {1, 1};
+    BvhHit hits[2];
+    bvh.closestPoints(queries, 2, hits, radiiSq);
+    EXPECT_EQ(hits[0].triangle, -1);
+    EXPECT_EQ(hits[1].triangle, 0);
+    EXPECT_FLOAT_EQ(hits[1].distanceSq, 0.25f);
+}
+
+TEST(MeshBvh, RefitFollowsMovedVertices)
+{
+    TestMesh mesh = makeSphere(16, 16, 1.0, Vec3());
+    MeshBvh bvh;
+    bvh.build(mesh.points.data(), mesh.numVertices(), mesh.triangles.data(), mesh.numTriangles());
+
+    translateMesh(mesh, Vec3(5, 0, 0));
+    bvh.refit(mesh.points.data(), mesh.numVertices());
+
+    float query[] = {5, 0, 3};
+    BvhHit hit = bvh.closestPoint(query);
+    EXPECT_NEAR(hit.distanceSq, bruteForceDistanceSq(mesh, query), 1e-5f);
+    EXPECT_NEAR(hit.point[0], 5.0f, 1e-3f);
+    EXPECT_NEAR(hit.point[2], 1.0f, 1e-3f);
+}
@@ -0,0 +1,76 @@
+#include "motionFilter.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+namespace
+{
+    Vec3 ballistic(double frame)
+    {
+        return Vec3(2 + 0.5 * frame, 10 + 1.2 * frame - 0.15 * frame * frame, -0.3 * frame);
+    }
+}
+
+TEST(MotionFilter, FirstMeasurementStartsAtRest)
+{
+    MotionFilter filter;
+    EXPECT_FALSE(filter.started());
+    filter.update(Vec3(1, 2, 3));
+    EXPECT_TRUE(filter.started());
+    EXPECT_EQ(filter.position().x, 1);
+    EXPECT_EQ(filter.predicted().z, 3);
+    EXPECT_GT(filter.predictedVariance(), 1);
+}
+
+TEST(MotionFilter, PredictsConstantAcceleration)
+{
+    MotionFilter filter;
+    for (int frame = 0; frame < 30; frame++)
+    {
+        filter.update(ballistic(frame));
+        if (frame >= 6)
+        {
+            Vec3 error = filter.predicted() - ballistic(frame + 1);
+            EXPECT_LT(error.length(), 1e-2) << "frame " << frame;
+        }
+    }
+    EXPECT_NEAR(filter.acceleration().y, -0.3, 1e-3);
+    EXPECT_NEAR(filter.velocity().x, 0.5, 1e-3);
+}
+
+TEST(MotionFilter, VarianceSettlesAndBoundsTheMiss)
+{
+    MotionFilter filter;
+    double first = 0;
+    for (int frame = 0; frame < 40; frame++)
+    {
+        filter.update(ballistic(frame));
+        if (frame == 0)
+            first = filter.predictedVariance();
+    }
+    EXPECT_LT(filter.predictedVariance(), first);
+
+    //Steady state is reached and stays put.
+    double settled = filter.predictedVariance();
+    filter.update(ballistic(40));
+    EXPECT_NEAR(filter.predictedVariance(), settled, settled * 1e-6);
+
+    //A sudden jerk of the size the process noise allows lands inside the
+    //search radius.
+    Vec3 kicked = ballistic(41) + Vec3(std::sqrt(MotionFilter::kDefaultProcessNoise / 20), 0, 0);
+    EXPECT_LT((kicked - filter.predicted()).length(), filter.searchRadius(4));
+}
+
+TEST(MotionFilter, ResetForgetsTheTrack)
+{
+    MotionFilter filter;
+    for (int frame = 0; frame < 5; frame++)
+        filter.update(ballistic(frame));
+    filter.reset();
+    EXPECT_FALSE(filter.started());
+
+    filter.update(Vec3(7, 7, 7));
+    EXPECT_EQ(filter.velocity().length(), 0);
+    EXPECT_EQ(filter.predicted().x, 7);
+}
@@ -0,0 +1,38 @@
+#include "motion.h"
+
+#include <gtest/gtest.h>
+
+TEST(Motion, VelocityAndAcceleration)
+{
+    Vec3 velocity = computeVelocity(Vec3(1, 1, 1), Vec3(2, 3, 4));
+    EXPECT_DOUBLE_EQ(velocity.x, 1);
+    EXPECT_DOUBLE_EQ(velocity.y, 2);
+    EXPECT_DOUBLE_EQ(velocity.z, 3);
+
+    Vec3 acceleration = computeAcceleration(Vec3(1, 2, 3), Vec3(2, 2, 1));
+    EXPECT_DOUBLE_EQ(acceleration.x, 1);
+    EXPECT_DOUBLE_EQ(acceleration.y, 0);
+    EXPECT_DOUBLE_EQ(acceleration.z, -2);
+}
+
+TEST(Motion, ProjectPointUsesKinematicStep)
+{
+    //p + v + a/2 with x(t) = t^2 / 2 sampled at t = 1, 2, 3.
+    Vec3 p1(0.5, 0, 0), p2(2, 0, 0), p3(4.5, 0, 0);
+    Vec3 v2 = computeVelocity(p1, p2);
+    Vec3 v3 = computeVelocity(p2, p3);
+    Vec3 projected = projectPoint(p3, v3, computeAcceleration(v2, v3));
+    EXPECT_DOUBLE_EQ(projected.x, 7.5);
+}
+
+TEST(Motion, Centroid)
+{
+    Vec3 points[] = {Vec3(0, 0, 0), Vec3(2, 0, 0), Vec3(1, 3, 0)};
+    Vec3 center = centroid(points, 3);
+    EXPECT_DOUBLE_EQ(center.x, 1);
+    EXPECT_DOUBLE_EQ(center.y, 1);
+    EXPECT_DOUBLE_EQ(center.z, 0);
+
+    Vec3 empty = centroid(points, 0);
+    EXPECT_DOUBLE_EQ(empty.length(), 0);
+}
@@ -0,0 +1,112 @@
+#include "pointCacheStream.h"
+#include "testMesh.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+
+namespace
+{
+    std::string writeCache(const char* name, unsigned numFrames, unsigned topologyChange)
+    {
+        std::string path = ::testing::TempDir() + name;
+        TestMesh first = makeSphere(8, 8, 1.0, Vec3());
+        TestMesh second = makeSphere(10, 12, 1.0, Vec3());
+
+        PointCacheWriter writer;
+        writer.open(path, 5);
+        for (unsigned i = 0; i < numFrames; i++)
+        {
+            TestMesh& mesh = i < topologyChange ? first : second;
+            bool newTopology = i == 0 || i == topologyChange;
+            writer.writeFrame(mesh.points.data(), mesh.numVertices(), newTopology ? mesh.triangles.data() : nullptr,
+                              mesh.numTriangles());
+            translateMesh(mesh, Vec3(0.1, 0, 0));
+        }
+        writer.close();
+        return path;
+    }
+}
+
+TEST(PointCacheStream, FramesPointIntoTheCache)
+{
+    std::string path = writeCache("stream.vjpc", 6, 3);
+    PointCacheStream stream;
+    ASSERT_TRUE(stream.open(path)) << stream.error();
+    EXPECT_EQ(stream.numFrames(), 6u);
+    EXPECT_EQ(stream.startFrame(), 5.0);
+
+    TestMesh expected = makeSphere(10, 12, 1.0, Vec3());
+    translateMesh(expected, Vec3(0.1, 0, 0));
+
+    TrackFrame frame;
+    ASSERT_TRUE(stream.frame(4, frame));
+    ASSERT_EQ(frame.numVertices, expected.numVertices());
+    ASSERT_EQ(frame.numTriangles, expected.numTriangles());
+    for (unsigned i = 0; i < expected.points.size(); i++)
+        EXPECT_EQ(frame.points[i], expected.points[i]);
+    for (unsigned i = 0; i < expected.triangles.size(); i++)
+        EXPECT_EQ(frame.triangles[i], expected.triangles[i]);
+
+    //Frames of one topology share the triangles stored with the first.
+    TrackFrame other;
+    ASSERT_TRUE(stream.frame(5, other));
+    EXPECT_EQ(other.triangles, frame.triangles);
+    EXPECT_EQ(other.topology, frame.topology);
+    EXPECT_EQ(frame.topology, topologyFingerprint(expected.numVertices(), expected.triangles.data(),
+                                                  expected.numTriangles()));
+    ASSERT_TRUE(stream.frame(2, other));
+    EXPECT_NE(other.topology, frame.topology);
+    EXPECT_FALSE(stream.frame(6, other));
+
+    stream.close();
+    std::remove(path.c_str());
+}
+
+TEST(PointCacheStream, SlidingWindowKeepsDataReadable)
+{
+    std::string path = writeCache("window.vjpc", 40, 20);
+    PointCacheStream stream;
+    ASSERT_TRUE(stream.open(path)) << stream.error();
+
+    PointCacheReader reader;
+    ASSERT_TRUE(reader.open(path));
+
+    //Released pages come back from the file when touched again.
+    for (unsigned i = 0; i < 39; i++)
+        stream.setWindow(i > 0 ? i - 1 : 0, i + 1);
+
+    for (unsigned i = 0; i < 40; i++)
+    {
+        TrackFrame frame;
+        PointCacheFrame copy;
+        ASSERT_TRUE(stream.frame(i, frame));
+        ASSERT_TRUE(reader.readFrame(i, copy));
+        EXPECT_EQ(std::vector<float>(frame.points, frame.points + frame.numVertices * 3), copy.points);
+        EXPECT_EQ(std::vector<int>(frame.triangles, frame.triangles + frame.numTriangles * 3), *copy.triangles);
+    }
+
+    stream.close();
+    std::remove(path.c_str());
+}
+
+TEST(PointCacheStream, RejectsTruncatedCache)
+{
+    std::string path = writeCache("truncated.vjpc", 4, 4);
+    std::string cut = ::testing::TempDir() + "cut.vjpc";
+    {
+        std::ifstream in(path.c_str(), std::ios::binary);
+        std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::ofstream out(cut.c_str(), std::ios::binary);
+        out.write(data.data(), (std::streamsize)data.size() / 2);
+    }
+
+    PointCacheStream stream;
+    EXPECT_FALSE(stream.open(cut));
+    EXPECT_FALSE(stream.error().empty());
+    EXPECT_FALSE(stream.open(::testing::TempDir() + "missing.vjpc"));
+
+    std::remove(path.c_str());
+    std::remove(cut.c_str());
+}
@@ -0,0 +1,66 @@
+#include "pointCache.h"
+#include "testMesh.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+
+namespace
+{
+    std::string tempPath(const char* name)
+    {
+        return ::testing::TempDir() + name;
+    }
+}
+
+TEST(PointCache, RoundTripWithTopologyChange)
+{
+    std::string path = tempPath("roundTrip.vjpc");
+    TestMesh first = makeSphere(8, 8, 1.0, Vec3());
+    TestMesh second = makeSphere(10, 12, 1.0, Vec3());
+
+    PointCacheWriter writer;
+    ASSERT_TRUE(writer.open(path, 12));
+    ASSERT_TRUE(writer.writeFrame(first.points.data(), first.numVertices(), first.triangles.data(),
+                                  first.numTriangles()));
+    translateMesh(first, Vec3(0, 1, 0));
+    ASSERT_TRUE(writer.writeFrame(first.points.data(), first.numVertices(), nullptr, 0));
+    ASSERT_TRUE(writer.writeFrame(second.points.data(), second.numVertices(), second.triangles.data(),
+                                  second.numTriangles()));
+    ASSERT_TRUE(writer.close());
+
+    PointCacheReader reader;
+    ASSERT_TRUE(reader.open(path)) << reader.error();
+    EXPECT_EQ(reader.numFrames(), 3u);
+    EXPECT_EQ(reader.startFrame(), 12.0);
+
+    PointCacheFrame frame0, frame1, frame2;
+    ASSERT_TRUE(reader.readFrame(0, frame0));
+    ASSERT_TRUE(reader.readFrame(1, frame1));
+    ASSERT_TRUE(reader.readFrame(2, frame2));
+
+    EXPECT_EQ(frame1.points, first.points);
+    EXPECT_EQ(*frame1.triangles, first.triangles);
+    //Frames sharing a topology share the triangle array.
+    EXPECT_EQ(frame0.triangles, frame1.triangles);
+    EXPECT_EQ(frame2.numVertices, second.numVertices());
+    EXPECT_EQ(*frame2.triangles, second.triangles);
+    EXPECT_EQ(frame2.topologyFrame, 2u);
+
+    std::remove(path.c_str());
+}
+
+TEST(PointCache, RejectsBadInput)
+{
+    std::string path = tempPath("bad.vjpc");
+    TestMesh mesh = makeSphere(8, 8, 1.0, Vec3());
+
+    PointCacheWriter writer;
+    ASSERT_TRUE(writer.open(path, 1));
+    EXPECT_FALSE(writer.writeFrame(mesh.points.data(), mesh.numVertices(), nullptr, 0));
+    writer.close();
+
+    PointCacheReader reader;
+    EXPECT_FALSE(reader.open(tempPath("missing.vjpc")));
+    std::remove(path.c_str());
+}
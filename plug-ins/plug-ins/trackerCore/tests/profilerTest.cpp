@@ -0,0 +1,94 @@
+#include "profiler.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+    void timedWork(unsigned sleepMs)
+    {
+        PROFILE_SCOPE("testWork");
+        PROFILE_COUNT("testItems", 3);
+        std::this_thread::sleep_for(std::chrono::milliseconds(sleepMs));
+    }
+}
+
+TEST(Profiler, DisabledRecordsNothing)
+{
+    Profiler::stop();
+    timedWork(0);
+    ProfileSession session(true, false);
+    Profiler::stop();
+    EXPECT_EQ(Profiler::report().find("testWork"), std::string::npos);
+}
+
+TEST(Profiler, ReportsPhasesAndCounters)
+{
+    {
+        ProfileSession session(true, false);
+        for (unsigned frame = 0; frame < 4; frame++)
+        {
+            timedWork(frame == 3 ? 20 : 1);
+            Profiler::endFrame();
+        }
+    }
+
+    std::string report = Profiler::report();
+    EXPECT_NE(report.find("4 frames"), std::string::npos) << report;
+
+    //calls, total, mean per frame and the slow frame as p95.
+    std::istringstream lines(report);
+    std::string line;
+    bool foundPhase = false;
+    while (std::getline(lines, line))
+    {
+        std::istringstream fields(line);
+        std::string name;
+        fields >> name;
+        if (name == "testWork")
+        {
+            unsigned calls;
+            double total, mean, p95;
+            fields >> calls >> total >> mean >> p95;
+            EXPECT_EQ(calls, 4u);
+            EXPECT_GE(total, 23.0);
+            EXPECT_NEAR(mean, total / 4, 1e-2);
+            EXPECT_GE(p95, 20.0);
+            foundPhase = true;
+        }
+        if (name == "testItems")
+        {
+            unsigned count;
+            fields >> count;
+            EXPECT_EQ(count, 12u);
+        }
+    }
+    EXPECT_TRUE(foundPhase) << report;
+}
+
+TEST(Profiler, WritesChromeTrace)
+{
+    std::string path = ::testing::TempDir() + "trace.json";
+    {
+        ProfileSession session(true, true);
+        timedWork(0);
+        timedWork(0);
+    }
+
+    std::string error;
+    ASSERT_TRUE(Profiler::writeChromeTrace(path, error)) << error;
+
+    std::ifstream file(path.c_str());
+    std::stringstream json;
+    json << file.rdbuf();
+    std::string text = json.str();
+    EXPECT_EQ(text.find("{\"traceEvents\":["), 0u);
+    size_t first = text.find("\"name\":\"testWork\"");
+    ASSERT_NE(first, std::string::npos);
+    EXPECT_NE(text.find("\"name\":\"testWork\"", first + 1), std::string::npos);
+    std::remove(path.c_str());
+}
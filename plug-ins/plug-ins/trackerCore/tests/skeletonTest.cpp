@@ -0,0 +1,131 @@
+#include "skeleton.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+namespace
+{
+    bool parse(const std::string& text, SkeletonTemplate& skeleton, std::string& error)
+    {
+        std::istringstream in(text);
+        return parseSkeletonTemplate(in, "test", skeleton, error);
+    }
+
+    void expectNear(const Vec3& actual, const Vec3& expected)
+    {
+        EXPECT_NEAR(actual.x, expected.x, 1e-9);
+        EXPECT_NEAR(actual.y, expected.y, 1e-9);
+        EXPECT_NEAR(actual.z, expected.z, 1e-9);
+    }
+}
+
+TEST(Skeleton, ParsesJointsAndIkHandles)
+{
+    SkeletonTemplate skeleton;
+    std::string error;
+    ASSERT_TRUE(parse("# arm\n"
+                      "shoulder - 0 1.5 0 orient 0 0 -90\n"
+                      "\n"
+                      "elbow shoulder 0.3 0 0\n"
+                      "wrist elbow 0.25 0 0 track 2\n"
+                      "ik armIk shoulder wrist\n",
+                      skeleton, error)) << error;
+
+    ASSERT_EQ(skeleton.joints.size(), 3u);
+    EXPECT_EQ(skeleton.joints[0].parent, -1);
+    EXPECT_EQ(skeleton.joints[0].orient.z, -90.0);
+    EXPECT_EQ(skeleton.joints[2].parent, 1);
+    EXPECT_EQ(skeleton.joints[2].trackedJoint, 2);
+    EXPECT_EQ(skeleton.find("elbow"), 1);
+    ASSERT_EQ(skeleton.ikHandles.size(), 1u);
+    EXPECT_EQ(skeleton.ikHandles[0].startJoint, 0u);
+    EXPECT_EQ(skeleton.ikHandles[0].endJoint, 2u);
+}
+
+TEST(Skeleton, RejectsBrokenTemplates)
+{
+    SkeletonTemplate skeleton;
+    std::string error;
+    EXPECT_FALSE(parse("a - 0 0 0\nb c 0 1 0\n", skeleton, error));
+    EXPECT_EQ(error, "test:2: unknown parent c");
+    EXPECT_FALSE(parse("a - 0 0 0\na a 0 1 0\n", skeleton, error));
+    EXPECT_FALSE(parse("a - 0 0\n", skeleton, error));
+    EXPECT_FALSE(parse("a - 0 0 0 spin 1\n", skeleton, error));
+    EXPECT_FALSE(parse("a - 0 0 0\nb - 0 1 0\nik h a b\n", skeleton, error));
+    EXPECT_EQ(error, "test:3: b is not below a");
+    EXPECT_FALSE(parse("# nothing\n", skeleton, error));
+}
+
+TEST(Skeleton, ChainFollowsJointOrients)
+{
+    //The chain jointCreate has always built.
+    SkeletonTemplate skeleton = chainSkeleton(3, 0.2, 20);
+    ASSERT_EQ(skeleton.joints.size(), 3u);
+    EXPECT_EQ(skeleton.joints[2].name, "joint3");
+    ASSERT_EQ(skeleton.ikHandles.size(), 1u);
+    EXPECT_EQ(skeleton.ikHandles[0].endJoint, 2u);
+
+    std::vector<Vec3> world;
+    EXPECT_EQ(placeSkeleton(skeleton, std::vector<Vec3>(), world), 0u);
+    double a = 20 * 3.14159265358979323846 / 180;
+    expectNear(world[0], Vec3(0, 0.2, 0));
+    expectNear(world[1], Vec3(0, 0.2 + 0.2 * std::cos(a), 0.2 * std::sin(a)));
+    expectNear(world[2], world[1] + Vec3(0, 0.2 * std::cos(2 * a), 0.2 * std::sin(2 * a)));
+}
+
+TEST(Skeleton, TrackedChainLandsOnEveryTrackedJoint)
+{
+    SkeletonTemplate skeleton = chainSkeleton(3, 0.2, 20, true);
+    EXPECT_EQ(numTrackedJoints(skeleton), 3u);
+    EXPECT_EQ(numTrackedJoints(chainSkeleton(3, 0.2, 20)), 0u);
+    EXPECT_EQ(numTrackedJoints(humanoidSkeleton()), 0u);
+
+    std::vector<Vec3> tracked = {Vec3(0, 1, 0), Vec3(0.1, 0.6, 0.05), Vec3(0.1, 0.2, 0.1)};
+    std::vector<Vec3> world;
+    EXPECT_EQ(placeSkeleton(skeleton, tracked, world), 3u);
+    for (unsigned j = 0; j < 3; j++)
+        expectNear(world[j], tracked[j]);
+}
+
+TEST(Skeleton, TrackedJointsMoveTheirChildren)
+{
+    SkeletonTemplate skeleton;
+    std::string error;
+    ASSERT_TRUE(parse("hips - 0 1 0\n"
+                      "knee hips 0 -0.5 0 orient 0 90 0 track 1\n"
+                      "ankle knee 0 -0.5 0\n"
+                      "toe ankle 0 0 0.1 track 0\n",
+                      skeleton, error)) << error;
+
+    //Tracked joint 0 lost track, so the toe keeps its template offset.
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    std::vector<Vec3> tracked = {Vec3(nan, 0, 0), Vec3(0.2, 0.6, 0.1)};
+    std::vector<Vec3> world;
+    EXPECT_EQ(placeSkeleton(skeleton, tracked, world), 1u);
+    expectNear(world[1], Vec3(0.2, 0.6, 0.1));
+    expectNear(skeleton.joints[1].translation, Vec3(0.2, -0.4, 0.1));
+    //The knee's orient turns its children's z into x.
+    expectNear(world[2], Vec3(0.2, 0.1, 0.1));
+    expectNear(world[3], Vec3(0.3, 0.1, 0.1));
+}
+
+TEST(Skeleton, HumanoidIsSymmetric)
+{
+    SkeletonTemplate skeleton = humanoidSkeleton();
+    EXPECT_EQ(skeleton.joints.size(), 57u);
+    EXPECT_EQ(skeleton.ikHandles.size(), 4u);
+
+    std::vector<Vec3> world;
+    placeSkeleton(skeleton, std::vector<Vec3>(), world);
+    int left = skeleton.find("leftPinky3");
+    int right = skeleton.find("rightPinky3");
+    ASSERT_GE(left, 0);
+    ASSERT_GE(right, 0);
+    expectNear(world[right], Vec3(-world[left].x, world[left].y, world[left].z));
+    EXPECT_EQ(skeleton.joints[skeleton.find("rightElbow")].parent, skeleton.find("rightShoulder"));
+    EXPECT_EQ(skeleton.ikHandles[3].name, "rightLegIk");
+    EXPECT_EQ(skeleton.ikHandles[3].endJoint, (unsigned)skeleton.find("rightAnkle"));
+}
@@ -0,0 +1,154 @@
+#include "surfaceWalk.h"
+#include "testMesh.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+
+namespace
+{
+    //Flat strip of length quads along x, two triangles each.
+    TestMesh makeStrip(unsigned length)
+    {
+        TestMesh strip;
+        for (unsigned i = 0; i <= length; i++)
+        {
+            float row[] = {(float)i, 0, 0, (float)i, 1, 0};
+            strip.points.insert(strip.points.end(), row, row + 6);
+        }
+        for (int i = 0; i < (int)length; i++)
+        {
+            int quad[] = {i * 2, i * 2 + 2, i * 2 + 1, i * 2 + 1, i * 2 + 2, i * 2 + 3};
+            strip.triangles.insert(strip.triangles.end(), quad, quad + 6);
+        }
+        return strip;
+    }
+
+    //makeSphere() with each pole ring merged into one vertex, so the
+    //surface is connected across the poles.
+    TestMesh makeClosedSphere(unsigned rows, unsigned columns)
+    {
+        TestMesh sphere = makeSphere(rows, columns, 1.0, Vec3());
+        std::vector<int> triangles;
+        for (unsigned t = 0; t < sphere.numTriangles(); t++)
+        {
+            int triangle[3];
+            for (unsigned c = 0; c < 3; c++)
+            {
+                int id = sphere.triangles[t * 3 + c];
+                if (id < (int)columns)
+                    id = 0;
+                else if (id >= (int)((rows - 1) * columns))
+                    id = (rows - 1) * columns;
+                triangle[c] = id;
+            }
+            if (triangle[0] != triangle[1] && triangle[1] != triangle[2] && triangle[2] != triangle[0])
+                triangles.insert(triangles.end(), triangle, triangle + 3);
+        }
+        sphere.triangles = triangles;
+        return sphere;
+    }
+}
+
+TEST(SurfaceWalk, MatchesTheBvhOnASphere)
+{
+    TestMesh sphere = makeClosedSphere(24, 32);
+    SurfaceWalk walk;
+    walk.build(sphere.numVertices(), sphere.triangles.data(), sphere.numTriangles());
+    MeshBvh bvh;
+    bvh.build(sphere.points.data(), sphere.numVertices(), sphere.triangles.data(), sphere.numTriangles());
+    ASSERT_EQ(walk.numTriangles(), sphere.numTriangles());
+
+    //From any start the walk runs down to the one closest point, since
+    //the distance to a point off a sphere falls steadily towards it.
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> direction(-1, 1);
+    std::uniform_int_distribution<int> triangle(0, (int)sphere.numTriangles() - 1);
+    for (unsigned i = 0; i < 200; i++)
+    {
+        Vec3 d(direction(random), direction(random), direction(random));
+        if (d.length() < 0.1)
+            continue;
+        d = d * (1.1 / d.length());
+        float query[] = {(float)d.x, (float)d.y, (float)d.z};
+
+        BvhHit expected = bvh.closestPoint(query);
+        BvhHit hit = walk.closestPoint(sphere.points.data(), query, triangle(random));
+        ASSERT_GE(hit.triangle, 0) << i;
+        EXPECT_NEAR(hit.distanceSq, expected.distanceSq, 1e-5f) << i;
+    }
+}
+
+TEST(SurfaceWalk, FollowsAPointAsTheMeshMoves)
+{
+    TestMesh sphere = makeSphere(16, 24, 1.0, Vec3());
+    SurfaceWalk walk;
+    walk.build(sphere.numVertices(), sphere.triangles.data(), sphere.numTriangles());
+
+    float query[] = {0.3f, 0.9f, 0.2f};
+    BvhHit hit = walk.closestPoint(sphere.points.data(), query, 0);
+    ASSERT_GE(hit.triangle, 0);
+
+    //Slide the mesh a little per frame under a fixed point and keep
+    //starting from the last hit.
+    for (unsigned frame = 0; frame < 10; frame++)
+    {
+        translateMesh(sphere, Vec3(0.02, -0.01, 0.01));
+        MeshBvh bvh;
+        bvh.build(sphere.points.data(), sphere.numVertices(), sphere.triangles.data(), sphere.numTriangles());
+        BvhHit expected = bvh.closestPoint(query);
+
+        hit = walk.closestPoint(sphere.points.data(), query, hit.triangle, 0.01f);
+        ASSERT_GE(hit.triangle, 0) << frame;
+        EXPECT_NEAR(hit.distanceSq, expected.distanceSq, 1e-6f) << frame;
+    }
+}
+
+TEST(SurfaceWalk, GivesUpOutsideTheRadius)
+{
+    TestMesh strip = makeStrip(4);
+    SurfaceWalk walk;
+    walk.build(strip.numVertices(), strip.triangles.data(), strip.numTriangles());
+
+    float query[] = {2, 0.5f, 0.5f};
+    BvhHit hit = walk.closestPoint(strip.points.data(), query, 0, 0.2f);
+    EXPECT_EQ(hit.triangle, -1);
+    EXPECT_EQ(hit.point[2], 0.5f);
+
+    hit = walk.closestPoint(strip.points.data(), query, 0, 0.3f);
+    ASSERT_GE(hit.triangle, 0);
+    EXPECT_NEAR(hit.point[0], 2, 1e-6f);
+    EXPECT_NEAR(hit.point[2], 0, 1e-6f);
+}
+
+TEST(SurfaceWalk, GivesUpOnLongWalks)
+{
+    TestMesh strip = makeStrip(200);
+    SurfaceWalk walk;
+    walk.build(strip.numVertices(), strip.triangles.data(), strip.numTriangles());
+
+    float near[] = {SurfaceWalk::kMaxSteps - 10.0f, 0.5f, 0.1f};
+    EXPECT_GE(walk.closestPoint(strip.points.data(), near, 0).triangle, 0);
+
+    float far[] = {190, 0.5f, 0.1f};
+    EXPECT_EQ(walk.closestPoint(strip.points.data(), far, 0).triangle, -1);
+}
+
+TEST(SurfaceWalk, RejectsBadStarts)
+{
+    int triangles[] = {0, 1, 2, 0, 2, 9};
+    float points[] = {0, 0, 0, 1, 0, 0, 0, 1, 0};
+    SurfaceWalk walk;
+    walk.build(3, triangles, 2);
+    float query[] = {0.2f, 0.2f, 1};
+
+    EXPECT_EQ(walk.closestPoint(points, query, -1).triangle, -1);
+    EXPECT_EQ(walk.closestPoint(points, query, 1).triangle, -1);
+    EXPECT_EQ(walk.closestPoint(points, query, 2).triangle, -1);
+    EXPECT_EQ(walk.closestPoint(points, query, 0).triangle, 0);
+
+    walk.clear();
+    EXPECT_TRUE(walk.empty());
+    EXPECT_EQ(walk.closestPoint(points, query, 0).triangle, -1);
+}
@@ -0,0 +1,255 @@
+//
+// Synthetic volumetric capture with known joint positions.
+//
+#include "syntheticCapture.h"
+#include "topology.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace
+{
+    const double kPi = 3.14159265358979323846;
+    const double kBoneLength = 30;
+    const double kRootRadius = 6;
+    //Each bone is this much thinner than the one before, like a limb, so
+    //the capsules never share a surface at the joints.
+    const double kTaper = 0.12;
+
+    double wave(unsigned frame, double period, double phase = 0)
+    {
+        return std::sin(2 * kPi * frame / period + phase);
+    }
+}
+
+SyntheticCapture::SyntheticCapture(const CaptureOptions& options) : m_options(options)
+{
+    m_options.numBones = std::max(1u, m_options.numBones);
+    m_options.resolution = std::max(8u, m_options.resolution);
+    unsigned numKeyframes = 1;
+    if (m_options.remeshInterval > 0 && m_options.numFrames > 0)
+        numKeyframes = (m_options.numFrames + m_options.remeshInterval - 1) / m_options.remeshInterval;
+
+    m_keyframes.resize(numKeyframes);
+    for (unsigned k = 0; k < numKeyframes; k++)
+        buildKeyframe(k, m_keyframes[k]);
+}
+
+void SyntheticCapture::buildKeyframe(unsigned index, Keyframe& keyframe) const
+{
+    //Every keyframe samples the capsules at a different resolution from
+    //the one before and at a different angle.
+    const int deltas[] = {0, 3, -2};
+    keyframe.around = (unsigned)((int)m_options.resolution + deltas[index % 3]);
+    keyframe.phase = 0.61 * index;
+
+    unsigned capRings = std::max(2u, keyframe.around / 4);
+    unsigned bodyRings = keyframe.around;
+    keyframe.ringAlong.clear();
+    keyframe.ringCap.clear();
+    keyframe.ringRadius.clear();
+    for (unsigned i = 1; i <= capRings; i++)
+    {
+        double angle = 0.5 * kPi * i / capRings;
+        keyframe.ringAlong.push_back(0);
+        keyframe.ringCap.push_back(i == capRings ? 0 : -std::cos(angle));
+        keyframe.ringRadius.push_back(std::sin(angle));
+    }
+    keyframe.startRing = capRings - 1;
+    for (unsigned i = 1; i < bodyRings; i++)
+    {
+        keyframe.ringAlong.push_back((double)i / bodyRings);
+        keyframe.ringCap.push_back(0);
+        keyframe.ringRadius.push_back(1);
+    }
+    keyframe.endRing = (unsigned)keyframe.ringAlong.size();
+    for (unsigned i = capRings; i >= 1; i--)
+    {
+        double angle = 0.5 * kPi * i / capRings;
+        keyframe.ringAlong.push_back(1);
+        keyframe.ringCap.push_back(i == capRings ? 0 : std::cos(angle));
+        keyframe.ringRadius.push_back(std::sin(angle));
+    }
+
+    //Per bone: the start pole, the rings, then the end pole.
+    unsigned around = keyframe.around;
+    unsigned numRings = (unsigned)keyframe.ringAlong.size();
+    keyframe.verticesPerBone = numRings * around + 2;
+    keyframe.triangles.clear();
+    for (unsigned bone = 0; bone < m_options.numBones; bone++)
+    {
+        int first = (int)(bone * keyframe.verticesPerBone);
+        int endPole = first + 1 + (int)(numRings * around);
+        for (unsigned k = 0; k < around; k++)
+        {
+            int a = first + 1 + (int)k;
+            int b = first + 1 + (int)((k + 1) % around);
+            int start[] = {first, b, a};
+            keyframe.triangles.insert(keyframe.triangles.end(), start, start + 3);
+
+            for (unsigned ring = 0; ring + 1 < numRings; ring++)
+            {
+                int ra = a + (int)(ring * around);
+                int rb = b + (int)(ring * around);
+                int quad[] = {ra, rb, ra + (int)around, rb, rb + (int)around, ra + (int)around};
+                keyframe.triangles.insert(keyframe.triangles.end(), quad, quad + 6);
+            }
+
+            int last = (int)((numRings - 1) * around);
+            int end[] = {endPole, a + last, b + last};
+            keyframe.triangles.insert(keyframe.triangles.end(), end, end + 3);
+        }
+    }
+    keyframe.topology = topologyFingerprint(m_options.numBones * keyframe.verticesPerBone,
+                                            keyframe.triangles.data(),
+                                            (unsigned)keyframe.triangles.size() / 3);
+}
+
+const CaptureOptions& SyntheticCapture::options() const
+{
+    return m_options;
+}
+
+unsigned SyntheticCapture::numFrames() const
+{
+    return m_options.numFrames;
+}
+
+unsigned SyntheticCapture::numJoints() const
+{
+    return m_options.numBones + 1;
+}
+
+unsigned SyntheticCapture::numVertices(unsigned frame) const
+{
+    return m_options.numBones * m_keyframes[keyframe(frame)].verticesPerBone;
+}
+
+unsigned SyntheticCapture::keyframe(unsigned frame) const
+{
+    if (m_options.remeshInterval == 0)
+        return 0;
+    return std::min(frame / m_options.remeshInterval, (unsigned)m_keyframes.size() - 1);
+}
+
+double SyntheticCapture::bend(unsigned joint, unsigned frame) const
+{
+    //Always bent a little, so every inner joint has a well defined plane.
+    return 0.5 + 0.4 * wave(frame, 60, joint);
+}
+
+double SyntheticCapture::boneRadius(unsigned bone) const
+{
+    return kRootRadius * std::pow(1 - kTaper, (double)bone);
+}
+
+void SyntheticCapture::bonePose(unsigned bone, unsigned frame, Vec3& start, Vec3 axes[3]) const
+{
+    //The bending plane turns about y while the root sways.
+    double yaw = 0.35 * wave(frame, 120);
+    Vec3 ex(std::cos(yaw), 0, -std::sin(yaw));
+    Vec3 ey(0, 1, 0);
+    Vec3 ez(std::sin(yaw), 0, std::cos(yaw));
+
+    start = Vec3(20 * wave(frame, 90), 150 + 5 * wave(frame, 45), 10 * wave(frame, 70));
+    double angle = -0.5 * kPi + 0.25 * wave(frame, 80);
+    for (unsigned b = 0; ; b++)
+    {
+        if (b > 0)
+            angle += bend(b, frame);
+        axes[0] = ex * std::cos(angle) + ey * std::sin(angle);
+        if (b == bone)
+            break;
+        start += axes[0] * kBoneLength;
+    }
+    axes[1] = ey * std::cos(angle) - ex * std::sin(angle);
+    axes[2] = ez;
+}
+
+TrackFrame SyntheticCapture::frame(unsigned frame, std::vector<float>& points) const
+{
+    const Keyframe& mesh = m_keyframes[keyframe(frame)];
+    points.resize(numVertices(frame) * 3);
+
+    std::seed_seq seed = {m_options.seed, frame};
+    std::mt19937 random(seed);
+    std::normal_distribution<double> noise(0.0, m_options.noise > 0 ? m_options.noise : 1.0);
+    double scale = m_options.noise > 0 ? 1.0 : 0.0;
+
+    float* out = points.data();
+    for (unsigned bone = 0; bone < m_options.numBones; bone++)
+    {
+        Vec3 start;
+        Vec3 axes[3];
+        bonePose(bone, frame, start, axes);
+        double radius = boneRadius(bone);
+
+        auto emit = [&](const Vec3& position, const Vec3& normal) {
+            Vec3 p = position + normal * (scale * noise(random));
+            *out++ = (float)p.x;
+            *out++ = (float)p.y;
+            *out++ = (float)p.z;
+        };
+
+        emit(start - axes[0] * radius, axes[0] * -1.0);
+        for (size_t ring = 0; ring < mesh.ringAlong.size(); ring++)
+        {
+            Vec3 center = start + axes[0] * (mesh.ringAlong[ring] * kBoneLength + mesh.ringCap[ring] * radius);
+            for (unsigned k = 0; k < mesh.around; k++)
+            {
+                double angle = mesh.phase + 2 * kPi * k / mesh.around;
+                Vec3 radial = axes[1] * std::cos(angle) + axes[2] * std::sin(angle);
+                Vec3 normal = axes[0] * mesh.ringCap[ring] + radial * mesh.ringRadius[ring];
+                emit(center + radial * (mesh.ringRadius[ring] * radius), normal);
+            }
+        }
+        emit(start + axes[0] * (kBoneLength + radius), axes[0]);
+    }
+
+    TrackFrame result;
+    result.points = points.data();
+    result.numVertices = numVertices(frame);
+    result.triangles = mesh.triangles.data();
+    result.numTriangles = (unsigned)mesh.triangles.size() / 3;
+    result.topology = mesh.topology;
+    return result;
+}
+
+Vec3 SyntheticCapture::joint(unsigned joint, unsigned frame) const
+{
+    Vec3 start;
+    Vec3 axes[3];
+    unsigned bone = std::min(joint, m_options.numBones - 1);
+    bonePose(bone, frame, start, axes);
+    return joint < m_options.numBones ? start : start + axes[0] * kBoneLength;
+}
+
+double SyntheticCapture::jointAngle(unsigned joint, unsigned frame) const
+{
+    return 180 - bend(joint, frame) * 180 / kPi;
+}
+
+std::vector<LimbChain> SyntheticCapture::chains() const
+{
+    std::vector<LimbChain> chains;
+    for (unsigned j = 1; j < m_options.numBones; j++)
+        chains.push_back({j - 1, j, j + 1});
+    return chains;
+}
+
+std::vector<std::vector<int>> SyntheticCapture::vertexSets(unsigned pointsPerJoint) const
+{
+    const Keyframe& mesh = m_keyframes[0];
+    unsigned count = std::max(1u, std::min(pointsPerJoint, mesh.around));
+    std::vector<std::vector<int>> sets(numJoints());
+    for (unsigned joint = 0; joint < numJoints(); joint++)
+    {
+        unsigned bone = std::min(joint, m_options.numBones - 1);
+        unsigned ring = joint < m_options.numBones ? mesh.startRing : mesh.endRing;
+        int first = (int)(bone * mesh.verticesPerBone + 1 + ring * mesh.around);
+        for (unsigned i = 0; i < count; i++)
+            sets[joint].push_back(first + (int)(i * mesh.around / count));
+    }
+    return sets;
+}
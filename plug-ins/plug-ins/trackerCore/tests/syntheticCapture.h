@@ -0,0 +1,101 @@
+//
+// Synthetic volumetric capture with known joint positions, for measuring
+// how well and how fast the tracker follows a performance without Maya or
+// real capture data.
+//
+// The figure is a chain of tapering capsules, one per bone, bending in a
+// plane that slowly turns while the whole chain sways. Every frame the
+// surface is sampled again with noise along the normals, and every
+// remeshInterval frames the capsules are sampled at a different
+// resolution and angle, the way a 4DViews sequence switches to a new
+// keyframe mesh. Positions are in centimetres, Maya's default unit.
+//
+// Frames are generated on demand, so long takes of large meshes cost one
+// frame of memory.
+//
+#ifndef TRACKERCORE_SYNTHETICCAPTURE_H
+#define TRACKERCORE_SYNTHETICCAPTURE_H
+
+#include "limbAngle.h"
+#include "trackingEngine.h"
+#include "vec3.h"
+
+#include <vector>
+
+struct CaptureOptions
+{
+    unsigned numFrames = 120;
+    //Capsules in the chain. The joints are the chain's numBones + 1 ends.
+    unsigned numBones = 4;
+    //Vertices around each capsule. A capsule has about 1.5 x resolution^2
+    //vertices, so 4 bones at 128 are about the 100k of a full body.
+    unsigned resolution = 32;
+    //Standard deviation of the surface noise along the normals.
+    double noise = 0.05;
+    //Frames per keyframe mesh, 0 to keep the first one throughout.
+    unsigned remeshInterval = 0;
+    unsigned seed = 1;
+};
+
+class SyntheticCapture
+{
+public:
+    explicit SyntheticCapture(const CaptureOptions& options = CaptureOptions());
+
+    const CaptureOptions& options() const;
+    unsigned numFrames() const;
+    unsigned numJoints() const;
+    //Vertices of the keyframe mesh frame belongs to.
+    unsigned numVertices(unsigned frame) const;
+    unsigned keyframe(unsigned frame) const;
+
+    //Fills points with the surface of frame. The triangles and the
+    //topology fingerprint are shared by every frame of a keyframe, and
+    //stay valid as long as the capture does. Frames come out the same
+    //whatever order they are asked for in.
+    TrackFrame frame(unsigned frame, std::vector<float>& points) const;
+
+    //Where joint really is on frame.
+    Vec3 joint(unsigned joint, unsigned frame) const;
+    //Local angle in degrees at an inner joint, as localJointAngle() would
+    //measure it on the true joint positions.
+    double jointAngle(unsigned joint, unsigned frame) const;
+    //The chains a-b-c around every inner joint.
+    std::vector<LimbChain> chains() const;
+
+    //Per joint, samples of the ring of the first keyframe's vertices
+    //around it. Their centre is the joint.
+    std::vector<std::vector<int>> vertexSets(unsigned pointsPerJoint = 16) const;
+
+private:
+    struct Keyframe
+    {
+        //Vertices per ring and the angle of the first.
+        unsigned around;
+        double phase;
+        //Per ring, without the poles: where it sits along the bone as a
+        //fraction of its length plus a multiple of its radius, and its
+        //radius as a fraction of the bone's.
+        std::vector<double> ringAlong;
+        std::vector<double> ringCap;
+        std::vector<double> ringRadius;
+        //The rings at the start and the end of the bone.
+        unsigned startRing;
+        unsigned endRing;
+        unsigned verticesPerBone;
+        std::vector<int> triangles;
+        uint64_t topology;
+    };
+
+    void buildKeyframe(unsigned index, Keyframe& keyframe) const;
+    //Bone start and its axes on frame: along the bone, in the bending
+    //plane and out of it.
+    void bonePose(unsigned bone, unsigned frame, Vec3& start, Vec3 axes[3]) const;
+    double bend(unsigned joint, unsigned frame) const;
+    double boneRadius(unsigned bone) const;
+
+    CaptureOptions m_options;
+    std::vector<Keyframe> m_keyframes;
+};
+
+#endif //TRACKERCORE_SYNTHETICCAPTURE_H
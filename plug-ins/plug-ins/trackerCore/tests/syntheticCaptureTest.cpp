@@ -0,0 +1,140 @@
+#include "syntheticCapture.h"
+#include "trackingEngine.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    Vec3 centroid(const std::vector<float>& points, const std::vector<int>& ids)
+    {
+        Vec3 sum;
+        for (int id : ids)
+            sum += Vec3(points[id * 3], points[id * 3 + 1], points[id * 3 + 2]);
+        return sum / (double)ids.size();
+    }
+
+    //Tracks the whole capture and returns the mean and worst distance of
+    //the tracked joints from the true ones.
+    void trackCapture(const SyntheticCapture& capture, double& meanError, double& maxError)
+    {
+        TrackingEngine engine(2);
+        engine.setJoints(capture.vertexSets());
+        std::vector<float> current;
+        std::vector<float> next;
+        TrackFrame nextFrame = capture.frame(0, next);
+        meanError = 0;
+        maxError = 0;
+        for (unsigned f = 0; f < capture.numFrames(); f++)
+        {
+            current.swap(next);
+            TrackFrame currentFrame = nextFrame;
+            currentFrame.points = current.data();
+            nextFrame = f + 1 < capture.numFrames() ? capture.frame(f + 1, next) : TrackFrame();
+            ASSERT_TRUE(engine.trackFrame(currentFrame, nextFrame)) << "frame " << f;
+
+            for (unsigned j = 0; j < engine.numJoints(); j++)
+            {
+                double error = (engine.jointPosition(j) - capture.joint(j, f)).length();
+                meanError += error;
+                maxError = std::max(maxError, error);
+            }
+        }
+        meanError /= capture.numFrames() * capture.numJoints();
+    }
+}
+
+TEST(SyntheticCapture, CentresTheVertexSetsOnTheJoints)
+{
+    CaptureOptions options;
+    options.noise = 0;
+    options.numFrames = 40;
+    SyntheticCapture capture(options);
+    std::vector<std::vector<int>> sets = capture.vertexSets(8);
+    ASSERT_EQ(sets.size(), capture.numJoints());
+
+    std::vector<float> points;
+    for (unsigned f = 0; f < capture.numFrames(); f += 13)
+    {
+        TrackFrame frame = capture.frame(f, points);
+        ASSERT_EQ(frame.numVertices * 3, points.size());
+        for (unsigned j = 0; j < capture.numJoints(); j++)
+        {
+            ASSERT_EQ(sets[j].size(), 8u);
+            Vec3 error = centroid(points, sets[j]) - capture.joint(j, f);
+            EXPECT_LT(error.length(), 1e-4) << "frame " << f << " joint " << j;
+        }
+        for (unsigned j = 1; j + 1 < capture.numJoints(); j++)
+        {
+            double angle = localJointAngle(capture.joint(j - 1, f), capture.joint(j, f), capture.joint(j + 1, f));
+            EXPECT_NEAR(angle, capture.jointAngle(j, f), 1e-6) << "frame " << f << " joint " << j;
+        }
+    }
+}
+
+TEST(SyntheticCapture, RemeshesEveryInterval)
+{
+    CaptureOptions options;
+    options.numFrames = 25;
+    options.remeshInterval = 10;
+    SyntheticCapture capture(options);
+
+    std::vector<float> points;
+    TrackFrame first = capture.frame(0, points);
+    TrackFrame same = capture.frame(9, points);
+    TrackFrame second = capture.frame(10, points);
+    TrackFrame third = capture.frame(24, points);
+    EXPECT_EQ(first.topology, same.topology);
+    EXPECT_EQ(first.triangles, same.triangles);
+    EXPECT_NE(first.topology, second.topology);
+    EXPECT_NE(first.numVertices, second.numVertices);
+    EXPECT_NE(second.topology, third.topology);
+    EXPECT_EQ(capture.keyframe(24), 2u);
+
+    //Every vertex of every triangle exists.
+    for (unsigned t = 0; t < third.numTriangles * 3; t++)
+    {
+        ASSERT_GE(third.triangles[t], 0);
+        ASSERT_LT((unsigned)third.triangles[t], third.numVertices);
+    }
+}
+
+TEST(SyntheticCapture, FramesDoNotDependOnOrder)
+{
+    SyntheticCapture capture;
+    std::vector<float> a;
+    std::vector<float> b;
+    capture.frame(7, a);
+    capture.frame(3, b);
+    capture.frame(7, b);
+    EXPECT_EQ(a, b);
+}
+
+TEST(SyntheticCapture, TracksWithinAMillimetre)
+{
+    CaptureOptions options;
+    options.numFrames = 90;
+    SyntheticCapture capture(options);
+    double meanError;
+    double maxError;
+    trackCapture(capture, meanError, maxError);
+    EXPECT_LT(meanError, 0.05);
+    EXPECT_LT(maxError, 0.1);
+}
+
+TEST(SyntheticCapture, TracksAcrossKeyframeMeshes)
+{
+    CaptureOptions options;
+    options.numFrames = 90;
+    options.remeshInterval = 30;
+    SyntheticCapture capture(options);
+    double meanError;
+    double maxError;
+    trackCapture(capture, meanError, maxError);
+    //Each new mesh is searched, which costs some accuracy on its first
+    //frame.
+    EXPECT_LT(meanError, 0.2);
+    EXPECT_LT(maxError, 1.0);
+}
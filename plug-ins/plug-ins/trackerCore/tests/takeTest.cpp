@@ -0,0 +1,396 @@
+#include "take.h"
+#include "correspondence.h"
+#include "pointCache.h"
+#include "testMesh.h"
+#include "trajectory.h"
+#include "vertexSets.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+    //A sphere moving along x for numFrames frames from scene frame 1. The
+    //triangles are stored again on frame index newTopology, if given, and
+    //with remesh the sphere is tessellated anew there.
+    void writeTake(const std::string& cachePath, unsigned numFrames, unsigned newTopology = 0, bool remesh = false)
+    {
+        TestMesh mesh = makeSphere(16, 16, 1.0, Vec3());
+        PointCacheWriter writer;
+        writer.open(cachePath, 1);
+        for (unsigned i = 0; i < numFrames; i++)
+        {
+            if (remesh && i == newTopology && i > 0)
+                mesh = makeSphere(19, 23, 1.0, Vec3(0.05 * i, 0, 0));
+            bool triangles = i == 0 || i == newTopology;
+            writer.writeFrame(mesh.points.data(), mesh.numVertices(), triangles ? mesh.triangles.data() : nullptr,
+                              mesh.numTriangles());
+            translateMesh(mesh, Vec3(0.05, 0, 0));
+        }
+        writer.close();
+
+        std::string error;
+        writeVertexSets(vertexSetsPath(cachePath), {{20, 40}, {100, 120, 140}}, error);
+    }
+}
+
+TEST(Take, TracksACacheIntoATrajectory)
+{
+    std::string cachePath = ::testing::TempDir() + "take.vjpc";
+    writeTake(cachePath, 12);
+
+    TakeJob job;
+    job.cachePath = cachePath;
+    job.setsPath = vertexSetsPath(cachePath);
+    job.trajectoryPath = ::testing::TempDir() + "take.vjtr";
+    job.numThreads = 1;
+
+    TakeResult result = trackTake(job);
+    ASSERT_TRUE(result.ok) << result.error;
+    EXPECT_EQ(result.numJoints, 2u);
+    EXPECT_EQ(result.numFrames, 11u);
+    EXPECT_EQ(result.lost, 0u);
+
+    TrajectoryReader reader;
+    ASSERT_TRUE(reader.open(job.trajectoryPath)) << reader.error();
+    EXPECT_EQ(reader.numFrames(), 11u);
+    EXPECT_NEAR(reader.position(0, 10).x - reader.position(0, 0).x, 0.5, 1e-4);
+
+    reader.close();
+    std::remove(job.trajectoryPath.c_str());
+    std::remove(job.setsPath.c_str());
+    std::remove(cachePath.c_str());
+}
+
+TEST(Take, MissingCacheFails)
+{
+    TakeJob job;
+    job.cachePath = ::testing::TempDir() + "missing.vjpc";
+    job.setsPath = ::testing::TempDir() + "missing.sets";
+
+    TakeResult result = trackTake(job);
+    EXPECT_FALSE(result.ok);
+    EXPECT_FALSE(result.error.empty());
+}
+
+TEST(Take, ManifestDefaultsAndRelativePaths)
+{
+    std::string directory = ::testing::TempDir();
+    if (!directory.empty() && directory.back() != '/')
+        directory += "/";
+    std::string path = directory + "takes.txt";
+    {
+        std::ofstream manifest(path.c_str());
+        manifest << "# cache [sets [trajectory]]\n"
+                 << "takeA.vjpc\n"
+                 << "\n"
+                 << "sub/takeB.vjpc - /out/takeB.vjtr\n"
+                 << "takeC.vjpc shared.sets\n";
+    }
+
+    std::vector<TakeJob> jobs;
+    std::string error;
+    ASSERT_TRUE(readTakeManifest(path, jobs, error)) << error;
+    ASSERT_EQ(jobs.size(), 3u);
+
+    EXPECT_EQ(jobs[0].name, "takeA.vjpc");
+    EXPECT_EQ(jobs[0].cachePath, directory + "takeA.vjpc");
+    EXPECT_EQ(jobs[0].setsPath, directory + "takeA.sets");
+    EXPECT_EQ(jobs[0].trajectoryPath, directory + "takeA.vjtr");
+
+    EXPECT_EQ(jobs[1].name, "takeB.vjpc");
+    EXPECT_EQ(jobs[1].setsPath, directory + "sub/takeB.sets");
+    EXPECT_EQ(jobs[1].trajectoryPath, "/out/takeB.vjtr");
+
+    EXPECT_EQ(jobs[2].setsPath, directory + "shared.sets");
+
+    {
+        std::ofstream manifest(path.c_str());
+        manifest << "a.vjpc a.sets a.vjtr extra\n";
+    }
+    EXPECT_FALSE(readTakeManifest(path, jobs, error));
+    EXPECT_NE(error.find(":1:"), std::string::npos);
+    std::remove(path.c_str());
+}
+
+TEST(Take, ResumesFromTheLastCheckpoint)
+{
+    std::string cachePath = ::testing::TempDir() + "resume.vjpc";
+    writeTake(cachePath, 20);
+
+    TakeJob job;
+    job.cachePath = cachePath;
+    job.setsPath = vertexSetsPath(cachePath);
+    job.trajectoryPath = ::testing::TempDir() + "resumeStraight.vjtr";
+    job.numThreads = 1;
+    ASSERT_TRUE(trackTake(job).ok);
+
+    //A run that fails at the end, after its checkpoints, keeps the last.
+    TakeJob stopped = job;
+    stopped.trajectoryPath = ::testing::TempDir() + "missing/directory/resume.vjtr";
+    stopped.checkpointPath = ::testing::TempDir() + "resume.vjcp";
+    stopped.checkpointInterval = 6;
+    EXPECT_FALSE(trackTake(stopped).ok);
+    ASSERT_TRUE(std::ifstream(stopped.checkpointPath.c_str()).good());
+
+    TakeJob resumed = stopped;
+    resumed.trajectoryPath = ::testing::TempDir() + "resumed.vjtr";
+    resumed.resume = true;
+    TakeResult result = trackTake(resumed);
+    ASSERT_TRUE(result.ok) << result.error;
+    EXPECT_EQ(result.resumedFrames, 18u);
+    EXPECT_EQ(result.numFrames, 19u);
+    EXPECT_FALSE(std::ifstream(resumed.checkpointPath.c_str()).good());
+
+    TrajectoryReader straight;
+    TrajectoryReader reader;
+    ASSERT_TRUE(straight.open(job.trajectoryPath)) << straight.error();
+    ASSERT_TRUE(reader.open(resumed.trajectoryPath)) << reader.error();
+    ASSERT_EQ(reader.numFrames(), straight.numFrames());
+    for (unsigned j = 0; j < 2; j++)
+    {
+        for (unsigned f = 0; f < reader.numFrames(); f++)
+            EXPECT_EQ(reader.channel(j, kPositionX)[f], straight.channel(j, kPositionX)[f]) << f;
+    }
+
+    //Resuming with other vertex sets is refused.
+    std::string error;
+    writeVertexSets(job.setsPath, {{20, 40}}, error);
+    resumed.resume = false;
+    resumed.checkpointInterval = 5;
+    resumed.endFrame = 8;
+    resumed.trajectoryPath = ::testing::TempDir() + "missing/directory/resume.vjtr";
+    EXPECT_FALSE(trackTake(resumed).ok);
+    writeVertexSets(job.setsPath, {{20, 40}, {100, 120, 140}}, error);
+    resumed.resume = true;
+    result = trackTake(resumed);
+    EXPECT_FALSE(result.ok);
+    EXPECT_NE(result.error.find("other vertex sets"), std::string::npos) << result.error;
+
+    reader.close();
+    straight.close();
+    std::remove(resumed.checkpointPath.c_str());
+    std::remove(job.trajectoryPath.c_str());
+    std::remove(::testing::TempDir().append("resumed.vjtr").c_str());
+    std::remove(job.setsPath.c_str());
+    std::remove(cachePath.c_str());
+}
+
+TEST(Take, ChunksStitchIntoTheWholeTake)
+{
+    std::string cachePath = ::testing::TempDir() + "chunks.vjpc";
+    writeTake(cachePath, 24);
+
+    TakeJob job;
+    job.name = "chunks";
+    job.cachePath = cachePath;
+    job.setsPath = vertexSetsPath(cachePath);
+    job.trajectoryPath = ::testing::TempDir() + "chunksStraight.vjtr";
+    job.numThreads = 1;
+    ASSERT_TRUE(trackTake(job).ok);
+
+    TakeJob chunked = job;
+    chunked.trajectoryPath = ::testing::TempDir() + "chunked.vjtr";
+    std::vector<TakeJob> chunks;
+    std::string error;
+    ASSERT_TRUE(splitTake(chunked, 8, 3, chunks, error)) << error;
+    ASSERT_EQ(chunks.size(), 3u);
+    EXPECT_EQ(chunks[0].startFrame, 1.0);
+    EXPECT_EQ(chunks[0].endFrame, 9.0);
+    EXPECT_EQ(chunks[1].startFrame, 6.0);
+    EXPECT_EQ(chunks[1].endFrame, 17.0);
+    EXPECT_EQ(chunks[2].startFrame, 14.0);
+    EXPECT_EQ(chunks[2].endFrame, 24.0);
+
+    std::vector<TakeResult> results;
+    for (const TakeJob& chunk : chunks)
+        results.push_back(trackTake(chunk));
+    TakeResult result = joinTake(chunked, chunks, results);
+    ASSERT_TRUE(result.ok) << result.error;
+    EXPECT_EQ(result.numFrames, 23u);
+    EXPECT_FALSE(std::ifstream(chunks[0].trajectoryPath.c_str()).good());
+
+    TrajectoryReader straight;
+    TrajectoryReader stitched;
+    ASSERT_TRUE(straight.open(job.trajectoryPath)) << straight.error();
+    ASSERT_TRUE(stitched.open(chunked.trajectoryPath)) << stitched.error();
+    ASSERT_EQ(stitched.numFrames(), straight.numFrames());
+    EXPECT_EQ(stitched.startFrame(), straight.startFrame());
+    for (unsigned j = 0; j < 2; j++)
+    {
+        for (unsigned f = 0; f < stitched.numFrames(); f++)
+            EXPECT_LT((stitched.position(j, f) - straight.position(j, f)).length(), 1e-5) << f;
+    }
+
+    stitched.close();
+    straight.close();
+    std::remove(job.trajectoryPath.c_str());
+    std::remove(chunked.trajectoryPath.c_str());
+    std::remove(job.setsPath.c_str());
+    std::remove(cachePath.c_str());
+}
+
+TEST(Take, ChunksCarryTheSetsOntoNewMeshes)
+{
+    std::string cachePath = ::testing::TempDir() + "retopo.vjpc";
+    writeTake(cachePath, 24, 10, true);
+
+    TakeJob job;
+    job.name = "retopo";
+    job.cachePath = cachePath;
+    job.setsPath = vertexSetsPath(cachePath);
+    job.trajectoryPath = ::testing::TempDir() + "retopo.vjtr";
+    job.correspondencePath = correspondencePath(cachePath);
+    job.numThreads = 2;
+    std::remove(job.correspondencePath.c_str());
+    ASSERT_TRUE(trackTake(job).ok);
+    TrajectoryReader straight;
+    ASSERT_TRUE(straight.open(job.trajectoryPath)) << straight.error();
+
+    //The cache starts on scene frame 1, so the new mesh is on frame 11.
+    //The last chunk starts on it for overlaps up to 6. At 7 it would start
+    //on frame 10, the frame before the new mesh, and moves back a frame.
+    TakeJob chunked = job;
+    chunked.trajectoryPath = ::testing::TempDir() + "retopo_chunked.vjtr";
+    for (unsigned overlap = 1; overlap <= 8; overlap++)
+    {
+        std::vector<TakeJob> chunks;
+        std::string error;
+        ASSERT_TRUE(splitTake(chunked, 8, overlap, chunks, error)) << error;
+        ASSERT_EQ(chunks.size(), 3u);
+        EXPECT_TRUE(chunks[1].startSets.empty());
+        EXPECT_EQ(chunks[2].startSets.empty(), overlap >= 7) << overlap;
+        EXPECT_NE(chunks[2].startFrame, 10.0) << overlap;
+
+        //The map was saved on the first split and every chunk reuses it.
+        std::vector<TakeResult> results;
+        for (const TakeJob& chunk : chunks)
+        {
+            results.push_back(trackTake(chunk));
+            EXPECT_EQ(results.back().mapsComputed, 0u) << overlap;
+        }
+        TakeResult result = joinTake(chunked, chunks, results);
+        ASSERT_TRUE(result.ok) << result.error;
+        EXPECT_EQ(result.lost, 0u);
+
+        //Within a fraction of an edge of the take tracked in one go, as
+        //the carried sets land on the nearest new vertices, and surface
+        //points within an edge of the new mesh, about 0.27.
+        TrajectoryReader stitched;
+        ASSERT_TRUE(stitched.open(chunked.trajectoryPath)) << stitched.error();
+        ASSERT_EQ(stitched.numFrames(), straight.numFrames());
+        for (unsigned j = 0; j < 2; j++)
+        {
+            ASSERT_EQ(stitched.numPoints(j), straight.numPoints(j));
+            for (unsigned f = 0; f < stitched.numFrames(); f++)
+            {
+                EXPECT_LT((stitched.position(j, f) - straight.position(j, f)).length(), 0.1)
+                    << "overlap " << overlap << " frame " << f;
+                for (unsigned p = 0; p < stitched.numPoints(j); p++)
+                {
+                    Vec3 point(stitched.surfacePoint(j, p, 0)[f], stitched.surfacePoint(j, p, 1)[f],
+                               stitched.surfacePoint(j, p, 2)[f]);
+                    Vec3 expected(straight.surfacePoint(j, p, 0)[f], straight.surfacePoint(j, p, 1)[f],
+                                  straight.surfacePoint(j, p, 2)[f]);
+                    EXPECT_LT((point - expected).length(), 0.2)
+                        << "overlap " << overlap << " frame " << f << " point " << p;
+                }
+            }
+        }
+        stitched.close();
+    }
+
+    straight.close();
+    std::remove(job.trajectoryPath.c_str());
+    std::remove(chunked.trajectoryPath.c_str());
+    std::remove(job.correspondencePath.c_str());
+    std::remove(job.setsPath.c_str());
+    std::remove(cachePath.c_str());
+}
+
+TEST(Take, ComputesCorrespondenceMapsOnce)
+{
+    std::string cachePath = ::testing::TempDir() + "take_remesh.vjpc";
+    writeTake(cachePath, 12, 6, true);
+
+    TakeJob job;
+    job.cachePath = cachePath;
+    job.setsPath = vertexSetsPath(cachePath);
+    job.trajectoryPath = ::testing::TempDir() + "take_remesh.vjtr";
+    job.correspondencePath = correspondencePath(cachePath);
+    job.numThreads = 2;
+    std::remove(job.correspondencePath.c_str());
+
+    TakeResult result = trackTake(job);
+    ASSERT_TRUE(result.ok) << result.error;
+    EXPECT_EQ(result.topologyChanges, 1u);
+    EXPECT_EQ(result.mapsComputed, 1u);
+    EXPECT_EQ(result.mapsReused, 0u);
+    EXPECT_EQ(result.lost, 0u);
+
+    TrajectoryReader reader;
+    ASSERT_TRUE(reader.open(job.trajectoryPath)) << reader.error();
+    std::vector<Vec3> positions;
+    for (unsigned f = 0; f < reader.numFrames(); f++)
+        positions.push_back(reader.position(0, f));
+    reader.close();
+    EXPECT_NEAR(positions[10].x - positions[0].x, 0.5, 1e-2);
+
+    //The rerun reads the map back and tracks the same.
+    result = trackTake(job);
+    ASSERT_TRUE(result.ok) << result.error;
+    EXPECT_EQ(result.mapsComputed, 0u);
+    EXPECT_EQ(result.mapsReused, 1u);
+    ASSERT_TRUE(reader.open(job.trajectoryPath)) << reader.error();
+    for (unsigned f = 0; f < reader.numFrames(); f++)
+        EXPECT_EQ((reader.position(0, f) - positions[f]).length(), 0) << f;
+
+    reader.close();
+    std::remove(job.correspondencePath.c_str());
+    std::remove(job.trajectoryPath.c_str());
+    std::remove(job.setsPath.c_str());
+    std::remove(cachePath.c_str());
+}
+
+TEST(Take, PipelineTracksTheSameAsALoop)
+{
+    std::string cachePath = ::testing::TempDir() + "pipeline.vjpc";
+    writeTake(cachePath, 30, 12, true);
+
+    TakeJob loop;
+    loop.cachePath = cachePath;
+    loop.setsPath = vertexSetsPath(cachePath);
+    loop.csvPath = ::testing::TempDir() + "loop.csv";
+    loop.correspondencePath = correspondencePath(cachePath);
+    loop.numThreads = 2;
+    loop.pipelineDepth = 0;
+    TakeResult looped = trackTake(loop);
+    ASSERT_TRUE(looped.ok) << looped.error;
+    EXPECT_EQ(looped.mapsComputed, 1u);
+
+    TakeJob job = loop;
+    job.csvPath = ::testing::TempDir() + "pipelined.csv";
+    job.pipelineDepth = 3;
+    TakeResult pipelined = trackTake(job);
+    ASSERT_TRUE(pipelined.ok) << pipelined.error;
+    EXPECT_EQ(pipelined.numFrames, looped.numFrames);
+    EXPECT_EQ(pipelined.lost, looped.lost);
+    EXPECT_EQ(pipelined.topologyChanges, 1u);
+    EXPECT_EQ(pipelined.mapsReused, 1u);
+
+    std::ifstream a(job.csvPath.c_str());
+    std::ifstream b(loop.csvPath.c_str());
+    std::string actual((std::istreambuf_iterator<char>(a)), std::istreambuf_iterator<char>());
+    std::string expected((std::istreambuf_iterator<char>(b)), std::istreambuf_iterator<char>());
+    EXPECT_GT(expected.size(), 100u);
+    EXPECT_EQ(actual, expected);
+
+    std::remove(job.csvPath.c_str());
+    std::remove(loop.csvPath.c_str());
+    std::remove(job.correspondencePath.c_str());
+    std::remove(job.setsPath.c_str());
+    std::remove(cachePath.c_str());
+}
@@ -0,0 +1,59 @@
+//
+// Small procedural meshes for the trackerCore tests and benchmarks.
+//
+#include "testMesh.h"
+
+#include <cmath>
+
+TrackFrame TestMesh::trackFrame() const
+{
+    TrackFrame frame;
+    frame.points = points.data();
+    frame.numVertices = numVertices();
+    frame.triangles = triangles.data();
+    frame.numTriangles = numTriangles();
+    return frame;
+}
+
+TestMesh makeSphere(unsigned rows, unsigned columns, double radius, const Vec3& center)
+{
+    const double pi = 3.14159265358979323846;
+    TestMesh mesh;
+    mesh.points.reserve(rows * columns * 3);
+
+    for (unsigned row = 0; row < rows; row++)
+    {
+        double theta = pi * row / (rows - 1);
+        for (unsigned column = 0; column < columns; column++)
+        {
+            double phi = 2 * pi * column / columns;
+            mesh.points.push_back((float)(center.x + radius * std::sin(theta) * std::cos(phi)));
+            mesh.points.push_back((float)(center.y + radius * std::sin(theta) * std::sin(phi)));
+            mesh.points.push_back((float)(center.z + radius * std::cos(theta)));
+        }
+    }
+
+    for (unsigned row = 0; row + 1 < rows; row++)
+    {
+        for (unsigned column = 0; column < columns; column++)
+        {
+            int a = row * columns + column;
+            int b = row * columns + (column + 1) % columns;
+            int c = (row + 1) * columns + column;
+            int d = (row + 1) * columns + (column + 1) % columns;
+            int quad[] = {a, b, c, b, d, c};
+            mesh.triangles.insert(mesh.triangles.end(), quad, quad + 6);
+        }
+    }
+    return mesh;
+}
+
+void translateMesh(TestMesh& mesh, const Vec3& offset)
+{
+    for (size_t i = 0; i < mesh.points.size(); i += 3)
+    {
+        mesh.points[i] += (float)offset.x;
+        mesh.points[i + 1] += (float)offset.y;
+        mesh.points[i + 2] += (float)offset.z;
+    }
+}
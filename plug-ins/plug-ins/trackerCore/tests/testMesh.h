@@ -0,0 +1,29 @@
+//
+// Small procedural meshes for the trackerCore tests and benchmarks.
+//
+#ifndef TRACKERCORE_TESTMESH_H
+#define TRACKERCORE_TESTMESH_H
+
+#include "trackingEngine.h"
+#include "vec3.h"
+
+#include <vector>
+
+struct TestMesh
+{
+    std::vector<float> points;
+    std::vector<int> triangles;
+
+    unsigned numVertices() const { return (unsigned)points.size() / 3; }
+    unsigned numTriangles() const { return (unsigned)triangles.size() / 3; }
+    Vec3 vertex(int id) const { return Vec3(points[id * 3], points[id * 3 + 1], points[id * 3 + 2]); }
+    TrackFrame trackFrame() const;
+};
+
+//UV sphere with rows x columns vertices (poles included as rings).
+TestMesh makeSphere(unsigned rows, unsigned columns, double radius, const Vec3& center);
+
+//Moves every vertex by offset.
+void translateMesh(TestMesh& mesh, const Vec3& offset);
+
+#endif //TRACKERCORE_TESTMESH_H
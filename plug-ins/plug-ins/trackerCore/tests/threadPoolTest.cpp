@@ -0,0 +1,31 @@
+#include "threadPool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+
+TEST(ThreadPool, RunsEveryIndexOnce)
+{
+    ThreadPool pool(4);
+    EXPECT_EQ(pool.numThreads(), 4u);
+
+    for (unsigned loop = 0; loop < 50; loop++)
+    {
+        std::vector<std::atomic<int>> counts(97);
+        for (std::atomic<int>& count : counts)
+            count = 0;
+
+        pool.parallelFor((unsigned)counts.size(), [&counts](unsigned i) { counts[i]++; });
+
+        for (std::atomic<int>& count : counts)
+            EXPECT_EQ(count.load(), 1);
+    }
+}
+
+TEST(ThreadPool, SingleThreadRunsInline)
+{
+    ThreadPool pool(1);
+    unsigned sum = 0;
+    pool.parallelFor(10, [&sum](unsigned i) { sum += i; });
+    EXPECT_EQ(sum, 45u);
+}
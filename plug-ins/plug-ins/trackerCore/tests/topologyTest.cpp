@@ -0,0 +1,61 @@
+#include "topology.h"
+#include "testMesh.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+TEST(Topology, SameConnectivitySameFingerprint)
+{
+    TestMesh a = makeSphere(10, 12, 1.0, Vec3());
+    TestMesh b = makeSphere(10, 12, 3.0, Vec3(1, 2, 3));
+
+    uint64_t fingerprint = topologyFingerprint(a.numVertices(), a.triangles.data(), a.numTriangles());
+    EXPECT_NE(fingerprint, kNoTopology);
+    EXPECT_EQ(fingerprint, topologyFingerprint(b.numVertices(), b.triangles.data(), b.numTriangles()));
+}
+
+TEST(Topology, SameVertexCountDifferentConnectivity)
+{
+    //A keyframe mesh can keep the vertex count and still rewire faces.
+    TestMesh a = makeSphere(10, 12, 1.0, Vec3());
+    TestMesh b = a;
+    std::swap(b.triangles[4], b.triangles[5]);
+
+    EXPECT_NE(topologyFingerprint(a.numVertices(), a.triangles.data(), a.numTriangles()),
+              topologyFingerprint(b.numVertices(), b.triangles.data(), b.numTriangles()));
+}
+
+TEST(Topology, TrianglesMatchPolygonForm)
+{
+    TestMesh mesh = makeSphere(6, 6, 1.0, Vec3());
+    std::vector<int> counts(mesh.numTriangles(), 3);
+
+    EXPECT_EQ(topologyFingerprint(mesh.numVertices(), mesh.triangles.data(), mesh.numTriangles()),
+              topologyFingerprint(mesh.numVertices(), counts.data(), (unsigned)counts.size(),
+                                  mesh.triangles.data(), (unsigned)mesh.triangles.size()));
+}
+
+TEST(Topology, PolygonCountsAreHashed)
+{
+    //Same face vertex list split into different faces.
+    int vertices[] = {0, 1, 2, 3, 4, 5};
+    int quadAndTwo[] = {4, 2};
+    int twoAndQuad[] = {2, 4};
+
+    EXPECT_NE(topologyFingerprint(6, quadAndTwo, 2, vertices, 6), topologyFingerprint(6, twoAndQuad, 2, vertices, 6));
+}
+
+TEST(Topology, FrameFingerprintFollowsPoints)
+{
+    TestMesh mesh = makeSphere(10, 12, 1.0, Vec3());
+    uint64_t topology = topologyFingerprint(mesh.numVertices(), mesh.triangles.data(), mesh.numTriangles());
+    uint64_t fingerprint = frameFingerprint(topology, mesh.points.data(), mesh.numVertices());
+    EXPECT_NE(fingerprint, kNoTopology);
+    EXPECT_EQ(fingerprint, frameFingerprint(topology, mesh.points.data(), mesh.numVertices()));
+
+    mesh.points[7] += 0.001f;
+    EXPECT_NE(fingerprint, frameFingerprint(topology, mesh.points.data(), mesh.numVertices()));
+    mesh.points[7] -= 0.001f;
+    EXPECT_NE(fingerprint, frameFingerprint(topology + 1, mesh.points.data(), mesh.numVertices()));
+}
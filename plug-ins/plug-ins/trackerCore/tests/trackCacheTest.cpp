@@ -0,0 +1,200 @@
+#include "trackCache.h"
+#include "testMesh.h"
+#include "topology.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace
+{
+    const unsigned kColumns = 30;
+
+    std::vector<std::vector<int>> jointSets()
+    {
+        std::vector<std::vector<int>> sets;
+        for (unsigned j = 0; j < 4; j++)
+            sets.push_back({(int)((6 + j * 4) * kColumns + 2), (int)((6 + j * 4) * kColumns + 17)});
+        return sets;
+    }
+
+    //A sphere moving along x, frame f at x = 0.02 f.
+    std::vector<TestMesh> makeSequence(unsigned numFrames)
+    {
+        std::vector<TestMesh> frames;
+        TestMesh mesh = makeSphere(30, kColumns, 1.0, Vec3());
+        for (unsigned f = 0; f < numFrames; f++)
+        {
+            frames.push_back(mesh);
+            translateMesh(mesh, Vec3(0.02, 0, 0));
+        }
+        return frames;
+    }
+
+    //The frames are separate copies, so they need a fingerprint to be
+    //seen as one topology.
+    TrackFrame trackFrame(const TestMesh& mesh)
+    {
+        TrackFrame frame = mesh.trackFrame();
+        frame.topology = topologyFingerprint(mesh.numVertices(), mesh.triangles.data(), mesh.numTriangles());
+        return frame;
+    }
+
+    uint64_t fingerprint(const TestMesh& mesh)
+    {
+        return frameFingerprint(trackFrame(mesh).topology, mesh.points.data(), mesh.numVertices());
+    }
+
+    //Tracks up to and including frame, the way the jointTracker node does.
+    void trackTo(TrackCache& cache, const std::vector<TestMesh>& frames, int frame)
+    {
+        while (!cache.cached(frame))
+        {
+            int f = cache.nextFrame();
+            const TestMesh& current = frames[f - cache.startFrame()];
+            TrackFrame next;
+            if (cache.readsNext() && f + 1 - cache.startFrame() < (int)frames.size())
+                next = trackFrame(frames[f + 1 - cache.startFrame()]);
+            cache.track(trackFrame(current), next, fingerprint(current));
+        }
+    }
+}
+
+TEST(TrackCache, MatchesAStraightRun)
+{
+    std::vector<TestMesh> frames = makeSequence(12);
+    TrackingEngine engine(2);
+    engine.setJoints(jointSets());
+
+    TrackCache cache(2);
+    cache.setJoints(jointSets());
+    cache.setStartFrame(10);
+    trackTo(cache, frames, 21);
+    EXPECT_EQ(cache.endFrame(), 22);
+    EXPECT_EQ(cache.framesTracked(), 12u);
+
+    for (unsigned f = 0; f < frames.size(); f++)
+    {
+        TrackFrame next = f + 1 < frames.size() ? trackFrame(frames[f + 1]) : TrackFrame();
+        engine.trackFrame(trackFrame(frames[f]), next);
+        for (unsigned j = 0; j < engine.numJoints(); j++)
+        {
+            EXPECT_TRUE(cache.tracked(10 + f, j));
+            EXPECT_EQ(cache.position(10 + f, j).x, engine.jointPosition(j).x);
+            EXPECT_EQ(cache.confidence(10 + f, j), engine.jointConfidence(j));
+        }
+    }
+}
+
+TEST(TrackCache, ScrubbingBackReusesFrames)
+{
+    std::vector<TestMesh> frames = makeSequence(10);
+    TrackCache cache(1);
+    cache.setJoints(jointSets());
+    cache.setStartFrame(0);
+    trackTo(cache, frames, 9);
+
+    for (int f = 9; f >= 0; f--)
+    {
+        EXPECT_TRUE(cache.validate(f, fingerprint(frames[f])));
+        trackTo(cache, frames, f);
+    }
+    EXPECT_EQ(cache.framesTracked(), 10u);
+
+    //Same sets and start frame keep everything.
+    cache.setJoints(jointSets());
+    cache.setStartFrame(0);
+    EXPECT_EQ(cache.endFrame(), 10);
+}
+
+TEST(TrackCache, ChangedMeshDropsLaterFrames)
+{
+    std::vector<TestMesh> frames = makeSequence(10);
+    TrackCache cache(1);
+    cache.setJoints(jointSets());
+    cache.setStartFrame(0);
+    trackTo(cache, frames, 9);
+    Vec3 before = cache.position(3, 0);
+
+    //An edit upstream moves the mesh from frame 6 on.
+    for (unsigned f = 6; f < frames.size(); f++)
+        translateMesh(frames[f], Vec3(0, 0.05, 0));
+
+    EXPECT_TRUE(cache.validate(3, fingerprint(frames[3])));
+    EXPECT_FALSE(cache.validate(6, fingerprint(frames[6])));
+    EXPECT_EQ(cache.endFrame(), 6);
+    EXPECT_TRUE(cache.cached(5));
+    EXPECT_FALSE(cache.cached(6));
+
+    //Frames before the edit stay cached but are tracked again to get the
+    //track back to frame 6.
+    EXPECT_EQ(cache.nextFrame(), 0);
+    trackTo(cache, frames, 9);
+    EXPECT_EQ(cache.framesTracked(), 20u);
+    EXPECT_EQ(cache.position(3, 0).x, before.x);
+    EXPECT_TRUE(cache.validate(8, fingerprint(frames[8])));
+    EXPECT_NEAR(cache.position(8, 0).y - cache.position(5, 0).y, 0.05, 1e-6);
+}
+
+TEST(TrackCache, ChangedSetsTrackOnlyThoseJointsAgain)
+{
+    std::vector<TestMesh> frames = makeSequence(14);
+    TrackCache cache(1);
+    cache.setJoints(jointSets());
+    cache.setStartFrame(0);
+    trackTo(cache, frames, 9);
+    Vec3 kept = cache.position(9, 0);
+
+    std::vector<std::vector<int>> sets = jointSets();
+    sets[2] = {(int)(3 * kColumns + 5), (int)(3 * kColumns + 9), (int)(4 * kColumns + 5)};
+    cache.setJoints(sets);
+    EXPECT_EQ(cache.endFrame(), 10);
+    EXPECT_EQ(cache.nextFrame(), 0);
+
+    //Joint 3 catches up only as far as it is asked for.
+    trackTo(cache, frames, 4);
+    EXPECT_TRUE(cache.cached(4));
+    EXPECT_FALSE(cache.cached(5));
+    EXPECT_EQ(cache.nextFrame(), 5);
+
+    //Then carries on with the others past where they were.
+    trackTo(cache, frames, 13);
+    EXPECT_EQ(cache.framesTracked(), 24u);
+    EXPECT_EQ(cache.position(9, 0).x, kept.x);
+
+    TrackCache fresh(1);
+    fresh.setJoints(sets);
+    fresh.setStartFrame(0);
+    trackTo(fresh, frames, 13);
+    for (int f = 0; f < 14; f++)
+    {
+        for (unsigned j = 0; j < cache.numJoints(); j++)
+        {
+            EXPECT_TRUE(cache.tracked(f, j));
+            EXPECT_EQ(cache.position(f, j).x, fresh.position(f, j).x) << f << " " << j;
+            EXPECT_EQ(cache.position(f, j).z, fresh.position(f, j).z) << f << " " << j;
+            EXPECT_EQ(cache.confidence(f, j), fresh.confidence(f, j)) << f << " " << j;
+        }
+    }
+}
+
+TEST(TrackCache, NewInputsDropEverything)
+{
+    std::vector<TestMesh> frames = makeSequence(6);
+    TrackCache cache(1);
+    cache.setJoints(jointSets());
+    cache.setStartFrame(0);
+    trackTo(cache, frames, 5);
+
+    std::vector<std::vector<int>> sets = jointSets();
+    sets.pop_back();
+    cache.setJoints(sets);
+    EXPECT_EQ(cache.numJoints(), 3u);
+    EXPECT_FALSE(cache.cached(0));
+    EXPECT_EQ(cache.nextFrame(), 0);
+    trackTo(cache, frames, 2);
+
+    cache.setStartFrame(1);
+    EXPECT_FALSE(cache.cached(1));
+    EXPECT_EQ(cache.nextFrame(), 1);
+}
@@ -0,0 +1,264 @@
+#include "trackingEngine.h"
+#include "correspondence.h"
+#include "testMesh.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+namespace
+{
+    Vec3 expectedCentroid(const TestMesh& mesh, const std::vector<int>& ids)
+    {
+        Vec3 sum;
+        for (int id : ids)
+            sum += mesh.vertex(id);
+        return sum / (double)ids.size();
+    }
+}
+
+TEST(TrackingEngine, FollowsRigidMotion)
+{
+    const unsigned columns = 40;
+    TestMesh mesh = makeSphere(40, columns, 1.0, Vec3());
+    std::vector<std::vector<int>> sets;
+    for (unsigned j = 0; j < 12; j++)
+        sets.push_back({(int)((5 + j * 2) * columns + 3), (int)((5 + j * 2) * columns + 23)});
+
+    TrackingEngine engine(3);
+    engine.setJoints(sets);
+    EXPECT_EQ(engine.numJoints(), 12u);
+
+    //Constant velocity, which the predictor models exactly.
+    TestMesh next = mesh;
+    for (unsigned frame = 0; frame < 20; frame++)
+    {
+        TestMesh current = next;
+        translateMesh(next, Vec3(0.02, 0.01, 0));
+
+        ASSERT_TRUE(engine.trackFrame(current.trackFrame(), next.trackFrame())) << "frame " << frame;
+        for (unsigned j = 0; j < engine.numJoints(); j++)
+        {
+            Vec3 error = engine.jointPosition(j) - expectedCentroid(current, sets[j]);
+            EXPECT_LT(error.length(), 1e-4) << "frame " << frame << " joint " << j;
+        }
+    }
+    EXPECT_EQ(engine.framesTracked(), 20u);
+}
+
+TEST(TrackingEngine, InvalidVertexIdLosesTrack)
+{
+    TestMesh mesh = makeSphere(8, 8, 1.0, Vec3());
+    TrackingEngine engine(1);
+    engine.setJoints({{0, 1}, {2, 100000}});
+
+    EXPECT_FALSE(engine.trackFrame(mesh.trackFrame(), mesh.trackFrame()));
+    EXPECT_TRUE(engine.jointTracked(0));
+    EXPECT_FALSE(engine.jointTracked(1));
+}
+
+TEST(TrackingEngine, FollowsVertexIdsWhileTopologyHolds)
+{
+    const unsigned columns = 30;
+    TestMesh rest = makeSphere(30, columns, 1.0, Vec3());
+    std::vector<std::vector<int>> sets = {{(int)(10 * columns + 3), (int)(12 * columns + 7)},
+                                          {(int)(20 * columns + 11), (int)(21 * columns + 29)}};
+    uint64_t topology = topologyFingerprint(rest.numVertices(), rest.triangles.data(), rest.numTriangles());
+
+    TrackingEngine engine(2);
+    engine.setJoints(sets);
+
+    //Every vertex moves differently, which a surface search could not
+    //follow exactly.
+    std::vector<TestMesh> frames;
+    for (unsigned frame = 0; frame < 12; frame++)
+    {
+        TestMesh mesh = rest;
+        for (size_t i = 0; i < mesh.points.size(); i++)
+            mesh.points[i] += (float)(0.05 * std::sin(0.3 * frame + 0.7 * i));
+        frames.push_back(mesh);
+    }
+
+    for (unsigned frame = 0; frame + 1 < frames.size(); frame++)
+    {
+        TrackFrame current = frames[frame].trackFrame();
+        TrackFrame next = frames[frame + 1].trackFrame();
+        current.topology = next.topology = topology;
+
+        ASSERT_TRUE(engine.trackFrame(current, next)) << "frame " << frame;
+        for (unsigned j = 0; j < engine.numJoints(); j++)
+        {
+            Vec3 error = engine.jointPosition(j) - expectedCentroid(frames[frame], sets[j]);
+            EXPECT_LT(error.length(), 1e-6) << "frame " << frame << " joint " << j;
+        }
+    }
+    EXPECT_EQ(engine.topologyChanges(), 0u);
+}
+
+TEST(TrackingEngine, SearchesSurfaceAtTopologyChange)
+{
+    const unsigned columns = 40;
+    TestMesh first = makeSphere(40, columns, 1.0, Vec3());
+    TestMesh second = makeSphere(47, 53, 1.0, Vec3());
+    std::vector<std::vector<int>> sets = {{(int)(12 * columns + 5), (int)(14 * columns + 9)},
+                                          {(int)(25 * columns + 30), (int)(27 * columns + 31)}};
+    std::vector<Vec3> expected;
+    for (const std::vector<int>& ids : sets)
+        expected.push_back(expectedCentroid(first, ids));
+
+    TrackingEngine engine(2);
+    engine.setJoints(sets);
+
+    //The first topology runs for 5 frames, then the keyframe mesh
+    //changes while the motion carries on.
+    const Vec3 step(0.01, -0.02, 0.005);
+    for (unsigned frame = 0; frame < 10; frame++)
+    {
+        TestMesh current = frame < 5 ? first : second;
+        TestMesh next = frame + 1 < 5 ? first : second;
+        translateMesh(current, step * frame);
+        translateMesh(next, step * (frame + 1));
+
+        TrackFrame currentFrame = current.trackFrame();
+        TrackFrame nextFrame = next.trackFrame();
+        currentFrame.topology = frame < 5 ? 1 : 2;
+        nextFrame.topology = frame + 1 < 5 ? 1 : 2;
+
+        ASSERT_TRUE(engine.trackFrame(currentFrame, nextFrame)) << "frame " << frame;
+        for (unsigned j = 0; j < engine.numJoints(); j++)
+        {
+            //The surface search lands on the new tessellation, a little
+            //off the old one.
+            Vec3 error = engine.jointPosition(j) - (expected[j] + step * frame);
+            EXPECT_LT(error.length(), frame < 5 ? 1e-5 : 1e-2) << "frame " << frame << " joint " << j;
+        }
+
+        //After the search the new topology is followed exactly.
+        if (frame > 5)
+        {
+            for (unsigned j = 0; j < engine.numJoints(); j++)
+                EXPECT_LT((engine.jointVelocity(j) - step).length(), 1e-5) << "frame " << frame << " joint " << j;
+        }
+    }
+    EXPECT_EQ(engine.topologyChanges(), 1u);
+}
+
+TEST(TrackingEngine, SearchesATopologyChangeOnTheSecondFrame)
+{
+    const unsigned columns = 40;
+    TestMesh first = makeSphere(40, columns, 1.0, Vec3());
+    TestMesh second = makeSphere(47, 53, 1.0, Vec3());
+    std::vector<std::vector<int>> sets = {{(int)(12 * columns + 5), (int)(14 * columns + 9)},
+                                          {(int)(25 * columns + 30), (int)(27 * columns + 31)}};
+    std::vector<Vec3> expected;
+    for (const std::vector<int>& ids : sets)
+        expected.push_back(expectedCentroid(first, ids));
+
+    TrackingEngine engine(2);
+    engine.setJoints(sets);
+
+    //The selection's vertex IDs mean nothing on the mesh of frame 1.
+    const Vec3 step(0.01, -0.02, 0.005);
+    for (unsigned frame = 0; frame < 4; frame++)
+    {
+        TestMesh current = frame < 1 ? first : second;
+        TestMesh next = second;
+        translateMesh(current, step * frame);
+        translateMesh(next, step * (frame + 1));
+
+        TrackFrame currentFrame = current.trackFrame();
+        TrackFrame nextFrame = next.trackFrame();
+        currentFrame.topology = frame < 1 ? 1 : 2;
+        nextFrame.topology = 2;
+
+        //With no motion to predict from yet, the search lands where the
+        //points were, within a frame's motion of where they are.
+        ASSERT_TRUE(engine.trackFrame(currentFrame, nextFrame)) << "frame " << frame;
+        for (unsigned j = 0; j < engine.numJoints(); j++)
+        {
+            Vec3 error = engine.jointPosition(j) - (expected[j] + step * frame);
+            EXPECT_LT(error.length(), frame < 1 ? 1e-5 : step.length()) << "frame " << frame << " joint " << j;
+        }
+    }
+    EXPECT_EQ(engine.topologyChanges(), 1u);
+}
+
+TEST(TrackingEngine, CarriesPointsOverTopologyChange)
+{
+    const unsigned columns = 40;
+    TestMesh first = makeSphere(40, columns, 1.0, Vec3());
+    TestMesh second = makeSphere(47, 53, 1.0, Vec3());
+    std::vector<std::vector<int>> sets = {{(int)(12 * columns + 5), (int)(14 * columns + 9)},
+                                          {(int)(25 * columns + 30), (int)(27 * columns + 31)}};
+    std::vector<Vec3> expected;
+    for (const std::vector<int>& ids : sets)
+        expected.push_back(expectedCentroid(first, ids));
+
+    ThreadPool pool(2);
+    TrackingEngine engine(2);
+    engine.setJoints(sets);
+
+    //The same take as SearchesSurfaceAtTopologyChange, but the switch
+    //comes with a map from the last frame of the old mesh.
+    const Vec3 step(0.01, -0.02, 0.005);
+    TestMesh previous;
+    TestMesh beforePrevious;
+    VertexCorrespondence map;
+    for (unsigned frame = 0; frame < 10; frame++)
+    {
+        TestMesh current = frame < 5 ? first : second;
+        TestMesh next = frame + 1 < 5 ? first : second;
+        translateMesh(current, step * frame);
+        translateMesh(next, step * (frame + 1));
+
+        TrackFrame currentFrame = current.trackFrame();
+        TrackFrame nextFrame = next.trackFrame();
+        currentFrame.topology = frame < 5 ? 1 : 2;
+        nextFrame.topology = frame + 1 < 5 ? 1 : 2;
+        if (frame == 5)
+        {
+            TrackFrame before = beforePrevious.trackFrame();
+            EXPECT_EQ(computeCorrespondence(previous.trackFrame(), currentFrame, &before, pool, map),
+                      first.numVertices());
+            currentFrame.fromPrevious = &map;
+        }
+
+        ASSERT_TRUE(engine.trackFrame(currentFrame, nextFrame)) << "frame " << frame;
+        for (unsigned j = 0; j < engine.numJoints(); j++)
+        {
+            Vec3 error = engine.jointPosition(j) - (expected[j] + step * frame);
+            EXPECT_LT(error.length(), frame < 5 ? 1e-5 : 1e-2) << "frame " << frame << " joint " << j;
+        }
+        beforePrevious = previous;
+        previous = current;
+    }
+    EXPECT_EQ(engine.topologyChanges(), 1u);
+}
+
+TEST(TrackingEngine, SearchesJointsTheMapCannotCarry)
+{
+    TestMesh first = makeSphere(20, 24, 1.0, Vec3());
+    TestMesh second = makeSphere(23, 29, 1.0, Vec3());
+    std::vector<std::vector<int>> sets = {{100, 101}, {300, 301}};
+    TrackingEngine engine(2);
+    engine.setJoints(sets);
+
+    //A map that matches no vertex of the first joint's points.
+    ThreadPool pool(1);
+    VertexCorrespondence map;
+    computeCorrespondence(first.trackFrame(), second.trackFrame(), nullptr, pool, map);
+    for (int id : sets[0])
+        map.anchors[id * 3] = -1;
+
+    for (unsigned frame = 0; frame < 4; frame++)
+    {
+        TestMesh& current = frame < 3 ? first : second;
+        TrackFrame currentFrame = current.trackFrame();
+        currentFrame.topology = frame < 3 ? 1 : 2;
+        if (frame == 3)
+            currentFrame.fromPrevious = &map;
+        ASSERT_TRUE(engine.trackFrame(currentFrame, currentFrame)) << "frame " << frame;
+    }
+    for (unsigned j = 0; j < engine.numJoints(); j++)
+        EXPECT_LT((engine.jointPosition(j) - expectedCentroid(first, sets[j])).length(), 2e-2) << j;
+}
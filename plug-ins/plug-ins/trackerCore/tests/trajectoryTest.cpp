@@ -0,0 +1,77 @@
+#include "trajectory.h"
+#include "testMesh.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdio>
+
+TEST(Trajectory, RoundTripFromEngine)
+{
+    const unsigned columns = 20;
+    TestMesh mesh = makeSphere(20, columns, 1.0, Vec3());
+    std::vector<std::vector<int>> sets = {{5 * columns, 5 * columns + 10}, {8 * columns + 1, 8 * columns + 6, 12 * columns}};
+
+    TrackingEngine engine(1);
+    engine.setJoints(sets);
+    TrajectoryWriter writer;
+    writer.begin(10, 6, sets);
+
+    //Track 5 of the 6 frames, leaving the last one lost.
+    TestMesh next = mesh;
+    std::vector<Vec3> positions;
+    for (unsigned frame = 0; frame < 5; frame++)
+    {
+        TestMesh current = next;
+        translateMesh(next, Vec3(0, 0.05, 0));
+        ASSERT_TRUE(engine.trackFrame(current.trackFrame(), next.trackFrame()));
+        writer.recordFrame(frame, engine);
+        positions.push_back(engine.jointPosition(1));
+    }
+
+    std::string path = ::testing::TempDir() + "roundTrip.vjtr";
+    std::string error;
+    ASSERT_TRUE(writer.write(path, error)) << error;
+
+    TrajectoryReader reader;
+    ASSERT_TRUE(reader.open(path)) << reader.error();
+    EXPECT_EQ(reader.numJoints(), 2u);
+    EXPECT_EQ(reader.numFrames(), 6u);
+    EXPECT_EQ(reader.startFrame(), 10.0);
+    ASSERT_EQ(reader.numPoints(1), 3u);
+    EXPECT_EQ(reader.vertexIds(1)[2], (int)(12 * columns));
+
+    for (unsigned frame = 0; frame < 5; frame++)
+    {
+        EXPECT_TRUE(reader.tracked(1, frame));
+        EXPECT_NEAR((reader.position(1, frame) - positions[frame]).length(), 0, 1e-6);
+        EXPECT_GT(reader.channel(1, kConfidence)[frame], 0.99f);
+    }
+    //Moving 0.05 a frame, once there is a previous frame to compare with.
+    EXPECT_NEAR(reader.channel(0, kVelocityY)[3], 0.05f, 1e-5f);
+    EXPECT_NEAR(reader.channel(0, kAccelerationY)[3], 0.0f, 1e-5f);
+    EXPECT_NEAR(reader.surfacePoint(0, 1, 1)[4], mesh.vertex(sets[0][1]).y + 0.2, 1e-5);
+
+    EXPECT_FALSE(reader.tracked(0, 5));
+    EXPECT_TRUE(std::isnan(reader.channel(0, kPositionX)[5]));
+    EXPECT_EQ(reader.channel(0, kConfidence)[5], 0.0f);
+
+    reader.close();
+    std::remove(path.c_str());
+}
+
+TEST(Trajectory, RejectsOtherFiles)
+{
+    std::string path = ::testing::TempDir() + "other.vjtr";
+    {
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        const char junk[64] = "not a trajectory";
+        std::fwrite(junk, 1, sizeof(junk), file);
+        std::fclose(file);
+    }
+
+    TrajectoryReader reader;
+    EXPECT_FALSE(reader.open(path));
+    EXPECT_FALSE(reader.error().empty());
+    std::remove(path.c_str());
+}
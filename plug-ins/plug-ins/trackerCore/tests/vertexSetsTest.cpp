@@ -0,0 +1,41 @@
+#include "vertexSets.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+
+TEST(VertexSets, RoundTrip)
+{
+    std::string path = ::testing::TempDir() + "roundTrip.sets";
+    std::vector<std::vector<int>> sets = {{1, 2}, {30, 40, 50}};
+    std::string error;
+    ASSERT_TRUE(writeVertexSets(path, sets, error)) << error;
+
+    std::vector<std::vector<int>> read;
+    ASSERT_TRUE(readVertexSets(path, read, error)) << error;
+    EXPECT_EQ(read, sets);
+    std::remove(path.c_str());
+}
+
+TEST(VertexSets, ReportsBadLines)
+{
+    std::string path = ::testing::TempDir() + "bad.sets";
+    {
+        std::ofstream file(path.c_str());
+        file << "# comment\n1 2\n3 x\n";
+    }
+
+    std::vector<std::vector<int>> sets;
+    std::string error;
+    EXPECT_FALSE(readVertexSets(path, sets, error));
+    EXPECT_NE(error.find(":3:"), std::string::npos);
+    std::remove(path.c_str());
+}
+
+TEST(VertexSets, PathNextToCache)
+{
+    EXPECT_EQ(vertexSetsPath("/takes/somersault.vjpc"), "/takes/somersault.sets");
+    EXPECT_EQ(vertexSetsPath("/takes.v2/somersault"), "/takes.v2/somersault.sets");
+    EXPECT_EQ(vertexSetsPath("C:\\takes\\jump.vjpc"), "C:\\takes\\jump.sets");
+}
@@ -0,0 +1,101 @@
+//
+// Fixed size pool of worker threads for data parallel loops.
+//
+#include "threadPool.h"
+
+ThreadPool::ThreadPool(unsigned numThreads)
+    : m_next(0)
+{
+    if (numThreads == 0)
+        numThreads = std::thread::hardware_concurrency();
+    if (numThreads == 0)
+        numThreads = 1;
+
+    //The caller is one of the threads.
+    for (unsigned i = 1; i < numThreads; i++)
+        m_workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers)
+        worker.join();
+}
+
+unsigned ThreadPool::numThreads() const
+{
+    return (unsigned)m_workers.size() + 1;
+}
+
+void ThreadPool::parallelFor(unsigned count, const std::function<void(unsigned)>& task)
+{
+    if (count == 0)
+        return;
+
+    if (m_workers.empty() || count == 1)
+    {
+        for (unsigned i = 0; i < count; i++)
+            task(i);
+        return;
+    }
+
+    {
+        //Workers still finishing a previous loop must not see the
+        //new task half written.
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this] { return m_active == 0; });
+        m_task = &task;
+        m_count = count;
+        m_next = 0;
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    runTasks(task, count);
+
+    //A worker that only wakes up after this point finds nothing to do.
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_active == 0; });
+    m_task = nullptr;
+    m_count = 0;
+}
+
+void ThreadPool::runTasks(const std::function<void(unsigned)>& task, unsigned count)
+{
+    for (unsigned i = m_next++; i < count; i = m_next++)
+        task(i);
+}
+
+void ThreadPool::workerLoop()
+{
+    unsigned generation = 0;
+    for (;;)
+    {
+        const std::function<void(unsigned)>* task;
+        unsigned count;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this, generation] { return m_stop || m_generation != generation; });
+            if (m_stop)
+                return;
+            generation = m_generation;
+            task = m_task;
+            count = m_count;
+            m_active++;
+        }
+
+        if (task != nullptr)
+            runTasks(*task, count);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_active--;
+        }
+        m_done.notify_all();
+    }
+}
@@ -0,0 +1,47 @@
+//
+// Fixed size pool of worker threads for data parallel loops.
+//
+#ifndef TRACKERCORE_THREADPOOL_H
+#define TRACKERCORE_THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    //0 threads means one per hardware thread. The calling thread also
+    //takes part in every loop, so a pool of 1 runs everything inline.
+    explicit ThreadPool(unsigned numThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned numThreads() const;
+
+    //Runs task(i) for every i in [0, count) and returns once all are done.
+    //Only one loop runs at a time; task must not call parallelFor itself.
+    void parallelFor(unsigned count, const std::function<void(unsigned)>& task);
+
+private:
+    void workerLoop();
+    void runTasks(const std::function<void(unsigned)>& task, unsigned count);
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    const std::function<void(unsigned)>* m_task = nullptr;
+    unsigned m_count = 0;
+    std::atomic<unsigned> m_next;
+    unsigned m_active = 0;
+    unsigned m_generation = 0;
+    bool m_stop = false;
+};
+
+#endif //TRACKERCORE_THREADPOOL_H
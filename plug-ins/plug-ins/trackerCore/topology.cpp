@@ -0,0 +1,61 @@
+//
+// Mesh connectivity fingerprints.
+//
+#include "topology.h"
+
+#include <cstring>
+
+namespace
+{
+    //64 bit FNV-1a, fed a 32 bit word at a time.
+    const uint64_t kOffsetBasis = 14695981039346656037ull;
+    const uint64_t kPrime = 1099511628211ull;
+
+    inline uint64_t mix(uint64_t hash, uint32_t word)
+    {
+        return (hash ^ word) * kPrime;
+    }
+
+    uint64_t mixAll(uint64_t hash, const int* values, unsigned count)
+    {
+        for (unsigned i = 0; i < count; i++)
+            hash = mix(hash, (uint32_t)values[i]);
+        return hash;
+    }
+
+    inline uint64_t finish(uint64_t hash)
+    {
+        return hash != kNoTopology ? hash : kPrime;
+    }
+}
+
+uint64_t topologyFingerprint(unsigned numVertices, const int* faceCounts, unsigned numFaces,
+                             const int* faceVertices, unsigned numFaceVertices)
+{
+    uint64_t hash = mix(mix(mix(kOffsetBasis, numVertices), numFaces), numFaceVertices);
+    hash = mixAll(hash, faceCounts, numFaces);
+    return finish(mixAll(hash, faceVertices, numFaceVertices));
+}
+
+uint64_t topologyFingerprint(unsigned numVertices, const int* triangles, unsigned numTriangles)
+{
+    //Hashes the same as the polygon form with every face count 3.
+    uint64_t hash = mix(mix(mix(kOffsetBasis, numVertices), numTriangles), numTriangles * 3);
+    for (unsigned t = 0; t < numTriangles; t++)
+        hash = mix(hash, 3);
+    return finish(mixAll(hash, triangles, numTriangles * 3));
+}
+
+uint64_t frameFingerprint(uint64_t topology, const float* points, unsigned numVertices)
+{
+    //Hashes the bit patterns, so -0 and 0 count as a change. That only
+    //costs a needless retrack.
+    uint64_t hash = mix(mix(mix(kOffsetBasis, (uint32_t)topology), (uint32_t)(topology >> 32)), numVertices);
+    for (unsigned i = 0; i < numVertices * 3; i++)
+    {
+        uint32_t word;
+        std::memcpy(&word, points + i, sizeof(word));
+        hash = mix(hash, word);
+    }
+    return finish(hash);
+}
@@ -0,0 +1,31 @@
+//
+// Mesh connectivity fingerprints, used to tell whether two frames of a
+// sequence share a topology.
+//
+// 4DViews sequences keep one topology over each run of frames between
+// keyframe meshes. Within such a run a vertex ID names the same point of
+// the performer on every frame, so tracked points can be followed by ID
+// instead of searched for on the surface. The vertex count alone does not
+// prove that: two keyframe meshes can have the same number of vertices.
+//
+#ifndef TRACKERCORE_TOPOLOGY_H
+#define TRACKERCORE_TOPOLOGY_H
+
+#include <cstdint>
+
+//Unknown topology. Never returned by topologyFingerprint().
+const uint64_t kNoTopology = 0;
+
+//Hash of the vertex count and face vertex lists of a polygon mesh, as
+//given by MFnMesh::getVertices().
+uint64_t topologyFingerprint(unsigned numVertices, const int* faceCounts, unsigned numFaces,
+                             const int* faceVertices, unsigned numFaceVertices);
+
+//Same for a triangle mesh with 3 vertex IDs per triangle.
+uint64_t topologyFingerprint(unsigned numVertices, const int* triangles, unsigned numTriangles);
+
+//Hash of a frame's topology fingerprint and xyz vertex positions, to
+//tell whether a frame's mesh changed since it was last read.
+uint64_t frameFingerprint(uint64_t topology, const float* points, unsigned numVertices);
+
+#endif //TRACKERCORE_TOPOLOGY_H
@@ -0,0 +1,277 @@
+//
+// Per frame tracking results kept between requests.
+//
+#include "trackCache.h"
+#include "profiler.h"
+
+#include <algorithm>
+
+namespace
+{
+    template <typename T>
+    void append(std::vector<T>& to, const std::vector<T>& from, size_t first, size_t count, size_t stride)
+    {
+        to.insert(to.end(), from.begin() + first * stride, from.begin() + (first + count) * stride);
+    }
+
+    //state with the joints in joints, in order, taken from retracked,
+    //which tracked only those joints over the same frames.
+    TrackingState spliceJoints(const TrackingState& state, const TrackingState& retracked,
+                               const std::vector<unsigned>& joints, const std::vector<std::vector<int>>& vertexSets)
+    {
+        TrackingState spliced;
+        spliced.vertexSets = vertexSets;
+        spliced.framesTracked = state.framesTracked;
+        spliced.topologyChanges = state.topologyChanges;
+        spliced.topology = state.topology;
+        spliced.numVertices = state.numVertices;
+        spliced.numTriangles = state.numTriangles;
+
+        size_t statePoint = 0;
+        size_t retrackedPoint = 0;
+        unsigned k = 0;
+        for (unsigned j = 0; j < vertexSets.size(); j++)
+        {
+            bool isRetracked = k < joints.size() && joints[k] == j;
+            const TrackingState& source = isRetracked ? retracked : state;
+            unsigned joint = isRetracked ? k : j;
+            size_t first = isRetracked ? retrackedPoint : statePoint;
+            size_t count = source.vertexSets[joint].size();
+
+            append(spliced.filters, source.filters, first, count, MotionFilter::kStateSize);
+            append(spliced.projected, source.projected, first, count, 1);
+            append(spliced.positions, source.positions, first, count, 1);
+            append(spliced.anchors, source.anchors, first, count, 3);
+            append(spliced.weights, source.weights, first, count, 3);
+            append(spliced.anchored, source.anchored, first, count, 1);
+
+            spliced.jointPositions.push_back(source.jointPositions[joint]);
+            spliced.jointVelocities.push_back(source.jointVelocities[joint]);
+            spliced.jointAccelerations.push_back(source.jointAccelerations[joint]);
+            spliced.jointConfidence.push_back(source.jointConfidence[joint]);
+            spliced.jointHasPosition.push_back(source.jointHasPosition[joint]);
+            spliced.jointTracked.push_back(source.jointTracked[joint]);
+
+            statePoint += state.vertexSets[j].size();
+            if (isRetracked)
+            {
+                retrackedPoint += count;
+                k++;
+            }
+        }
+        return spliced;
+    }
+}
+
+TrackCache::TrackCache(unsigned numThreads)
+    : m_pool(numThreads), m_engine(m_pool), m_retrack(m_pool)
+{
+    clear();
+}
+
+void TrackCache::setJoints(const std::vector<std::vector<int>>& vertexSets)
+{
+    if (vertexSets == m_vertexSets)
+        return;
+
+    //With nothing tracked past the start there is nothing to keep.
+    if (vertexSets.size() != m_vertexSets.size() || m_engineFrame == m_startFrame)
+    {
+        m_vertexSets = vertexSets;
+        clear();
+        return;
+    }
+
+    //Joints already being tracked again start over with the new ones.
+    std::vector<unsigned> joints;
+    std::vector<std::vector<int>> sets;
+    for (unsigned j = 0; j < vertexSets.size(); j++)
+    {
+        if (vertexSets[j] != m_vertexSets[j]
+            || std::find(m_retrackJoints.begin(), m_retrackJoints.end(), j) != m_retrackJoints.end())
+        {
+            joints.push_back(j);
+            sets.push_back(vertexSets[j]);
+        }
+    }
+    PROFILE_COUNT("trackCacheRetrackedJoints", joints.size());
+    m_vertexSets = vertexSets;
+    m_retrackJoints = joints;
+    m_retrack.setJoints(sets);
+    m_retrackFrame = m_startFrame;
+}
+
+void TrackCache::setStartFrame(int frame)
+{
+    if (frame == m_startFrame)
+        return;
+
+    m_startFrame = frame;
+    clear();
+}
+
+int TrackCache::startFrame() const
+{
+    return m_startFrame;
+}
+
+unsigned TrackCache::numJoints() const
+{
+    return (unsigned)m_vertexSets.size();
+}
+
+int TrackCache::endFrame() const
+{
+    return m_endFrame;
+}
+
+bool TrackCache::cached(int frame) const
+{
+    return frame >= m_startFrame && frame < m_endFrame && (m_retrackJoints.empty() || frame < m_retrackFrame);
+}
+
+bool TrackCache::validate(int frame, uint64_t fingerprint)
+{
+    if (!cached(frame))
+        return false;
+    if (m_fingerprints[frame - m_startFrame] == fingerprint)
+        return true;
+
+    dropFrom(frame);
+    return false;
+}
+
+int TrackCache::nextFrame() const
+{
+    return m_retrackJoints.empty() ? m_engineFrame : m_retrackFrame;
+}
+
+bool TrackCache::readsNext() const
+{
+    const TrackingEngine& engine = m_retrackJoints.empty() ? m_engine : m_retrack;
+    return engine.framesTracked() < TrackingEngine::kSelectionFrames;
+}
+
+bool TrackCache::track(const TrackFrame& current, const TrackFrame& next, uint64_t fingerprint)
+{
+    PROFILE_SCOPE("trackCache");
+    if (!m_retrackJoints.empty())
+    {
+        //The frame's other joints and fingerprint are kept as they are.
+        bool tracked = m_retrack.trackFrame(current, next);
+        m_framesTracked++;
+        unsigned frame = (unsigned)(m_retrackFrame - m_startFrame);
+        for (unsigned k = 0; k < m_retrackJoints.size(); k++)
+        {
+            unsigned index = frame * numJoints() + m_retrackJoints[k];
+            m_positions[index] = m_retrack.jointPosition(k);
+            m_confidence[index] = m_retrack.jointConfidence(k);
+            m_tracked[index] = m_retrack.jointTracked(k) ? 1 : 0;
+        }
+        m_retrackFrame++;
+        finishRetrack();
+        return tracked;
+    }
+
+    bool tracked = m_engine.trackFrame(current, next);
+    m_framesTracked++;
+
+    //Frames tracked again on the way back to endFrame() come out the same
+    //and are simply overwritten.
+    unsigned frame = (unsigned)(m_engineFrame - m_startFrame);
+    unsigned numJoints = m_engine.numJoints();
+    if (m_engineFrame == m_endFrame)
+    {
+        m_positions.resize(m_positions.size() + numJoints);
+        m_confidence.resize(m_confidence.size() + numJoints);
+        m_tracked.resize(m_tracked.size() + numJoints);
+        m_fingerprints.push_back(fingerprint);
+        m_endFrame++;
+    }
+    m_fingerprints[frame] = fingerprint;
+
+    for (unsigned j = 0; j < numJoints; j++)
+    {
+        unsigned index = frame * numJoints + j;
+        m_positions[index] = m_engine.jointPosition(j);
+        m_confidence[index] = m_engine.jointConfidence(j);
+        m_tracked[index] = m_engine.jointTracked(j) ? 1 : 0;
+    }
+
+    m_engineFrame++;
+    return tracked;
+}
+
+unsigned TrackCache::framesTracked() const
+{
+    return m_framesTracked;
+}
+
+const Vec3& TrackCache::position(int frame, unsigned joint) const
+{
+    return m_positions[slot(frame, joint)];
+}
+
+float TrackCache::confidence(int frame, unsigned joint) const
+{
+    return m_confidence[slot(frame, joint)];
+}
+
+bool TrackCache::tracked(int frame, unsigned joint) const
+{
+    return m_tracked[slot(frame, joint)] != 0;
+}
+
+void TrackCache::clear()
+{
+    m_engine.setJoints(m_vertexSets);
+    m_retrackJoints.clear();
+    m_endFrame = m_engineFrame = m_startFrame;
+    m_positions.clear();
+    m_confidence.clear();
+    m_tracked.clear();
+    m_fingerprints.clear();
+}
+
+void TrackCache::dropFrom(int frame)
+{
+    //m_engine starting over below tracks every joint again anyway.
+    if (!m_retrackJoints.empty() && m_engineFrame > frame)
+    {
+        frame = std::min(frame, m_retrackFrame);
+        m_retrackJoints.clear();
+    }
+
+    PROFILE_COUNT("trackCacheDrops", (uint64_t)(m_endFrame - frame));
+    unsigned kept = (unsigned)(frame - m_startFrame) * numJoints();
+    m_positions.resize(kept);
+    m_confidence.resize(kept);
+    m_tracked.resize(kept);
+    m_fingerprints.resize(frame - m_startFrame);
+    m_endFrame = frame;
+
+    //The engine cannot step back, so it starts over.
+    if (m_engineFrame > frame)
+    {
+        m_engine.setJoints(m_vertexSets);
+        m_engineFrame = m_startFrame;
+    }
+}
+
+void TrackCache::finishRetrack()
+{
+    if (m_retrackJoints.empty() || m_retrackFrame < m_engineFrame)
+        return;
+
+    TrackingState state;
+    TrackingState retracked;
+    m_engine.saveState(state);
+    m_retrack.saveState(retracked);
+    m_engine.restoreState(spliceJoints(state, retracked, m_retrackJoints, m_vertexSets));
+    m_retrackJoints.clear();
+}
+
+unsigned TrackCache::slot(int frame, unsigned joint) const
+{
+    return (unsigned)(frame - m_startFrame) * numJoints() + joint;
+}
@@ -0,0 +1,98 @@
+//
+// Per frame tracking results kept between requests, for trackers that are
+// asked for frames in any order, like the jointTracker node while the
+// timeline is scrubbed.
+//
+// Each frame is tracked from where the one before it left off, so frames
+// are tracked in order from the start frame and every result is kept.
+// Results are only dropped when what they were tracked from changes: a
+// new start frame or number of joints drops every frame, a frame whose
+// mesh changed drops itself and the frames after it.
+//
+// Joints are tracked independently, so a change to some joints' vertex
+// sets keeps the other joints' results. The changed joints are tracked
+// again on their own from the start frame, up to the frames asked for,
+// and once they catch up with the rest they carry on together.
+//
+#ifndef TRACKERCORE_TRACKCACHE_H
+#define TRACKERCORE_TRACKCACHE_H
+
+#include "threadPool.h"
+#include "trackingEngine.h"
+#include "vec3.h"
+
+#include <cstdint>
+#include <vector>
+
+class TrackCache
+{
+public:
+    //Both engines track on one pool of numThreads, 0 for one per core.
+    explicit TrackCache(unsigned numThreads = 0);
+
+    //Only the frames of joints whose set changed are tracked again, unless
+    //the number of joints changes.
+    void setJoints(const std::vector<std::vector<int>>& vertexSets);
+    //Drops every cached frame when the frame changes.
+    void setStartFrame(int frame);
+    int startFrame() const;
+    //Drops every cached frame, for when the frames come from somewhere new.
+    void clear();
+    unsigned numJoints() const;
+
+    //Frames [startFrame(), endFrame()) are cached.
+    int endFrame() const;
+    bool cached(int frame) const;
+    //Checks a cached frame against the frameFingerprint() of its mesh as
+    //it is now. If the mesh changed the frame and every frame after it
+    //are dropped and false is returned.
+    bool validate(int frame, uint64_t fingerprint);
+
+    //The frame track() tracks next. Normally endFrame(), but after frames
+    //were dropped the track starts over from startFrame() and tracks the
+    //frames that are still cached again to get back to them, and after
+    //joints changed it is the next frame those joints have to catch up on.
+    int nextFrame() const;
+    //Whether track() reads the frame after nextFrame().
+    bool readsNext() const;
+    //Tracks nextFrame() and caches the result along with the
+    //frameFingerprint() of current.
+    bool track(const TrackFrame& current, const TrackFrame& next, uint64_t fingerprint);
+    //Frames tracked since the cache was created, counting the ones
+    //tracked again.
+    unsigned framesTracked() const;
+
+    //Results of a cached frame.
+    const Vec3& position(int frame, unsigned joint) const;
+    float confidence(int frame, unsigned joint) const;
+    bool tracked(int frame, unsigned joint) const;
+
+private:
+    void dropFrom(int frame);
+    //Hands the joints tracked again over to m_engine once they are on
+    //the frame it is on.
+    void finishRetrack();
+    unsigned slot(int frame, unsigned joint) const;
+
+    ThreadPool m_pool;
+    TrackingEngine m_engine;
+    //Joints whose sets changed, in order, tracked again on their own by
+    //m_retrack. Their results are only cached before m_retrackFrame.
+    TrackingEngine m_retrack;
+    std::vector<unsigned> m_retrackJoints;
+    int m_retrackFrame = 0;
+    std::vector<std::vector<int>> m_vertexSets;
+    int m_startFrame = 0;
+    //Cached frames, and the frame m_engine has tracked up to.
+    int m_endFrame = 0;
+    int m_engineFrame = 0;
+    unsigned m_framesTracked = 0;
+
+    //One entry per cached frame and joint, frame major.
+    std::vector<Vec3> m_positions;
+    std::vector<float> m_confidence;
+    std::vector<uint8_t> m_tracked;
+    std::vector<uint64_t> m_fingerprints;
+};
+
+#endif //TRACKERCORE_TRACKCACHE_H
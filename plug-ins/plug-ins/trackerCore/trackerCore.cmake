@@ -0,0 +1,30 @@
+# Sources of the Maya independent tracking core. Included by the
+# standalone build in this directory and by the plug-ins that compile the
+# core straight into themselves.
+set(TRACKER_CORE_DIR ${CMAKE_CURRENT_LIST_DIR})
+set(TRACKER_CORE_SOURCES
+        ${TRACKER_CORE_DIR}/checkpoint.cpp
+        ${TRACKER_CORE_DIR}/correspondence.cpp
+        ${TRACKER_CORE_DIR}/frameCache.cpp
+        ${TRACKER_CORE_DIR}/framePipeline.cpp
+        ${TRACKER_CORE_DIR}/jointEstimate.cpp
+        ${TRACKER_CORE_DIR}/landmarks.cpp
+        ${TRACKER_CORE_DIR}/limbAngle.cpp
+        ${TRACKER_CORE_DIR}/log.cpp
+        ${TRACKER_CORE_DIR}/mappedFile.cpp
+        ${TRACKER_CORE_DIR}/meshAdjacency.cpp
+        ${TRACKER_CORE_DIR}/meshBvh.cpp
+        ${TRACKER_CORE_DIR}/motion.cpp
+        ${TRACKER_CORE_DIR}/motionFilter.cpp
+        ${TRACKER_CORE_DIR}/pointCache.cpp
+        ${TRACKER_CORE_DIR}/pointCacheStream.cpp
+        ${TRACKER_CORE_DIR}/profiler.cpp
+        ${TRACKER_CORE_DIR}/skeleton.cpp
+        ${TRACKER_CORE_DIR}/surfaceWalk.cpp
+        ${TRACKER_CORE_DIR}/take.cpp
+        ${TRACKER_CORE_DIR}/threadPool.cpp
+        ${TRACKER_CORE_DIR}/topology.cpp
+        ${TRACKER_CORE_DIR}/trackCache.cpp
+        ${TRACKER_CORE_DIR}/trackingEngine.cpp
+        ${TRACKER_CORE_DIR}/trajectory.cpp
+        ${TRACKER_CORE_DIR}/vertexSets.cpp)
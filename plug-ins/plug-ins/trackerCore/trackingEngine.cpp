@@ -0,0 +1,647 @@
+//
+// Tracks any number of joints over a mesh sequence, one joint per set of
+// surface vertices, with the joints of a frame processed in parallel.
+//
+#include "trackingEngine.h"
+#include "correspondence.h"
+#include "jointEstimate.h"
+#include "motion.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    inline Vec3 vertex(const TrackFrame& frame, int id)
+    {
+        const float* p = frame.points + id * 3;
+        return Vec3(p[0], p[1], p[2]);
+    }
+}
+
+TrackingEngine::TrackingEngine(unsigned numThreads)
+    : m_ownPool(new ThreadPool(numThreads)), m_pool(m_ownPool.get())
+{
+}
+
+TrackingEngine::TrackingEngine(ThreadPool& pool)
+    : m_pool(&pool)
+{
+}
+
+const unsigned TrackingEngine::kSelectionFrames;
+const double TrackingEngine::kSearchSigmas = 4;
+
+void TrackingEngine::setJoints(const std::vector<std::vector<int>>& vertexSets)
+{
+    m_framesTracked = 0;
+    m_topologyChanges = 0;
+    m_topology = TopologyCache();
+    m_vertexSets = vertexSets;
+
+    m_jointStart.assign(1, 0);
+    m_points.vertexIds.clear();
+    for (const std::vector<int>& ids : vertexSets)
+    {
+        m_points.vertexIds.insert(m_points.vertexIds.end(), ids.begin(), ids.end());
+        m_jointStart.push_back((unsigned)m_points.vertexIds.size());
+    }
+
+    size_t numPoints = m_points.vertexIds.size();
+    m_points.filters.assign(numPoints, MotionFilter());
+    m_points.projected.assign(numPoints, Vec3());
+    m_points.positions.assign(numPoints, Vec3());
+    m_points.x.assign(numPoints, 0);
+    m_points.y.assign(numPoints, 0);
+    m_points.z.assign(numPoints, 0);
+    m_points.robustWeights.assign(numPoints, 0);
+    m_points.anchors.assign(numPoints * 3, 0);
+    m_points.weights.assign(numPoints * 3, 0);
+    m_points.anchored.assign(numPoints, 0);
+    m_points.queries.assign(numPoints * 3, 0);
+    m_points.hits.resize(numPoints);
+    m_points.radiiSq.assign(numPoints, 0);
+
+    size_t numJoints = vertexSets.size();
+    m_joints.position.assign(numJoints, Vec3());
+    m_joints.velocity.assign(numJoints, Vec3());
+    m_joints.acceleration.assign(numJoints, Vec3());
+    m_joints.confidence.assign(numJoints, 0);
+    m_joints.searchMisses.assign(numJoints, 0);
+    m_joints.hasPosition.assign(numJoints, 0);
+    m_joints.tracked.assign(numJoints, 0);
+}
+
+unsigned TrackingEngine::numJoints() const
+{
+    return (unsigned)m_vertexSets.size();
+}
+
+unsigned TrackingEngine::numPoints() const
+{
+    return (unsigned)m_points.vertexIds.size();
+}
+
+unsigned TrackingEngine::numThreads() const
+{
+    return m_pool->numThreads();
+}
+
+bool TrackingEngine::trackFrame(const TrackFrame& current, const TrackFrame& next)
+{
+    //Vertex IDs only carry over from the previous frame within a topology.
+    bool holds = m_framesTracked > 0 && sameTopology(current);
+    bool carries = !holds && m_framesTracked > 0 && current.fromPrevious != nullptr
+        && current.fromPrevious->numVertices() == m_topology.numVertices;
+    if (!holds)
+    {
+        if (m_framesTracked > 0)
+            m_topologyChanges++;
+        setTopology(current);
+    }
+
+    m_current = &current;
+    m_next = &next;
+
+    //The selection is only read by ID on the mesh it was made on, so a
+    //new topology on the second frame is searched or carried over too.
+    bool tracked;
+    if (m_framesTracked == 0 || (m_framesTracked < kSelectionFrames && holds))
+    {
+        tracked = trackBySelection();
+    }
+    else if (holds)
+    {
+        tracked = trackByVertex();
+    }
+    else if (carries)
+    {
+        tracked = trackByCorrespondence();
+    }
+    else
+    {
+        tracked = trackByClosest();
+    }
+
+    m_current = m_next = nullptr;
+    m_framesTracked++;
+    return tracked;
+}
+
+unsigned TrackingEngine::framesTracked() const
+{
+    return m_framesTracked;
+}
+
+unsigned TrackingEngine::topologyChanges() const
+{
+    return m_topologyChanges;
+}
+
+bool TrackingEngine::sameTopology(const TrackFrame& frame) const
+{
+    if (frame.numVertices != m_topology.numVertices || frame.numTriangles != m_topology.numTriangles)
+        return false;
+    if (frame.topology != kNoTopology || m_topology.fingerprint != kNoTopology)
+        return frame.topology == m_topology.fingerprint;
+    return frame.triangles != nullptr && frame.triangles == m_topology.triangles;
+}
+
+void TrackingEngine::setTopology(const TrackFrame& frame)
+{
+    PROFILE_COUNT("topologyChanges", 1);
+    m_topology.fingerprint = frame.topology;
+    m_topology.triangles = frame.triangles;
+    m_topology.numVertices = frame.numVertices;
+    m_topology.numTriangles = frame.numTriangles;
+    m_topology.hasBvh = false;
+}
+
+void TrackingEngine::updateIndex()
+{
+    PROFILE_SCOPE("bvhUpdate");
+    const TrackFrame& current = *m_current;
+
+    //Searches mostly happen on the first frame of a topology, so this is
+    //normally a build. A refit covers a search later in the same run.
+    if (m_topology.hasBvh)
+    {
+        m_topology.bvh.refit(current.points, current.numVertices);
+        return;
+    }
+
+    m_topology.bvh.build(current.points, current.numVertices, current.triangles, current.numTriangles);
+    m_topology.hasBvh = true;
+}
+
+bool TrackingEngine::trackBySelection()
+{
+    PROFILE_SCOPE("trackBySelection");
+
+    //The next frame's vertices only say where the points are going when
+    //it has the same topology.
+    m_nextMatches = m_current->topology == kNoTopology || m_next->topology == kNoTopology
+        || m_current->topology == m_next->topology;
+    m_pool->parallelFor(numJoints(), [this](unsigned j) {
+        selectJoint(j);
+    });
+    return allTracked();
+}
+
+bool TrackingEngine::trackByVertex()
+{
+    PROFILE_SCOPE("trackByVertex");
+    PROFILE_COUNT("vertexReads", numPoints());
+    m_pool->parallelFor(numJoints(), [this](unsigned j) {
+        vertexJoint(j);
+    });
+    return allTracked();
+}
+
+bool TrackingEngine::trackByClosest()
+{
+    updateIndex();
+    if (m_topology.bvh.empty())
+    {
+        m_joints.tracked.assign(numJoints(), 0);
+        return false;
+    }
+
+    PROFILE_SCOPE("closestPoints");
+    PROFILE_COUNT("closestPointQueries", numPoints());
+    m_pool->parallelFor(numJoints(), [this](unsigned j) {
+        closestJoint(j);
+    });
+
+    unsigned misses = 0;
+    for (unsigned count : m_joints.searchMisses)
+        misses += count;
+    PROFILE_COUNT("searchRadiusMisses", misses);
+    return allTracked();
+}
+
+bool TrackingEngine::trackByCorrespondence()
+{
+    {
+        PROFILE_SCOPE("trackByCorrespondence");
+        PROFILE_COUNT("correspondenceCarries", numPoints());
+        m_pool->parallelFor(numJoints(), [this](unsigned j) {
+            carryJoint(j);
+        });
+    }
+
+    //A joint with a point on a vertex the map could not match, or one
+    //that was already lost, is searched for as without a map.
+    m_uncarried.clear();
+    for (unsigned j = 0; j < numJoints(); j++)
+    {
+        if (!m_joints.tracked[j])
+            m_uncarried.push_back(j);
+    }
+    if (m_uncarried.empty())
+        return true;
+
+    updateIndex();
+    if (m_topology.bvh.empty())
+        return false;
+    PROFILE_SCOPE("closestPoints");
+    m_pool->parallelFor((unsigned)m_uncarried.size(), [this](unsigned k) {
+        closestJoint(m_uncarried[k]);
+    });
+    return allTracked();
+}
+
+const Vec3& TrackingEngine::jointPosition(unsigned joint) const
+{
+    return m_joints.position[joint];
+}
+
+bool TrackingEngine::jointTracked(unsigned joint) const
+{
+    return m_joints.tracked[joint] != 0;
+}
+
+const Vec3& TrackingEngine::jointVelocity(unsigned joint) const
+{
+    return m_joints.velocity[joint];
+}
+
+const Vec3& TrackingEngine::jointAcceleration(unsigned joint) const
+{
+    return m_joints.acceleration[joint];
+}
+
+float TrackingEngine::jointConfidence(unsigned joint) const
+{
+    return m_joints.tracked[joint] ? m_joints.confidence[joint] : 0;
+}
+
+double TrackingEngine::jointSearchRadius(unsigned joint) const
+{
+    double radius = 0;
+    for (unsigned p = m_jointStart[joint]; p < m_jointStart[joint + 1]; p++)
+    {
+        if (m_points.filters[p].started())
+            radius = std::max(radius, m_points.filters[p].searchRadius(kSearchSigmas));
+    }
+    return radius;
+}
+
+const Vec3* TrackingEngine::jointSurfacePoints(unsigned joint) const
+{
+    return m_points.positions.data() + m_jointStart[joint];
+}
+
+unsigned TrackingEngine::jointNumPoints(unsigned joint) const
+{
+    return m_jointStart[joint + 1] - m_jointStart[joint];
+}
+
+const std::vector<int>& TrackingEngine::jointVertexIds(unsigned joint) const
+{
+    return m_vertexSets[joint];
+}
+
+void TrackingEngine::saveState(TrackingState& state) const
+{
+    state.vertexSets = m_vertexSets;
+    state.framesTracked = m_framesTracked;
+    state.topologyChanges = m_topologyChanges;
+    state.topology = m_topology.fingerprint;
+    state.numVertices = m_topology.numVertices;
+    state.numTriangles = m_topology.numTriangles;
+
+    state.filters.resize(m_points.filters.size() * MotionFilter::kStateSize);
+    for (size_t p = 0; p < m_points.filters.size(); p++)
+        m_points.filters[p].saveState(&state.filters[p * MotionFilter::kStateSize]);
+    state.projected = m_points.projected;
+    state.positions = m_points.positions;
+    state.anchors = m_points.anchors;
+    state.weights = m_points.weights;
+    state.anchored = m_points.anchored;
+
+    state.jointPositions = m_joints.position;
+    state.jointVelocities = m_joints.velocity;
+    state.jointAccelerations = m_joints.acceleration;
+    state.jointConfidence = m_joints.confidence;
+    state.jointHasPosition = m_joints.hasPosition;
+    state.jointTracked = m_joints.tracked;
+}
+
+bool TrackingEngine::restoreState(const TrackingState& state)
+{
+    size_t numPoints = 0;
+    for (const std::vector<int>& ids : state.vertexSets)
+        numPoints += ids.size();
+    size_t numJoints = state.vertexSets.size();
+    if (state.filters.size() != numPoints * MotionFilter::kStateSize || state.projected.size() != numPoints
+        || state.positions.size() != numPoints || state.anchors.size() != numPoints * 3
+        || state.weights.size() != numPoints * 3 || state.anchored.size() != numPoints
+        || state.jointPositions.size() != numJoints || state.jointVelocities.size() != numJoints
+        || state.jointAccelerations.size() != numJoints || state.jointConfidence.size() != numJoints
+        || state.jointHasPosition.size() != numJoints || state.jointTracked.size() != numJoints)
+        return false;
+
+    setJoints(state.vertexSets);
+    m_framesTracked = state.framesTracked;
+    m_topologyChanges = state.topologyChanges;
+
+    //The triangles themselves are gone, so only a fingerprint can show
+    //the next frame is still on the same topology.
+    m_topology.fingerprint = state.topology;
+    m_topology.numVertices = state.numVertices;
+    m_topology.numTriangles = state.numTriangles;
+
+    for (size_t p = 0; p < numPoints; p++)
+    {
+        m_points.filters[p].restoreState(&state.filters[p * MotionFilter::kStateSize]);
+        setPosition((unsigned)p, state.positions[p]);
+    }
+    m_points.projected = state.projected;
+    m_points.anchors = state.anchors;
+    m_points.weights = state.weights;
+    m_points.anchored = state.anchored;
+
+    m_joints.position = state.jointPositions;
+    m_joints.velocity = state.jointVelocities;
+    m_joints.acceleration = state.jointAccelerations;
+    m_joints.confidence = state.jointConfidence;
+    m_joints.hasPosition = state.jointHasPosition;
+    m_joints.tracked = state.jointTracked;
+    return true;
+}
+
+bool TrackingEngine::allTracked() const
+{
+    for (uint8_t tracked : m_joints.tracked)
+    {
+        if (!tracked)
+            return false;
+    }
+    return true;
+}
+
+void TrackingEngine::anchorToVertex(unsigned point, int id)
+{
+    int* anchor = &m_points.anchors[point * 3];
+    float* weights = &m_points.weights[point * 3];
+    anchor[0] = anchor[1] = anchor[2] = id;
+    weights[0] = 1;
+    weights[1] = weights[2] = 0;
+    m_points.anchored[point] = 1;
+}
+
+void TrackingEngine::setPosition(unsigned point, const Vec3& position)
+{
+    m_points.positions[point] = position;
+    m_points.x[point] = (float)position.x;
+    m_points.y[point] = (float)position.y;
+    m_points.z[point] = (float)position.z;
+}
+
+void TrackingEngine::selectJoint(unsigned joint)
+{
+    const TrackFrame& current = *m_current;
+    const TrackFrame& next = *m_next;
+    unsigned first = m_jointStart[joint];
+    unsigned last = m_jointStart[joint + 1];
+
+    m_joints.tracked[joint] = 0;
+    if (first == last)
+        return;
+
+    for (unsigned p = first; p < last; p++)
+        m_points.anchored[p] = 0;
+
+    for (unsigned p = first; p < last; p++)
+    {
+        int id = m_points.vertexIds[p];
+        if (id < 0 || (unsigned)id >= current.numVertices)
+            return;
+
+        Vec3 position = vertex(current, id);
+        m_points.filters[p].update(position);
+        anchorToVertex(p, id);
+
+        //Where the vertex actually is on the next frame stands in for
+        //the prediction until there is enough history to project.
+        if (m_nextMatches && (unsigned)id < next.numVertices)
+            m_points.projected[p] = vertex(next, id);
+        else
+            m_points.projected[p] = position;
+
+        setPosition(p, position);
+    }
+
+    placeJoint(joint, 0);
+}
+
+void TrackingEngine::vertexJoint(unsigned joint)
+{
+    const TrackFrame& current = *m_current;
+    unsigned first = m_jointStart[joint];
+    unsigned last = m_jointStart[joint + 1];
+
+    m_joints.tracked[joint] = 0;
+    if (first == last)
+        return;
+
+    for (unsigned p = first; p < last; p++)
+    {
+        if (!m_points.anchored[p])
+            return;
+
+        const int* anchor = &m_points.anchors[p * 3];
+        const float* weights = &m_points.weights[p * 3];
+        Vec3 position = vertex(current, anchor[0]) * weights[0];
+        if (weights[1] != 0 || weights[2] != 0)
+            position += vertex(current, anchor[1]) * weights[1] + vertex(current, anchor[2]) * weights[2];
+
+        //Kept up to date for the search at the next topology change.
+        MotionFilter& filter = m_points.filters[p];
+        filter.update(position);
+        m_points.projected[p] = filter.predicted();
+        setPosition(p, position);
+    }
+
+    placeJoint(joint, 0);
+}
+
+void TrackingEngine::closestJoint(unsigned joint)
+{
+    const TrackFrame& current = *m_current;
+    const MeshBvh& bvh = m_topology.bvh;
+    unsigned first = m_jointStart[joint];
+    unsigned last = m_jointStart[joint + 1];
+
+    m_joints.tracked[joint] = 0;
+    if (first == last)
+        return;
+
+    //Find all of the joint's points on the surface in one batch.
+    for (unsigned p = first; p < last; p++)
+    {
+        //Anchors from the previous topology mean nothing on this one.
+        m_points.anchored[p] = 0;
+        const Vec3& projected = m_points.projected[p];
+        m_points.queries[p * 3] = (float)projected.x;
+        m_points.queries[p * 3 + 1] = (float)projected.y;
+        m_points.queries[p * 3 + 2] = (float)projected.z;
+
+        //Only look as far as the filter expects the point could be.
+        const MotionFilter& filter = m_points.filters[p];
+        double radius = filter.searchRadius(kSearchSigmas);
+        m_points.radiiSq[p] = filter.started() ? (float)(radius * radius) : std::numeric_limits<float>::max();
+    }
+    bvh.closestPoints(&m_points.queries[first * 3], last - first, &m_points.hits[first], &m_points.radiiSq[first]);
+
+    double residual = 0;
+    m_joints.searchMisses[joint] = 0;
+    for (unsigned p = first; p < last; p++)
+    {
+        BvhHit& hit = m_points.hits[p];
+
+        //Motion the model did not see coming, such as a hard turn or a
+        //new keyframe mesh sitting off the old one. Search everywhere.
+        if (hit.triangle < 0)
+        {
+            hit = bvh.closestPoint(&m_points.queries[p * 3]);
+            m_joints.searchMisses[joint]++;
+        }
+        if (hit.triangle < 0)
+            return;
+        residual += std::sqrt(hit.distanceSq);
+
+        //Pin the point to the surface so the rest of the topology's run
+        //can follow it by vertex ID.
+        Vec3 position(hit.point[0], hit.point[1], hit.point[2]);
+        const int* triangle = current.triangles + hit.triangle * 3;
+        int* anchor = &m_points.anchors[p * 3];
+        for (int k = 0; k < 3; k++)
+            anchor[k] = triangle[k];
+        barycentricWeights(hit.point, current.points + triangle[0] * 3, current.points + triangle[1] * 3,
+                           current.points + triangle[2] * 3, &m_points.weights[p * 3]);
+        m_points.anchored[p] = 1;
+
+        MotionFilter& filter = m_points.filters[p];
+        filter.update(position);
+        m_points.projected[p] = filter.predicted();
+        setPosition(p, position);
+    }
+
+    placeJoint(joint, residual / (last - first));
+}
+
+void TrackingEngine::carryJoint(unsigned joint)
+{
+    const TrackFrame& current = *m_current;
+    const VertexCorrespondence& map = *current.fromPrevious;
+    unsigned first = m_jointStart[joint];
+    unsigned last = m_jointStart[joint + 1];
+
+    m_joints.tracked[joint] = 0;
+    if (first == last)
+        return;
+
+    //Nothing is touched unless every point of the joint can be carried,
+    //so the search fallback starts from the state it would have had.
+    for (unsigned p = first; p < last; p++)
+    {
+        if (!m_points.anchored[p])
+            return;
+        for (unsigned k = 0; k < 3; k++)
+        {
+            int id = m_points.anchors[p * 3 + k];
+            if (m_points.weights[p * 3 + k] == 0)
+                continue;
+            if (id < 0 || (unsigned)id >= map.numVertices() || !map.matched(id))
+                return;
+            for (unsigned m = 0; m < 3; m++)
+            {
+                if ((unsigned)map.anchors[id * 3 + m] >= current.numVertices)
+                    return;
+            }
+        }
+    }
+
+    for (unsigned p = first; p < last; p++)
+    {
+        //Each old anchor lands on a new triangle, and the point lands
+        //between those. It is pinned to whichever of the triangles it is
+        //closest to, so it stays on the surface.
+        int* anchor = &m_points.anchors[p * 3];
+        float* anchorWeights = &m_points.weights[p * 3];
+        float carried[] = {0, 0, 0};
+        for (unsigned k = 0; k < 3; k++)
+        {
+            for (unsigned m = 0; m < 3 && anchorWeights[k] != 0; m++)
+            {
+                float weight = anchorWeights[k] * map.weights[anchor[k] * 3 + m];
+                const float* to = current.points + map.anchors[anchor[k] * 3 + m] * 3;
+                for (unsigned axis = 0; axis < 3; axis++)
+                    carried[axis] += weight * to[axis];
+            }
+        }
+
+        int triangle[3];
+        float onSurface[3];
+        float bestSq = std::numeric_limits<float>::max();
+        for (unsigned k = 0; k < 3; k++)
+        {
+            if (anchorWeights[k] == 0)
+                continue;
+            const int* candidate = &map.anchors[anchor[k] * 3];
+            float point[3];
+            closestPointOnTriangle(carried, current.points + candidate[0] * 3, current.points + candidate[1] * 3,
+                                   current.points + candidate[2] * 3, point);
+            float dx = point[0] - carried[0];
+            float dy = point[1] - carried[1];
+            float dz = point[2] - carried[2];
+            float distanceSq = dx * dx + dy * dy + dz * dz;
+            if (distanceSq < bestSq)
+            {
+                bestSq = distanceSq;
+                std::copy(candidate, candidate + 3, triangle);
+                std::copy(point, point + 3, onSurface);
+            }
+        }
+
+        std::copy(triangle, triangle + 3, anchor);
+        barycentricWeights(onSurface, current.points + triangle[0] * 3, current.points + triangle[1] * 3,
+                           current.points + triangle[2] * 3, anchorWeights);
+        Vec3 position(onSurface[0], onSurface[1], onSurface[2]);
+        MotionFilter& filter = m_points.filters[p];
+        filter.update(position);
+        m_points.projected[p] = filter.predicted();
+        setPosition(p, position);
+    }
+
+    placeJoint(joint, 0);
+}
+
+void TrackingEngine::placeJoint(unsigned joint, double residual)
+{
+    unsigned first = m_jointStart[joint];
+    const Vec3* positions = m_points.positions.data() + first;
+    unsigned count = jointNumPoints(joint);
+
+    Vec3 position = robustCentroid(&m_points.x[first], &m_points.y[first], &m_points.z[first], count,
+                                   &m_points.robustWeights[first]);
+    bool hasPosition = m_joints.hasPosition[joint] != 0;
+    Vec3 velocity = hasPosition ? computeVelocity(m_joints.position[joint], position) : Vec3();
+    m_joints.acceleration[joint] = hasPosition ? computeAcceleration(m_joints.velocity[joint], velocity) : Vec3();
+    m_joints.velocity[joint] = velocity;
+    m_joints.position[joint] = position;
+    m_joints.hasPosition[joint] = 1;
+
+    //Misses are measured against how far the points sit from the joint,
+    //so the confidence does not depend on the scene's units.
+    double spread = 0;
+    for (unsigned p = 0; p < count; p++)
+        spread += (positions[p] - position).length();
+    spread /= count;
+    m_joints.confidence[joint] = (float)(1 / (1 + residual / (spread > 0 ? spread : 1)));
+    m_joints.tracked[joint] = 1;
+}
@@ -0,0 +1,236 @@
+//
+// Tracks any number of joints over a mesh sequence, one joint per set of
+// surface vertices, with the joints of a frame processed in parallel.
+//
+// The engine only sees frame data that has already been pulled out of the
+// scene or a cache file, so it is safe to run off Maya's main thread and
+// outside Maya altogether. Writing the results back to locators or joints
+// is left to the caller.
+//
+#ifndef TRACKERCORE_TRACKINGENGINE_H
+#define TRACKERCORE_TRACKINGENGINE_H
+
+#include "meshBvh.h"
+#include "motionFilter.h"
+#include "threadPool.h"
+#include "topology.h"
+#include "vec3.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct VertexCorrespondence;
+
+struct TrackFrame
+{
+    //numVertices xyz triples in world space.
+    const float* points = nullptr;
+    unsigned numVertices = 0;
+    //3 vertex indices per triangle. Frames with the same topology are
+    //expected to share the same array.
+    const int* triangles = nullptr;
+    unsigned numTriangles = 0;
+    //topologyFingerprint() of the frame's mesh. Left as kNoTopology,
+    //frames are taken to share a topology when they share the triangle
+    //array and counts.
+    uint64_t topology = kNoTopology;
+    //Optional on the first frame of a new topology: where each vertex of
+    //the previous frame lies on this frame's surface, see
+    //correspondence.h. Tracked points are then carried over instead of
+    //searched for.
+    const VertexCorrespondence* fromPrevious = nullptr;
+};
+
+//Everything the engine carries from one frame to the next, as plain
+//arrays, so a track can be saved and carried on later. See checkpoint.h.
+struct TrackingState
+{
+    std::vector<std::vector<int>> vertexSets;
+    unsigned framesTracked = 0;
+    unsigned topologyChanges = 0;
+    //Topology of the last frame tracked.
+    uint64_t topology = kNoTopology;
+    unsigned numVertices = 0;
+    unsigned numTriangles = 0;
+
+    //Per tracked point, over all joints: MotionFilter::kStateSize doubles
+    //of filter, where the next search looks, the surface point, and up to
+    //3 anchor vertices and weights.
+    std::vector<double> filters;
+    std::vector<Vec3> projected;
+    std::vector<Vec3> positions;
+    std::vector<int> anchors;
+    std::vector<float> weights;
+    std::vector<uint8_t> anchored;
+
+    //Per joint.
+    std::vector<Vec3> jointPositions;
+    std::vector<Vec3> jointVelocities;
+    std::vector<Vec3> jointAccelerations;
+    std::vector<float> jointConfidence;
+    std::vector<uint8_t> jointHasPosition;
+    std::vector<uint8_t> jointTracked;
+};
+
+class TrackingEngine
+{
+public:
+    //Frames tracked by reading vertex IDs before switching to
+    //closest point tracking, matching jointRig's thirdFrame rule. The
+    //second is only read by ID if it keeps the first one's topology.
+    static const unsigned kSelectionFrames = 2;
+    //Standard deviations of prediction error the closest point search
+    //allows before it falls back to searching the whole mesh.
+    static const double kSearchSigmas;
+
+    explicit TrackingEngine(unsigned numThreads = 0);
+    //Runs on pool instead of a pool of its own, for engines that take
+    //turns tracking. pool must outlive the engine.
+    explicit TrackingEngine(ThreadPool& pool);
+
+    //One set of surface vertex IDs per joint, any number of them. Each
+    //joint is placed at the robustCentroid() of its tracked surface
+    //points. Also resets the track.
+    void setJoints(const std::vector<std::vector<int>>& vertexSets);
+    unsigned numJoints() const;
+    //Tracked surface points over all joints.
+    unsigned numPoints() const;
+    unsigned numThreads() const;
+
+    //Tracks the next frame of the sequence. next is only read during the
+    //first kSelectionFrames frames and may be empty on the last frame.
+    //While the topology is unchanged from the previous frame the tracked
+    //points are read by vertex ID; the surface is only searched on the
+    //first frame of a new topology, and only for joints that
+    //current.fromPrevious cannot carry over.
+    bool trackFrame(const TrackFrame& current, const TrackFrame& next);
+    unsigned framesTracked() const;
+    //Frames on which the topology differed from the frame before.
+    unsigned topologyChanges() const;
+
+    const Vec3& jointPosition(unsigned joint) const;
+    bool jointTracked(unsigned joint) const;
+    //Frame to frame motion of the joint position.
+    const Vec3& jointVelocity(unsigned joint) const;
+    const Vec3& jointAcceleration(unsigned joint) const;
+    //1 when every surface point was found where it was predicted to be,
+    //falling towards 0 as the mean miss grows relative to the spread of
+    //the joint's points. 0 when the joint lost track.
+    float jointConfidence(unsigned joint) const;
+    //How far from its prediction the joint's points are searched for on
+    //the next surface search, from the points' motion filters. Grows
+    //with motion the filters did not predict.
+    double jointSearchRadius(unsigned joint) const;
+    //This frame's surface point for each vertex of the joint's set,
+    //jointNumPoints() of them.
+    const Vec3* jointSurfacePoints(unsigned joint) const;
+    unsigned jointNumPoints(unsigned joint) const;
+    const std::vector<int>& jointVertexIds(unsigned joint) const;
+
+    //The track so far. Restoring sets the joints to the state's vertex
+    //sets and carries on from the frame after the last one tracked. A
+    //frame whose topology fingerprint matches the saved one carries on by
+    //vertex ID, anything else is searched for. Fails, leaving the engine
+    //as it was, when the state's arrays do not fit its vertex sets.
+    void saveState(TrackingState& state) const;
+    bool restoreState(const TrackingState& state);
+
+private:
+    //State of every tracked point of every joint, one array per field.
+    //Joint j owns points [m_jointStart[j], m_jointStart[j + 1]). Sized by
+    //setJoints(), so tracking a frame never allocates. Flags are bytes
+    //rather than std::vector<bool> so joints on different threads never
+    //share a word.
+    struct PointArrays
+    {
+        std::vector<int> vertexIds;
+        std::vector<MotionFilter> filters;
+        //Where the next surface search looks for each point.
+        std::vector<Vec3> projected;
+        //This frame's surface points, also as float x, y and z arrays
+        //for the joint estimate, which leaves its weights in robustWeights.
+        std::vector<Vec3> positions;
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+        std::vector<float> robustWeights;
+        //Where each point sits on the current topology, as weights of up
+        //to 3 vertices. Selected points are a single vertex.
+        std::vector<int> anchors;
+        std::vector<float> weights;
+        std::vector<uint8_t> anchored;
+        //Closest point query scratch: xyz, results and squared radii.
+        std::vector<float> queries;
+        std::vector<BvhHit> hits;
+        std::vector<float> radiiSq;
+    };
+
+    struct JointArrays
+    {
+        std::vector<Vec3> position;
+        std::vector<Vec3> velocity;
+        std::vector<Vec3> acceleration;
+        std::vector<float> confidence;
+        std::vector<unsigned> searchMisses;
+        std::vector<uint8_t> hasPosition;
+        std::vector<uint8_t> tracked;
+    };
+
+    //Data that stays valid for as long as the topology holds.
+    struct TopologyCache
+    {
+        uint64_t fingerprint = kNoTopology;
+        const int* triangles = nullptr;
+        unsigned numVertices = 0;
+        unsigned numTriangles = 0;
+        //Built on the first surface search of the topology.
+        MeshBvh bvh;
+        bool hasBvh = false;
+    };
+
+    //Reads the tracked points straight from their vertex IDs on the
+    //current frame and primes the prediction with the next frame.
+    bool trackBySelection();
+    //Reads the tracked points from the vertices they are anchored to.
+    bool trackByVertex();
+    //Moves every tracked point to the closest surface point to where it
+    //was predicted to be, anchors it there and predicts the next frame.
+    bool trackByClosest();
+    //Carries the anchors over a topology change through the
+    //correspondence map, searching for the joints it cannot carry.
+    bool trackByCorrespondence();
+    bool sameTopology(const TrackFrame& frame) const;
+    void setTopology(const TrackFrame& frame);
+    void updateIndex();
+
+    //Per joint steps, run in parallel on disjoint point ranges. They read
+    //the frames given to trackFrame() through m_current and m_next.
+    void selectJoint(unsigned joint);
+    void vertexJoint(unsigned joint);
+    void closestJoint(unsigned joint);
+    void carryJoint(unsigned joint);
+    void placeJoint(unsigned joint, double residual);
+    void anchorToVertex(unsigned point, int id);
+    void setPosition(unsigned point, const Vec3& position);
+    bool allTracked() const;
+
+    std::unique_ptr<ThreadPool> m_ownPool;
+    ThreadPool* m_pool;
+    std::vector<std::vector<int>> m_vertexSets;
+    std::vector<unsigned> m_jointStart;
+    PointArrays m_points;
+    JointArrays m_joints;
+    unsigned m_framesTracked = 0;
+    unsigned m_topologyChanges = 0;
+    TopologyCache m_topology;
+
+    //The frames being tracked, valid during trackFrame().
+    const TrackFrame* m_current = nullptr;
+    const TrackFrame* m_next = nullptr;
+    bool m_nextMatches = false;
+    //Joints trackByCorrespondence() could not carry.
+    std::vector<unsigned> m_uncarried;
+};
+
+#endif //TRACKERCORE_TRACKINGENGINE_H
@@ -0,0 +1,316 @@
+//
+// Binary file of tracked joint trajectories.
+//
+#include "trajectory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+void TrajectoryWriter::begin(double startFrame, unsigned numFrames, const std::vector<std::vector<int>>& vertexSets)
+{
+    m_startFrame = startFrame;
+    m_numFrames = numFrames;
+    m_vertexSets = vertexSets;
+    m_channels.assign(vertexSets.size(), std::vector<float>());
+
+    //Until a frame is recorded every joint counts as lost on it.
+    for (size_t j = 0; j < vertexSets.size(); j++)
+    {
+        size_t numColumns = kNumJointChannels + vertexSets[j].size() * 3;
+        m_channels[j].assign(numColumns * numFrames, std::numeric_limits<float>::quiet_NaN());
+        std::fill(m_channels[j].begin() + kConfidence * numFrames, m_channels[j].begin() + (kConfidence + 1) * numFrames,
+                  0.0f);
+    }
+}
+
+void TrajectoryWriter::recordFrame(unsigned frame, const TrackingEngine& engine)
+{
+    if (frame >= m_numFrames)
+        return;
+
+    for (unsigned j = 0; j < engine.numJoints() && j < m_channels.size(); j++)
+    {
+        if (!engine.jointTracked(j))
+            continue;
+
+        float* columns = m_channels[j].data() + frame;
+        const Vec3 values[] = {engine.jointPosition(j), engine.jointVelocity(j), engine.jointAcceleration(j)};
+        for (unsigned v = 0; v < 3; v++)
+        {
+            columns[(v * 3) * m_numFrames] = (float)values[v].x;
+            columns[(v * 3 + 1) * m_numFrames] = (float)values[v].y;
+            columns[(v * 3 + 2) * m_numFrames] = (float)values[v].z;
+        }
+        columns[kConfidence * m_numFrames] = engine.jointConfidence(j);
+
+        const Vec3* points = engine.jointSurfacePoints(j);
+        for (size_t p = 0; p < engine.jointNumPoints(j) && p < m_vertexSets[j].size(); p++)
+        {
+            float* point = columns + (kNumJointChannels + p * 3) * m_numFrames;
+            point[0] = (float)points[p].x;
+            point[m_numFrames] = (float)points[p].y;
+            point[2 * m_numFrames] = (float)points[p].z;
+        }
+    }
+}
+
+bool TrajectoryWriter::write(const std::string& path, std::string& error) const
+{
+    std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        error = "could not open " + path + " for writing";
+        return false;
+    }
+
+    TrajectoryHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kTrajectoryMagic, sizeof(kTrajectoryMagic));
+    header.version = kTrajectoryVersion;
+    header.numJoints = (uint32_t)m_vertexSets.size();
+    header.numFrames = m_numFrames;
+    header.startFrame = m_startFrame;
+
+    //Everything is a multiple of 4 bytes, so the columns stay aligned.
+    std::vector<TrajectoryJointEntry> entries(m_vertexSets.size());
+    uint64_t offset = sizeof(header) + sizeof(TrajectoryJointEntry) * entries.size();
+    for (size_t j = 0; j < entries.size(); j++)
+    {
+        std::memset(&entries[j], 0, sizeof(TrajectoryJointEntry));
+        entries[j].numPoints = (uint32_t)m_vertexSets[j].size();
+        entries[j].vertexIdsOffset = offset;
+        offset += sizeof(int32_t) * m_vertexSets[j].size();
+        entries[j].channelsOffset = offset;
+        offset += sizeof(float) * m_channels[j].size();
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries.data()), sizeof(TrajectoryJointEntry) * entries.size());
+    for (size_t j = 0; j < entries.size(); j++)
+    {
+        file.write(reinterpret_cast<const char*>(m_vertexSets[j].data()), sizeof(int32_t) * m_vertexSets[j].size());
+        file.write(reinterpret_cast<const char*>(m_channels[j].data()), sizeof(float) * m_channels[j].size());
+    }
+
+    if (!file)
+    {
+        error = "could not write " + path;
+        return false;
+    }
+    return true;
+}
+
+double TrajectoryWriter::startFrame() const
+{
+    return m_startFrame;
+}
+
+unsigned TrajectoryWriter::numFrames() const
+{
+    return m_numFrames;
+}
+
+const std::vector<std::vector<int>>& TrajectoryWriter::vertexSets() const
+{
+    return m_vertexSets;
+}
+
+Vec3 TrajectoryWriter::position(unsigned joint, unsigned frame) const
+{
+    const float* columns = m_channels[joint].data() + frame;
+    return Vec3(columns[kPositionX * m_numFrames], columns[kPositionY * m_numFrames], columns[kPositionZ * m_numFrames]);
+}
+
+bool TrajectoryWriter::tracked(unsigned joint, unsigned frame) const
+{
+    return !std::isnan(m_channels[joint][kPositionX * m_numFrames + frame]);
+}
+
+std::vector<float>& TrajectoryWriter::columns(unsigned joint)
+{
+    return m_channels[joint];
+}
+
+const std::vector<float>& TrajectoryWriter::columns(unsigned joint) const
+{
+    return m_channels[joint];
+}
+
+bool TrajectoryReader::open(const std::string& path)
+{
+    close();
+    if (!m_file.open(path, m_error))
+        return false;
+
+    if (m_file.size() < sizeof(m_header))
+        return fail(path + " is not a trajectory file");
+    std::memcpy(&m_header, m_file.data(), sizeof(m_header));
+    if (std::memcmp(m_header.magic, kTrajectoryMagic, sizeof(kTrajectoryMagic)) != 0)
+        return fail(path + " is not a trajectory file");
+    if (m_header.version != kTrajectoryVersion)
+        return fail(path + " has an unsupported trajectory version");
+
+    uint64_t tableSize = sizeof(TrajectoryJointEntry) * (uint64_t)m_header.numJoints;
+    if (tableSize > m_file.size() - sizeof(m_header))
+        return fail(path + " has a truncated joint table");
+    m_joints.resize(m_header.numJoints);
+    std::memcpy(m_joints.data(), m_file.data() + sizeof(m_header), (size_t)tableSize);
+
+    for (const TrajectoryJointEntry& joint : m_joints)
+    {
+        uint64_t columnsSize = sizeof(float) * (uint64_t)m_header.numFrames * (kNumJointChannels + joint.numPoints * 3);
+        if (joint.vertexIdsOffset % 4 != 0 || joint.channelsOffset % 4 != 0
+            || joint.vertexIdsOffset + sizeof(int32_t) * (uint64_t)joint.numPoints > m_file.size()
+            || joint.channelsOffset + columnsSize > m_file.size())
+            return fail(path + " has a truncated joint");
+    }
+    return true;
+}
+
+void TrajectoryReader::close()
+{
+    m_file.close();
+    m_joints.clear();
+    m_error.clear();
+}
+
+unsigned TrajectoryReader::numJoints() const
+{
+    return (unsigned)m_joints.size();
+}
+
+unsigned TrajectoryReader::numFrames() const
+{
+    return m_header.numFrames;
+}
+
+double TrajectoryReader::startFrame() const
+{
+    return m_header.startFrame;
+}
+
+unsigned TrajectoryReader::numPoints(unsigned joint) const
+{
+    return m_joints[joint].numPoints;
+}
+
+const int32_t* TrajectoryReader::vertexIds(unsigned joint) const
+{
+    return reinterpret_cast<const int32_t*>(m_file.data() + m_joints[joint].vertexIdsOffset);
+}
+
+const float* TrajectoryReader::channel(unsigned joint, TrajectoryChannel channel) const
+{
+    return column(joint, channel);
+}
+
+const float* TrajectoryReader::surfacePoint(unsigned joint, unsigned point, unsigned axis) const
+{
+    return column(joint, kNumJointChannels + point * 3 + axis);
+}
+
+Vec3 TrajectoryReader::position(unsigned joint, unsigned frame) const
+{
+    return Vec3(column(joint, kPositionX)[frame], column(joint, kPositionY)[frame], column(joint, kPositionZ)[frame]);
+}
+
+bool TrajectoryReader::tracked(unsigned joint, unsigned frame) const
+{
+    return !std::isnan(column(joint, kPositionX)[frame]);
+}
+
+const std::string& TrajectoryReader::error() const
+{
+    return m_error;
+}
+
+bool TrajectoryReader::fail(const std::string& message)
+{
+    m_error = message;
+    m_file.close();
+    m_joints.clear();
+    return false;
+}
+
+const float* TrajectoryReader::column(unsigned joint, unsigned column) const
+{
+    const float* columns = reinterpret_cast<const float*>(m_file.data() + m_joints[joint].channelsOffset);
+    return columns + (uint64_t)column * m_header.numFrames;
+}
+
+bool stitchTrajectories(const std::vector<std::string>& paths, const std::string& output, std::string& error)
+{
+    if (paths.empty())
+    {
+        error = "no trajectories to stitch";
+        return false;
+    }
+
+    std::vector<TrajectoryReader> parts(paths.size());
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        if (!parts[i].open(paths[i]))
+        {
+            error = parts[i].error();
+            return false;
+        }
+    }
+
+    //Every part has to track the same points.
+    std::vector<std::vector<int>> sets;
+    for (unsigned j = 0; j < parts[0].numJoints(); j++)
+        sets.push_back(std::vector<int>(parts[0].vertexIds(j), parts[0].vertexIds(j) + parts[0].numPoints(j)));
+    double first = parts[0].startFrame();
+    double end = first + parts[0].numFrames();
+    for (size_t i = 1; i < parts.size(); i++)
+    {
+        bool same = parts[i].numJoints() == sets.size();
+        for (unsigned j = 0; same && j < sets.size(); j++)
+            same = parts[i].numPoints(j) == sets[j].size()
+                && std::equal(sets[j].begin(), sets[j].end(), parts[i].vertexIds(j));
+        if (!same)
+        {
+            error = paths[i] + " was tracked with other vertex sets than " + paths[0];
+            return false;
+        }
+        first = std::min(first, parts[i].startFrame());
+        end = std::max(end, parts[i].startFrame() + parts[i].numFrames());
+    }
+
+    TrajectoryWriter stitched;
+    unsigned numFrames = (unsigned)(end - first);
+    stitched.begin(first, numFrames, sets);
+    std::vector<double> sums;
+    for (unsigned j = 0; j < sets.size(); j++)
+    {
+        std::vector<float>& columns = stitched.columns(j);
+        unsigned numColumns = kNumJointChannels + (unsigned)sets[j].size() * 3;
+        for (unsigned f = 0; f < numFrames; f++)
+        {
+            sums.assign(numColumns, 0);
+            double totalWeight = 0;
+            for (const TrajectoryReader& part : parts)
+            {
+                double offset = first + f - part.startFrame();
+                if (offset < 0 || offset >= part.numFrames() || !part.tracked(j, (unsigned)offset))
+                    continue;
+
+                unsigned frame = (unsigned)offset;
+                double weight = std::min(frame + 1, part.numFrames() - frame);
+                const float* partColumns = part.channel(j, kPositionX);
+                for (unsigned c = 0; c < numColumns; c++)
+                    sums[c] += weight * partColumns[(uint64_t)c * part.numFrames() + frame];
+                totalWeight += weight;
+            }
+            if (totalWeight == 0)
+                continue;
+            for (unsigned c = 0; c < numColumns; c++)
+                columns[(size_t)c * numFrames + f] = (float)(sums[c] / totalWeight);
+        }
+    }
+
+    return stitched.write(output, error);
+}
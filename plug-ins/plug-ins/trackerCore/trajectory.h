@@ -0,0 +1,131 @@
+//
+// Binary file of tracked joint trajectories, laid out column by column so
+// a reader can map it and pull one channel of one joint for the whole
+// take without touching the rest.
+//
+// Layout (little endian):
+//   TrajectoryHeader
+//   TrajectoryJointEntry table, one per joint
+//   per joint: numPoints int32 vertex IDs, then the joint's channels,
+//              each numFrames floats: kNumJointChannels joint channels
+//              followed by x, y, z of every surface point
+//
+// Frames where a joint lost track hold NaN positions and 0 confidence.
+//
+#ifndef TRACKERCORE_TRAJECTORY_H
+#define TRACKERCORE_TRAJECTORY_H
+
+#include "mappedFile.h"
+#include "trackingEngine.h"
+#include "vec3.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+const char kTrajectoryMagic[4] = {'V', 'J', 'T', 'R'};
+const uint32_t kTrajectoryVersion = 1;
+
+enum TrajectoryChannel
+{
+    kPositionX,
+    kPositionY,
+    kPositionZ,
+    kVelocityX,
+    kVelocityY,
+    kVelocityZ,
+    kAccelerationX,
+    kAccelerationY,
+    kAccelerationZ,
+    kConfidence,
+    kNumJointChannels
+};
+
+struct TrajectoryHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t numJoints;
+    uint32_t numFrames;
+    //Scene frame number of the first frame.
+    double startFrame;
+    uint64_t reserved;
+};
+
+struct TrajectoryJointEntry
+{
+    uint64_t vertexIdsOffset;
+    uint64_t channelsOffset;
+    uint32_t numPoints;
+    uint32_t reserved;
+};
+
+//Collects a take in memory and writes it out in one go.
+class TrajectoryWriter
+{
+public:
+    //Frames are numbered from 0 at startFrame.
+    void begin(double startFrame, unsigned numFrames, const std::vector<std::vector<int>>& vertexSets);
+    //Records every joint of the engine's last tracked frame.
+    void recordFrame(unsigned frame, const TrackingEngine& engine);
+    bool write(const std::string& path, std::string& error) const;
+
+    double startFrame() const;
+    unsigned numFrames() const;
+    const std::vector<std::vector<int>>& vertexSets() const;
+    //Frames are numbered from 0 at startFrame.
+    Vec3 position(unsigned joint, unsigned frame) const;
+    bool tracked(unsigned joint, unsigned frame) const;
+    //Every channel of a joint, numFrames() floats each in file order, for
+    //saving the frames recorded so far in a checkpoint and for stitching.
+    std::vector<float>& columns(unsigned joint);
+    const std::vector<float>& columns(unsigned joint) const;
+
+private:
+    double m_startFrame = 0;
+    unsigned m_numFrames = 0;
+    std::vector<std::vector<int>> m_vertexSets;
+    //Per joint, channel after channel of numFrames floats.
+    std::vector<std::vector<float>> m_channels;
+};
+
+class TrajectoryReader
+{
+public:
+    bool open(const std::string& path);
+    void close();
+
+    unsigned numJoints() const;
+    unsigned numFrames() const;
+    double startFrame() const;
+    unsigned numPoints(unsigned joint) const;
+    const int32_t* vertexIds(unsigned joint) const;
+
+    //numFrames values of one channel, straight from the mapped file.
+    const float* channel(unsigned joint, TrajectoryChannel channel) const;
+    //numFrames values of one axis (0 to 2) of one surface point.
+    const float* surfacePoint(unsigned joint, unsigned point, unsigned axis) const;
+
+    Vec3 position(unsigned joint, unsigned frame) const;
+    bool tracked(unsigned joint, unsigned frame) const;
+
+    const std::string& error() const;
+
+private:
+    bool fail(const std::string& message);
+    const float* column(unsigned joint, unsigned column) const;
+
+    MappedFile m_file;
+    TrajectoryHeader m_header = TrajectoryHeader();
+    std::vector<TrajectoryJointEntry> m_joints;
+    std::string m_error;
+};
+
+//Joins trajectories of parts of one take, tracked separately with the
+//same vertex sets, into one covering all of them. Where parts overlap,
+//each frame is a blend weighted by how far it is from the nearer end of
+//each part, so the result crossfades from one part to the next. A part
+//that lost a joint on a frame does not count for it.
+bool stitchTrajectories(const std::vector<std::string>& paths, const std::string& output, std::string& error);
+
+#endif //TRACKERCORE_TRAJECTORY_H
@@ -0,0 +1,31 @@
+//
+// Minimal double precision 3D vector used throughout trackerCore in place
+// of MPoint/MVector.
+//
+#ifndef TRACKERCORE_VEC3_H
+#define TRACKERCORE_VEC3_H
+
+#include <cmath>
+
+struct Vec3
+{
+    double x = 0;
+    double y = 0;
+    double z = 0;
+
+    Vec3() {}
+    Vec3(double x, double y, double z) : x(x), y(y), z(z) {}
+
+    Vec3 operator+(const Vec3& o) const { return Vec3(x + o.x, y + o.y, z + o.z); }
+    Vec3 operator-(const Vec3& o) const { return Vec3(x - o.x, y - o.y, z - o.z); }
+    Vec3 operator*(double s) const { return Vec3(x * s, y * s, z * s); }
+    Vec3 operator/(double s) const { return Vec3(x / s, y / s, z / s); }
+    Vec3& operator+=(const Vec3& o) { x += o.x; y += o.y; z += o.z; return *this; }
+    Vec3& operator-=(const Vec3& o) { x -= o.x; y -= o.y; z -= o.z; return *this; }
+
+    double dot(const Vec3& o) const { return x * o.x + y * o.y + z * o.z; }
+    Vec3 cross(const Vec3& o) const { return Vec3(y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x); }
+    double length() const { return std::sqrt(dot(*this)); }
+};
+
+#endif //TRACKERCORE_VEC3_H
@@ -0,0 +1,78 @@
+//
+// Text file holding the vertex sets that define the tracked joints.
+//
+#include "vertexSets.h"
+
+#include <fstream>
+#include <sstream>
+
+bool readVertexSets(const std::string& path, std::vector<std::vector<int>>& sets, std::string& error)
+{
+    std::ifstream file(path.c_str());
+    if (!file)
+    {
+        error = "could not open " + path;
+        return false;
+    }
+
+    sets.clear();
+    std::string line;
+    unsigned lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#')
+            continue;
+
+        std::istringstream ids(line);
+        std::vector<int> set;
+        int id;
+        while (ids >> id)
+            set.push_back(id);
+
+        if (!ids.eof() || set.empty())
+        {
+            std::ostringstream message;
+            message << path << ":" << lineNumber << ": expected vertex IDs";
+            error = message.str();
+            return false;
+        }
+        sets.push_back(set);
+    }
+    return true;
+}
+
+bool writeVertexSets(const std::string& path, const std::vector<std::vector<int>>& sets, std::string& error)
+{
+    std::ofstream file(path.c_str());
+    if (!file)
+    {
+        error = "could not open " + path + " for writing";
+        return false;
+    }
+
+    file << "# One joint per line: the vertex IDs tracked for it.\n";
+    for (const std::vector<int>& set : sets)
+    {
+        for (size_t i = 0; i < set.size(); i++)
+            file << (i > 0 ? " " : "") << set[i];
+        file << "\n";
+    }
+
+    if (!file)
+    {
+        error = "could not write " + path;
+        return false;
+    }
+    return true;
+}
+
+std::string vertexSetsPath(const std::string& cachePath)
+{
+    size_t extension = cachePath.find_last_of('.');
+    size_t directory = cachePath.find_last_of("/\\");
+    if (extension == std::string::npos || (directory != std::string::npos && extension < directory))
+        extension = cachePath.size();
+    return cachePath.substr(0, extension) + ".sets";
+}
@@ -0,0 +1,19 @@
+//
+// Text file holding the vertex sets that define the tracked joints, one
+// joint per line as whitespace separated vertex IDs. Lines starting with
+// '#' are comments.
+//
+#ifndef TRACKERCORE_VERTEXSETS_H
+#define TRACKERCORE_VERTEXSETS_H
+
+#include <string>
+#include <vector>
+
+bool readVertexSets(const std::string& path, std::vector<std::vector<int>>& sets, std::string& error);
+bool writeVertexSets(const std::string& path, const std::vector<std::vector<int>>& sets, std::string& error);
+
+//Where the sets of a point cache live: the cache path with its extension
+//replaced by .sets.
+std::string vertexSetsPath(const std::string& cachePath);
+
+#endif //TRACKERCORE_VERTEXSETS_H